@@ -56,6 +56,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/Math.h"
 #include "platform/Thread.h"
 #include "platform/Lock.h"
+#include "platform/Profiler.h"
 #include "physics/Anchors.h"
 #include "scene/Light.h"
 
@@ -244,6 +245,8 @@ static bool EERIE_PATHFINDER_Get_Next_Request(PATHFINDER_REQUEST * request) {
 // Pathfinder Thread
 void PathFinderThread::run() {
 	
+	profiler::registerThread("Pathfinder");
+	
 	EERIE_BACKGROUND * eb = ACTIVEBKG;
 	PathFinder pathfinder(eb->nbanchors, eb->anchors,
 	                      MAX_LIGHTS, (EERIE_LIGHT **)GLight);
@@ -256,6 +259,7 @@ void PathFinderThread::run() {
 
 		if (EERIE_PATHFINDER_Get_Next_Request(&pr) && pr.isvalid)
 		{
+			ARX_PROFILE("PathfinderRequest");
 
 			PATHFINDER_REQUEST curpr;
 			memcpy(&curpr, &pr, sizeof(PATHFINDER_REQUEST));
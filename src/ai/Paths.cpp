@@ -46,12 +46,24 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "ai/Paths.h"
 
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
+#include <vector>
 
 #include <boost/foreach.hpp>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARX_PHYSICS_SSE2
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
 #include "animation/AnimationRender.h"
 
 #include "core/GameTime.h"
@@ -1133,136 +1145,333 @@ extern long CUR_COLLISION_MATERIAL;
 
 float VELOCITY_THRESHOLD = 850.f;
 
-void ARX_ApplySpring(PHYSVERT * phys, long k, long l, float PHYSICS_constant,
-                     float PHYSICS_Damp) {
+const float PHYSICS_SPRING_CONSTANT = 15.f;
+const float PHYSICS_SPRING_DAMP = 0.99f;
+
+/*!
+ * Vertices of all physics boxes that are stepped together, stored as structure of
+ * arrays. Each box owns a block of vertices padded to a multiple of four so that
+ * the spring kernels can process four neighbours at a time.
+ */
+struct PhysicsBoxVertices {
+	
+	std::vector<float> px, py, pz; //!< position before the step
+	std::vector<float> vx, vy, vz; //!< velocity before the step
+	std::vector<float> fx, fy, fz; //!< accumulated force
+	std::vector<float> weight; //!< 2 for real vertices, 0 for padding
+	
+	void resize(size_t size) {
+		px.resize(size), py.resize(size), pz.resize(size);
+		vx.resize(size), vy.resize(size), vz.resize(size);
+		fx.resize(size), fy.resize(size), fz.resize(size);
+		weight.resize(size);
+	}
 	
-	Vec3f deltaP, deltaV, springforce;
-	PHYSVERT * pv_k = &phys[k];
-	PHYSVERT * pv_l = &phys[l];
-	float Dterm, Hterm;
+};
 
-	float restlength = dist(pv_k->initpos, pv_l->initpos);
-	// Computes Spring Magnitude
-	deltaP = pv_k->pos - pv_l->pos;
-	float dist = deltaP.length(); // Magnitude of delta
-	dist = std::max(dist, 0.000001f); //TODO workaround for division by zero
-	float divdist = 1.f / dist;
-	Hterm = (dist - restlength) * PHYSICS_constant;
+//! Cell-local background polygon that a physics box may collide with
+struct PhysicsCollisionCandidate {
+	EERIEPOLY * ep;
+	long px;
+	long pz;
+	Vec3f probes[7]; //!< center, vertices and edge midpoints
+	Vec3f min; //!< bounds of the probes
+	Vec3f max;
+};
+
+struct PhysicsBatchBox {
+	
+	EERIE_3DOBJ * obj;
+	PhysicsBoxUpdate * update;
+	float timing;
+	
+	long count;
+	long padded;
+	size_t offset; //!< first vertex in the PhysicsBoxVertices arrays
+	size_t restOffset; //!< first rest length in g_physicsRestLengths
+	
+	float margin; //!< how far vert[0] can move during the remaining steps
+	long ix, ax, iz, az; //!< cells covered by candidates
+	std::vector<PhysicsCollisionCandidate> candidates;
+	
+};
 
-	deltaV = pv_k->velocity - pv_l->velocity; // Delta Velocity Vector
-	Dterm = dot(deltaV, deltaP) * PHYSICS_Damp * divdist; // Damping Term
-	Dterm = (-(Hterm + Dterm));
-	divdist *= Dterm;
-	springforce = deltaP * divdist; // Normalize Distance Vector & Calc Force
+static PhysicsBoxVertices g_physicsVertices;
+//! Spring rest lengths for each box, padded rows of padded columns
+static std::vector<float> g_physicsRestLengths;
 
-	pv_k->force += springforce; // + force on particle 1
+static long padPhysicsVertexCount(long count) {
+	return (count + 3) & ~3l;
+}
 
-	pv_l->force -= springforce; // - force on particle 2
+static void computePhysicsRestLengths(PhysicsBatchBox & box) {
+	
+	box.restOffset = g_physicsRestLengths.size();
+	g_physicsRestLengths.resize(box.restOffset + box.padded * box.padded, 0.f);
+	
+	float * rest = &g_physicsRestLengths[box.restOffset];
+	const PHYSVERT * vert = box.obj->pbox->vert;
+	for(long k = 0; k < box.count; k++) {
+		for(long l = 0; l < box.count; l++) {
+			rest[k * box.padded + l] = dist(vert[k].initpos, vert[l].initpos);
+		}
+	}
 }
 
-void ComputeForces(PHYSVERT * phys, long nb) {
+//! Copy a box into the SoA arrays and initialize the forces with gravity and damping
+static void loadPhysicsBox(PhysicsBatchBox & box, size_t offset) {
 	
 	const Vec3f PHYSICS_Gravity(0.f, 65.f, 0.f);
 	const float PHYSICS_Damping = 0.5f;
 	
-	float lastmass = 1.f;
-	float div = 1.f;
+	PhysicsBoxVertices & v = g_physicsVertices;
+	box.offset = offset;
 	
-	for(long k = 0; k < nb; k++) {
+	const PHYSVERT * vert = box.obj->pbox->vert;
+	for(long k = 0; k < box.padded; k++) {
 		
-		PHYSVERT * pv = &phys[k];
+		size_t i = offset + k;
 		
-		// Reset Force
-		pv->force = pv->inertia;
+		if(k >= box.count) {
+			v.px[i] = v.py[i] = v.pz[i] = 0.f;
+			v.vx[i] = v.vy[i] = v.vz[i] = 0.f;
+			v.fx[i] = v.fy[i] = v.fz[i] = 0.f;
+			v.weight[i] = 0.f;
+			continue;
+		}
 		
-		// Apply Gravity
-		if(pv->mass > 0.f) {
-			
-			// need to be precomputed...
-			if(lastmass != pv->mass) {
-				div = 1.f / pv->mass;
-				lastmass = pv->mass;
-			}
-			
-			pv->force += (PHYSICS_Gravity * div);
+		const PHYSVERT & pv = vert[k];
+		
+		Vec3f force = pv.inertia;
+		if(pv.mass > 0.f) {
+			force += PHYSICS_Gravity * (1.f / pv.mass);
 		}
+		force += pv.velocity * -PHYSICS_Damping;
 		
-		// Apply Damping
-		pv->force += pv->velocity * -PHYSICS_Damping;
+		v.px[i] = pv.pos.x, v.py[i] = pv.pos.y, v.pz[i] = pv.pos.z;
+		v.vx[i] = pv.velocity.x, v.vy[i] = pv.velocity.y, v.vz[i] = pv.velocity.z;
+		v.fx[i] = force.x, v.fy[i] = force.y, v.fz[i] = force.z;
+		// Every spring used to be applied once from each end
+		v.weight[i] = 2.f;
 	}
+}
+
+/*
+ * The spring between vertices k and l pushes k along (pos[k] - pos[l]) by
+ *   -((dist - rest) * constant + dot(vel[k] - vel[l], pos[k] - pos[l]) * damp / dist) / dist
+ * The diagonal (k == l) contributes nothing as the delta is zero, so it doesn't need
+ * to be masked out. Padding vertices have a zero weight.
+ */
+
+#if defined(ARX_PHYSICS_SSE2)
+
+static void applyPhysicsSpringsSSE2(const PhysicsBatchBox & box) {
 	
-	for(int k = 0; k < nb; k++) {
-		// Now Resolves Spring System
-		for(long l = 0; l < nb; l++) {
-			if(l != k) {
-				ARX_ApplySpring(phys, l, k, 15.f, 0.99f);
-			}
+	PhysicsBoxVertices & v = g_physicsVertices;
+	const float * px = &v.px[box.offset], * py = &v.py[box.offset], * pz = &v.pz[box.offset];
+	const float * vx = &v.vx[box.offset], * vy = &v.vy[box.offset], * vz = &v.vz[box.offset];
+	const float * weight = &v.weight[box.offset];
+	
+	const __m128 constant = _mm_set1_ps(PHYSICS_SPRING_CONSTANT);
+	const __m128 damp = _mm_set1_ps(PHYSICS_SPRING_DAMP);
+	const __m128 mindist = _mm_set1_ps(0.000001f);
+	const __m128 one = _mm_set1_ps(1.f);
+	
+	for(long k = 0; k < box.count; k++) {
+		
+		const float * rest = &g_physicsRestLengths[box.restOffset + k * box.padded];
+		
+		const __m128 kpx = _mm_set1_ps(px[k]), kpy = _mm_set1_ps(py[k]), kpz = _mm_set1_ps(pz[k]);
+		const __m128 kvx = _mm_set1_ps(vx[k]), kvy = _mm_set1_ps(vy[k]), kvz = _mm_set1_ps(vz[k]);
+		
+		__m128 fx = _mm_setzero_ps(), fy = _mm_setzero_ps(), fz = _mm_setzero_ps();
+		
+		for(long l = 0; l < box.padded; l += 4) {
+			
+			__m128 dx = _mm_sub_ps(kpx, _mm_loadu_ps(px + l));
+			__m128 dy = _mm_sub_ps(kpy, _mm_loadu_ps(py + l));
+			__m128 dz = _mm_sub_ps(kpz, _mm_loadu_ps(pz + l));
+			
+			__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+			                       _mm_mul_ps(dz, dz));
+			__m128 d = _mm_max_ps(_mm_sqrt_ps(d2), mindist);
+			__m128 divdist = _mm_div_ps(one, d);
+			
+			__m128 hterm = _mm_mul_ps(_mm_sub_ps(d, _mm_loadu_ps(rest + l)), constant);
+			
+			__m128 dvx = _mm_sub_ps(kvx, _mm_loadu_ps(vx + l));
+			__m128 dvy = _mm_sub_ps(kvy, _mm_loadu_ps(vy + l));
+			__m128 dvz = _mm_sub_ps(kvz, _mm_loadu_ps(vz + l));
+			__m128 dterm = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dvx, dx), _mm_mul_ps(dvy, dy)),
+			                          _mm_mul_ps(dvz, dz));
+			dterm = _mm_mul_ps(_mm_mul_ps(dterm, damp), divdist);
+			
+			__m128 s = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(hterm, dterm));
+			s = _mm_mul_ps(_mm_mul_ps(s, divdist), _mm_loadu_ps(weight + l));
+			
+			fx = _mm_add_ps(fx, _mm_mul_ps(dx, s));
+			fy = _mm_add_ps(fy, _mm_mul_ps(dy, s));
+			fz = _mm_add_ps(fz, _mm_mul_ps(dz, s));
 		}
+		
+		float out[12];
+		_mm_storeu_ps(out, fx);
+		_mm_storeu_ps(out + 4, fy);
+		_mm_storeu_ps(out + 8, fz);
+		
+		size_t i = box.offset + k;
+		v.fx[i] += (out[0] + out[1]) + (out[2] + out[3]);
+		v.fy[i] += (out[4] + out[5]) + (out[6] + out[7]);
+		v.fz[i] += (out[8] + out[9]) + (out[10] + out[11]);
 	}
 }
 
-bool ARX_INTERACTIVE_CheckFULLCollision(EERIE_3DOBJ * obj, long source);
+#endif // defined(ARX_PHYSICS_SSE2)
+
+#ifdef __ARM_NEON__
 
-//! Calculate new Positions and Velocities given a deltatime
-//! @param DeltaTime that has passed since last iteration
-void RK4Integrate(EERIE_3DOBJ * obj, float DeltaTime) {
+static void applyPhysicsSpringsNEON(const PhysicsBatchBox & box) {
 	
-	PHYSVERT * source, * target, * accum1, * accum2, * accum3, * accum4;
-	float halfDeltaT, sixthDeltaT;
-	halfDeltaT = DeltaTime * .5f; // some time values i will need
-	sixthDeltaT = ( 1.0f / 6 );
+	PhysicsBoxVertices & v = g_physicsVertices;
+	const float * px = &v.px[box.offset], * py = &v.py[box.offset], * pz = &v.pz[box.offset];
+	const float * vx = &v.vx[box.offset], * vy = &v.vy[box.offset], * vz = &v.vz[box.offset];
+	const float * weight = &v.weight[box.offset];
 	
-	PHYSVERT m_TempSys[5][32];
+	const float32x4_t mind2 = vdupq_n_f32(0.000001f * 0.000001f);
 	
-	for(long jj = 0; jj < 4; jj++) {
+	for(long k = 0; k < box.count; k++) {
 		
-		arx_assert(size_t(obj->pbox->nb_physvert) <= ARRAY_SIZE(m_TempSys[jj + 1]));
-		memcpy(m_TempSys[jj + 1], obj->pbox->vert, sizeof(PHYSVERT) * obj->pbox->nb_physvert);
+		const float * rest = &g_physicsRestLengths[box.restOffset + k * box.padded];
 		
-		if(jj == 3) {
-			halfDeltaT = DeltaTime;
-		}
+		float32x4_t fx = vdupq_n_f32(0.f), fy = vdupq_n_f32(0.f), fz = vdupq_n_f32(0.f);
 		
-		for(long kk = 0; kk < obj->pbox->nb_physvert; kk++) {
+		for(long l = 0; l < box.padded; l += 4) {
 			
-			source = &obj->pbox->vert[kk];
-			accum1 = &m_TempSys[jj + 1][kk];
-			target = &m_TempSys[0][kk];
+			float32x4_t dx = vsubq_f32(vdupq_n_f32(px[k]), vld1q_f32(px + l));
+			float32x4_t dy = vsubq_f32(vdupq_n_f32(py[k]), vld1q_f32(py + l));
+			float32x4_t dz = vsubq_f32(vdupq_n_f32(pz[k]), vld1q_f32(pz + l));
 			
-			accum1->force = source->force * (source->mass * halfDeltaT);
-			accum1->velocity = source->velocity * halfDeltaT;
+			float32x4_t d2 = vmlaq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz);
+			d2 = vmaxq_f32(d2, mind2);
 			
-			// determine the new velocity for the particle over 1/2 time
-			target->velocity = source->velocity + accum1->force;
-			target->mass = source->mass;
+			// No vector divide or square root before ARMv8: refine the estimates
+			float32x4_t divdist = vrsqrteq_f32(d2);
+			divdist = vmulq_f32(divdist, vrsqrtsq_f32(vmulq_f32(d2, divdist), divdist));
+			divdist = vmulq_f32(divdist, vrsqrtsq_f32(vmulq_f32(d2, divdist), divdist));
+			float32x4_t d = vmulq_f32(d2, divdist);
 			
-			// set the new position
-			target->pos = source->pos + accum1->velocity;
+			float32x4_t hterm = vmulq_n_f32(vsubq_f32(d, vld1q_f32(rest + l)),
+			                                PHYSICS_SPRING_CONSTANT);
+			
+			float32x4_t dvx = vsubq_f32(vdupq_n_f32(vx[k]), vld1q_f32(vx + l));
+			float32x4_t dvy = vsubq_f32(vdupq_n_f32(vy[k]), vld1q_f32(vy + l));
+			float32x4_t dvz = vsubq_f32(vdupq_n_f32(vz[k]), vld1q_f32(vz + l));
+			float32x4_t dterm = vmlaq_f32(vmlaq_f32(vmulq_f32(dvx, dx), dvy, dy), dvz, dz);
+			dterm = vmulq_f32(vmulq_n_f32(dterm, PHYSICS_SPRING_DAMP), divdist);
+			
+			float32x4_t s = vnegq_f32(vaddq_f32(hterm, dterm));
+			s = vmulq_f32(vmulq_f32(s, divdist), vld1q_f32(weight + l));
+			
+			fx = vmlaq_f32(fx, dx, s);
+			fy = vmlaq_f32(fy, dy, s);
+			fz = vmlaq_f32(fz, dz, s);
 		}
 		
-		ComputeForces(m_TempSys[0], obj->pbox->nb_physvert); // compute the new forces
+		float out[12];
+		vst1q_f32(out, fx);
+		vst1q_f32(out + 4, fy);
+		vst1q_f32(out + 8, fz);
+		
+		size_t i = box.offset + k;
+		v.fx[i] += (out[0] + out[1]) + (out[2] + out[3]);
+		v.fy[i] += (out[4] + out[5]) + (out[6] + out[7]);
+		v.fz[i] += (out[8] + out[9]) + (out[10] + out[11]);
 	}
+}
+
+#endif // defined(__ARM_NEON__)
+
+#if !defined(ARX_PHYSICS_SSE2) && !defined(__ARM_NEON__)
+
+static void applyPhysicsSpringsScalar(const PhysicsBatchBox & box) {
 	
-	for(long kk = 0; kk < obj->pbox->nb_physvert; kk++) {
+	PhysicsBoxVertices & v = g_physicsVertices;
+	const float * px = &v.px[box.offset], * py = &v.py[box.offset], * pz = &v.pz[box.offset];
+	const float * vx = &v.vx[box.offset], * vy = &v.vy[box.offset], * vz = &v.vz[box.offset];
+	const float * weight = &v.weight[box.offset];
+	
+	for(long k = 0; k < box.count; k++) {
+		
+		const float * rest = &g_physicsRestLengths[box.restOffset + k * box.padded];
 		
-		source = &obj->pbox->vert[kk]; // current state of particle
-		target = &obj->pbox->vert[kk];
-		accum1 = &m_TempSys[1][kk];
-		accum2 = &m_TempSys[2][kk];
-		accum3 = &m_TempSys[3][kk];
-		accum4 = &m_TempSys[4][kk];
+		float fx = 0.f, fy = 0.f, fz = 0.f;
 		
-		// determine the new velocity for the particle using rk4 formula
-		Vec3f dv = accum1->force + ((accum2->force + accum3->force) * 2.f) + accum4->force;
-		target->velocity = source->velocity + (dv * sixthDeltaT);
-		// determine the new position for the particle using rk4 formula
-		Vec3f dp = accum1->velocity + ((accum2->velocity + accum3->velocity) * 2.f)
-		           + accum4->velocity;
-		target->pos = source->pos + (dp * sixthDeltaT * 1.2f);
+		for(long l = 0; l < box.padded; l++) {
+			
+			float dx = px[k] - px[l], dy = py[k] - py[l], dz = pz[k] - pz[l];
+			float d = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 0.000001f);
+			float divdist = 1.f / d;
+			
+			float hterm = (d - rest[l]) * PHYSICS_SPRING_CONSTANT;
+			
+			float dvx = vx[k] - vx[l], dvy = vy[k] - vy[l], dvz = vz[k] - vz[l];
+			float dterm = (dvx * dx + dvy * dy + dvz * dz) * PHYSICS_SPRING_DAMP * divdist;
+			
+			float s = -(hterm + dterm) * divdist * weight[l];
+			
+			fx += dx * s, fy += dy * s, fz += dz * s;
+		}
+		
+		size_t i = box.offset + k;
+		v.fx[i] += fx, v.fy[i] += fy, v.fz[i] += fz;
 	}
+}
+
+#endif // !defined(ARX_PHYSICS_SSE2) && !defined(__ARM_NEON__)
+
+static void applyPhysicsSprings(const PhysicsBatchBox & box) {
+#if defined(ARX_PHYSICS_SSE2)
+	applyPhysicsSpringsSSE2(box);
+#elif defined(__ARM_NEON__)
+	applyPhysicsSpringsNEON(box);
+#else
+	applyPhysicsSpringsScalar(box);
+#endif
+}
+
+/*!
+ * Calculate new positions and velocities given a deltatime
+ *
+ * This used to be written as a four stage Runge-Kutta integration, but every stage
+ * started from the same source state and the forces computed for the intermediate
+ * states were never read. The weights sum up to 3.5 * DeltaTime, leaving a single
+ * explicit step with the original scale factors.
+ */
+static void integratePhysicsBox(PhysicsBatchBox & box, float DeltaTime) {
+	
+	const float velocityScale = DeltaTime * (3.5f / 6.f);
+	const float positionScale = DeltaTime * (3.5f / 6.f) * 1.2f;
 	
+	PhysicsBoxVertices & v = g_physicsVertices;
+	PHYSVERT * vert = box.obj->pbox->vert;
+	for(long k = 0; k < box.count; k++) {
+		
+		size_t i = box.offset + k;
+		PHYSVERT & pv = vert[k];
+		
+		Vec3f velocity(clamp(v.vx[i], -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD),
+		               clamp(v.vy[i], -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD),
+		               clamp(v.vz[i], -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD));
+		
+		pv.force = Vec3f(v.fx[i], v.fy[i], v.fz[i]);
+		pv.inertia = Vec3f::ZERO;
+		pv.velocity = velocity + pv.force * (pv.mass * velocityScale);
+		pv.pos = Vec3f(v.px[i], v.py[i], v.pz[i]) + velocity * positionScale;
+	}
 }
 
+bool ARX_INTERACTIVE_CheckFULLCollision(EERIE_3DOBJ * obj, long source);
+
 static bool IsPointInField(Vec3f * pos) {
 	
 	for(size_t i = 0; i < MAX_SPELLS; i++) {
@@ -1345,148 +1554,156 @@ static bool IsObjectVertexCollidingPoly(EERIE_3DOBJ * obj, EERIEPOLY * ep,
 	return false;
 }
 
-static bool IsFULLObjectVertexInValidPosition(EERIE_3DOBJ * obj) {
-	
-	bool ret = true;
-
-	float x = obj->pbox->vert[0].pos.x;
-	float z = obj->pbox->vert[0].pos.z;
-	long px = x * ACTIVEBKG->Xmul;
-	long pz = z * ACTIVEBKG->Zmul;
+static void setCollisionMaterial(const EERIEPOLY * ep) {
+	if (ep->type & POLY_METAL) CUR_COLLISION_MATERIAL = MATERIAL_METAL;
+	else if (ep->type & POLY_WOOD) CUR_COLLISION_MATERIAL = MATERIAL_WOOD;
+	else if (ep->type & POLY_STONE) CUR_COLLISION_MATERIAL = MATERIAL_STONE;
+	else if (ep->type & POLY_GRAVEL) CUR_COLLISION_MATERIAL = MATERIAL_GRAVEL;
+	else if (ep->type & POLY_WATER) CUR_COLLISION_MATERIAL = MATERIAL_WATER;
+	else if (ep->type & POLY_EARTH) CUR_COLLISION_MATERIAL = MATERIAL_EARTH;
+	else CUR_COLLISION_MATERIAL = MATERIAL_STONE;
+}
 
+//! Background cells around vert[0] that are tested for collisions
+static void getCollisionCells(const EERIE_3DOBJ * obj, const Vec3f & pos, float margin,
+                              long & ix, long & ax, long & iz, long & az) {
+	
 	long n = obj->pbox->radius * ( 1.0f / 100 );
 	n = min(1L, n + 1);
+	
+	ix = std::max(long((pos.x - margin) * ACTIVEBKG->Xmul) - n, 0L);
+	ax = std::min(long((pos.x + margin) * ACTIVEBKG->Xmul) + n, ACTIVEBKG->Xsize - 1L);
+	iz = std::max(long((pos.z - margin) * ACTIVEBKG->Zmul) - n, 0L);
+	az = std::min(long((pos.z + margin) * ACTIVEBKG->Zmul) + n, ACTIVEBKG->Zsize - 1L);
+}
 
-	long ix = std::max(px - n, 0L);
-	long ax = std::min(px + n, ACTIVEBKG->Xsize - 1L);
-	long iz = std::max(pz - n, 0L);
-	long az = std::min(pz + n, ACTIVEBKG->Zsize - 1L);
-
-	LAST_COLLISION_POLY = NULL;
-	EERIEPOLY * ep;
-	EERIE_BKG_INFO * eg;
-
-	float rad = obj->pbox->radius;
-
-	for(pz = iz; pz <= az; pz++)
-		for(px = ix; px <= ax; px++) {
-			eg = &ACTIVEBKG->Backg[px+pz*ACTIVEBKG->Xsize];
-
-			for(long k = 0; k < eg->nbpoly; k++) {
+/*!
+ * Gather the polygons a box can collide with during all of its steps this frame
+ *
+ * The list keeps the cell and polygon order of the background grid so that the
+ * first colliding polygon is the same one a direct scan would find.
+ */
+static void gatherCollisionCandidates(PhysicsBatchBox & box) {
+	
+	getCollisionCells(box.obj, box.obj->pbox->vert[0].pos, box.margin,
+	                  box.ix, box.ax, box.iz, box.az);
+	
+	box.candidates.clear();
+	
+	for(long pz = box.iz; pz <= box.az; pz++)
+	for(long px = box.ix; px <= box.ax; px++) {
+		
+		EERIE_BKG_INFO * eg = &ACTIVEBKG->Backg[px + pz * ACTIVEBKG->Xsize];
+		
+		for(long k = 0; k < eg->nbpoly; k++) {
 			
-				ep = &eg->polydata[k];
-
-				if(ep->area > 190.f
-				   && !(ep->type & POLY_WATER)
-				   && !(ep->type & POLY_TRANS)
-				   && !(ep->type & POLY_NOCOL)
-				) {
-					if(fartherThan(ep->center, obj->pbox->vert[0].pos, rad + 75.f))
-						continue;
-
-					for(long kk = 0; kk < obj->pbox->nb_physvert; kk++) {
-						float radd = 4.f;
-
-						if(!fartherThan(obj->pbox->vert[kk].pos, ep->center, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, ep->v[0].p, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, ep->v[1].p, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, ep->v[2].p, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, (ep->v[0].p + ep->v[1].p) * .5f, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, (ep->v[2].p + ep->v[1].p) * .5f, radd)
-						   || !fartherThan(obj->pbox->vert[kk].pos, (ep->v[0].p + ep->v[2].p) * .5f, radd)
-						) {
-							LAST_COLLISION_POLY = ep;
-
-							if (ep->type & POLY_METAL) CUR_COLLISION_MATERIAL = MATERIAL_METAL;
-							else if (ep->type & POLY_WOOD) CUR_COLLISION_MATERIAL = MATERIAL_WOOD;
-							else if (ep->type & POLY_STONE) CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-							else if (ep->type & POLY_GRAVEL) CUR_COLLISION_MATERIAL = MATERIAL_GRAVEL;
-							else if (ep->type & POLY_WATER) CUR_COLLISION_MATERIAL = MATERIAL_WATER;
-							else if (ep->type & POLY_EARTH) CUR_COLLISION_MATERIAL = MATERIAL_EARTH;
-							else CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-
-							return false;
-						}
+			EERIEPOLY * ep = &eg->polydata[k];
+			
+			if(ep->area <= 190.f || (ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))) {
+				continue;
+			}
+			
+			box.candidates.resize(box.candidates.size() + 1);
+			PhysicsCollisionCandidate & candidate = box.candidates.back();
+			candidate.ep = ep;
+			candidate.px = px;
+			candidate.pz = pz;
+			candidate.probes[0] = ep->center;
+			candidate.probes[1] = ep->v[0].p;
+			candidate.probes[2] = ep->v[1].p;
+			candidate.probes[3] = ep->v[2].p;
+			candidate.probes[4] = (ep->v[0].p + ep->v[1].p) * .5f;
+			candidate.probes[5] = (ep->v[2].p + ep->v[1].p) * .5f;
+			candidate.probes[6] = (ep->v[0].p + ep->v[2].p) * .5f;
+			candidate.min = candidate.max = candidate.probes[0];
+			for(size_t i = 1; i < ARRAY_SIZE(candidate.probes); i++) {
+				candidate.min = componentwise_min(candidate.min, candidate.probes[i]);
+				candidate.max = componentwise_max(candidate.max, candidate.probes[i]);
+			}
+		}
+	}
+}
 
-						// Last addon
-						for(long kl = 1; kl < obj->pbox->nb_physvert; kl++) {
-							if(kl != kk) {
-								Vec3f pos = (obj->pbox->vert[kk].pos + obj->pbox->vert[kl].pos) * .5f;
-
-								if(!fartherThan(pos, ep->center, radd)
-								   || !fartherThan(pos, ep->v[0].p, radd)
-								   || !fartherThan(pos, ep->v[1].p, radd)
-								   || !fartherThan(pos, ep->v[2].p, radd)
-								   || !fartherThan(pos, (ep->v[0].p + ep->v[1].p) * .5f, radd)
-								   || !fartherThan(pos, (ep->v[2].p + ep->v[1].p) * .5f, radd)
-								   || !fartherThan(pos, (ep->v[0].p + ep->v[2].p) * .5f, radd)
-								) {
-									LAST_COLLISION_POLY = ep;
-
-									if (ep->type & POLY_METAL) CUR_COLLISION_MATERIAL = MATERIAL_METAL;
-									else if (ep->type & POLY_WOOD) CUR_COLLISION_MATERIAL = MATERIAL_WOOD;
-									else if (ep->type & POLY_STONE) CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-									else if (ep->type & POLY_GRAVEL) CUR_COLLISION_MATERIAL = MATERIAL_GRAVEL;
-									else if (ep->type & POLY_WATER) CUR_COLLISION_MATERIAL = MATERIAL_WATER;
-									else if (ep->type & POLY_EARTH) CUR_COLLISION_MATERIAL = MATERIAL_EARTH;
-									else CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-
-									return false;
-								}
-							}
-						}
-					}
+//! Vertices and the midpoints between all vertex pairs
+static std::vector<Vec3f> g_physicsProbePoints;
 
-				
-					if(IsObjectVertexCollidingPoly(obj, ep, -1, NULL)) {
-						
+static bool IsFULLObjectVertexInValidPosition(PhysicsBatchBox & box) {
+	
+	EERIE_3DOBJ * obj = box.obj;
+	const PHYSVERT * vert = obj->pbox->vert;
+	
+	LAST_COLLISION_POLY = NULL;
+	
+	long ix, ax, iz, az;
+	getCollisionCells(obj, vert[0].pos, 0.f, ix, ax, iz, az);
+	if(ix < box.ix || ax > box.ax || iz < box.iz || az > box.az) {
+		gatherCollisionCandidates(box);
+	}
+	
+	const float radd = 4.f;
+	
+	g_physicsProbePoints.clear();
+	Vec3f min = vert[0].pos, max = vert[0].pos;
+	for(long k = 0; k < obj->pbox->nb_physvert; k++) {
+		g_physicsProbePoints.push_back(vert[k].pos);
+		min = componentwise_min(min, vert[k].pos);
+		max = componentwise_max(max, vert[k].pos);
+		for(long l = k + 1; l < obj->pbox->nb_physvert; l++) {
+			g_physicsProbePoints.push_back((vert[k].pos + vert[l].pos) * .5f);
+		}
+	}
+	min -= Vec3f::repeat(radd), max += Vec3f::repeat(radd);
+	
+	float rad = obj->pbox->radius;
+	
+	std::vector<PhysicsCollisionCandidate>::const_iterator it;
+	for(it = box.candidates.begin(); it != box.candidates.end(); ++it) {
+		
+		if(it->px < ix || it->px > ax || it->pz < iz || it->pz > az) {
+			continue;
+		}
+		
+		EERIEPOLY * ep = it->ep;
+		
+		if(fartherThan(ep->center, vert[0].pos, rad + 75.f))
+			continue;
+		
+		// Points closer than radd to any of the probes can only be inside the box bounds
+		if(it->max.x >= min.x && it->min.x <= max.x
+		   && it->max.y >= min.y && it->min.y <= max.y
+		   && it->max.z >= min.z && it->min.z <= max.z) {
+			for(size_t i = 0; i < g_physicsProbePoints.size(); i++) {
+				for(size_t j = 0; j < ARRAY_SIZE(it->probes); j++) {
+					if(!fartherThan(g_physicsProbePoints[i], it->probes[j], radd)) {
 						LAST_COLLISION_POLY = ep;
-
-						if (ep->type & POLY_METAL) CUR_COLLISION_MATERIAL = MATERIAL_METAL;
-						else if (ep->type & POLY_WOOD) CUR_COLLISION_MATERIAL = MATERIAL_WOOD;
-						else if (ep->type & POLY_STONE) CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-						else if (ep->type & POLY_GRAVEL) CUR_COLLISION_MATERIAL = MATERIAL_GRAVEL;
-						else if (ep->type & POLY_WATER) CUR_COLLISION_MATERIAL = MATERIAL_WATER;
-						else if (ep->type & POLY_EARTH) CUR_COLLISION_MATERIAL = MATERIAL_EARTH;
-						else CUR_COLLISION_MATERIAL = MATERIAL_STONE;
-
+						setCollisionMaterial(ep);
 						return false;
 					}
 				}
 			}
 		}
-
-	return ret;
+		
+		if(IsObjectVertexCollidingPoly(obj, ep, -1, NULL)) {
+			LAST_COLLISION_POLY = ep;
+			setCollisionMaterial(ep);
+			return false;
+		}
+	}
+	
+	return true;
 }
 
-static bool ARX_EERIE_PHYSICS_BOX_Compute(EERIE_3DOBJ * obj, float framediff, long source) {
+static void ARX_EERIE_PHYSICS_BOX_Collide(PhysicsBatchBox & box) {
 	
-	Vec3f oldpos[32];
-	long COUNT = 0;
-	COUNT++;
-
-	for(long kk = 0; kk < obj->pbox->nb_physvert; kk++) {
-		PHYSVERT *pv = &obj->pbox->vert[kk];
-		oldpos[kk] = pv->pos;
-		pv->inertia = Vec3f::ZERO;
-
-		pv->velocity.x = clamp(pv->velocity.x, -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
-		pv->velocity.y = clamp(pv->velocity.y, -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
-		pv->velocity.z = clamp(pv->velocity.z, -VELOCITY_THRESHOLD, VELOCITY_THRESHOLD);
-	}
+	EERIE_3DOBJ * obj = box.obj;
+	long source = box.update->source;
 	
 	CUR_COLLISION_MATERIAL = MATERIAL_STONE;
 	
-	RK4Integrate(obj, framediff);
-
-	EERIE_SPHERE sphere;
-	PHYSVERT *pv = &obj->pbox->vert[0];
-	sphere.origin = pv->pos;
-	sphere.radius = obj->pbox->radius;
 	long colidd = 0;
 
 	for(int kk = 0; kk < obj->pbox->nb_physvert; kk += 2) {
-		pv = &obj->pbox->vert[kk];
+		PHYSVERT * pv = &obj->pbox->vert[kk];
 
 		if(!IsValidPos3(&pv->pos)) {
 			colidd = 1;
@@ -1494,7 +1711,7 @@ static bool ARX_EERIE_PHYSICS_BOX_Compute(EERIE_3DOBJ * obj, float framediff, lo
 		}
 	}
 
-	if(!IsFULLObjectVertexInValidPosition(obj)
+	if(!IsFULLObjectVertexInValidPosition(box)
 	   || ARX_INTERACTIVE_CheckFULLCollision(obj, source)
 	   || colidd
 	   || IsObjectInField(obj)
@@ -1504,33 +1721,29 @@ static bool ARX_EERIE_PHYSICS_BOX_Compute(EERIE_3DOBJ * obj, float framediff, lo
 		               + EEfabs(obj->pbox->vert[0].velocity.y)
 		               + EEfabs(obj->pbox->vert[0].velocity.z)) * .01f;
 
+		Entity * io = ValidIONum(source) ? entities[source] : NULL;
+		if(!(io && (io->ioflags & IO_BODY_CHUNK)))
+			ARX_TEMPORARY_TrySound(io, 0.4f + power);
 
-		if(!(ValidIONum(source) && (entities[source]->ioflags & IO_BODY_CHUNK)))
-			ARX_TEMPORARY_TrySound(0.4f + power);
-
-		if(!LAST_COLLISION_POLY) {
-			for(long k = 0; k < obj->pbox->nb_physvert; k++) {
-				pv = &obj->pbox->vert[k];
-
+		const PhysicsBoxVertices & v = g_physicsVertices;
+		for(long k = 0; k < obj->pbox->nb_physvert; k++) {
+			PHYSVERT * pv = &obj->pbox->vert[k];
+			
+			if(!LAST_COLLISION_POLY) {
 				pv->velocity.x *= -0.3f;
 				pv->velocity.z *= -0.3f;
 				pv->velocity.y *= -0.4f;
-
-				pv->pos = oldpos[k];
-			}
-		} else {
-			for(long k = 0; k < obj->pbox->nb_physvert; k++) {
-				pv = &obj->pbox->vert[k];
-				
+			} else {
 				float t = dot(LAST_COLLISION_POLY->norm, pv->velocity);
 				pv->velocity -= LAST_COLLISION_POLY->norm * (2.f * t);
 				
 				pv->velocity.x *= 0.3f;
 				pv->velocity.z *= 0.3f;
 				pv->velocity.y *= 0.4f;
-				
-				pv->pos = oldpos[k];
 			}
+			
+			size_t i = box.offset + k;
+			pv->pos = Vec3f(v.px[i], v.py[i], v.pz[i]);
 		}
 	}
 
@@ -1542,63 +1755,114 @@ static bool ARX_EERIE_PHYSICS_BOX_Compute(EERIE_3DOBJ * obj, float framediff, lo
 		if(obj->pbox->stopcount < 0)
 			obj->pbox->stopcount = 0;
 	}
-
-	return true;
 }
 
-long ARX_PHYSICS_BOX_ApplyModel(EERIE_3DOBJ * obj, float framediff, float rubber, long source) {
+static std::vector<PhysicsBatchBox> g_physicsBoxes;
+static std::vector<PhysicsBatchBox *> g_physicsActiveBoxes;
+
+void ARX_PHYSICS_BOX_ApplyModels(PhysicsBoxUpdate * updates, size_t count, float framediff) {
 	
 	VELOCITY_THRESHOLD = 400.f;
-	long ret = 0;
-
-	if(!obj || !obj->pbox)
-		return ret;
-
-	if(obj->pbox->active == 2)
-		return ret;
-
-	if(framediff == 0.f)
-		return ret;
-
-	PHYSVERT * pv;
-
-	// Memorizes initpos
-	for(long k = 0; k < obj->pbox->nb_physvert; k++) {
-		pv = &obj->pbox->vert[k];
-		pv->temp = pv->pos;
+	
+	const float t_threshold = 0.18f;
+	
+	g_physicsBoxes.resize(std::max(g_physicsBoxes.size(), count));
+	g_physicsActiveBoxes.clear();
+	g_physicsRestLengths.clear();
+	
+	for(size_t i = 0; i < count; i++) {
+		
+		PhysicsBoxUpdate & update = updates[i];
+		EERIE_3DOBJ * obj = update.obj;
+		update.result = 0;
+		
+		if(!obj || !obj->pbox || obj->pbox->active == 2 || framediff == 0.f)
+			continue;
+		
+		// Memorizes initpos
+		for(long k = 0; k < obj->pbox->nb_physvert; k++) {
+			obj->pbox->vert[k].temp = obj->pbox->vert[k].pos;
+		}
+		
+		float timing = obj->pbox->storedtiming + framediff * update.rubber * 0.0055f;
+		if(timing < t_threshold) {
+			obj->pbox->storedtiming = timing;
+			update.result = 1;
+			continue;
+		}
+		
+		PhysicsBatchBox & box = g_physicsBoxes[g_physicsActiveBoxes.size()];
+		box.obj = obj;
+		box.update = &update;
+		box.timing = timing;
+		box.count = obj->pbox->nb_physvert;
+		box.padded = padPhysicsVertexCount(box.count);
+		
+		long steps = 0;
+		for(float t = timing; t >= t_threshold; t -= t_threshold) {
+			steps++;
+		}
+		// Velocities are clamped before each step, limiting the distance per step
+		box.margin = float(steps) * VELOCITY_THRESHOLD * 0.11f * (3.5f / 6.f) * 1.2f;
+		
+		computePhysicsRestLengths(box);
+		gatherCollisionCandidates(box);
+		
+		g_physicsActiveBoxes.push_back(&box);
 	}
-
-	float timing = obj->pbox->storedtiming + framediff * rubber * 0.0055f;
-	float t_threshold = 0.18f;
-
-	if(timing < t_threshold) {
-		obj->pbox->storedtiming = timing;
-		return 1;
-	} else {
-		while(timing >= t_threshold) {
-			ComputeForces(obj->pbox->vert, obj->pbox->nb_physvert);
-
-			if(!ARX_EERIE_PHYSICS_BOX_Compute(obj, std::min(0.11f, timing * 10), source))
-				ret = 1;
-
-			timing -= t_threshold;
+	
+	size_t stepped = g_physicsActiveBoxes.size();
+	
+	while(!g_physicsActiveBoxes.empty()) {
+		
+		size_t vertices = 0;
+		BOOST_FOREACH(PhysicsBatchBox * box, g_physicsActiveBoxes) {
+			vertices += box->padded;
 		}
-
-		obj->pbox->storedtiming = timing;
+		g_physicsVertices.resize(vertices);
+		
+		size_t offset = 0;
+		BOOST_FOREACH(PhysicsBatchBox * box, g_physicsActiveBoxes) {
+			loadPhysicsBox(*box, offset);
+			offset += box->padded;
+		}
+		
+		BOOST_FOREACH(PhysicsBatchBox * box, g_physicsActiveBoxes) {
+			applyPhysicsSprings(*box);
+			integratePhysicsBox(*box, std::min(0.11f, box->timing * 10));
+		}
+		
+		// Collisions call into scripts and sounds and stay sequential
+		size_t remaining = 0;
+		BOOST_FOREACH(PhysicsBatchBox * box, g_physicsActiveBoxes) {
+			
+			ARX_EERIE_PHYSICS_BOX_Collide(*box);
+			
+			box->timing -= t_threshold;
+			if(box->timing >= t_threshold) {
+				g_physicsActiveBoxes[remaining++] = box;
+			} else {
+				box->obj->pbox->storedtiming = box->timing;
+			}
+		}
+		g_physicsActiveBoxes.resize(remaining);
 	}
-
-	if(obj->pbox->stopcount < 16)
-		return ret;
-
-	obj->pbox->active = 2;
-	obj->pbox->stopcount = 0;
-
-	if(ValidIONum(source)) {
-		entities[source]->soundcount = 0;
-		entities[source]->soundtime = (unsigned long)(arxtime) + 2000;
+	
+	for(size_t i = 0; i < stepped; i++) {
+		
+		PhysicsBatchBox & box = g_physicsBoxes[i];
+		if(box.obj->pbox->stopcount < 16)
+			continue;
+		
+		box.obj->pbox->active = 2;
+		box.obj->pbox->stopcount = 0;
+		
+		long source = box.update->source;
+		if(ValidIONum(source)) {
+			entities[source]->soundcount = 0;
+			entities[source]->soundtime = (unsigned long)(arxtime) + 2000;
+		}
 	}
-
-	return ret;
 }
 
 void ARX_PrepareBackgroundNRMLs()
@@ -213,6 +213,19 @@ void ARX_THROWN_OBJECT_KillAll();
 void ARX_THROWN_OBJECT_Manage(unsigned long time_offset);
 void ARX_THROWN_OBJECT_Render();
 
-long ARX_PHYSICS_BOX_ApplyModel(EERIE_3DOBJ * obj, float framediff, float rubber, long source);
+struct PhysicsBoxUpdate {
+	EERIE_3DOBJ * obj;
+	float rubber;
+	long source;
+	long result; //!< 1 if the elapsed time was only accumulated
+};
+
+/*!
+ * Step the physics boxes of several objects together
+ *
+ * Spring forces for all boxes are computed in one pass, collisions are then
+ * resolved one box at a time.
+ */
+void ARX_PHYSICS_BOX_ApplyModels(PhysicsBoxUpdate * updates, size_t count, float framediff);
 
 #endif // ARX_AI_PATHS_H
@@ -56,9 +56,12 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "util/String.h"
 
+#include "animation/AnimationCache.h"
+
 #include "audio/Audio.h"
 
 #include "core/GameTime.h"
@@ -84,6 +87,10 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 const size_t MAX_ANIMATIONS = 900;
 std::vector<ANIM_HANDLE> animations(MAX_ANIMATIONS);
 
+//! Loaded animation handles by path
+typedef boost::unordered_map<std::string, ANIM_HANDLE *> AnimationIndex;
+static AnimationIndex g_animationIndex;
+
 static const long anim_power[] = { 100, 20, 15, 12, 8, 6, 5, 4, 3, 2, 2, 1, 1, 1, 1 };
 
 // ANIMATION HANDLES handling
@@ -145,14 +152,20 @@ void ReleaseAnim(EERIE_ANIM * ea) {
 		for(long i = 0; i < ea->nb_key_frames; i++) {
 			ARX_SOUND_Free(ea->frames[i].sample);
 		}
-		free(ea->frames);
+		delete[] ea->frames;
 	}
 
-	free(ea->groups);
+	delete[] ea->tracks;
+	free(ea->keys);
 	free(ea->voidgroups);
 	free(ea);
 }
 
+static void EERIE_ANIMMANAGER_Unregister(ANIM_HANDLE * handle) {
+	g_animationIndex.erase(handle->path.string());
+	handle->path.clear();
+}
+
 void EERIE_ANIMMANAGER_PurgeUnused() {
 	
 	for(size_t i = 0; i < MAX_ANIMATIONS; i++) {
@@ -162,7 +175,7 @@ void EERIE_ANIMMANAGER_PurgeUnused() {
 				animations[i].anims[k] = NULL;
 			}
 			free(animations[i].anims), animations[i].anims = NULL;
-			animations[i].path.clear();
+			EERIE_ANIMMANAGER_Unregister(&animations[i]);
 		}
 	}
 }
@@ -180,13 +193,9 @@ void EERIE_ANIMMANAGER_ReleaseHandle(ANIM_HANDLE * anim) {
 
 static ANIM_HANDLE * EERIE_ANIMMANAGER_GetHandle(const res::path & path) {
 	
-	for(size_t i = 0; i < MAX_ANIMATIONS; i++) {
-		if(animations[i].path == path) {
-			return &animations[i];
-		}
-	}
+	AnimationIndex::const_iterator it = g_animationIndex.find(path.string());
 	
-	return NULL;
+	return (it != g_animationIndex.end()) ? it->second : NULL;
 }
 
 float GetTimeBetweenKeyFrames(EERIE_ANIM * ea, long f1, long f2)
@@ -203,7 +212,194 @@ float GetTimeBetweenKeyFrames(EERIE_ANIM * ea, long f1, long f2)
 	return time;
 }
 
-EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file) {
+//! Largest possible value of the three smallest components of a unit quaternion
+static const float QUAT_COMPONENT_MAX = 0.70710678f;
+//! Quantization steps for each of the three smallest components (15 bits)
+static const float QUAT_COMPONENT_STEPS = 32766.f; // even, so that 0 is exact
+//! Quantization steps for translation and scaling keys
+static const float VECTOR_KEY_STEPS = 65535.f;
+
+/*!
+ * Smallest-three quaternion encoding: the largest component is dropped and
+ * reconstructed from the other three, which are stored with 15 bits each.
+ * The index of the dropped component goes into the top bits of the first two values.
+ */
+static void packQuat(const EERIE_QUAT & quat, u16 * out) {
+	
+	float q[4] = { quat.x, quat.y, quat.z, quat.w };
+	
+	size_t largest = 0;
+	float length = 0.f;
+	for(size_t i = 0; i < 4; i++) {
+		if(std::abs(q[i]) > std::abs(q[largest])) {
+			largest = i;
+		}
+		length += q[i] * q[i];
+	}
+	
+	// q and -q are the same rotation, so make the dropped component positive
+	float scale = (length > 0.f) ? 1.f / std::sqrt(length) : 0.f;
+	if(q[largest] < 0.f) {
+		scale = -scale;
+	}
+	
+	for(size_t i = 0, k = 0; i < 4; i++) {
+		if(i != largest) {
+			float v = clamp(q[i] * scale * (1.f / QUAT_COMPONENT_MAX), -1.f, 1.f);
+			out[k++] = u16((v * 0.5f + 0.5f) * QUAT_COMPONENT_STEPS + 0.5f);
+		}
+	}
+	
+	out[0] = u16(out[0] | ((largest >> 1) << 15));
+	out[1] = u16(out[1] | ((largest & 1) << 15));
+}
+
+static EERIE_QUAT unpackQuat(const u16 * in) {
+	
+	size_t largest = ((in[0] >> 15) << 1) | (in[1] >> 15);
+	
+	float q[4];
+	float sum = 0.f;
+	for(size_t i = 0, k = 0; i < 4; i++) {
+		if(i != largest) {
+			float v = float(in[k++] & 0x7fff) * (2.f / QUAT_COMPONENT_STEPS) - 1.f;
+			q[i] = v * QUAT_COMPONENT_MAX;
+			sum += q[i] * q[i];
+		}
+	}
+	q[largest] = std::sqrt(std::max(0.f, 1.f - sum));
+	
+	EERIE_QUAT quat;
+	quat.x = q[0];
+	quat.y = q[1];
+	quat.z = q[2];
+	quat.w = q[3];
+	return quat;
+}
+
+static Vec3f unpackVector(const EERIE_ANIM_CHANNEL & channel, const u16 * in) {
+	return Vec3f(channel.base.x + float(in[0]) * channel.step.x,
+	             channel.base.y + float(in[1]) * channel.step.y,
+	             channel.base.z + float(in[2]) * channel.step.z);
+}
+
+EERIE_GROUP GetAnimGroup(const EERIE_ANIM * eanim, long frame, long group) {
+	
+	EERIE_GROUP result;
+	result.translate = Vec3f::ZERO;
+	result.zoom = Vec3f::ZERO;
+	
+	if(eanim->voidgroups[group]) {
+		return result; // identity
+	}
+	
+	const EERIE_ANIM_TRACK & track = eanim->tracks[group];
+	
+	result.quat = unpackQuat(&eanim->keys[track.rotation.offset + frame * track.rotation.stride]);
+	result.translate = unpackVector(track.translation,
+	                                &eanim->keys[track.translation.offset + frame * track.translation.stride]);
+	result.zoom = unpackVector(track.zoom, &eanim->keys[track.zoom.offset + frame * track.zoom.stride]);
+	
+	return result;
+}
+
+//! Quantize one vector component of a group, stored as base + key * step
+static void packVectorChannel(EERIE_ANIM_CHANNEL & channel, std::vector<u16> & keys,
+                              const std::vector<Vec3f> & values) {
+	
+	Vec3f low = values[0];
+	Vec3f high = values[0];
+	for(size_t i = 1; i < values.size(); i++) {
+		low = Vec3f(std::min(low.x, values[i].x), std::min(low.y, values[i].y), std::min(low.z, values[i].z));
+		high = Vec3f(std::max(high.x, values[i].x), std::max(high.y, values[i].y), std::max(high.z, values[i].z));
+	}
+	
+	channel.offset = u32(keys.size());
+	channel.base = low;
+	
+	if(low == high) {
+		// Constant value - a single key decodes to base exactly
+		channel.stride = 0;
+		channel.step = Vec3f::ZERO;
+		keys.resize(keys.size() + 3, 0);
+		return;
+	}
+	
+	channel.stride = 3;
+	channel.step = (high - low) * (1.f / VECTOR_KEY_STEPS);
+	
+	for(size_t i = 0; i < values.size(); i++) {
+		const float * value = &values[i].x;
+		const float * base = &channel.base.x;
+		const float * step = &channel.step.x;
+		for(size_t j = 0; j < 3; j++) {
+			float key = (step[j] > 0.f) ? (value[j] - base[j]) / step[j] : 0.f;
+			keys.push_back(u16(clamp(key, 0.f, VECTOR_KEY_STEPS) + 0.5f));
+		}
+	}
+}
+
+static void packRotationChannel(EERIE_ANIM_CHANNEL & channel, std::vector<u16> & keys,
+                                const std::vector<EERIE_QUAT> & values) {
+	
+	bool constant = true;
+	for(size_t i = 1; i < values.size() && constant; i++) {
+		constant = (values[i].x == values[0].x && values[i].y == values[0].y
+		            && values[i].z == values[0].z && values[i].w == values[0].w);
+	}
+	
+	channel.offset = u32(keys.size());
+	channel.stride = constant ? 0 : 3;
+	channel.base = channel.step = Vec3f::ZERO;
+	
+	size_t count = constant ? 1 : values.size();
+	keys.resize(keys.size() + count * 3);
+	for(size_t i = 0; i < count; i++) {
+		packQuat(values[i], &keys[channel.offset + i * 3]);
+	}
+}
+
+/*!
+ * Quantize full-precision group transforms (nb_key_frames * nb_groups, frame-major)
+ * into the tracks and keys of an animation whose voidgroups are already set.
+ */
+static void PackAnimGroups(EERIE_ANIM * eanim, const std::vector<EERIE_GROUP> & groups) {
+	
+	std::vector<u16> keys;
+	std::vector<EERIE_QUAT> rotations(eanim->nb_key_frames);
+	std::vector<Vec3f> translations(eanim->nb_key_frames);
+	std::vector<Vec3f> zooms(eanim->nb_key_frames);
+	
+	eanim->tracks = new EERIE_ANIM_TRACK[eanim->nb_groups]();
+	
+	for(long i = 0; i < eanim->nb_groups; i++) {
+		
+		if(eanim->voidgroups[i]) {
+			continue;
+		}
+		
+		for(long j = 0; j < eanim->nb_key_frames; j++) {
+			const EERIE_GROUP & group = groups[i + j * eanim->nb_groups];
+			rotations[j] = group.quat;
+			translations[j] = group.translate;
+			zooms[j] = group.zoom;
+		}
+		
+		EERIE_ANIM_TRACK & track = eanim->tracks[i];
+		packRotationChannel(track.rotation, keys, rotations);
+		packVectorChannel(track.translation, keys, translations);
+		packVectorChannel(track.zoom, keys, zooms);
+	}
+	
+	eanim->nb_keys = long(keys.size());
+	eanim->keys = allocStructZero<u16>(std::max(keys.size(), size_t(1)));
+	if(!keys.empty()) {
+		std::copy(keys.begin(), keys.end(), eanim->keys);
+	}
+}
+
+EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file,
+                         std::vector<res::path> * samples) {
 
 	(void)size; // TODO use size
 
@@ -229,9 +425,13 @@ EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file)
 	eerie->nb_groups = th->nb_groups;
 	eerie->nb_key_frames = th->nb_key_frames;
 
-	eerie->frames = allocStructZero<EERIE_FRAME>(th->nb_key_frames);
-	eerie->groups = allocStructZero<EERIE_GROUP>(th->nb_key_frames * th->nb_groups);
+	eerie->frames = new EERIE_FRAME[th->nb_key_frames]();
+	std::vector<EERIE_GROUP> groups(th->nb_key_frames * th->nb_groups);
 	eerie->voidgroups = allocStructZero<unsigned char>(th->nb_groups);
+	
+	if(samples) {
+		samples->assign(th->nb_key_frames, res::path());
+	}
 
 	eerie->anim_time = 0;
 
@@ -315,8 +515,7 @@ EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file)
 			const THEO_GROUPANIM * tga = reinterpret_cast<const THEO_GROUPANIM *>(adr + pos);
 			pos += sizeof(THEO_GROUPANIM);
 
-			EERIE_GROUP * eg = &eerie->groups[j + i * th->nb_groups];
-			eg->key = tga->key_group;
+			EERIE_GROUP * eg = &groups[j + i * th->nb_groups];
 			eg->quat = tga->Quaternion;
 			eg->translate = tga->translate;
 			eg->zoom = tga->zoom;
@@ -337,7 +536,11 @@ EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file)
 			LogDebug(" -> sample " << ts->sample_name << " size " << ts->sample_size
 					 << " THEA_SAMPLE:" << sizeof(THEA_SAMPLE));
 
-			eerie->frames[i].sample = ARX_SOUND_Load(res::path::load(util::loadString(ts->sample_name)));
+			res::path sample = res::path::load(util::loadString(ts->sample_name));
+			eerie->frames[i].sample = ARX_SOUND_Load(sample);
+			if(samples) {
+				(*samples)[i] = sample;
+			}
 		}
 
 		pos += 4; // num_sfx
@@ -406,12 +609,12 @@ EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file)
 		for(long j = 0; j < eerie->nb_key_frames; j++) {
 			long pos = i + (j * eerie->nb_groups);
 
-			if((eerie->groups[pos].quat.x != 0.f)
-			   || (eerie->groups[pos].quat.y != 0.f)
-			   || (eerie->groups[pos].quat.z != 0.f)
-			   || (eerie->groups[pos].quat.w != 1.f)
-			   || eerie->groups[pos].translate != Vec3f::ZERO
-			   || eerie->groups[pos].zoom != Vec3f::ZERO) {
+			if((groups[pos].quat.x != 0.f)
+			   || (groups[pos].quat.y != 0.f)
+			   || (groups[pos].quat.z != 0.f)
+			   || (groups[pos].quat.w != 1.f)
+			   || groups[pos].translate != Vec3f::ZERO
+			   || groups[pos].zoom != Vec3f::ZERO) {
 				voidd = false;
 				break;
 			}
@@ -421,6 +624,8 @@ EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file)
 			eerie->voidgroups[i] = 1;
 		}
 	}
+	
+	PackAnimGroups(eerie, groups);
 
 	eerie->anim_time = th->nb_frames * 1000.f * (1.f/24);
 	if(eerie->anim_time < 1) {
@@ -434,20 +639,42 @@ EERIE_ANIM * TheaToEerie(const char * adr, size_t size, const res::path & file)
 
 
 
-static bool EERIE_ANIMMANAGER_AddAltAnim(ANIM_HANDLE * ah, const res::path & path) {
+//! Load an animation from the animation cache or convert it from the .tea file
+static EERIE_ANIM * loadAnimation(const res::path & path) {
 	
-	if(!ah || ah->path.empty()) {
-		return false;
+	AnimationCache::Key key;
+	bool cacheable = AnimationCache::getKey(path, key);
+	if(cacheable) {
+		EERIE_ANIM * anim = AnimationCache::load(key);
+		if(anim) {
+			return anim;
+		}
 	}
 	
 	size_t FileSize;
 	char * adr = resources->readAlloc(path, FileSize);
 	if(!adr) {
-		return false;
+		return NULL;
 	}
 	
-	EERIE_ANIM * temp = TheaToEerie(adr, FileSize, path);
+	std::vector<res::path> samples;
+	EERIE_ANIM * anim = TheaToEerie(adr, FileSize, path, cacheable ? &samples : NULL);
 	free(adr);
+	
+	if(anim && cacheable) {
+		AnimationCache::store(key, anim, samples);
+	}
+	
+	return anim;
+}
+
+static bool EERIE_ANIMMANAGER_AddAltAnim(ANIM_HANDLE * ah, const res::path & path) {
+	
+	if(!ah || ah->path.empty()) {
+		return false;
+	}
+	
+	EERIE_ANIM * temp = loadAnimation(path);
 	if(!temp) {
 		return false;
 	}
@@ -483,24 +710,18 @@ ANIM_HANDLE * EERIE_ANIMMANAGER_Load_NoWarning(const res::path & path) {
 			continue;
 		}
 		
-		size_t FileSize;
-		char * adr = resources->readAlloc(path, FileSize);
-		if(!adr) {
+		EERIE_ANIM * anim = loadAnimation(path);
+		if(!anim) {
 			return NULL;
 		}
 		
 		animations[i].anims = (EERIE_ANIM **)malloc(sizeof(EERIE_ANIM *));
-		animations[i].anims[0] = TheaToEerie(adr, FileSize, path);
+		animations[i].anims[0] = anim;
 		animations[i].alt_nb = 1;
 		
-		free(adr);
-		
-		if(!animations[i].anims[0]) {
-			return NULL;
-		}
-		
 		animations[i].path = path;
 		animations[i].locks = 1;
+		g_animationIndex[path.string()] = &animations[i];
 		
 		int pathcount = 2;
 		res::path altpath;
@@ -531,10 +752,16 @@ long EERIE_ANIMMANAGER_Count( std::string& tex, long * memsize)
 			char txx[256];
 			strcpy(txx,animations[i].path.string().c_str());
 			long totsize=0;
+			for(long k = 0; k < animations[i].alt_nb; k++) {
+				const EERIE_ANIM * anim = animations[i].anims[k];
+				totsize += sizeof(EERIE_ANIM) + anim->nb_key_frames * sizeof(EERIE_FRAME)
+				           + anim->nb_groups * (sizeof(EERIE_ANIM_TRACK) + 1)
+				           + anim->nb_keys * sizeof(u16);
+			}
 
 			sprintf(temp, "%3ld[%3lu] %s size %ld Locks %ld Alt %d\r\n", count, (unsigned long)i,
 			        txx, totsize, animations[i].locks, animations[i].alt_nb - 1);
-			memsize+=totsize;
+			*memsize += totsize;
 			tex += temp;
 		}
 	}
@@ -746,7 +973,7 @@ void EERIE_ANIMMANAGER_Clear(long i) {
 	
 	free(animations[i].anims), animations[i].anims = NULL;
 	
-	animations[i].path.clear();
+	EERIE_ANIMMANAGER_Unregister(&animations[i]);
 }
 
 void EERIE_ANIMMANAGER_ClearAll() {
@@ -69,14 +69,34 @@ struct EERIE_FRAME
 	audio::SampleId	sample;
 };
 
+//! Transform of one group at one key frame
 struct EERIE_GROUP
 {
-	int		key;
 	Vec3f	translate;
 	EERIE_QUAT	quat;
 	Vec3f	zoom;
 };
 
+/*!
+ * Quantized values of one group transform component for all key frames.
+ * Each key is three u16 values in EERIE_ANIM::keys. Rotations use the smallest-three
+ * quaternion encoding, translations and scaling are stored as base + key * step.
+ */
+struct EERIE_ANIM_CHANNEL
+{
+	u32		offset; //!< Index of the first key value in EERIE_ANIM::keys
+	u32		stride; //!< 3 if there is a key per key frame, 0 if the value never changes
+	Vec3f	base;
+	Vec3f	step;
+};
+
+struct EERIE_ANIM_TRACK
+{
+	EERIE_ANIM_CHANNEL	rotation;
+	EERIE_ANIM_CHANNEL	translation;
+	EERIE_ANIM_CHANNEL	zoom;
+};
+
 struct EERIE_ANIM
 {
 	long		anim_time;
@@ -84,8 +104,10 @@ struct EERIE_ANIM
 	long		nb_groups;
 	long		nb_key_frames;
 	EERIE_FRAME *	frames;
-	EERIE_GROUP  *  groups;
-	unsigned char *	voidgroups;
+	EERIE_ANIM_TRACK *	tracks; //!< One per group, unused for void groups
+	u16 *		keys;
+	long		nb_keys;
+	unsigned char *	voidgroups; //!< Groups that are not modified by the whole animation
 };
 
 struct ANIM_HANDLE {
@@ -143,6 +165,9 @@ void ANIM_Set(ANIM_USE * au,ANIM_HANDLE * anim);
 
 void GetAnimTotalTranslate( ANIM_HANDLE * eanim,long alt_idx,Vec3f * pos);
 
+//! Decode the transform of a group at a key frame
+EERIE_GROUP GetAnimGroup(const EERIE_ANIM * eanim, long frame, long group);
+
 long EERIE_ANIMMANAGER_Count(std::string & tex, long * memsize);
 void EERIE_ANIMMANAGER_ClearAll();
 void EERIE_ANIMMANAGER_PurgeUnused();
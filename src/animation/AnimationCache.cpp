@@ -0,0 +1,386 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "animation/AnimationCache.h"
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "animation/Animation.h"
+#include "core/Config.h"
+#include "io/fs/FilePath.h"
+#include "io/fs/FileStream.h"
+#include "io/fs/Filesystem.h"
+#include "io/fs/SystemPaths.h"
+#include "io/log/Logger.h"
+#include "io/resource/PakEntry.h"
+#include "io/resource/PakReader.h"
+#include "platform/Platform.h"
+#include "scene/GameSound.h"
+#include "scene/Object.h"
+
+namespace {
+
+//! Increment this whenever the format of cache entries or the quantization changes
+const u32 CACHE_VERSION = 1;
+
+const char CACHE_MAGIC[4] = { 'A', 'R', 'X', 'A' };
+
+struct CacheHeader {
+	char magic[4];
+	u32 version;
+	u64 sourceSize;
+	s64 sourceTime;
+	u32 pathLength;
+	// followed by the resource path and the animation
+};
+
+struct CachedAnimation {
+	s32 animTime;
+	u32 flag;
+	u32 groups;
+	u32 keyFrames;
+	u32 keys;
+	u32 trackSize; //!< sizeof(EERIE_ANIM_TRACK) of the writer
+	// followed by the frames, voidgroups, tracks and keys
+};
+
+struct CachedFrame {
+	s32 numFrame;
+	s32 flag;
+	s32 masterKeyFrame;
+	s16 translateFlag;
+	s16 rotateFlag;
+	f32 time;
+	f32 translate[3];
+	f32 quat[4];
+	u32 sampleLength;
+	// followed by the sample name
+};
+
+//! Bounds-checked sequential reader for cache entries
+class CacheReader {
+	
+public:
+	
+	CacheReader(const char * data, size_t size) : m_data(data), m_size(size), m_pos(0) { }
+	
+	bool read(void * out, size_t size) {
+		if(size > m_size - m_pos) {
+			return false;
+		}
+		std::memcpy(out, m_data + m_pos, size);
+		m_pos += size;
+		return true;
+	}
+	
+	template <class T>
+	bool read(T & out) {
+		return read(&out, sizeof(T));
+	}
+	
+	bool read(std::string & out, size_t length) {
+		if(length > m_size - m_pos) {
+			return false;
+		}
+		out.assign(m_data + m_pos, length);
+		m_pos += length;
+		return true;
+	}
+	
+	bool atEnd() const { return m_pos == m_size; }
+	
+private:
+	
+	const char * m_data;
+	size_t m_size;
+	size_t m_pos;
+	
+};
+
+template <class T>
+void append(std::string & buffer, const T & value) {
+	buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+fs::path getCacheDir() {
+	return fs::paths.user / "cache" / "animations";
+}
+
+fs::path getCacheFile(const AnimationCache::Key & key) {
+	
+	// FNV-1a hash of the resource path
+	const std::string & name = key.file.string();
+	u64 hash = 14695981039346656037ull;
+	for(size_t i = 0; i < name.length(); i++) {
+		hash = (hash ^ u8(name[i])) * 1099511628211ull;
+	}
+	
+	std::ostringstream oss;
+	oss << std::hex << std::setfill('0') << std::setw(16) << hash << ".anim";
+	
+	return getCacheDir() / oss.str();
+}
+
+bool checkHeader(const AnimationCache::Key & key, CacheReader & reader) {
+	
+	CacheHeader header;
+	if(!reader.read(header)) {
+		return false;
+	}
+	
+	if(std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+	   || header.version != CACHE_VERSION || header.sourceSize != key.size
+	   || header.sourceTime != s64(key.mtime)) {
+		return false;
+	}
+	
+	std::string name;
+	return reader.read(name, header.pathLength) && name == key.file.string();
+}
+
+void freeAnimation(EERIE_ANIM * anim) {
+	delete[] anim->frames;
+	delete[] anim->tracks;
+	free(anim->keys);
+	free(anim->voidgroups);
+	free(anim);
+}
+
+//! Read the animation data, frame sounds are not loaded yet
+EERIE_ANIM * readAnimation(CacheReader & reader, std::vector<res::path> & samples) {
+	
+	CachedAnimation header;
+	if(!reader.read(header) || header.trackSize != sizeof(EERIE_ANIM_TRACK)
+	   || !header.keyFrames) {
+		return NULL;
+	}
+	
+	EERIE_ANIM * anim = allocStructZero<EERIE_ANIM>();
+	anim->anim_time = header.animTime;
+	anim->flag = header.flag;
+	anim->nb_groups = header.groups;
+	anim->nb_key_frames = header.keyFrames;
+	anim->nb_keys = header.keys;
+	anim->frames = new EERIE_FRAME[header.keyFrames]();
+	anim->voidgroups = allocStructZero<unsigned char>(header.groups);
+	anim->tracks = new EERIE_ANIM_TRACK[header.groups]();
+	anim->keys = allocStructZero<u16>(std::max(header.keys, u32(1)));
+	
+	samples.resize(header.keyFrames);
+	
+	bool ok = true;
+	for(u32 i = 0; i < header.keyFrames && ok; i++) {
+		CachedFrame saved;
+		std::string sample;
+		ok = reader.read(saved) && reader.read(sample, saved.sampleLength);
+		if(ok) {
+			EERIE_FRAME & frame = anim->frames[i];
+			frame.num_frame = saved.numFrame;
+			frame.flag = saved.flag;
+			frame.master_key_frame = saved.masterKeyFrame;
+			frame.f_translate = saved.translateFlag;
+			frame.f_rotate = saved.rotateFlag;
+			frame.time = saved.time;
+			frame.translate = Vec3f(saved.translate[0], saved.translate[1], saved.translate[2]);
+			frame.quat.x = saved.quat[0];
+			frame.quat.y = saved.quat[1];
+			frame.quat.z = saved.quat[2];
+			frame.quat.w = saved.quat[3];
+			frame.sample = -1;
+			samples[i] = res::path::load(sample);
+		}
+	}
+	
+	ok = ok && reader.read(anim->voidgroups, header.groups)
+	     && reader.read(anim->tracks, header.groups * sizeof(EERIE_ANIM_TRACK))
+	     && reader.read(anim->keys, header.keys * sizeof(u16)) && reader.atEnd();
+	
+	// Make sure all keys referenced by the tracks are there
+	for(u32 i = 0; i < header.groups && ok; i++) {
+		if(anim->voidgroups[i]) {
+			continue;
+		}
+		const EERIE_ANIM_CHANNEL * channels[] = {
+			&anim->tracks[i].rotation, &anim->tracks[i].translation, &anim->tracks[i].zoom
+		};
+		for(size_t j = 0; j < 3 && ok; j++) {
+			u64 last = u64(channels[j]->offset) + u64(channels[j]->stride) * (header.keyFrames - 1) + 3;
+			ok = (channels[j]->stride == 0 || channels[j]->stride == 3) && last <= header.keys;
+		}
+	}
+	
+	if(!ok) {
+		freeAnimation(anim);
+		return NULL;
+	}
+	
+	return anim;
+}
+
+} // anonymous namespace
+
+bool AnimationCache::isEnabled() {
+	return config.misc.animationCache && !fs::paths.user.empty();
+}
+
+bool AnimationCache::getKey(const res::path & file, Key & key) {
+	
+	if(!isEnabled()) {
+		return false;
+	}
+	
+	PakFile * source = resources->getFile(file);
+	if(!source || !source->mtime()) {
+		return false;
+	}
+	
+	key.file = file;
+	key.size = source->size();
+	key.mtime = source->mtime();
+	
+	return true;
+}
+
+EERIE_ANIM * AnimationCache::load(const Key & key) {
+	
+	fs::path file = getCacheFile(key);
+	if(!fs::exists(file)) {
+		return NULL;
+	}
+	
+	size_t size;
+	char * data = fs::read_file(file, size);
+	if(!data) {
+		return NULL;
+	}
+	
+	CacheReader reader(data, size);
+	if(!checkHeader(key, reader)) {
+		delete[] data;
+		LogDebug("discarding stale animation cache entry " << file << " for " << key.file);
+		fs::remove(file);
+		return NULL;
+	}
+	
+	std::vector<res::path> samples;
+	EERIE_ANIM * anim = readAnimation(reader, samples);
+	delete[] data;
+	if(!anim) {
+		LogWarning << "Corrupt animation cache entry " << file << " for " << key.file;
+		fs::remove(file);
+		return NULL;
+	}
+	
+	for(long i = 0; i < anim->nb_key_frames; i++) {
+		if(!samples[i].empty()) {
+			anim->frames[i].sample = ARX_SOUND_Load(samples[i]);
+		}
+	}
+	
+	return anim;
+}
+
+void AnimationCache::store(const Key & key, const EERIE_ANIM * anim,
+                           const std::vector<res::path> & samples) {
+	
+	arx_assert(samples.size() == size_t(anim->nb_key_frames));
+	
+	if(!fs::create_directories(getCacheDir())) {
+		LogWarning << "Could not create animation cache directory " << getCacheDir();
+		return;
+	}
+	
+	fs::path file = getCacheFile(key);
+	
+	const std::string & name = key.file.string();
+	
+	std::string buffer;
+	
+	// Value-initialize so that the padding written to the file is zero too
+	CacheHeader header = CacheHeader();
+	std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceSize = key.size;
+	header.sourceTime = key.mtime;
+	header.pathLength = name.length();
+	append(buffer, header);
+	buffer.append(name);
+	
+	CachedAnimation cached;
+	cached.animTime = anim->anim_time;
+	cached.flag = anim->flag;
+	cached.groups = anim->nb_groups;
+	cached.keyFrames = anim->nb_key_frames;
+	cached.keys = anim->nb_keys;
+	cached.trackSize = sizeof(EERIE_ANIM_TRACK);
+	append(buffer, cached);
+	
+	for(long i = 0; i < anim->nb_key_frames; i++) {
+		const EERIE_FRAME & frame = anim->frames[i];
+		const std::string & sample = samples[i].string();
+		CachedFrame saved;
+		saved.numFrame = frame.num_frame;
+		saved.flag = frame.flag;
+		saved.masterKeyFrame = frame.master_key_frame;
+		saved.translateFlag = frame.f_translate;
+		saved.rotateFlag = frame.f_rotate;
+		saved.time = frame.time;
+		saved.translate[0] = frame.translate.x;
+		saved.translate[1] = frame.translate.y;
+		saved.translate[2] = frame.translate.z;
+		saved.quat[0] = frame.quat.x;
+		saved.quat[1] = frame.quat.y;
+		saved.quat[2] = frame.quat.z;
+		saved.quat[3] = frame.quat.w;
+		saved.sampleLength = sample.length();
+		append(buffer, saved);
+		buffer.append(sample);
+	}
+	
+	buffer.append(reinterpret_cast<const char *>(anim->voidgroups), anim->nb_groups);
+	buffer.append(reinterpret_cast<const char *>(anim->tracks),
+	              anim->nb_groups * sizeof(EERIE_ANIM_TRACK));
+	buffer.append(reinterpret_cast<const char *>(anim->keys), anim->nb_keys * sizeof(u16));
+	
+	// Write to a temporary file first so that readers never see partial entries
+	fs::path temp = file;
+	temp.append(".tmp");
+	
+	{
+		fs::ofstream ofs(temp, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+		if(!ofs.is_open()) {
+			LogWarning << "Could not write animation cache entry " << file;
+			return;
+		}
+		ofs.write(buffer.data(), buffer.size());
+		if(ofs.fail()) {
+			LogWarning << "Could not write animation cache entry " << file;
+			ofs.close();
+			fs::remove(temp);
+			return;
+		}
+	}
+	
+	if(!fs::rename(temp, file, true)) {
+		fs::remove(temp);
+	}
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_ANIMATION_ANIMATIONCACHE_H
+#define ARX_ANIMATION_ANIMATIONCACHE_H
+
+#include <stddef.h>
+#include <ctime>
+#include <vector>
+
+#include "io/resource/ResourcePath.h"
+
+struct EERIE_ANIM;
+
+/*!
+ * Persistent cache of converted animations in the user directory.
+ *
+ * Entries hold the quantized runtime representation of a .tea file so that later
+ * runs do not need to parse and quantize it again. They are keyed by resource path
+ * and are discarded when the size or modification time of the source file (or its
+ * archive) changes.
+ */
+class AnimationCache {
+	
+public:
+	
+	//! Identifies an animation source file
+	struct Key {
+		res::path file;
+		size_t size;
+		std::time_t mtime;
+	};
+	
+	//! Is the animation cache enabled in the config
+	static bool isEnabled();
+	
+	/*!
+	 * Get the cache key for an animation file.
+	 * @return false if the cache is disabled or the file does not exist.
+	 */
+	static bool getKey(const res::path & file, Key & key);
+	
+	/*!
+	 * Load an animation from the cache, including its frame sounds.
+	 * Stale or corrupt entries are removed.
+	 * @return NULL if there is no valid entry for the key.
+	 */
+	static EERIE_ANIM * load(const Key & key);
+	
+	/*!
+	 * Store a converted animation in the cache.
+	 * @param samples The sound file for each key frame, empty if there is none.
+	 */
+	static void store(const Key & key, const EERIE_ANIM * anim,
+	                  const std::vector<res::path> & samples);
+	
+};
+
+#endif // ARX_ANIMATION_ANIMATIONCACHE_H
@@ -47,10 +47,25 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARX_SKIN_SSE2
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 #include "animation/Animation.h"
 
 #include "core/Application.h"
+#include "core/Config.h"
 #include "core/GameTime.h"
 #include "core/Core.h"
 
@@ -74,12 +89,17 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/particle/ParticleEffects.h"
 #include "graphics/effects/Halo.h"
 
+#include "io/log/Logger.h"
+
 #include "math/Angle.h"
 #include "math/Vector3.h"
 
 #include "physics/Collisions.h"
 
+#include "platform/JobSystem.h"
+#include "platform/Lock.h"
 #include "platform/Platform.h"
+#include "platform/Profiler.h"
 
 #include "scene/Light.h"
 #include "scene/GameSound.h"
@@ -1382,12 +1402,124 @@ static void StoreEntityMovement(Entity * io, Vec3f & ftr, float scale) {
 	}
 }
 
+namespace {
+
+//! Identifies the interpolated group transforms of one animation at one point in time
+struct PoseCacheKey {
+	
+	const EERIE_ANIM * anim;
+	long frame;
+	long pour; //!< Interpolation factor in units of 1 / POSE_CACHE_STEPS
+	
+	bool operator==(const PoseCacheKey & o) const {
+		return anim == o.anim && frame == o.frame && pour == o.pour;
+	}
+	
+};
+
+size_t hash_value(const PoseCacheKey & key) {
+	size_t seed = 0;
+	boost::hash_combine(seed, key.anim);
+	boost::hash_combine(seed, key.frame);
+	boost::hash_combine(seed, key.pour);
+	return seed;
+}
+
+struct PoseCacheEntry {
+	std::vector<BoneTransform> groups;
+	bool ready; //!< groups has been filled in, protected by g_poseCacheLock
+};
+
+} // anonymous namespace
+
+//! Resolution of the interpolation factor for poses shared through the pose cache
+static const float POSE_CACHE_STEPS = 256.f;
+
+/*!
+ * Group transforms sampled during the current EERIEDrawAnimQuatFinishUpdates call.
+ * Entities playing the same animation frame reuse them instead of interpolating again.
+ */
+static bool g_poseCacheActive = false;
+static Lock * g_poseCacheLock = NULL;
+static boost::unordered_map<PoseCacheKey, PoseCacheEntry *> g_poseCache;
+static std::vector<PoseCacheEntry *> g_poseCacheEntries; //!< Reused between frames
+static size_t g_poseCacheUsed = 0;
+
+static void sampleGroup(const EERIE_ANIM * eanim, long fr, float pour, long group,
+                        BoneTransform & out) {
+	
+	EERIE_GROUP sGroup = GetAnimGroup(eanim, fr, group);
+	EERIE_GROUP eGroup = GetAnimGroup(eanim, fr + 1, group);
+	
+	out.quat = Quat_Slerp(sGroup.quat, eGroup.quat, pour);
+	out.trans = sGroup.translate + (eGroup.translate - sGroup.translate) * pour;
+	out.scale = sGroup.zoom + (eGroup.zoom - sGroup.zoom) * pour;
+}
+
+/*!
+ * Get the group transforms of an animation frame from the pose cache.
+ * 
+ * \return NULL if another thread is still sampling this frame
+ */
+static const BoneTransform * getCachedPose(const EERIE_ANIM * eanim, long fr, long pour) {
+	
+	PoseCacheKey key;
+	key.anim = eanim;
+	key.frame = fr;
+	key.pour = pour;
+	
+	PoseCacheEntry * entry;
+	{
+		Autolock lock(g_poseCacheLock);
+		
+		boost::unordered_map<PoseCacheKey, PoseCacheEntry *>::const_iterator it = g_poseCache.find(key);
+		if(it != g_poseCache.end()) {
+			return it->second->ready ? &it->second->groups[0] : NULL;
+		}
+		
+		if(g_poseCacheUsed == g_poseCacheEntries.size()) {
+			g_poseCacheEntries.push_back(new PoseCacheEntry);
+		}
+		entry = g_poseCacheEntries[g_poseCacheUsed++];
+		entry->ready = false;
+		g_poseCache[key] = entry;
+	}
+	
+	entry->groups.resize(eanim->nb_groups);
+	float t = float(pour) / POSE_CACHE_STEPS;
+	for(long j = 0; j < eanim->nb_groups; j++) {
+		sampleGroup(eanim, fr, t, j, entry->groups[j]);
+	}
+	
+	Autolock lock(g_poseCacheLock);
+	entry->ready = true;
+	return &entry->groups[0];
+}
+
+static void clearPoseCache() {
+	g_poseCache.clear();
+	g_poseCacheUsed = 0;
+}
+
+static void releasePoseCache() {
+	clearPoseCache();
+	for(size_t i = 0; i < g_poseCacheEntries.size(); i++) {
+		delete g_poseCacheEntries[i];
+	}
+	g_poseCacheEntries.clear();
+	delete g_poseCacheLock, g_poseCacheLock = NULL;
+}
+
 /*!
  * Animate skeleton
  */
 static void Cedric_AnimateObject(EERIE_C_DATA * obj, ANIM_USE * animlayer)
 {
-	std::vector<unsigned char> grps(obj->nb_bones);
+	const EERIE_ANIM * anims[MAX_ANIM_LAYERS];
+	const BoneTransform * poses[MAX_ANIM_LAYERS];
+	long frames[MAX_ANIM_LAYERS];
+	float pours[MAX_ANIM_LAYERS];
+	size_t nlayers = 0;
 
 	for(long count = MAX_ANIM_LAYERS - 1; count >= 0; count--) {
 
@@ -1409,32 +1541,47 @@ static void Cedric_AnimateObject(EERIE_C_DATA * obj, ANIM_USE * animlayer)
 		}
 		animuse->pour = clamp(animuse->pour, 0.f, 1.f);
 
-		// Now go for groups rotation/translation/scaling, And transform Linked objects by the way
-		int l = std::min(obj->nb_bones - 1, eanim->nb_groups - 1);
+		anims[nlayers] = eanim;
+		poses[nlayers] = NULL;
+		frames[nlayers] = animuse->fr;
+		pours[nlayers] = animuse->pour;
 
-		for(int j = l; j >= 0; j--) {
-			if(grps[j])
-				continue;
+		// Share the interpolated groups with other entities playing the same frame
+		if(g_poseCacheActive && eanim->nb_key_frames != 1 && eanim->nb_groups > 0) {
+			long pour = long(animuse->pour * POSE_CACHE_STEPS + 0.5f);
+			pours[nlayers] = float(pour) / POSE_CACHE_STEPS;
+			poses[nlayers] = getCachedPose(eanim, animuse->fr, pour);
+		}
 
-			EERIE_GROUP * sGroup = &eanim->groups[j+(animuse->fr*eanim->nb_groups)];
-			EERIE_GROUP * eGroup = &eanim->groups[j+(animuse->fr*eanim->nb_groups)+eanim->nb_groups];
+		nlayers++;
+	}
 
-			if(!eanim->voidgroups[j])
-				grps[j] = 1;
+	// Now go for groups rotation/translation/scaling, And transform Linked objects by the way
+	// Each bone is driven by the topmost layers down to the first one that does not leave it void
+	for(long j = 0; j < obj->nb_bones; j++) {
+		EERIE_BONE & bone = obj->bones[j];
 
-			if(eanim->nb_key_frames != 1) {
-				EERIE_BONE & bone = obj->bones[j];
+		for(size_t layer = 0; layer < nlayers; layer++) {
+			const EERIE_ANIM * eanim = anims[layer];
 
-				BoneTransform temp;
+			if(j >= eanim->nb_groups)
+				continue;
 
-				temp.quat = Quat_Slerp(sGroup->quat, eGroup->quat, animuse->pour);
-				temp.trans = sGroup->translate + (eGroup->translate - sGroup->translate) * animuse->pour;
-				temp.scale = sGroup->zoom + (eGroup->zoom - sGroup->zoom) * animuse->pour;
+			if(eanim->nb_key_frames != 1) {
+				BoneTransform temp;
+				if(poses[layer]) {
+					temp = poses[layer][j];
+				} else {
+					sampleGroup(eanim, frames[layer], pours[layer], j, temp);
+				}
 
 				bone.init.quat = Quat_Multiply(bone.init.quat, temp.quat);
 				bone.init.trans = temp.trans + bone.transinit_global;
 				bone.init.scale = temp.scale;
 			}
+
+			if(!eanim->voidgroups[j])
+				break;
 		}
 	}
 }
@@ -1503,12 +1650,132 @@ static void Cedric_ConcatenateTM(EERIE_C_DATA & rig, const TransformInfo & t) {
 	}
 }
 
+//! Writes one skinned vertex: world position and, if requested, the position relative to pos
+static inline void storeSkinnedVertex(EERIE_3DOBJ * eobj, long index, const Vec3f & world,
+                                      const Vec3f & pos, bool relative) {
+	
+	EERIE_VERTEX & outVert = eobj->vertexlist3[index];
+	outVert.v = world;
+	outVert.vert.p = world;
+	
+	if(relative) {
+		eobj->vertexlist[index].vert.p = world - pos;
+	}
+}
+
+#if defined(ARX_SKIN_SSE2)
+
+static void skinBoneSSE2(EERIE_3DOBJ * eobj, const EERIE_BONE & bone, const EERIEMATRIX & m,
+                         const Vec3f & pos, bool relative) {
+	
+	const __m128 m11 = _mm_set1_ps(m._11), m12 = _mm_set1_ps(m._12), m13 = _mm_set1_ps(m._13);
+	const __m128 m21 = _mm_set1_ps(m._21), m22 = _mm_set1_ps(m._22), m23 = _mm_set1_ps(m._23);
+	const __m128 m31 = _mm_set1_ps(m._31), m32 = _mm_set1_ps(m._32), m33 = _mm_set1_ps(m._33);
+	const __m128 tx = _mm_set1_ps(bone.anim.trans.x);
+	const __m128 ty = _mm_set1_ps(bone.anim.trans.y);
+	const __m128 tz = _mm_set1_ps(bone.anim.trans.z);
+	
+	const float * block = bone.localblocks;
+	for(long v = 0; v < bone.nb_idxvertices; v += 4, block += 12) {
+		
+		__m128 x = _mm_loadu_ps(block);
+		__m128 y = _mm_loadu_ps(block + 4);
+		__m128 z = _mm_loadu_ps(block + 8);
+		
+		// Same evaluation order as TransformVertexMatrix() followed by the translation
+		__m128 wx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m11), _mm_mul_ps(y, m21)),
+		                                  _mm_mul_ps(z, m31)), tx);
+		__m128 wy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m12), _mm_mul_ps(y, m22)),
+		                                  _mm_mul_ps(z, m32)), ty);
+		__m128 wz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m13), _mm_mul_ps(y, m23)),
+		                                  _mm_mul_ps(z, m33)), tz);
+		
+		float out[12];
+		_mm_storeu_ps(out, wx);
+		_mm_storeu_ps(out + 4, wy);
+		_mm_storeu_ps(out + 8, wz);
+		
+		long count = std::min(bone.nb_idxvertices - v, 4l);
+		for(long i = 0; i < count; i++) {
+			Vec3f world(out[i], out[4 + i], out[8 + i]);
+			storeSkinnedVertex(eobj, bone.idxvertices[v + i], world, pos, relative);
+		}
+	}
+}
+
+#endif // defined(ARX_SKIN_SSE2)
+
+#ifdef __ARM_NEON__
+
+static void skinBoneNEON(EERIE_3DOBJ * eobj, const EERIE_BONE & bone, const EERIEMATRIX & m,
+                         const Vec3f & pos, bool relative) {
+	
+	const float32x4_t tx = vdupq_n_f32(bone.anim.trans.x);
+	const float32x4_t ty = vdupq_n_f32(bone.anim.trans.y);
+	const float32x4_t tz = vdupq_n_f32(bone.anim.trans.z);
+	
+	const float * block = bone.localblocks;
+	for(long v = 0; v < bone.nb_idxvertices; v += 4, block += 12) {
+		
+		float32x4_t x = vld1q_f32(block);
+		float32x4_t y = vld1q_f32(block + 4);
+		float32x4_t z = vld1q_f32(block + 8);
+		
+		float32x4_t wx = vaddq_f32(vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m._11), y, m._21),
+		                                       z, m._31), tx);
+		float32x4_t wy = vaddq_f32(vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m._12), y, m._22),
+		                                       z, m._32), ty);
+		float32x4_t wz = vaddq_f32(vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m._13), y, m._23),
+		                                       z, m._33), tz);
+		
+		float out[12];
+		vst1q_f32(out, wx);
+		vst1q_f32(out + 4, wy);
+		vst1q_f32(out + 8, wz);
+		
+		long count = std::min(bone.nb_idxvertices - v, 4l);
+		for(long i = 0; i < count; i++) {
+			Vec3f world(out[i], out[4 + i], out[8 + i]);
+			storeSkinnedVertex(eobj, bone.idxvertices[v + i], world, pos, relative);
+		}
+	}
+}
+
+#endif // defined(__ARM_NEON__)
+
+#if !defined(ARX_SKIN_SSE2) && !defined(__ARM_NEON__)
+
+static void skinBoneScalar(EERIE_3DOBJ * eobj, const EERIE_BONE & bone, const EERIEMATRIX & m,
+                           const Vec3f & pos, bool relative) {
+	
+	const float * block = bone.localblocks;
+	for(long v = 0; v < bone.nb_idxvertices; v++) {
+		
+		const float * local = &block[(v / 4) * 12 + (v % 4)];
+		Vec3f in(local[0], local[4], local[8]);
+		
+		Vec3f world;
+		TransformVertexMatrix(const_cast<EERIEMATRIX *>(&m), &in, &world);
+		world += bone.anim.trans;
+		
+		storeSkinnedVertex(eobj, bone.idxvertices[v], world, pos, relative);
+	}
+}
+
+#endif
+
 /*!
  * Transform object vertices
+ *
+ * Each vertex belongs to exactly one bone, so the world positions in vertexlist3 and,
+ * for objects with sdata, the positions relative to pos in vertexlist are written in
+ * the same pass.
  */
 void Cedric_TransformVerts(EERIE_3DOBJ *eobj, const Vec3f & pos) {
 
 	EERIE_C_DATA & rig = *eobj->c_data;
+	
+	bool relative = (eobj->sdata != NULL);
 
 	// Transform & project all vertices
 	for(long i = 0; i != rig.nb_bones; i++) {
@@ -1531,25 +1798,13 @@ void Cedric_TransformVerts(EERIE_3DOBJ *eobj, const Vec3f & pos) {
 		matrix._32 *= bone.anim.scale.z;
 		matrix._33 *= bone.anim.scale.z;
 
-		Vec3f vector = bone.anim.trans;
-
-		for(int v = 0; v != bone.nb_idxvertices; v++) {
-			long index = bone.idxvertices[v];
-
-			EERIE_3DPAD * inVert  = &eobj->vertexlocal[index];
-			EERIE_VERTEX * outVert = &eobj->vertexlist3[index];
-
-			TransformVertexMatrix(&matrix, inVert, &outVert->v);
-			outVert->v += vector;
-
-			outVert->vert.p = outVert->v;
-		}
-	}
-
-	if(eobj->sdata) {
-		for(size_t i = 0; i < eobj->vertexlist.size(); i++) {
-			eobj->vertexlist[i].vert.p = eobj->vertexlist3[i].v - pos;
-		}
+#if defined(ARX_SKIN_SSE2)
+		skinBoneSSE2(eobj, bone, matrix, pos, relative);
+#elif defined(__ARM_NEON__)
+		skinBoneNEON(eobj, bone, matrix, pos, relative);
+#else
+		skinBoneScalar(eobj, bone, matrix, pos, relative);
+#endif
 	}
 }
 
@@ -1625,7 +1880,40 @@ void Cedric_AnimateDrawEntity(EERIE_C_DATA & rig, ANIM_USE * animlayer, EERIE_EX
 	}
 }
 
-void EERIEDrawAnimQuatUpdate(EERIE_3DOBJ *eobj, ANIM_USE * animlayer,const Anglef & angle, const Vec3f & pos, unsigned long time, Entity *io, bool update_movement) {
+namespace {
+
+//! Pose work of one animation update - only touches the entity's own rig and vertices
+struct AnimationPoseJob {
+	EERIE_3DOBJ * eobj;
+	ANIM_USE * animlayer;
+	Entity * io;
+	Vec3f pos;
+	Vec3f ftr;
+	EERIE_QUAT rotation;
+	float scale;
+	long lodSteps; //!< Interpolation steps left until lodTarget is reached, 0 = full update
+	bool lodSample; //!< Sample a new lodTarget pose
+};
+
+} // anonymous namespace
+
+static std::vector<AnimationPoseJob> g_poseJobs;
+
+//! Number of entities per animation LOD in the current and in the last finished batch
+static long g_queuedLodCounts[AnimationLodCount];
+long g_animationLodCounts[AnimationLodCount];
+
+/*!
+ * Advance the animation layers and store the entity movement.
+ * This triggers frame sounds, animation end events and step sounds, so it must run on the
+ * main thread.
+ * 
+ * \return false if the entity is not visible and its pose does not need to be updated.
+ */
+static bool EERIEDrawAnimQuatPrepare(AnimationPoseJob & job, EERIE_3DOBJ * eobj,
+                                     ANIM_USE * animlayer, const Anglef & angle,
+                                     const Vec3f & pos, unsigned long time, Entity * io,
+                                     bool update_movement) {
 
 	if(io) {
 		float speedfactor = io->basespeed + io->speed_modif;
@@ -1658,13 +1946,96 @@ void EERIEDrawAnimQuatUpdate(EERIE_3DOBJ *eobj, ANIM_USE * animlayer,const Angle
 		StoreEntityMovement(io, ftr, scale);
 
 	if(io && io != entities.player() && !Cedric_IO_Visible(io->pos))
+		return false;
+
+	bool isNpc = io && (io->ioflags & IO_NPC);
+	worldAngleToQuat(&job.rotation, angle, isNpc);
+
+	job.eobj = eobj;
+	job.animlayer = animlayer;
+	job.io = io;
+	job.pos = pos;
+	job.ftr = ftr;
+	job.scale = scale;
+	job.lodSteps = 0;
+	job.lodSample = false;
+
+	return true;
+}
+
+static AnimationLod selectAnimationLod(Entity * io, const Vec3f & pos) {
+
+	if(!io || io == entities.player() || config.video.animationLodNear <= 0 || !ACTIVECAM) {
+		return AnimationLodFull;
+	}
+
+	float distance = distSqr(ACTIVECAM->orgTrans.pos, pos);
+	if(distance >= square(float(config.video.animationLodFar))) {
+		return AnimationLodFar;
+	}
+
+	if(ARX_SCENE_PORTAL_ClipIO(io, pos)) {
+		return AnimationLodFar;
+	}
+
+	if(distance >= square(float(config.video.animationLodNear))) {
+		return AnimationLodReduced;
+	}
+
+	return AnimationLodFull;
+}
+
+//! Decide how the pose of a queued entity is updated this frame
+static void updateAnimationLod(AnimationPoseJob & job) {
+
+	Entity * io = job.io;
+	AnimationLod lod = selectAnimationLod(io, job.pos);
+	g_queuedLodCounts[lod]++;
+
+	if(lod == AnimationLodFull) {
+		if(io) {
+			io->animLod.lod = lod;
+			io->animLod.framesLeft = 0;
+		}
 		return;
+	}
 
-	EERIE_QUAT rotation;
+	AnimationLodStatus & status = io->animLod;
+	if(status.lod == AnimationLodFull || status.framesLeft <= 0) {
+		long interval = config.video.animationLodInterval;
+		status.framesLeft = (lod == AnimationLodFar) ? interval * 2 : interval;
+		job.lodSample = true;
+	}
 
-	bool isNpc = io && (io->ioflags & IO_NPC);
-	worldAngleToQuat(&rotation, angle, isNpc);
+	job.lodSteps = status.framesLeft--;
+	status.lod = lod;
+}
+
+/*!
+ * Move the local pose of all bones 1/steps of the way towards their lodTarget pose.
+ */
+static void interpolateLodPose(EERIE_C_DATA & rig, long steps) {
+
+	float t = 1.f / float(steps);
+
+	for(long i = 0; i < rig.nb_bones; i++) {
+		BoneTransform & pose = rig.bones[i].init;
+		const BoneTransform & target = rig.bones[i].lodTarget;
+
+		pose.quat = Quat_Slerp(pose.quat, target.quat, t);
+		pose.trans = pose.trans + (target.trans - pose.trans) * t;
+		pose.scale = pose.scale + (target.scale - pose.scale) * t;
+	}
+}
 
+/*!
+ * Animate the skeleton and transform the vertices of one entity.
+ * Only reads shared state, so different entities can be updated in parallel.
+ */
+static void EERIEDrawAnimQuatPose(const AnimationPoseJob & job) {
+
+	EERIE_3DOBJ * eobj = job.eobj;
+	Entity * io = job.io;
 
 	EERIE_EXTRA_ROTATE * extraRotation = NULL;
 	AnimationBlendStatus * animBlend = NULL;
@@ -1687,13 +2058,37 @@ void EERIEDrawAnimQuatUpdate(EERIE_3DOBJ *eobj, ANIM_USE * animlayer,const Angle
 	arx_assert(eobj->c_data);
 	EERIE_C_DATA & skeleton = *eobj->c_data;
 
-	Cedric_AnimateDrawEntity(skeleton, animlayer, extraRotation, animBlend, extraScale);
+	if(job.lodSteps == 0) {
+		Cedric_AnimateDrawEntity(skeleton, job.animlayer, extraRotation, animBlend, extraScale);
+	} else {
+		
+		// Reduced LOD: sample the animation every few frames without blending and
+		// interpolate from the currently displayed pose towards the last sample
+		if(job.lodSample) {
+			for(long i = 0; i < skeleton.nb_bones; i++) {
+				skeleton.bones[i].lodTarget = skeleton.bones[i].init;
+			}
+			Cedric_AnimateDrawEntity(skeleton, job.animlayer, extraRotation, NULL, extraScale);
+			for(long i = 0; i < skeleton.nb_bones; i++) {
+				std::swap(skeleton.bones[i].init, skeleton.bones[i].lodTarget);
+			}
+		}
+		
+		interpolateLodPose(skeleton, job.lodSteps);
+		
+		// Keep the blend source current for when the entity returns to full LOD
+		if(animBlend) {
+			for(long i = 0; i < skeleton.nb_bones; i++) {
+				skeleton.bones[i].last = skeleton.bones[i].init;
+			}
+		}
+	}
 
 	// Build skeleton in Object Space
-	TransformInfo t(pos, rotation, scale, ftr);
+	TransformInfo t(job.pos, job.rotation, job.scale, job.ftr);
 	Cedric_ConcatenateTM(skeleton, t);
 
-	Cedric_TransformVerts(eobj, pos);
+	Cedric_TransformVerts(eobj, job.pos);
 	if(io) {
 		UpdateBbox3d(eobj, io->bbox3D);
 	}
@@ -1701,6 +2096,73 @@ void EERIEDrawAnimQuatUpdate(EERIE_3DOBJ *eobj, ANIM_USE * animlayer,const Angle
 	Cedric_ViewProjectTransform(io, eobj);
 }
 
+void EERIEDrawAnimQuatUpdate(EERIE_3DOBJ *eobj, ANIM_USE * animlayer,const Anglef & angle, const Vec3f & pos, unsigned long time, Entity *io, bool update_movement) {
+
+	AnimationPoseJob job;
+	if(EERIEDrawAnimQuatPrepare(job, eobj, animlayer, angle, pos, time, io, update_movement)) {
+		EERIEDrawAnimQuatPose(job);
+	}
+}
+
+void EERIEDrawAnimQuatQueueUpdate(EERIE_3DOBJ * eobj, ANIM_USE * animlayer, const Anglef & angle,
+                                  const Vec3f & pos, unsigned long time, Entity * io,
+                                  bool update_movement) {
+
+	AnimationPoseJob job;
+	if(EERIEDrawAnimQuatPrepare(job, eobj, animlayer, angle, pos, time, io, update_movement)) {
+		updateAnimationLod(job);
+		g_poseJobs.push_back(job);
+	}
+}
+
+namespace {
+
+//! Update a range of the queued poses
+struct PoseJobRange {
+	
+	void operator()(size_t begin, size_t end) {
+		
+		ARX_PROFILE("Animation Update");
+		
+		for(size_t i = begin; i < end; i++) {
+			EERIEDrawAnimQuatPose(g_poseJobs[i]);
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
+void EERIEDrawAnimQuatFinishUpdates() {
+	
+	ARX_PROFILE_FUNC();
+
+	std::copy(g_queuedLodCounts, g_queuedLodCounts + AnimationLodCount, g_animationLodCounts);
+	std::fill_n(g_queuedLodCounts, size_t(AnimationLodCount), 0);
+
+	if(g_poseJobs.empty()) {
+		return;
+	}
+
+	if(!g_poseCacheLock) {
+		g_poseCacheLock = new Lock();
+	}
+
+	g_poseCacheActive = true;
+
+	PoseJobRange range;
+	jobs::parallelFor(0, g_poseJobs.size(), range);
+
+	g_poseCacheActive = false;
+	clearPoseCache();
+
+	g_poseJobs.clear();
+}
+
+void ReleaseAnimationPoseCache() {
+	releasePoseCache();
+}
+
 void EERIEDrawAnimQuatRender(EERIE_3DOBJ *eobj, const Vec3f & pos, Entity *io, bool render, float invisibility) {
 
 	if(io && io != entities.player() && !Cedric_IO_Visible(io->pos))
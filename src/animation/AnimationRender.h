@@ -97,6 +97,25 @@ void DrawEERIEInter_Render(EERIE_3DOBJ *eobj, const TransformInfo &t, Entity *io
 void DrawEERIEInter(EERIE_3DOBJ *eobj, const TransformInfo & t, Entity *io, bool forceDraw = false, float invisibility = 0.f);
 
 void EERIEDrawAnimQuatUpdate(EERIE_3DOBJ *eobj, ANIM_USE * animlayer,const Anglef & angle, const Vec3f & pos, unsigned long time, Entity *io, bool update_movement);
+
+/*!
+ * Like EERIEDrawAnimQuatUpdate, but only advances the animation and stores the movement now.
+ * The skeleton and vertices are updated by the next EERIEDrawAnimQuatFinishUpdates call.
+ * The entity's rig and vertex arrays must not be shared with other queued entities.
+ */
+void EERIEDrawAnimQuatQueueUpdate(EERIE_3DOBJ * eobj, ANIM_USE * animlayer, const Anglef & angle,
+                                  const Vec3f & pos, unsigned long time, Entity * io,
+                                  bool update_movement);
+
+//! Update all queued entity poses in parallel and wait until they are done
+void EERIEDrawAnimQuatFinishUpdates();
+
+//! Number of entities updated at each AnimationLod by the last EERIEDrawAnimQuatFinishUpdates call
+extern long g_animationLodCounts[]; // indexed by AnimationLod
+
+//! Free the pose cache used by EERIEDrawAnimQuatFinishUpdates
+void ReleaseAnimationPoseCache();
+
 void EERIEDrawAnimQuatRender(EERIE_3DOBJ *eobj, const Vec3f & pos, Entity *io, bool render, float invisibility);
 
 void EERIEDrawAnimQuat(EERIE_3DOBJ *eobj, ANIM_USE * animlayer, const Anglef & angle, const Vec3f & pos, unsigned long time, Entity *io, bool render = true, bool update_movement = true, float invisibility = 0.f);
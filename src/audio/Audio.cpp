@@ -43,20 +43,25 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "audio/Audio.h"
 
+#include <algorithm>
+
 #include "Configure.h"
 
 #include "audio/AudioResource.h"
 #include "audio/Mixer.h"
 #include "audio/Sample.h"
+#include "audio/SampleCache.h"
 #include "audio/Ambiance.h"
 #include "audio/AudioGlobal.h"
 #include "audio/AudioBackend.h"
 #include "audio/AudioSource.h"
 #include "audio/AudioEnvironment.h"
+#include "audio/software/SoftwareBackend.h"
 #ifdef ARX_HAVE_OPENAL
 	#include "audio/openal/OpenALBackend.h"
 #endif
 
+#include "io/fs/FilePath.h"
 #include "io/log/Logger.h"
 
 #include "platform/Lock.h"
@@ -68,6 +73,10 @@ namespace audio {
 
 namespace {
 static Lock * mutex = NULL;
+//! Backend used by renderOffline(), if initialized with initOffline()
+static SoftwareBackend * offlineBackend = NULL;
+//! Rendered time not yet mixed by renderOffline(), in ms * frequency
+static size_t offlinePendingTime = 0;
 }
 
 aalError init(const string & backendName, bool enableEAX) {
@@ -101,6 +110,18 @@ aalError init(const string & backendName, bool enableEAX) {
 		}
 		#endif
 		
+		if(!backend && first && backendName == "Software") {
+			matched = true;
+			LogDebug("initializing software backend");
+			SoftwareBackend * _backend = new SoftwareBackend();
+			error = _backend->init(fs::path(), true);
+			if(!error) {
+				backend = _backend;
+			} else {
+				delete _backend;
+			}
+		}
+		
 		if(first && !matched) {
 			LogError << "Unknown backend: " << backendName;
 		}
@@ -122,6 +143,29 @@ aalError init(const string & backendName, bool enableEAX) {
 	return AAL_OK;
 }
 
+aalError initOffline(const fs::path & output) {
+	
+	clean();
+	
+	LogDebug("Init offline");
+	
+	stream_limit_bytes = DEFAULT_STREAMLIMIT;
+	
+	SoftwareBackend * _backend = new SoftwareBackend();
+	if(aalError error = _backend->init(output, false)) {
+		delete _backend;
+		return error;
+	}
+	backend = offlineBackend = _backend;
+	offlinePendingTime = 0;
+	
+	mutex = new Lock();
+	
+	session_time = 0;
+	
+	return AAL_OK;
+}
+
 aalError clean() {
 	
 	if(!backend) {
@@ -135,7 +179,10 @@ aalError clean() {
 	_mixer.clear();
 	_env.clear();
 	
+	sample_cache.clear();
+	
 	delete backend, backend = NULL;
+	offlineBackend = NULL;
 	
 	sample_path.clear();
 	ambiance_path.clear();
@@ -173,6 +220,8 @@ aalError setSamplePath(const res::path & path) {
 	
 	sample_path = path;
 	
+	sample_cache.clear();
+	
 	return AAL_OK;
 }
 
@@ -201,11 +250,8 @@ aalError setReverbEnabled(bool enable) {
 	return backend->setReverbEnabled(enable);
 }
 
-aalError update() {
-	
-	AAL_ENTRY
-	
-	session_time = Time::getMs();
+//! Update sources, ambiances and samples for the current session_time
+static aalError updateResources() {
 	
 	// Update sources
 	for(Backend::source_iterator p = backend->sourcesBegin(); p != backend->sourcesEnd();) {
@@ -239,6 +285,47 @@ aalError update() {
 	return backend->updateDeferred();
 }
 
+aalError update() {
+	
+	AAL_ENTRY
+	
+	session_time = Time::getMs();
+	
+	return updateResources();
+}
+
+aalError renderOffline(size_t duration) {
+	
+	AAL_ENTRY
+	
+	if(!offlineBackend) {
+		return AAL_ERROR_INIT;
+	}
+	
+	// Advance in small steps so that ambiance tracks start with the same precision as in game
+	const size_t step = 10;
+	
+	for(size_t t = 0; t < duration; t += step) {
+		
+		size_t interval = std::min(step, duration - t);
+		
+		session_time += interval;
+		
+		if(aalError error = updateResources()) {
+			return error;
+		}
+		
+		offlinePendingTime += interval * SoftwareBackend::frequency;
+		size_t frames = offlinePendingTime / 1000;
+		offlinePendingTime -= frames * 1000;
+		if(aalError error = offlineBackend->render(frames)) {
+			return error;
+		}
+	}
+	
+	return AAL_OK;
+}
+
 // Resource creation
 
 MixerId createMixer() {
@@ -299,6 +386,19 @@ EnvId createEnvironment(const res::path & name) {
 	return e_id;
 }
 
+aalError preloadSamples() {
+	
+	AAL_ENTRY
+	
+	for(size_t i = 0; i < _sample.size(); i++) {
+		if(_sample[i]) {
+			sample_cache.preload(_sample[i]);
+		}
+	}
+	
+	return AAL_OK;
+}
+
 // Resource destruction
 
 aalError deleteSample(SampleId sample_id) {
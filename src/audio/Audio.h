@@ -50,6 +50,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "audio/AudioTypes.h"
 #include "math/MathFwd.h"
 
+namespace fs { class path; }
 namespace res { class path; }
 
 namespace audio {
@@ -63,6 +64,14 @@ namespace audio {
  */
 aalError init(const std::string & backend, bool enableEAX);
 
+/*!
+ * Initialize the audio system with the software backend for offline rendering.
+ * Audio time only advances when calling renderOffline().
+ * This is not threadsafe: The caller must ensure that no other audio methods are called at the same time.
+ * \param output WAV file to write the mixed audio to, or an empty path to discard it.
+ */
+aalError initOffline(const fs::path & output);
+
 /*!
  * Cleanup the audio system.
  * This is not threadsafe: The caller must ensure that no other audio methods are called at the same time.
@@ -75,12 +84,20 @@ aalError setEnvironmentPath(const res::path & path);
 aalError setReverbEnabled(bool enable);
 aalError update();
 
+/*!
+ * Update and mix the given duration (in ms) of audio as fast as possible.
+ * Only available after initOffline().
+ */
+aalError renderOffline(size_t duration);
+
 // Resource
 
 MixerId createMixer();
 SampleId createSample(const res::path & name);
 AmbianceId createAmbiance(const res::path & name);
 EnvId createEnvironment(const res::path & name);
+//! Decode all currently loaded samples into the sample cache, so that playing them doesn't need to touch the files
+aalError preloadSamples();
 aalError deleteSample(SampleId sample_id);
 aalError deleteAmbiance(AmbianceId ambiance_id);
 
@@ -45,6 +45,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "audio/Mixer.h"
 #include "audio/Sample.h"
+#include "audio/SampleCache.h"
 #include "audio/Ambiance.h"
 #include "audio/AudioEnvironment.h"
 
@@ -68,6 +69,8 @@ ResourceList<Sample> _sample;
 ResourceList<Ambiance> _amb;
 ResourceList<Environment> _env;
 
+SampleCache sample_cache(DEFAULT_SAMPLE_CACHE_SIZE);
+
 size_t unitsToBytes(size_t v, const PCMFormat & _format, TimeUnit unit) {
 	switch(unit) {
 		case UNIT_MS:
@@ -60,6 +60,7 @@ class Ambiance;
 class Environment;
 class Sample;
 class Mixer;
+class SampleCache;
 
 const ChannelFlags FLAG_ANY_3D_FX = FLAG_POSITION | FLAG_VELOCITY | FLAG_DIRECTION |
                                     FLAG_CONE | FLAG_FALLOFF | FLAG_REVERBERATION;
@@ -80,6 +81,9 @@ extern ResourceList<Sample> _sample;
 extern ResourceList<Ambiance> _amb;
 extern ResourceList<Environment> _env;
 
+//! Decoded data for non-streamed samples
+extern SampleCache sample_cache;
+
 //! Convert a value from time units to bytes
 size_t unitsToBytes(size_t v, const PCMFormat & format, TimeUnit unit = UNIT_MS);
 
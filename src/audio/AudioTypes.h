@@ -52,6 +52,7 @@ namespace audio {
 
 // Default values
 const size_t DEFAULT_STREAMLIMIT = 88200; // in Bytes; ~1 second for the correct format
+const size_t DEFAULT_SAMPLE_CACHE_SIZE = 16 * 1024 * 1024; // in Bytes
 
 const float DEFAULT_ENVIRONMENT_SIZE = 7.5f;
 const float DEFAULT_ENVIRONMENT_DIFFUSION = 1.f; // High density echoes
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio/SampleCache.h"
+
+#include <algorithm>
+
+#include "audio/Sample.h"
+#include "audio/Stream.h"
+#include "io/log/Logger.h"
+#include "platform/Platform.h"
+
+namespace audio {
+
+namespace {
+
+bool decodeSample(const Sample * sample, std::vector<char> & data) {
+	
+	size_t length = sample->getLength();
+	
+	// Always allocate at least one byte so that empty samples have a valid pointer
+	data.resize(std::max(length, size_t(1)));
+	
+	Stream * stream = createStream(sample->getName());
+	if(!stream) {
+		return false;
+	}
+	
+	size_t read;
+	stream->read(&data[0], length, read);
+	deleteStream(stream);
+	
+	return (read == length);
+}
+
+} // anonymous namespace
+
+SampleCache::SampleCache(size_t _budget) : budget(_budget), size(0) { }
+
+const char * SampleCache::get(const Sample * sample) {
+	
+	Entries::iterator it = entries.find(sample->getName());
+	if(it != entries.end()) {
+		if(it->second.data.size() >= sample->getLength()) {
+			usage.splice(usage.begin(), usage, it->second.usage);
+			return &it->second.data[0];
+		}
+		// The sample was reloaded with a different length
+		size -= it->second.data.size();
+		usage.erase(it->second.usage);
+		entries.erase(it);
+	}
+	
+	if(sample->getLength() > maxEntrySize()) {
+		if(!decodeSample(sample, scratch)) {
+			return NULL;
+		}
+		return &scratch[0];
+	}
+	
+	std::vector<char> data;
+	if(!decodeSample(sample, data)) {
+		return NULL;
+	}
+	
+	evict(data.size());
+	
+	Entry & entry = entries[sample->getName()];
+	entry.data.swap(data);
+	entry.usage = usage.insert(usage.begin(), sample->getName());
+	size += entry.data.size();
+	
+	LogDebug("cached sample " << sample->getName() << ": " << size << " / " << budget << " bytes");
+	
+	return &entry.data[0];
+}
+
+void SampleCache::preload(const Sample * sample) {
+	
+	if(sample->getLength() > maxEntrySize()) {
+		return;
+	}
+	
+	if(!get(sample)) {
+		LogWarning << "Could not preload sample " << sample->getName();
+	}
+}
+
+void SampleCache::setBudget(size_t _budget) {
+	budget = _budget;
+	evict(0);
+}
+
+void SampleCache::clear() {
+	entries.clear();
+	usage.clear();
+	size = 0;
+	std::vector<char>().swap(scratch);
+}
+
+void SampleCache::evict(size_t required) {
+	
+	while(!usage.empty() && size + required > budget) {
+		Entries::iterator it = entries.find(usage.back());
+		arx_assert(it != entries.end());
+		size -= it->second.data.size();
+		entries.erase(it);
+		usage.pop_back();
+	}
+}
+
+} // namespace audio
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_SAMPLECACHE_H
+#define ARX_AUDIO_SAMPLECACHE_H
+
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <vector>
+
+#include "io/resource/ResourcePath.h"
+
+namespace audio {
+
+class Sample;
+
+/*!
+ * Cache of decoded PCM data for samples, shared by all sources that play the same file.
+ *
+ * Entries are keyed by the sample file name, as sample handles are recreated for
+ * every play of most sounds. The least recently used entries are evicted once the
+ * cache grows over its budget.
+ */
+class SampleCache {
+	
+public:
+	
+	explicit SampleCache(size_t budget);
+	
+	/*!
+	 * Get the decoded data for a sample, loading it if it is not cached.
+	 * The data is getLength() bytes in the sample's format.
+	 * Samples too large for the cache are decoded into a temporary buffer.
+	 * \return the data, which is valid until the next call to any cache method,
+	 *         or NULL if the sample could not be loaded
+	 */
+	const char * get(const Sample * sample);
+	
+	//! Load a sample into the cache without using it
+	void preload(const Sample * sample);
+	
+	//! Set the memory budget in bytes, evicting entries as needed
+	void setBudget(size_t budget);
+	
+	void clear();
+	
+	size_t getBudget() const { return budget; }
+	size_t getSize() const { return size; }
+	
+private:
+	
+	typedef std::list<res::path> UsageList;
+	
+	struct Entry {
+		std::vector<char> data;
+		UsageList::iterator usage;
+	};
+	
+	typedef std::map<res::path, Entry> Entries;
+	
+	//! Samples larger than this are not cached so they don't flush everything else
+	size_t maxEntrySize() const { return budget / 4; }
+	
+	void evict(size_t required);
+	
+	Entries entries;
+	UsageList usage; //!< most recently used first
+	size_t budget;
+	size_t size;
+	
+	std::vector<char> scratch;
+	
+};
+
+} // namespace audio
+
+#endif // ARX_AUDIO_SAMPLECACHE_H
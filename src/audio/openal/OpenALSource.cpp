@@ -21,12 +21,14 @@
 
 #include <cmath>
 #include <algorithm>
+#include <vector>
 
 #include "audio/openal/OpenALUtils.h"
 #include "audio/AudioGlobal.h"
 #include "audio/AudioResource.h"
 #include "audio/Stream.h"
 #include "audio/Sample.h"
+#include "audio/SampleCache.h"
 #include "audio/Mixer.h"
 #include "io/resource/ResourcePath.h"
 #include "io/log/Logger.h"
@@ -192,20 +194,19 @@ aalError OpenALSource::init(SourceId _id, OpenALSource * inst, const Channel & _
 	LogAL("init: length=" << sample->getLength() << " " << (streaming ? "streaming" : "static") << (buffers[0] ? " (copy)" : ""));
 	
 	if(!streaming && !buffers[0]) {
-		stream = createStream(sample->getName());
-		if(!stream) {
-			ALError << "error creating stream";
+		// Repeated plays of the same file share the decoded data
+		const char * data = sample_cache.get(sample);
+		if(!data) {
+			ALError << "error loading sample";
 			return AAL_ERROR_FILEIO;
 		}
 		alGenBuffers(1, &buffers[0]);
 		nbbuffers++;
 		AL_CHECK_ERROR("generating buffer")
 		arx_assert(buffers[0] != 0);
-		loadCount = 1;
-		if(aalError error = fillBuffer(0, sample->getLength())) {
+		if(aalError error = setBufferData(0, data, sample->getLength())) {
 			return error;
 		}
-		arx_assert(!stream && !loadCount);
 	}
 	
 	setVolume(channel.volume);
@@ -277,20 +278,22 @@ aalError OpenALSource::fillAllBuffers() {
 }
 
 /*!
- * Convert a stereo buffer to mono in-place.
+ * Convert a stereo buffer to mono.
  * @param T The type of one (mono) sound sample.
+ * @param dst buffer for the converted data, must hold at least size / 2 bytes.
  * @return the size of the converted buffer
  */
 template <class T>
-static size_t stereoToMono(char * data, size_t size) {
+static size_t stereoToMono(const char * src, char * dst, size_t size) {
 	
-	T * buf = reinterpret_cast<T *>(data);
+	const T * in = reinterpret_cast<const T *>(src);
+	T * out = reinterpret_cast<T *>(dst);
 	
 	size_t nbsamples = size / sizeof(T);
 	arx_assert(nbsamples % 2 == 0);
 	
-	for(size_t in = 0, out = 0; in < nbsamples - 1; in += 2, out++) {
-		buf[out] = T((int(buf[in]) + int(buf[in + 1])) / 2);
+	for(size_t i = 0, o = 0; i + 1 < nbsamples; i += 2, o++) {
+		out[o] = T((int(in[i]) + int(in[i + 1])) / 2);
 	}
 	
 	return size / 2;
@@ -339,6 +342,14 @@ aalError OpenALSource::fillBuffer(size_t i, size_t size) {
 		}
 	}
 	
+	aalError error = setBufferData(i, data, size);
+	delete[] data;
+	
+	return error;
+}
+
+aalError OpenALSource::setBufferData(size_t i, const char * data, size_t size) {
+	
 	const PCMFormat & f = sample->getFormat();
 	if((f.channels != 1 && f.channels != 2) || (f.quality != 8 && f.quality != 16)) {
 		LogError << "Unsupported audio format: quality=" << f.quality << " channels=" << f.channels;
@@ -352,13 +363,14 @@ aalError OpenALSource::fillBuffer(size_t i, size_t size) {
 		alformat = (f.quality == 8) ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
 	}
 	
-	size_t alsize = size;
 	if(convertStereoToMono()) {
-		alsize = (f.quality == 8) ? stereoToMono<s8>(data, size) : stereoToMono<s16>(data, size);
+		std::vector<char> mono(size / 2 + 1);
+		size_t alsize = (f.quality == 8) ? stereoToMono<s8>(data, &mono[0], size)
+		                                 : stereoToMono<s16>(data, &mono[0], size);
+		alBufferData(buffers[i], alformat, &mono[0], alsize, f.frequency);
+	} else {
+		alBufferData(buffers[i], alformat, data, size, f.frequency);
 	}
-	
-	alBufferData(buffers[i], alformat, data, alsize, f.frequency);
-	delete[] data;
 	AL_CHECK_ERROR("setting buffer data")
 	
 	bufferSizes[i] = size;
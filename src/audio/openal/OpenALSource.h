@@ -83,6 +83,12 @@ private:
 	 */
 	aalError fillBuffer(size_t i, size_t size);
 	
+	/*!
+	 * Uploads size bytes of sample data to the given buffer, converting it if needed.
+	 * @param i The index of the buffer to fill.
+	 */
+	aalError setBufferData(size_t i, const char * data, size_t size);
+	
 	bool markAsLoaded();
 	
 	/*!
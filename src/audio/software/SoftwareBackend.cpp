@@ -0,0 +1,298 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio/software/SoftwareBackend.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include "audio/software/SoftwareMixing.h"
+#include "audio/software/SoftwareSource.h"
+#include "audio/codec/WAVFormat.h"
+#include "audio/AudioGlobal.h"
+#include "audio/Sample.h"
+#include "io/fs/FilePath.h"
+#include "io/log/Logger.h"
+#include "platform/Time.h"
+
+namespace audio {
+
+namespace {
+
+//! Number of frames mixed at once
+const size_t MIX_FRAMES = 512;
+
+//! Don't try to catch up with more than this after a stall, in µs
+const u64 MAX_MIX_TIME = 250000;
+
+bool isFinite(const Vec3f & vec) {
+	return (boost::math::isfinite)(vec.x) && (boost::math::isfinite)(vec.y)
+	       && (boost::math::isfinite)(vec.z);
+}
+
+} // anonymous namespace
+
+SoftwareBackend::SoftwareBackend()
+	: listenerPosition(Vec3f::ZERO), listenerRight(Vec3f::X_AXIS), rolloffFactor(1.f),
+	  realtime(false), lastMix(0), pendingTime(0), outputSize(0) { }
+
+SoftwareBackend::~SoftwareBackend() {
+	
+	sources.clear();
+	
+	if(output.is_open()) {
+		writeHeader();
+		output.close();
+	}
+}
+
+aalError SoftwareBackend::init(const fs::path & path, bool _realtime) {
+	
+	realtime = _realtime;
+	
+	if(!path.empty()) {
+		output.open(path, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+		if(!output.is_open()) {
+			LogError << "Could not open audio output file " << path;
+			return AAL_ERROR_FILEIO;
+		}
+		writeHeader();
+	}
+	
+	left.resize(MIX_FRAMES);
+	right.resize(MIX_FRAMES);
+	pcm.resize(MIX_FRAMES * 2);
+	resampled.resize(MIX_FRAMES);
+	
+	lastMix = Time::getUs();
+	
+	if(output.is_open()) {
+		LogInfo << "Using software audio mixer writing to " << path;
+	} else {
+		LogInfo << "Using software audio mixer without output";
+	}
+	
+	return AAL_OK;
+}
+
+void SoftwareBackend::writeHeader() {
+	
+	// The sizes are only known once we are done, so this is written again at the end
+	
+	WaveHeader format = WaveHeader();
+	format.formatTag = WAV_FORMAT_PCM;
+	format.channels = 2;
+	format.samplesPerSec = frequency;
+	format.bitsPerSample = 16;
+	format.blockAlign = format.channels * format.bitsPerSample / 8;
+	format.avgBytesPerSec = format.samplesPerSec * format.blockAlign;
+	
+	// Plain PCM uses the 16-byte fmt chunk without the extra size field or padding
+	u32 formatSize = offsetof(WaveHeader, size);
+	u32 dataSize = outputSize;
+	u32 riffSize = 4 + (8 + formatSize) + (8 + dataSize);
+	
+	output.seekp(0);
+	fs::write(output, "RIFF", 4);
+	fs::write(output, riffSize);
+	fs::write(output, "WAVE", 4);
+	fs::write(output, "fmt ", 4);
+	fs::write(output, formatSize);
+	fs::write(output, &format, formatSize);
+	fs::write(output, "data", 4);
+	fs::write(output, dataSize);
+	output.seekp(0, std::ios_base::end);
+}
+
+aalError SoftwareBackend::updateDeferred() {
+	
+	if(!realtime) {
+		return AAL_OK;
+	}
+	
+	u64 now = Time::getUs();
+	u64 elapsed = std::min(Time::getElapsedUs(lastMix, now), MAX_MIX_TIME);
+	lastMix = now;
+	
+	pendingTime += elapsed * frequency;
+	size_t frames = size_t(pendingTime / 1000000);
+	pendingTime -= u64(frames) * 1000000;
+	
+	return render(frames);
+}
+
+aalError SoftwareBackend::render(size_t frames) {
+	
+	while(frames) {
+		
+		size_t count = std::min(frames, MIX_FRAMES);
+		
+		std::fill(left.begin(), left.begin() + count, 0.f);
+		std::fill(right.begin(), right.begin() + count, 0.f);
+		
+		for(size_t i = 0; i < sources.size(); i++) {
+			if(sources[i]) {
+				sources[i]->mix(&left[0], &right[0], count);
+			}
+		}
+		
+		convertToS16(&left[0], &right[0], &pcm[0], count);
+		
+		if(output.is_open()) {
+			size_t size = count * 2 * sizeof(s16);
+			if(fs::write(output, &pcm[0], size).fail()) {
+				LogError << "Error writing audio output";
+				output.close();
+			}
+			outputSize += size;
+		}
+		
+		frames -= count;
+	}
+	
+	return AAL_OK;
+}
+
+Source * SoftwareBackend::createSource(SampleId sampleId, const Channel & channel) {
+	
+	SampleId s_id = getSampleId(sampleId);
+	
+	if(!_sample.isValid(s_id)) {
+		return NULL;
+	}
+	
+	Sample * sample = _sample[s_id];
+	
+	SoftwareSource * orig = NULL;
+	for(size_t i = 0; i < sources.size(); i++) {
+		if(sources[i] && sources[i]->getSample() == sample) {
+			orig = sources[i];
+			break;
+		}
+	}
+	
+	SoftwareSource * source = new SoftwareSource(sample, this);
+	
+	size_t index = sources.add(source);
+	if(index == (size_t)INVALID_ID) {
+		delete source;
+		return NULL;
+	}
+	
+	SourceId id = (index << 16) | s_id;
+	if(source->init(id, orig, channel)) {
+		sources.remove(index);
+		return NULL;
+	}
+	
+	return source;
+}
+
+Source * SoftwareBackend::getSource(SourceId sourceId) {
+	
+	size_t index = ((sourceId >> 16) & 0x0000ffff);
+	if(!sources.isValid(index)) {
+		return NULL;
+	}
+	
+	Source * source = sources[index];
+	
+	SampleId sample = getSampleId(sourceId);
+	if(!_sample.isValid(sample) || source->getSample() != _sample[sample]) {
+		return NULL;
+	}
+	
+	arx_assert(source->getId() == sourceId);
+	
+	return source;
+}
+
+aalError SoftwareBackend::setReverbEnabled(bool enable) {
+	ARX_UNUSED(enable);
+	return AAL_ERROR_SYSTEM;
+}
+
+aalError SoftwareBackend::setUnitFactor(float factor) {
+	
+	// Only affects the doppler effect, which is not implemented
+	ARX_UNUSED(factor);
+	
+	return AAL_OK;
+}
+
+aalError SoftwareBackend::setRolloffFactor(float factor) {
+	
+	rolloffFactor = factor;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareBackend::setListenerPosition(const Vec3f & position) {
+	
+	if(!isFinite(position)) {
+		return AAL_ERROR;
+	}
+	
+	listenerPosition = position;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareBackend::setListenerOrientation(const Vec3f & front, const Vec3f & up) {
+	
+	// Same convention as the OpenAL backend, which uses -up as the up vector
+	Vec3f right = cross(front, -up);
+	
+	float length = right.length();
+	if(!isFinite(right) || length == 0.f) {
+		return AAL_ERROR;
+	}
+	
+	listenerRight = right * (1.f / length);
+	
+	return AAL_OK;
+}
+
+aalError SoftwareBackend::setListenerEnvironment(const Environment & env) {
+	ARX_UNUSED(env);
+	return AAL_ERROR_SYSTEM;
+}
+
+aalError SoftwareBackend::setRoomRolloffFactor(float factor) {
+	ARX_UNUSED(factor);
+	return AAL_ERROR_SYSTEM;
+}
+
+Backend::source_iterator SoftwareBackend::sourcesBegin() {
+	return (source_iterator)sources.begin();
+}
+
+Backend::source_iterator SoftwareBackend::sourcesEnd() {
+	return (source_iterator)sources.end();
+}
+
+Backend::source_iterator SoftwareBackend::deleteSource(source_iterator it) {
+	arx_assert(it >= sourcesBegin() && it < sourcesEnd());
+	return (source_iterator)sources.remove((ResourceList<SoftwareSource>::iterator)it);
+}
+
+} // namespace audio
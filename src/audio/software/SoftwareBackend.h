@@ -0,0 +1,120 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_SOFTWARE_SOFTWAREBACKEND_H
+#define ARX_AUDIO_SOFTWARE_SOFTWAREBACKEND_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "audio/AudioBackend.h"
+#include "audio/AudioTypes.h"
+#include "audio/AudioResource.h"
+#include "io/fs/FileStream.h"
+#include "math/Vector3.h"
+#include "platform/Platform.h"
+
+namespace fs { class path; }
+
+namespace audio {
+
+class SoftwareSource;
+
+/*!
+ * Backend that resamples and mixes all sources itself.
+ *
+ * The mixed output is either discarded or written to a WAV file. This allows running
+ * and profiling the audio code without sound hardware, or rendering audio offline.
+ */
+class SoftwareBackend : public Backend {
+	
+public:
+	
+	//! Output sample rate in Hz
+	static const size_t frequency = 44100;
+	
+	SoftwareBackend();
+	~SoftwareBackend();
+	
+	/*!
+	 * @param output WAV file to write the mixed output to, or an empty path to discard it.
+	 * @param realtime true to mix the time elapsed since the last call in updateDeferred(),
+	 *                 false to only mix when render() is called.
+	 */
+	aalError init(const fs::path & output, bool realtime);
+	
+	aalError updateDeferred();
+	
+	/*!
+	 * Mix the given number of output frames and write them to the output.
+	 */
+	aalError render(size_t frames);
+	
+	Source * createSource(SampleId sampleId, const Channel & channel);
+	
+	Source * getSource(SourceId sourceId);
+	
+	aalError setReverbEnabled(bool enable);
+	
+	aalError setUnitFactor(float factor);
+	aalError setRolloffFactor(float factor);
+	
+	aalError setListenerPosition(const Vec3f & position);
+	aalError setListenerOrientation(const Vec3f & front, const Vec3f & up);
+	
+	aalError setListenerEnvironment(const Environment & env);
+	aalError setRoomRolloffFactor(float factor);
+	
+	source_iterator sourcesBegin();
+	source_iterator sourcesEnd();
+	source_iterator deleteSource(source_iterator it);
+	
+private:
+	
+	void writeHeader();
+	
+	ResourceList<SoftwareSource> sources;
+	
+	Vec3f listenerPosition;
+	Vec3f listenerRight;
+	float rolloffFactor;
+	
+	bool realtime;
+	u64 lastMix;
+	u64 pendingTime; //!< Elapsed time not yet mixed, in µs * frequency
+	
+	fs::ofstream output;
+	size_t outputSize; //!< Bytes of sample data written
+	
+	// Mixing buffers
+	std::vector<float> left;
+	std::vector<float> right;
+	std::vector<s16> pcm;
+	
+	// Per-source scratch buffers
+	std::vector<char> raw;
+	std::vector<float> input[2];
+	std::vector<float> resampled;
+	
+	friend class SoftwareSource;
+};
+
+} // namespace audio
+
+#endif // ARX_AUDIO_SOFTWARE_SOFTWAREBACKEND_H
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio/software/SoftwareMixing.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARX_AUDIO_SSE2
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+void convertFromPCM(const char * in, const PCMFormat & format, float * const * out,
+                    size_t count) {
+	
+	size_t channels = format.channels;
+	
+	if(format.quality == 8) {
+		const u8 * src = reinterpret_cast<const u8 *>(in);
+		for(size_t c = 0; c < channels; c++) {
+			float * dst = out[c];
+			for(size_t i = 0; i < count; i++) {
+				dst[i] = (float(src[i * channels + c]) - 128.f) * (1.f / 128);
+			}
+		}
+	} else {
+		const s16 * src = reinterpret_cast<const s16 *>(in);
+		for(size_t c = 0; c < channels; c++) {
+			float * dst = out[c];
+			for(size_t i = 0; i < count; i++) {
+				dst[i] = float(src[i * channels + c]) * (1.f / 32768);
+			}
+		}
+	}
+}
+
+void resample(const float * in, float * out, size_t count, float pos, float step) {
+	
+	size_t i = 0;
+	
+#if defined(ARX_AUDIO_SSE2)
+	
+	const __m128 vstep = _mm_set1_ps(step * 4.f);
+	__m128 x = _mm_add_ps(_mm_set1_ps(pos),
+	                      _mm_mul_ps(_mm_set_ps(3.f, 2.f, 1.f, 0.f), _mm_set1_ps(step)));
+	
+	for(; i + 4 <= count; i += 4) {
+		
+		__m128i index = _mm_cvttps_epi32(x);
+		__m128 t = _mm_sub_ps(x, _mm_cvtepi32_ps(index));
+		
+		s32 idx[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(idx), index);
+		
+		__m128 a = _mm_set_ps(in[idx[3]], in[idx[2]], in[idx[1]], in[idx[0]]);
+		__m128 b = _mm_set_ps(in[idx[3] + 1], in[idx[2] + 1], in[idx[1] + 1], in[idx[0] + 1]);
+		
+		_mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+		
+		x = _mm_add_ps(x, vstep);
+	}
+	
+#elif defined(__ARM_NEON__)
+	
+	const float32x4_t vstep = vdupq_n_f32(step * 4.f);
+	const float offsets[4] = { 0.f, 1.f, 2.f, 3.f };
+	float32x4_t x = vmlaq_n_f32(vdupq_n_f32(pos), vld1q_f32(offsets), step);
+	
+	for(; i + 4 <= count; i += 4) {
+		
+		int32x4_t index = vcvtq_s32_f32(x);
+		float32x4_t t = vsubq_f32(x, vcvtq_f32_s32(index));
+		
+		s32 idx[4];
+		vst1q_s32(idx, index);
+		
+		float av[4] = { in[idx[0]], in[idx[1]], in[idx[2]], in[idx[3]] };
+		float bv[4] = { in[idx[0] + 1], in[idx[1] + 1], in[idx[2] + 1], in[idx[3] + 1] };
+		float32x4_t a = vld1q_f32(av);
+		float32x4_t b = vld1q_f32(bv);
+		
+		vst1q_f32(out + i, vmlaq_f32(a, vsubq_f32(b, a), t));
+		
+		x = vaddq_f32(x, vstep);
+	}
+	
+#endif
+	
+	for(; i < count; i++) {
+		float x = pos + float(i) * step;
+		size_t index = size_t(x);
+		float t = x - float(index);
+		out[i] = in[index] + (in[index + 1] - in[index]) * t;
+	}
+}
+
+void mixAdd(float * out, const float * in, size_t count, float gain) {
+	
+	size_t i = 0;
+	
+#if defined(ARX_AUDIO_SSE2)
+	
+	const __m128 g = _mm_set1_ps(gain);
+	for(; i + 4 <= count; i += 4) {
+		__m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), g);
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), v));
+	}
+	
+#elif defined(__ARM_NEON__)
+	
+	for(; i + 4 <= count; i += 4) {
+		vst1q_f32(out + i, vmlaq_n_f32(vld1q_f32(out + i), vld1q_f32(in + i), gain));
+	}
+	
+#endif
+	
+	for(; i < count; i++) {
+		out[i] += in[i] * gain;
+	}
+}
+
+void convertToS16(const float * left, const float * right, s16 * out, size_t count) {
+	
+	size_t i = 0;
+	
+#if defined(ARX_AUDIO_SSE2)
+	
+	const __m128 scale = _mm_set1_ps(32767.f);
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 minusOne = _mm_set1_ps(-1.f);
+	
+	for(; i + 4 <= count; i += 4) {
+		
+		// Clamp first, out of range values convert to INT_MIN
+		__m128 l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(left + i), minusOne), one);
+		__m128 r = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(right + i), minusOne), one);
+		
+		__m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpacklo_ps(l, r), scale));
+		__m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpackhi_ps(l, r), scale));
+		
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), _mm_packs_epi32(lo, hi));
+	}
+	
+#elif defined(__ARM_NEON__)
+	
+	for(; i + 4 <= count; i += 4) {
+		
+		float32x4x2_t lr = vzipq_f32(vld1q_f32(left + i), vld1q_f32(right + i));
+		
+		// Conversion saturates, so no clamping needed
+		int32x4_t lo = vcvtq_s32_f32(vmulq_n_f32(lr.val[0], 32767.f));
+		int32x4_t hi = vcvtq_s32_f32(vmulq_n_f32(lr.val[1], 32767.f));
+		
+		vst1q_s16(out + i * 2, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+	
+#endif
+	
+	for(; i < count; i++) {
+		out[i * 2] = s16(std::min(std::max(left[i], -1.f), 1.f) * 32767.f);
+		out[i * 2 + 1] = s16(std::min(std::max(right[i], -1.f), 1.f) * 32767.f);
+	}
+}
+
+} // namespace audio
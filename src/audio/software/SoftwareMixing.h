@@ -0,0 +1,52 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_SOFTWARE_SOFTWAREMIXING_H
+#define ARX_AUDIO_SOFTWARE_SOFTWAREMIXING_H
+
+#include <stddef.h>
+
+#include "audio/AudioTypes.h"
+#include "platform/Platform.h"
+
+namespace audio {
+
+/*!
+ * Convert interleaved PCM data to one float buffer per channel.
+ * 8-bit data is unsigned, 16-bit data is signed. The result is in the range [-1, 1).
+ * @param out one buffer of at least count floats for each channel in the format.
+ */
+void convertFromPCM(const char * in, const PCMFormat & format, float * const * out, size_t count);
+
+/*!
+ * Resample a channel using linear interpolation.
+ * Output frame i is interpolated at input position pos + i * step, so in must hold
+ * at least floor(pos + (count - 1) * step) + 2 frames.
+ */
+void resample(const float * in, float * out, size_t count, float pos, float step);
+
+//! out[i] += in[i] * gain
+void mixAdd(float * out, const float * in, size_t count, float gain);
+
+//! Interleave two channels into 16-bit stereo, clipping values outside [-1, 1]
+void convertToS16(const float * left, const float * right, s16 * out, size_t count);
+
+} // namespace audio
+
+#endif // ARX_AUDIO_SOFTWARE_SOFTWAREMIXING_H
@@ -0,0 +1,545 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio/software/SoftwareSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "audio/software/SoftwareBackend.h"
+#include "audio/software/SoftwareMixing.h"
+#include "audio/AudioGlobal.h"
+#include "audio/Mixer.h"
+#include "audio/Sample.h"
+#include "audio/SampleCache.h"
+#include "audio/Stream.h"
+#include "io/log/Logger.h"
+#include "math/Vector3.h"
+#include "platform/Platform.h"
+
+namespace audio {
+
+namespace {
+
+//! Samples are streamed if they would need more than this many stream buffers, same as OpenAL
+const size_t STREAM_BUFFERS = 2;
+
+const float DEG_TO_RAD = 3.14159265f / 180.f;
+
+} // anonymous namespace
+
+SoftwareSource::SoftwareSource(Sample * _sample, SoftwareBackend * _backend) :
+	Source(_sample),
+	backend(_backend),
+	streaming(false), stream(NULL), streamPosition(0),
+	frameSize(0), frameCount(0),
+	position(0), fraction(0.f), loadCount(0), played(0),
+	finished(false), tooFar(false),
+	volume(1.f) { }
+
+SoftwareSource::~SoftwareSource() {
+	if(stream) {
+		deleteStream(stream);
+	}
+}
+
+aalError SoftwareSource::init(SourceId _id, SoftwareSource * instance, const Channel & _channel) {
+	
+	id = _id;
+	
+	channel = _channel;
+	if(channel.flags & FLAG_ANY_3D_FX) {
+		channel.flags &= ~FLAG_PAN;
+	}
+	
+	const PCMFormat & f = sample->getFormat();
+	if((f.channels != 1 && f.channels != 2) || (f.quality != 8 && f.quality != 16)) {
+		LogError << "Unsupported audio format: quality=" << f.quality << " channels=" << f.channels;
+		return AAL_ERROR_SYSTEM;
+	}
+	
+	frameSize = f.channels * (f.quality / 8);
+	frameCount = sample->getLength() / frameSize;
+	
+	streaming = (sample->getLength() > stream_limit_bytes * STREAM_BUFFERS);
+	
+	if(!streaming) {
+		if(instance && instance->data) {
+			data = instance->data;
+		} else {
+			const char * pcm = sample_cache.get(sample);
+			if(!pcm) {
+				LogError << "Error loading sample " << sample->getName();
+				return AAL_ERROR_FILEIO;
+			}
+			data.reset(new std::vector<char>(pcm, pcm + sample->getLength()));
+		}
+	}
+	
+	setVolume(channel.volume);
+	setPitch(channel.pitch);
+	setPan(channel.pan);
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::setPitch(float p) {
+	
+	if(!(channel.flags & FLAG_PITCH)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.pitch = clamp(p, 0.1f, 2.f);
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::setPan(float p) {
+	
+	if(!(channel.flags & FLAG_PAN)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.pan = clamp(p, -1.f, 1.f);
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::setPosition(const Vec3f & position) {
+	
+	if(!(channel.flags & FLAG_POSITION)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.position = position;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::setVelocity(const Vec3f & velocity) {
+	
+	if(!(channel.flags & FLAG_VELOCITY)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	// The doppler effect is not implemented
+	channel.velocity = velocity;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::setDirection(const Vec3f & direction) {
+	
+	if(!(channel.flags & FLAG_DIRECTION)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.direction = direction;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::setCone(const SourceCone & cone) {
+	
+	if(!(channel.flags & FLAG_CONE)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.cone.inner_angle = cone.inner_angle;
+	channel.cone.outer_angle = cone.outer_angle;
+	channel.cone.outer_volume = clamp(cone.outer_volume, 0.f, 1.f);
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::setFalloff(const SourceFalloff & falloff) {
+	
+	if(!(channel.flags & FLAG_FALLOFF)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	channel.falloff = falloff;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::play(unsigned playCount) {
+	
+	if(status != Playing) {
+		
+		status = Playing;
+		
+		position = 0, fraction = 0.f;
+		played = 0;
+		finished = false;
+		carry.clear();
+		reset();
+		
+	}
+	
+	if(playCount && loadCount != (unsigned)-1) {
+		loadCount += playCount;
+	} else {
+		loadCount = (unsigned)-1;
+	}
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::stop() {
+	
+	if(status == Idle) {
+		return AAL_OK;
+	}
+	
+	status = Idle;
+	
+	loadCount = 0;
+	position = 0, fraction = 0.f;
+	carry.clear();
+	
+	if(stream) {
+		deleteStream(stream);
+	}
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::pause() {
+	
+	if(status == Idle || status == Paused) {
+		return AAL_OK;
+	}
+	
+	status = Paused;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::resume() {
+	
+	if(status == Idle || status == Playing) {
+		return AAL_OK;
+	}
+	
+	status = Playing;
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::updateVolume() {
+	
+	if(!(channel.flags & FLAG_VOLUME)) {
+		return AAL_ERROR_INIT;
+	}
+	
+	const Mixer * mixer = _mixer[channel.mixer];
+	float v = mixer ? mixer->getFinalVolume() : 1.f;
+	
+	if(v) {
+		// LogToLinearVolume(LinearToLogVolume(volume) * channel.volume)
+		v = std::pow(100000.f * v, channel.volume) / 100000.f;
+	}
+	
+	volume = v;
+	
+	return AAL_OK;
+}
+
+bool SoftwareSource::updateCulling() {
+	
+	arx_assert(status == Playing);
+	
+	if(!(channel.flags & FLAG_POSITION)) {
+		return false;
+	}
+	
+	float max = std::numeric_limits<float>::max();
+	if(channel.flags & FLAG_FALLOFF) {
+		max = channel.falloff.end;
+	}
+	
+	Vec3f listener = (channel.flags & FLAG_RELATIVE) ? Vec3f::ZERO : backend->listenerPosition;
+	float d = dist(channel.position, listener);
+	
+	if(tooFar) {
+		
+		if(d > max) {
+			return true;
+		}
+		
+		tooFar = false;
+		return false;
+		
+	} else {
+		
+		if(d <= max) {
+			return false;
+		}
+		
+		tooFar = true;
+		if(loadCount <= 1) {
+			stop();
+		}
+		return true;
+		
+	}
+}
+
+aalError SoftwareSource::updateBuffers() {
+	
+	time += played;
+	played = 0;
+	
+	if(finished) {
+		return stop();
+	}
+	
+	return AAL_OK;
+}
+
+void SoftwareSource::getGains(float & left, float & right) const {
+	
+	float gain = volume;
+	float pan = 0.f;
+	
+	if(channel.flags & FLAG_POSITION) {
+		
+		bool relative = (channel.flags & FLAG_RELATIVE) != 0;
+		Vec3f offset = channel.position - (relative ? Vec3f::ZERO : backend->listenerPosition);
+		float distance = offset.length();
+		
+		// Same as the inverse clamped distance model used by the OpenAL backend
+		float reference = 1.f;
+		float max = std::numeric_limits<float>::max();
+		if(channel.flags & FLAG_FALLOFF) {
+			reference = channel.falloff.start;
+			max = channel.falloff.end;
+		}
+		float d = clamp(distance, reference, max);
+		float attenuation = reference + backend->rolloffFactor * (d - reference);
+		if(reference > 0.f && attenuation > 0.f) {
+			gain *= reference / attenuation;
+		}
+		
+		if(distance > 0.f) {
+			
+			Vec3f direction = offset * (1.f / distance);
+			
+			float length = channel.direction.length();
+			if((channel.flags & FLAG_CONE) && (channel.flags & FLAG_DIRECTION) && length > 0.f) {
+				float cosine = clamp(-dot(channel.direction, direction) / length, -1.f, 1.f);
+				float angle = 2.f * std::acos(cosine);
+				float inner = channel.cone.inner_angle * DEG_TO_RAD;
+				float outer = channel.cone.outer_angle * DEG_TO_RAD;
+				if(angle >= outer) {
+					gain *= channel.cone.outer_volume;
+				} else if(angle > inner) {
+					float t = (angle - inner) / (outer - inner);
+					gain *= 1.f + (channel.cone.outer_volume - 1.f) * t;
+				}
+			}
+			
+			pan = dot(direction, relative ? Vec3f::X_AXIS : backend->listenerRight);
+		}
+		
+	} else if(channel.flags & FLAG_PAN) {
+		pan = channel.pan;
+	}
+	
+	left = gain * std::min(1.f, 1.f - pan);
+	right = gain * std::min(1.f, 1.f + pan);
+}
+
+aalError SoftwareSource::readStream(char * buffer, size_t count) {
+	
+	if(!stream) {
+		stream = createStream(sample->getName());
+		if(!stream) {
+			LogError << "Error creating stream for " << sample->getName();
+			return AAL_ERROR_FILEIO;
+		}
+		streamPosition = 0;
+	}
+	
+	while(count) {
+		
+		if(streamPosition == frameCount) {
+			stream->setPosition(0);
+			streamPosition = 0;
+		}
+		
+		size_t frames = std::min(count, frameCount - streamPosition);
+		size_t size = frames * frameSize;
+		
+		size_t read;
+		stream->read(buffer, size, read);
+		if(read != size) {
+			return AAL_ERROR_SYSTEM;
+		}
+		
+		buffer += size;
+		count -= frames;
+		streamPosition += frames;
+	}
+	
+	return AAL_OK;
+}
+
+aalError SoftwareSource::fetch(size_t count, size_t & available) {
+	
+	std::vector<char> & raw = backend->raw;
+	if(raw.size() < count * frameSize) {
+		raw.resize(count * frameSize);
+	}
+	
+	// Frames left until the end of the last loop
+	available = count;
+	if(loadCount != (unsigned)-1) {
+		size_t left = (loadCount - 1) * frameCount + (frameCount - position);
+		available = std::min(count, left);
+	}
+	
+	if(streaming) {
+		
+		size_t carried = std::min(carry.size() / frameSize, available);
+		std::copy(carry.begin(), carry.begin() + carried * frameSize, raw.begin());
+		
+		if(aalError error = readStream(&raw[carried * frameSize], available - carried)) {
+			return error;
+		}
+		
+	} else {
+		
+		size_t p = position;
+		for(size_t i = 0; i < available;) {
+			size_t frames = std::min(available - i, frameCount - p);
+			std::memcpy(&raw[i * frameSize], &(*data)[p * frameSize], frames * frameSize);
+			i += frames;
+			p += frames;
+			if(p == frameCount) {
+				p = 0;
+			}
+		}
+		
+	}
+	
+	const PCMFormat & f = sample->getFormat();
+	
+	// Silence for 8-bit unsigned samples is 128
+	std::memset(&raw[available * frameSize], (f.quality == 8) ? 0x80 : 0,
+	            (count - available) * frameSize);
+	
+	float * input[2];
+	for(size_t c = 0; c < f.channels; c++) {
+		if(backend->input[c].size() < count) {
+			backend->input[c].resize(count);
+		}
+		input[c] = &backend->input[c][0];
+	}
+	
+	convertFromPCM(&raw[0], f, input, count);
+	
+	return AAL_OK;
+}
+
+void SoftwareSource::advance(size_t count, size_t available) {
+	
+	if(streaming) {
+		// Keep the frames that were read from the stream but not played yet
+		size_t keep = std::min(count, available);
+		carry.assign(backend->raw.begin() + keep * frameSize,
+		             backend->raw.begin() + available * frameSize);
+	}
+	
+	position += count;
+	played += count * frameSize;
+	
+	while(position >= frameCount) {
+		
+		if(loadCount != (unsigned)-1) {
+			loadCount--;
+		}
+		
+		if(!loadCount) {
+			played -= (position - frameCount) * frameSize;
+			position = 0;
+			finished = true;
+			break;
+		}
+		
+		position -= frameCount;
+	}
+}
+
+void SoftwareSource::mix(float * left, float * right, size_t count) {
+	
+	if(status != Playing || tooFar || finished) {
+		return;
+	}
+	
+	if(!frameCount) {
+		finished = true;
+		return;
+	}
+	
+	const PCMFormat & f = sample->getFormat();
+	
+	float step = float(f.frequency) / float(SoftwareBackend::frequency);
+	if(channel.flags & FLAG_PITCH) {
+		step *= channel.pitch;
+	}
+	
+	// Linear interpolation needs one frame after the last position
+	size_t needed = size_t(fraction + float(count - 1) * step) + 2;
+	
+	size_t available;
+	if(fetch(needed, available)) {
+		LogError << "Error reading sample " << sample->getName();
+		finished = true;
+		return;
+	}
+	
+	float gainLeft, gainRight;
+	getGains(gainLeft, gainRight);
+	
+	if(gainLeft > 0.f || gainRight > 0.f) {
+		
+		float * resampled = &backend->resampled[0];
+		
+		resample(&backend->input[0][0], resampled, count, fraction, step);
+		mixAdd(left, resampled, count, gainLeft);
+		
+		if(f.channels == 2) {
+			resample(&backend->input[1][0], resampled, count, fraction, step);
+		}
+		mixAdd(right, resampled, count, gainRight);
+		
+	}
+	
+	double end = double(fraction) + double(count) * double(step);
+	size_t consumed = size_t(end);
+	fraction = float(end - double(consumed));
+	
+	advance(consumed, available);
+}
+
+} // namespace audio
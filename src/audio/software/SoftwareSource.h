@@ -0,0 +1,120 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_AUDIO_SOFTWARE_SOFTWARESOURCE_H
+#define ARX_AUDIO_SOFTWARE_SOFTWARESOURCE_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "audio/AudioTypes.h"
+#include "audio/AudioSource.h"
+#include "math/MathFwd.h"
+
+namespace audio {
+
+class SoftwareBackend;
+class Stream;
+
+class SoftwareSource : public Source {
+	
+public:
+	
+	SoftwareSource(Sample * sample, SoftwareBackend * backend);
+	~SoftwareSource();
+	
+	/*!
+	 * Initialize the source.
+	 * @param instance an existing source for the same sample whose decoded data can be shared.
+	 */
+	aalError init(SourceId id, SoftwareSource * instance, const Channel & channel);
+	
+	aalError setPitch(float pitch);
+	aalError setPan(float pan);
+	
+	aalError setPosition(const Vec3f & position);
+	aalError setVelocity(const Vec3f & velocity);
+	aalError setDirection(const Vec3f & direction);
+	aalError setCone(const SourceCone & cone);
+	aalError setFalloff(const SourceFalloff & falloff);
+	
+	aalError play(unsigned playCount = 1);
+	aalError stop();
+	aalError pause();
+	aalError resume();
+	
+	aalError updateVolume();
+	
+	/*!
+	 * Mix the next count frames of this source into the output buffers.
+	 * Does nothing if the source isn't playing.
+	 */
+	void mix(float * left, float * right, size_t count);
+	
+protected:
+	
+	bool updateCulling();
+	aalError updateBuffers();
+	
+private:
+	
+	/*!
+	 * Read count frames starting at the current position into the backend's input buffers,
+	 * continuing at the start of the sample if more loops are queued.
+	 * Frames after the end of the last loop are silent.
+	 * @param available set to the number of frames that were actually read.
+	 */
+	aalError fetch(size_t count, size_t & available);
+	
+	//! Read frames from the stream, restarting it at the end of the sample
+	aalError readStream(char * buffer, size_t count);
+	
+	//! Advance the play position by count frames
+	void advance(size_t count, size_t available);
+	
+	//! Calculate the output gains from the volume, position, cone and pan
+	void getGains(float & left, float & right) const;
+	
+	SoftwareBackend * backend;
+	
+	bool streaming;
+	boost::shared_ptr<const std::vector<char> > data; //!< Decoded sample if not streaming
+	Stream * stream;
+	size_t streamPosition; //!< Next frame that will be read from the stream
+	std::vector<char> carry; //!< Frames read from the stream but not played yet
+	
+	size_t frameSize;
+	size_t frameCount;
+	
+	size_t position; //!< Current frame in the sample
+	float fraction; //!< Position between the current and next frame
+	unsigned loadCount; //!< Remaining loops including the current one, (unsigned)-1 to loop forever
+	size_t played; //!< Bytes played since the last updateBuffers() call
+	bool finished;
+	bool tooFar;
+	
+	float volume; //!< Final volume including mixers
+	
+};
+
+} // namespace audio
+
+#endif // ARX_AUDIO_SOFTWARE_SOFTWARESOURCE_H
@@ -87,6 +87,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/VertexBuffer.h"
 #include "graphics/data/Mesh.h"
 #include "graphics/data/TextureContainer.h"
+#include "graphics/data/TextureLoader.h"
 #include "graphics/effects/Fog.h"
 #include "graphics/font/Font.h"
 #include "graphics/particle/ParticleEffects.h"
@@ -118,7 +119,9 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "io/log/Logger.h"
 
 #include "platform/Flags.h"
+#include "platform/JobSystem.h"
 #include "platform/Platform.h"
+#include "platform/Profiler.h"
 
 #include "scene/ChangeLevel.h"
 #include "scene/Interactive.h"
@@ -128,6 +131,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "scene/Object.h"
 #include "scene/Scene.h"
 
+#include "script/ScriptProfiler.h"
+
 #include "Configure.h"
 #include "core/URLConstants.h"
 
@@ -141,6 +146,7 @@ enum InfoPanels {
 	InfoPanelDebug,
 	InfoPanelTest,
 	InfoPanelDebugToggles,
+	InfoPanelScriptProfile,
 
 	InfoPanelEnumSize
 };
@@ -229,6 +235,11 @@ bool ArxGame::initialize()
 		return false;
 	}
 	
+	jobs::init(config.misc.jobThreads);
+	
+	// Collect script statistics from the start so that showprofile has something to dump
+	ScriptProfiler::setEnabled(config.misc.scriptProfile);
+	
 	init = initGameData();
 	if(!init) {
 		LogCritical << "Failed to initialize the game data.";
@@ -569,6 +580,8 @@ void ArxGame::run() {
 	
 	beforeRun();
 	
+	profiler::registerThread("Main");
+	
 	while(m_RunLoop) {
 		
 		m_MainWindow->tick();
@@ -580,7 +593,12 @@ void ArxGame::run() {
 			doFrame();
 			
 			// Show the frame on the primary surface.
-			m_MainWindow->showFrame();
+			{
+				ARX_PROFILE("showFrame");
+				m_MainWindow->showFrame();
+			}
+			
+			profiler::frame();
 		}
 	}
 }
@@ -589,7 +607,9 @@ void ArxGame::run() {
  * \brief Draws the scene.
  */
 void ArxGame::doFrame() {
-		
+	
+	ARX_PROFILE_FUNC();
+	
 	updateTime();
 
 	updateInput();
@@ -638,12 +658,16 @@ void ArxGame::doFrame() {
 		ARX_DrawAfterQuickLoad();
 	}
 		
+	TextureLoader::upload(config.video.textureUploadBudget);
+	
 	if(FirstFrame) {
 		FirstFrameHandling();
 	} else {
 		update();
 		render();
 	}
+	
+	TextureContainer::EndFrame();
 }
 
 /*!
@@ -1263,6 +1287,10 @@ void ArxGame::updateInput() {
 
 		if(showInfo == InfoPanelEnumSize)
 			showInfo = InfoPanelNone;
+		
+		// Only collect script statistics while they are shown, unless requested in the config
+		ScriptProfiler::setEnabled(config.misc.scriptProfile
+		                           || showInfo == InfoPanelScriptProfile);
 	}
 
 	if(showInfo == InfoPanelDebugToggles) {
@@ -1280,6 +1308,21 @@ void ArxGame::updateInput() {
 	if(GInput->isKeyPressedNowPressed(Keyboard::Key_ScrollLock)) {
 		DrawDebugToggleDisplayTypes();
 	}
+	
+	if(GInput->isKeyPressedNowPressed(Keyboard::Key_Pause)) {
+		if(profiler::isEnabled()) {
+			profiler::setEnabled(false);
+			fs::path trace = fs::paths.user / "profile.json";
+			if(profiler::writeChromeTrace(trace)) {
+				LogInfo << "Wrote profile to " << trace;
+			} else {
+				LogError << "Could not write profile to " << trace;
+			}
+		} else {
+			LogInfo << "Profiling started";
+			profiler::setEnabled(true);
+		}
+	}
 
 	if(GInput->isKeyPressedNowPressed(Keyboard::Key_Spacebar)) {
 		CAMERACONTROLLER = NULL;
@@ -1312,6 +1355,8 @@ void ArxGame::renderCinematic() {
 extern int iHighLight;
 
 void ArxGame::updateLevel() {
+	
+	ARX_PROFILE_FUNC();
 
 	if(!PLAYER_PARALYSED) {
 		manageEditorControls();
@@ -1473,6 +1518,8 @@ void ArxGame::updateLevel() {
 }
 
 void ArxGame::renderLevel() {
+	
+	ARX_PROFILE_FUNC();
 
 	// Clear screen & Z buffers
 	if(desired.flags & GMOD_DCOLOR) {
@@ -1683,6 +1730,8 @@ void ArxGame::renderLevel() {
 
 void ArxGame::update() {
 	
+	ARX_PROFILE_FUNC();
+	
 	if(!WILL_LAUNCH_CINE.empty()) {
 		// A cinematic is waiting to be played...
 		LaunchWaitingCine();
@@ -1691,6 +1740,8 @@ void ArxGame::update() {
 
 void ArxGame::render() {
 	
+	ARX_PROFILE_FUNC();
+	
 	ACTIVECAM = &subj;
 
 	// Update Various Player Infos for this frame.
@@ -1802,6 +1853,10 @@ void ArxGame::render() {
 			ShowDebugToggles();
 			break;
 		}
+		case InfoPanelScriptProfile: {
+			ShowScriptProfile();
+			break;
+		}
 		default: break;
 		}
 		GRenderer->EndScene();
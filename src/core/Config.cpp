@@ -76,7 +76,18 @@ const int
 	ambianceVolume = 10,
 	mouseSensitivity = 6,
 	migration = Config::OriginalAssets,
-	quicksaveSlots = 3;
+	quicksaveSlots = 3,
+	textureUploadBudget = 4,
+#ifdef PANDORA
+	textureMemoryBudget = 64,
+#else
+	textureMemoryBudget = 0,
+#endif
+	textureReleaseFrames = 300,
+	animationLodNear = 1200,
+	animationLodFar = 3000,
+	animationLodInterval = 2,
+	jobThreads = -1;
 
 const bool
 	first_run = true,
@@ -85,17 +96,22 @@ const bool
 #ifdef PANDORA
 	antialiasing = false,
 	vsync = false,
+	asyncTextures = false,
 #else
 	antialiasing = true,
 	vsync = true,
+	asyncTextures = true,
 #endif
+	textureCache = true,
 	eax = false,
 	invertMouse = false,
 	autoReadyWeapon = false,
 	mouseLookToggle = true,
 	autoDescription = true,
 	linkMouseLookToUse = false,
-	forceToggle = false;
+	forceToggle = false,
+	animationCache = true,
+	scriptProfile = false;
 
 ActionKey actions[NUM_ACTION_KEY] = {
 	ActionKey(Keyboard::Key_Spacebar), // JUMP
@@ -184,7 +200,15 @@ const string
 	fogDistance = "fog",
 	showCrosshair = "show_crosshair",
 	antialiasing = "antialiasing",
-	vsync = "vsync";
+	vsync = "vsync",
+	asyncTextures = "async_textures",
+	textureCache = "texture_cache",
+	textureMemoryBudget = "texture_memory_budget",
+	textureReleaseFrames = "texture_release_frames",
+	textureUploadBudget = "texture_upload_budget",
+	animationLodNear = "animation_lod_near",
+	animationLodFar = "animation_lod_far",
+	animationLodInterval = "animation_lod_interval";
 
 // Window options
 const string
@@ -260,6 +284,9 @@ const string
 	forceToggle = "forcetoggle",
 	migration = "migration",
 	quicksaveSlots = "quicksave_slots",
+	animationCache = "animation_cache",
+	jobThreads = "job_threads",
+	scriptProfile = "script_profile",
 	debugLevels = "debug";
 
 } // namespace Key
@@ -409,6 +436,14 @@ bool Config::save() {
 	writer.writeKey(Key::showCrosshair, video.showCrosshair);
 	writer.writeKey(Key::antialiasing, video.antialiasing);
 	writer.writeKey(Key::vsync, video.vsync);
+	writer.writeKey(Key::asyncTextures, video.asyncTextures);
+	writer.writeKey(Key::textureCache, video.textureCache);
+	writer.writeKey(Key::textureUploadBudget, video.textureUploadBudget);
+	writer.writeKey(Key::textureMemoryBudget, video.textureMemoryBudget);
+	writer.writeKey(Key::textureReleaseFrames, video.textureReleaseFrames);
+	writer.writeKey(Key::animationLodNear, video.animationLodNear);
+	writer.writeKey(Key::animationLodFar, video.animationLodFar);
+	writer.writeKey(Key::animationLodInterval, video.animationLodInterval);
 	
 	// window
 	writer.beginSection(Section::Window);
@@ -447,6 +482,9 @@ bool Config::save() {
 	writer.writeKey(Key::forceToggle, misc.forceToggle);
 	writer.writeKey(Key::migration, misc.migration);
 	writer.writeKey(Key::quicksaveSlots, misc.quicksaveSlots);
+	writer.writeKey(Key::animationCache, misc.animationCache);
+	writer.writeKey(Key::jobThreads, misc.jobThreads);
+	writer.writeKey(Key::scriptProfile, misc.scriptProfile);
 	writer.writeKey(Key::debugLevels, misc.debug);
 	
 	return writer.flush();
@@ -498,6 +536,14 @@ bool Config::init(const fs::path & file) {
 	video.showCrosshair = reader.getKey(Section::Video, Key::showCrosshair, Default::showCrosshair);
 	video.antialiasing = reader.getKey(Section::Video, Key::antialiasing, Default::antialiasing);
 	video.vsync = reader.getKey(Section::Video, Key::vsync, Default::vsync);
+	video.asyncTextures = reader.getKey(Section::Video, Key::asyncTextures, Default::asyncTextures);
+	video.textureCache = reader.getKey(Section::Video, Key::textureCache, Default::textureCache);
+	video.textureUploadBudget = std::max(reader.getKey(Section::Video, Key::textureUploadBudget, Default::textureUploadBudget), 0);
+	video.textureMemoryBudget = std::max(reader.getKey(Section::Video, Key::textureMemoryBudget, Default::textureMemoryBudget), 0);
+	video.textureReleaseFrames = std::max(reader.getKey(Section::Video, Key::textureReleaseFrames, Default::textureReleaseFrames), 1);
+	video.animationLodNear = std::max(reader.getKey(Section::Video, Key::animationLodNear, Default::animationLodNear), 0);
+	video.animationLodFar = std::max(reader.getKey(Section::Video, Key::animationLodFar, Default::animationLodFar), video.animationLodNear);
+	video.animationLodInterval = std::max(reader.getKey(Section::Video, Key::animationLodInterval, Default::animationLodInterval), 1);
 	
 	// Get window settings
 	string windowSize = reader.getKey(Section::Window, Key::windowSize, Default::windowSize);
@@ -530,6 +576,9 @@ bool Config::init(const fs::path & file) {
 	misc.forceToggle = reader.getKey(Section::Misc, Key::forceToggle, Default::forceToggle);
 	misc.migration = (MigrationStatus)reader.getKey(Section::Misc, Key::migration, Default::migration);
 	misc.quicksaveSlots = std::max(reader.getKey(Section::Misc, Key::quicksaveSlots, Default::quicksaveSlots), 1);
+	misc.animationCache = reader.getKey(Section::Misc, Key::animationCache, Default::animationCache);
+	misc.jobThreads = std::max(reader.getKey(Section::Misc, Key::jobThreads, Default::jobThreads), -1);
+	misc.scriptProfile = reader.getKey(Section::Misc, Key::scriptProfile, Default::scriptProfile);
 	misc.debug = reader.getKey(Section::Misc, Key::debugLevels, Default::debugLevels);
 	
 	return loaded;
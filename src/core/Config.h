@@ -117,6 +117,14 @@ public:
 		bool showCrosshair;
 		bool antialiasing;
 		bool vsync;
+		bool asyncTextures;
+		bool textureCache; //!< Keep decoded textures in the user cache directory
+		int textureMemoryBudget; //!< Megabytes of texture memory before unused textures are released, 0 = unlimited
+		int textureReleaseFrames; //!< Frames a texture must be unused before it can be released
+		int textureUploadBudget; //!< Milliseconds per frame for uploading textures
+		int animationLodNear; //!< Distance beyond which animations are sampled less often, 0 = disabled
+		int animationLodFar; //!< Distance beyond which animations are sampled least often
+		int animationLodInterval; //!< Frames between animation samples for reduced LOD
 	} video;
 	
 	// section 'window'
@@ -173,6 +181,12 @@ public:
 		
 		int quicksaveSlots;
 		
+		bool animationCache; //!< Keep converted animations in the user cache directory
+		
+		int jobThreads; //!< Job worker threads, -1 = one per additional CPU, 0 = none
+		
+		bool scriptProfile; //!< Always collect script statistics, not only while shown
+		
 		std::string debug; //!< Logger debug levels.
 		
 	} misc;
@@ -102,6 +102,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/Vertex.h"
 #include "graphics/data/FTL.h"
 #include "graphics/data/TextureContainer.h"
+#include "graphics/data/TextureLoader.h"
 #include "graphics/effects/Fog.h"
 #include "graphics/image/Image.h"
 #include "graphics/particle/ParticleEffects.h"
@@ -133,6 +134,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "platform/CrashHandler.h"
 #include "platform/Flags.h"
+#include "platform/JobSystem.h"
 #include "platform/Platform.h"
 
 #include "scene/LinkedObject.h"
@@ -147,6 +149,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "script/Script.h"
 #include "script/ScriptEvent.h"
+#include "script/ScriptProfiler.h"
 
 #include "window/RenderWindow.h"
 
@@ -2983,12 +2986,13 @@ void ShowInfoText() {
 	Entity * io=ARX_SCRIPT_Get_IO_Max_Events();
 
 	if(!io) {
-		sprintf(tex, "Events %ld (IOmax N/A) Timers %ld",
-				ScriptEvent::totalCount, ARX_SCRIPT_CountTimers());
+		sprintf(tex, "Events %ld (IOmax N/A) Timers %ld Stacked %ld",
+				ScriptEvent::totalCount, ARX_SCRIPT_CountTimers(),
+				ARX_SCRIPT_EventStackCount());
 	} else {
-		sprintf(tex, "Events %ld (IOmax %s %d) Timers %ld",
+		sprintf(tex, "Events %ld (IOmax %s %d) Timers %ld Stacked %ld",
 				ScriptEvent::totalCount, io->long_name().c_str(),
-				io->stat_count, ARX_SCRIPT_CountTimers());
+				io->stat_count, ARX_SCRIPT_CountTimers(), ARX_SCRIPT_EventStackCount());
 	}
 	mainApp->outputText(70, 94, tex);
 
@@ -3011,6 +3015,11 @@ void ShowInfoText() {
 
 	mainApp->outputText(100, 208, tex);
 
+	sprintf(tex, "Animation LOD full %ld reduced %ld far %ld",
+			g_animationLodCounts[AnimationLodFull], g_animationLodCounts[AnimationLodReduced],
+			g_animationLodCounts[AnimationLodFar]);
+	mainApp->outputText(70, 144, tex);
+
 #ifdef BUILD_EDITOR
 	if(ValidIONum(LastSelectedIONum)) {
 		io = entities[LastSelectedIONum];
@@ -3101,6 +3110,27 @@ void ShowDebugToggles() {
 	}
 }
 
+void ShowScriptProfile() {
+	
+	std::vector<ScriptProfiler::Entry> entries;
+	ScriptProfiler::getTop(entries, 20);
+	
+	mainApp->outputTextGrid(0.f, 0, "Script profile (ms, calls) - use showprofile to log everything");
+	
+	for(size_t i = 0; i < entries.size(); i++) {
+		const ScriptProfiler::Entry & entry = entries[i];
+		std::stringstream textStream;
+		textStream.setf(std::ios::fixed);
+		textStream.precision(2);
+		textStream << (entry.stats.time / 1000.0) << "  " << entry.stats.calls << "  "
+		           << entry.script << " on " << entry.event;
+		if(!entry.command.empty()) {
+			textStream << ": " << entry.command;
+		}
+		mainApp->outputTextGrid(0.f, i + 1, textStream.str());
+	}
+}
+
 void ARX_SetAntiAliasing() {
 	GRenderer->SetAntialiasing(config.video.antialiasing);
 }
@@ -3142,6 +3172,9 @@ void shutdownGame() {
 	Menu2_Close();
 	DanaeClearLevel(2);
 	TextureContainer::DeleteAll();
+	TextureLoader::shutdown();
+	ReleaseAnimationPoseCache();
+	jobs::shutdown();
 	
 	delete ControlCinematique, ControlCinematique = NULL;
 	
@@ -151,6 +151,7 @@ void ShowTestText();
 void ShowInfoText();
 void ShowFPS();
 void ShowDebugToggles();
+void ShowScriptProfile();
 
 void DrawImproveVisionInterface();
 
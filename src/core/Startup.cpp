@@ -53,6 +53,7 @@
 #include "core/Version.h"
 #include "io/fs/Filesystem.h"
 #include "io/fs/SystemPaths.h"
+#include "io/log/AsyncLogger.h"
 #include "io/log/CriticalLogger.h"
 #include "io/log/FileLogger.h"
 #include "io/log/Logger.h"
@@ -154,6 +155,8 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
 	Logger::initialize();
 	CrashHandler::registerCrashCallback(Logger::quickShutdown);
 	Logger::add(new logger::CriticalErrorDialog);
+	// Write log output from a separate thread so that logging does not cause frame hitches
+	Logger::setQueue(new logger::AsyncQueue);
 	
 	// Parse the command line and process options
 	ExitStatus status = parseCommandLine(argc, argv);
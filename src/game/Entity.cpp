@@ -96,6 +96,8 @@ Entity::Entity(const res::path & classPath)
 
 	animBlend.nb_lastanimvertex = 0;
 	animBlend.lastanimtime = 0;
+	animLod.lod = AnimationLodFull;
+	animLod.framesLeft = 0;
 	
 	std::memset(&bbox3D, 0, sizeof(EERIE_3D_BBOX)); // TODO use constructor
 	
@@ -224,6 +224,19 @@ struct AnimationBlendStatus {
 	unsigned long lastanimtime;
 };
 
+//! How often the pose of an animated entity is sampled from its animations
+enum AnimationLod {
+	AnimationLodFull,    //!< Sampled and blended every frame
+	AnimationLodReduced, //!< Sampled every few frames and interpolated in between
+	AnimationLodFar,     //!< Far away or off-screen - sampled least often
+	AnimationLodCount
+};
+
+struct AnimationLodStatus {
+	AnimationLod lod;
+	long framesLeft; //!< Frames until the pose is sampled again
+};
+
 class Entity {
 	
 public:
@@ -250,6 +263,7 @@ public:
 	ANIM_USE animlayer[MAX_ANIM_LAYERS];
 
 	AnimationBlendStatus animBlend;
+	AnimationLodStatus animLod;
 	
 	EERIE_3D_BBOX bbox3D;
 	EERIE_2D_BBOX bbox2D;
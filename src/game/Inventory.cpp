@@ -51,6 +51,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include <vector>
 
 #include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "ai/Paths.h"
 
@@ -318,6 +319,68 @@ std::ostream & operator<<(std::ostream & strm, const InventoryPos & p) {
 
 namespace {
 
+typedef boost::unordered_map<const Entity *, InventoryPos> InventoryIndex;
+
+/*!
+ * Top-left slot of each item that has been put into an inventory.
+ * Some code clears slots directly without updating the index, so entries are
+ * checked against the slot contents before they are used.
+ */
+InventoryIndex inventoryIndex;
+
+//! @return the slot at the given position or NULL if that slot does not exist
+const INVENTORY_SLOT * getInventorySlot(const InventoryPos & pos) {
+	
+	if(pos.io == 0) {
+		if(pos.bag >= player.bag || pos.x >= INVENTORY_X || pos.y >= INVENTORY_Y) {
+			return NULL;
+		}
+		return &inventory[pos.bag][pos.x][pos.y];
+	}
+	
+	if(!ValidIONum(pos.io) || !entities[pos.io]->inventory) {
+		return NULL;
+	}
+	
+	const INVENTORY_DATA * inv = entities[pos.io]->inventory;
+	if(pos.bag != 0 || pos.x >= inv->sizex || pos.y >= inv->sizey) {
+		return NULL;
+	}
+	return &inv->slot[pos.x][pos.y];
+}
+
+void indexItem(const Entity * item, const InventoryPos & pos) {
+	inventoryIndex[item] = pos;
+}
+
+void indexItem(const Entity * item, const INVENTORY_DATA * inv, long x, long y) {
+	if(inv->io && inv->io->inventory == inv) {
+		indexItem(item, InventoryPos(inv->io->index(), 0, x, y));
+	}
+}
+
+void unindexItem(const Entity * item) {
+	inventoryIndex.erase(item);
+}
+
+//! @return the position of an item in any inventory
+InventoryPos findItem(const Entity * item) {
+	
+	InventoryIndex::iterator it = inventoryIndex.find(item);
+	if(it == inventoryIndex.end()) {
+		return InventoryPos();
+	}
+	
+	const INVENTORY_SLOT * slot = getInventorySlot(it->second);
+	if(!slot || slot->io != item) {
+		// The item has been removed from its slot
+		inventoryIndex.erase(it);
+		return InventoryPos();
+	}
+	
+	return it->second;
+}
+
 // Glue code to access both player and IO inventories in a uniform way.
 template <size_t MaxBags, size_t MaxWidth, size_t MaxHeight>
 struct InventoryArray {
@@ -443,6 +506,7 @@ private:
 				index(pos.bag, i, j).show = 0;
 			}
 		}
+		unindexItem(item);
 	}
 	
 	bool insertIntoNewSlotAt(Entity * item, const Pos & pos) {
@@ -479,6 +543,7 @@ private:
 			}
 		}
 		index(pos).show = 1;
+		indexItem(item, pos);
 		
 		return true;
 	}
@@ -679,16 +744,22 @@ public:
 	 * @return the position of the item
 	 */
 	Pos locate(const Entity * item) const {
+		Pos pos = findItem(item);
+		return (pos.io == io) ? pos : Pos();
+	}
+	
+	//! Rebuild the index for all items after the slots have been written directly
+	void reindex() const {
 		for(size_t bag = 0; bag < bags; bag++) {
 			for(size_t i = 0; i < width; i++) {
 				for(size_t j = 0; j < height; j++) {
-					if(index(bag, i, j).io == item) {
-						return Pos(io, bag, i, j);
+					const Entity * item = index(bag, i, j).io;
+					if(item && findItem(item).io != io) {
+						indexItem(item, Pos(io, bag, i, j));
 					}
 				}
 			}
 		}
-		return Pos();
 	}
 	
 	/*!
@@ -714,6 +785,7 @@ public:
 					}
 				}
 			}
+			unindexItem(item);
 		}
 		return pos;
 	}
@@ -787,42 +859,28 @@ bool giveToPlayer(Entity * item, const InventoryPos & pos) {
 
 InventoryPos removeFromInventories(Entity * item) {
 	
-	// TODO the item should know the inventory it is in and position
-	
-	InventoryPos oldPos = playerInventory.remove(item);
-	if(oldPos) {
-		return oldPos;
+	InventoryPos pos = findItem(item);
+	if(!pos) {
+		return pos;
 	}
 	
-	for(size_t i = 1; i < entities.size(); i++) {
-		if(entities[i] && entities[i]->inventory) {
-			oldPos = getIoInventory(entities[i]).remove(item);
-			if(oldPos) {
-				return oldPos;
-			}
-		}
+	if(pos.io == 0) {
+		return playerInventory.remove(item);
 	}
 	
-	return InventoryPos();
+	return getIoInventory(entities[pos.io]).remove(item);
 }
 
 InventoryPos locateInInventories(const Entity * item) {
-	
-	InventoryPos pos = playerInventory.locate(item);
-	if(pos) {
-		return pos;
-	}
-	
-	for(size_t i = 1; i < entities.size(); i++) {
-		if(entities[i] && entities[i]->inventory) {
-			pos = getIoInventory(entities[i]).locate(item);
-			if(pos) {
-				return pos;
-			}
-		}
+	return findItem(item);
+}
+
+void indexInventory(Entity * container) {
+	if(container == entities.player()) {
+		getPlayerInventory().reindex();
+	} else if(container && container->inventory) {
+		getIoInventory(container).reindex();
 	}
-	
-	return InventoryPos();
 }
 
 bool insertIntoInventory(Entity * item, const InventoryPos & pos) {
@@ -937,6 +995,7 @@ bool CanBePutInInventory(Entity * io)
 							}
 
 						inventory[iNbBag][i][j].show = 1;
+						indexItem(io, InventoryPos(0, iNbBag, i, j));
 						ARX_INVENTORY_Declare_InventoryIn(io);
 						sInventory = -1;
 						return true;
@@ -1010,6 +1069,7 @@ bool CanBePutInInventory(Entity * io)
 								}
 
 							inventory[iNbBag][i][j].show = 1;
+							indexItem(io, InventoryPos(0, iNbBag, i, j));
 							ARX_INVENTORY_Declare_InventoryIn(io);
 							return true;
 						}
@@ -1112,6 +1172,7 @@ bool CanBePutInSecondaryInventory(INVENTORY_DATA * id, Entity * io, long * xx, l
 					}
 
 				id->slot[i][j].show = 1;
+				indexItem(io, id, i, j);
 				*xx = i;
 				*yy = j;
 				sInventory = -1;
@@ -1180,6 +1241,7 @@ bool CanBePutInSecondaryInventory(INVENTORY_DATA * id, Entity * io, long * xx, l
 						}
 
 					id->slot[i][j].show = 1;
+					indexItem(io, id, i, j);
 					*xx = i;
 					*yy = j;
 					return true;
@@ -1361,6 +1423,7 @@ bool PutInInventory()
 			}
 
 			SecondaryInventory->slot[tx][ty].show = 1;
+			indexItem(DRAGINTER, SecondaryInventory, tx, ty);
 			DRAGINTER->show = SHOW_FLAG_IN_INVENTORY;
 			ARX_SOUND_PlayInterface(SND_INVSTD);
 			Set_DragInter(NULL);
@@ -1494,6 +1557,7 @@ bool PutInInventory()
 		}
 
 	inventory[iBag][tx][ty].show = 1;
+	indexItem(DRAGINTER, InventoryPos(0, iBag, tx, ty));
 
 	ARX_INVENTORY_Declare_InventoryIn(DRAGINTER);
 	ARX_SOUND_PlayInterface(SND_INVSTD);
@@ -1725,34 +1789,20 @@ bool GetItemWorldPosition(Entity * io, Vec3f * pos)
 			return true;
 		}
 
+		InventoryPos inventoryPos = findItem(io);
+		
 		// Is it in any player inventory ?
-		for(long iNbBag = 0; iNbBag < player.bag; iNbBag++) {
-			for(size_t j = 0; j < INVENTORY_Y; j++) {
-				for(size_t i = 0; i < INVENTORY_X; i++) {
-					if(inventory[iNbBag][i][j].io == io) {
-						pos->x = player.pos.x;
-						pos->y = player.pos.y + 80.f; 
-						pos->z = player.pos.z;
-						return true;
-					}
-				}
-			}
+		if(inventoryPos.io == 0) {
+			pos->x = player.pos.x;
+			pos->y = player.pos.y + 80.f; 
+			pos->z = player.pos.z;
+			return true;
 		}
 
 		// Is it in any other IO inventory ?
-		for(size_t i = 0; i < entities.size(); i++) {
-			Entity * ioo = entities[i];
-			if(ioo && ioo->inventory) {
-				INVENTORY_DATA * id = ioo->inventory;
-				for(long j = 0; j < id->sizey; j++) {
-					for(long k = 0; k < id->sizex; k++) {
-						if(id->slot[k][j].io == io) {
-							*pos = ioo->pos;
-							return true;
-						}
-					}
-				}
-			}
+		if(inventoryPos) {
+			*pos = entities[inventoryPos.io]->pos;
+			return true;
 		}
 	}
 
@@ -1786,33 +1836,17 @@ bool GetItemWorldPositionSound(const Entity * io, Vec3f * pos) {
 			return true;
 		}
 		
-		if(player.bag) {
-			for(int iNbBag = 0; iNbBag < player.bag; iNbBag++) {
-				for(size_t j = 0; j < INVENTORY_Y; j++) {
-					for(size_t i = 0; i < INVENTORY_X; i++) {
-						if(inventory[iNbBag][i][j].io == io) {
-							// in player inventory
-							ARX_PLAYER_FrontPos(pos);
-							return true;
-						}
-					}
-				}
-			}
+		InventoryPos inventoryPos = findItem(io);
+		
+		if(inventoryPos.io == 0) {
+			// in player inventory
+			ARX_PLAYER_FrontPos(pos);
+			return true;
 		}
 		
-		for(size_t i = 0; i < entities.size(); i++) {
-			Entity * ioo = entities[i];
-			if(ioo && ioo->inventory) {
-				INVENTORY_DATA * id = ioo->inventory;
-				for(long j = 0; j < id->sizey; j++) {
-					for(long k = 0; k < id->sizex; k++) {
-						if(id->slot[k][j].io == io) {
-							*pos = ioo->pos;
-							return true;
-						}
-					}
-				}
-			}
+		if(inventoryPos) {
+			*pos = entities[inventoryPos.io]->pos;
+			return true;
 		}
 	}
 	
@@ -1832,25 +1866,28 @@ void RemoveFromAllInventories(const Entity * io) {
 		return;
 	}
 	
+	InventoryPos pos = findItem(io);
+	if(!pos) {
+		return;
+	}
+	
 	// Seek IO in Player Inventory/ies
-	playerInventory.remove(io);
+	if(pos.io == 0) {
+		playerInventory.remove(io);
+		return;
+	}
 	
 	// Seek IO in Other IO's Inventories
-	for(size_t i = 0; i < entities.size(); i++) {
-		if(entities[i] != NULL) {
-			if(entities[i]->inventory != NULL) {
-				INVENTORY_DATA * id = entities[i]->inventory;
-				for(long j = 0; j < id->sizey; j++) {
-					for(long k = 0; k < id->sizex; k++) {
-						if(id->slot[k][j].io == io) {
-							id->slot[k][j].io = NULL;
-							id->slot[k][j].show = 1;
-						}
-					}
-				}
+	INVENTORY_DATA * id = entities[pos.io]->inventory;
+	for(long j = 0; j < id->sizey; j++) {
+		for(long k = 0; k < id->sizex; k++) {
+			if(id->slot[k][j].io == io) {
+				id->slot[k][j].io = NULL;
+				id->slot[k][j].show = 1;
 			}
 		}
 	}
+	unindexItem(io);
 }
 
 //*************************************************************************************
@@ -1858,26 +1895,16 @@ void RemoveFromAllInventories(const Entity * io) {
 //*************************************************************************************
 void CheckForInventoryReplaceMe(Entity * io, Entity * old) {
 	
-	for(size_t i = 0; i < entities.size(); i++) {
-		if(entities[i] != NULL) {
-			if(entities[i]->inventory != NULL) {
-				INVENTORY_DATA * id = entities[i]->inventory;
-				
-				for(long j = 0; j < id->sizey; j++) {
-					for(long k = 0; k < id->sizex; k++) {
-						if (id->slot[k][j].io == old) {
-							long xx, yy;
-							if(CanBePutInSecondaryInventory(id, io, &xx, &yy)) {
-								return;
-							}
-							PutInFrontOfPlayer(io); 
-							return;
-						}
-					}
-				}
-			}
-		}
+	InventoryPos pos = findItem(old);
+	if(!pos || pos.io == 0) {
+		return;
 	}
+	
+	long xx, yy;
+	if(CanBePutInSecondaryInventory(entities[pos.io]->inventory, io, &xx, &yy)) {
+		return;
+	}
+	PutInFrontOfPlayer(io);
 }
 
 //*************************************************************************************
@@ -2043,33 +2070,17 @@ bool TakeFromInventory(Vec2s * pos)
 }
 
 bool IsInPlayerInventory(Entity * io) {
-	
-	for(long iNbBag = 0; iNbBag < player.bag; iNbBag ++) {
-		for(size_t j = 0; j < INVENTORY_Y; j++) {
-			for(size_t i = 0; i < INVENTORY_X; i++) {
-				if(inventory[iNbBag][i][j].io == io) {
-					return true;
-				}
-			}
-		}
-	}
-	
-	return false;
+	return findItem(io).io == 0;
 }
 
 bool IsInSecondaryInventory(Entity * io) {
 	
-	if(SecondaryInventory) {
-		for(long j = 0; j < SecondaryInventory->sizey; j++) {
-			for(long i = 0; i < SecondaryInventory->sizex; i++) {
-				if(SecondaryInventory->slot[i][j].io == io) {
-					return true;
-				}
-			}
-		}
+	if(!SecondaryInventory) {
+		return false;
 	}
 	
-	return false;
+	InventoryPos pos = findItem(io);
+	return pos && pos.io != 0 && entities[pos.io]->inventory == SecondaryInventory;
 }
 
 void SendInventoryObjectCommand(const string & _lpszText, ScriptMessage _lCommand) {
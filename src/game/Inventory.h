@@ -205,6 +205,14 @@ bool insertIntoInventory(Entity * item, const InventoryPos & pos);
  */
 InventoryPos locateInInventories(const Entity * item);
 
+/*!
+ * Update the item positions used by locateInInventories() and removeFromInventories()
+ * after the slots of an inventory have been filled in directly.
+ *
+ * @param container the entity owning the inventory, or the player
+ */
+void indexInventory(Entity * container);
+
 /*!
  * Remove an item from all inventories.
  * The item is not deleted.
@@ -56,6 +56,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/foreach.hpp>
 
 #include "animation/Animation.h"
 
@@ -102,6 +103,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "platform/Flags.h"
 #include "platform/Platform.h"
+#include "platform/Profiler.h"
 
 #include "scene/Object.h"
 #include "scene/Interactive.h"
@@ -785,33 +787,31 @@ bool ARX_NPC_SetStat(Entity& io, const string & statname, float value) {
 }
 
 extern long CUR_COLLISION_MATERIAL;
-static Entity * PHYSICS_CURIO = NULL;
-
-void ARX_TEMPORARY_TrySound(float volume) {
+void ARX_TEMPORARY_TrySound(Entity * source, float volume) {
 	
-	if(PHYSICS_CURIO) {
-		if(PHYSICS_CURIO->ioflags & IO_BODY_CHUNK)
+	if(source) {
+		if(source->ioflags & IO_BODY_CHUNK)
 			return;
 
 		unsigned long at = (unsigned long)(arxtime);
 
-		if(at > PHYSICS_CURIO->soundtime) {
+		if(at > source->soundtime) {
 
-			PHYSICS_CURIO->soundcount++;
+			source->soundcount++;
 
-			if(PHYSICS_CURIO->soundcount < 5) {
+			if(source->soundcount < 5) {
 				long material;
-				if(EEIsUnderWater(&PHYSICS_CURIO->pos))
+				if(EEIsUnderWater(&source->pos))
 					material = MATERIAL_WATER;
-				else if(PHYSICS_CURIO->material)
-					material = PHYSICS_CURIO->material;
+				else if(source->material)
+					material = source->material;
 				else
 					material = MATERIAL_STONE;
 
 				if(volume > 1.f)
 					volume = 1.f;
 
-				PHYSICS_CURIO->soundtime = at + (ARX_SOUND_PlayCollision(material, CUR_COLLISION_MATERIAL, volume, 1.f, &PHYSICS_CURIO->pos, PHYSICS_CURIO) >> 4) + 50;
+				source->soundtime = at + (ARX_SOUND_PlayCollision(material, CUR_COLLISION_MATERIAL, volume, 1.f, &source->pos, source) >> 4) + 50;
 			}
 		}
 	}
@@ -952,8 +952,20 @@ static void ManageNPCMovement(Entity * io);
 
 extern float MAX_ALLOWED_PER_SECOND;
 
+//! Checks if the entity that queued a physics box update no longer owns its mesh
+static bool isPhysicsBoxUpdateStale(const PhysicsBoxUpdate & update) {
+	return !ValidIONum(update.source) || entities[update.source]->obj != update.obj
+	       || !update.obj->pbox;
+}
+
 void ARX_PHYSICS_Apply() {
+	
+	ARX_PROFILE_FUNC();
+	
 	static long CURRENT_DETECT = 0;
+	static std::vector<PhysicsBoxUpdate> physicsBoxes;
+	
+	physicsBoxes.clear();
 
 	CURRENT_DETECT++;
 
@@ -1016,30 +1028,12 @@ void ARX_PHYSICS_Apply() {
 			io->gameFlags &= ~GFLAG_NOCOMPUTATION;
 
 			if(io->obj->pbox->active == 1) {
-				PHYSICS_CURIO = io;
-
-				if(ARX_PHYSICS_BOX_ApplyModel(io->obj, (float)framedelay, io->rubber, treatio[i].num)) {
-					if(io->damagedata >= 0) {
-						damages[io->damagedata].active = 1;
-						ARX_DAMAGES_UpdateDamage(io->damagedata, float(arxtime));
-						damages[io->damagedata].exist = 0;
-						io->damagedata = -1;
-					}
-				}
-				
-				if(io->soundcount > 12) {
-					io->soundtime = 0;
-					io->soundcount = 0;
-					for(long k = 0; k < io->obj->pbox->nb_physvert; k++) {
-						io->obj->pbox->vert[k].velocity = Vec3f::ZERO;
-					}
-					io->obj->pbox->active = 2;
-					io->obj->pbox->stopcount = 0;
-				}
-				
-				io->room_flags |= 1;
-				io->pos = io->obj->pbox->vert[0].pos;
-				
+				PhysicsBoxUpdate update;
+				update.obj = io->obj;
+				update.rubber = io->rubber;
+				update.source = treatio[i].num;
+				update.result = 0;
+				physicsBoxes.push_back(update);
 				continue;
 			}
 		}
@@ -1106,6 +1100,46 @@ void ARX_PHYSICS_Apply() {
 				CheckNPCEx(io);
 		}
 	}
+	
+	// Scripts run above may have destroyed entities or replaced their meshes
+	physicsBoxes.erase(std::remove_if(physicsBoxes.begin(), physicsBoxes.end(),
+	                                  isPhysicsBoxUpdateStale), physicsBoxes.end());
+	
+	if(physicsBoxes.empty())
+		return;
+	
+	ARX_PHYSICS_BOX_ApplyModels(&physicsBoxes[0], physicsBoxes.size(), (float)framedelay);
+	
+	BOOST_FOREACH(const PhysicsBoxUpdate & update, physicsBoxes) {
+		
+		// Damage updates can trigger scripts affecting the remaining entries
+		if(isPhysicsBoxUpdateStale(update))
+			continue;
+		
+		Entity * io = entities[update.source];
+		
+		if(update.result) {
+			if(io->damagedata >= 0) {
+				damages[io->damagedata].active = 1;
+				ARX_DAMAGES_UpdateDamage(io->damagedata, float(arxtime));
+				damages[io->damagedata].exist = 0;
+				io->damagedata = -1;
+			}
+		}
+		
+		if(io->soundcount > 12) {
+			io->soundtime = 0;
+			io->soundcount = 0;
+			for(long k = 0; k < io->obj->pbox->nb_physvert; k++) {
+				io->obj->pbox->vert[k].velocity = Vec3f::ZERO;
+			}
+			io->obj->pbox->active = 2;
+			io->obj->pbox->stopcount = 0;
+		}
+		
+		io->room_flags |= 1;
+		io->pos = io->obj->pbox->vert[0].pos;
+	}
 }
 
 void FaceTarget2(Entity * io)
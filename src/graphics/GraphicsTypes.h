@@ -328,12 +328,20 @@ struct EERIE_BONE
 {
 	long				nb_idxvertices;
 	long 		*		idxvertices;
+	
+	/*!
+	 * Bone-local positions of idxvertices in blocks of four vertices:
+	 * { x0 x1 x2 x3, y0 y1 y2 y3, z0 z1 z2 z3 }, with the last block padded.
+	 * Built with the Cedric data so skinning can transform four vertices per step.
+	 */
+	float *				localblocks;
 	EERIE_GROUPLIST *	original_group;
 	long				father;
 
 	BoneTransform anim;
 	BoneTransform last;
 	BoneTransform init;
+	BoneTransform lodTarget; //!< Last sampled local pose for reduced animation LOD
 
 	Vec3f			transinit_global;
 };
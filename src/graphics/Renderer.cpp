@@ -42,6 +42,7 @@ void Renderer::SetTexture(unsigned int textureStage, Texture * pTexture) {
 void Renderer::SetTexture(unsigned int textureStage, TextureContainer * pTextureContainer) {
 	
 	if(pTextureContainer && pTextureContainer->m_pTexture) {
+		pTextureContainer->use();
 		GetTextureStage(textureStage)->setTexture(pTextureContainer->m_pTexture);
 	} else {
 		GetTextureStage(textureStage)->resetTexture();
@@ -56,6 +56,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/static_assert.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "graphics/data/FTLFormat.h"
 #include "graphics/data/TextureContainer.h"
@@ -70,6 +71,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "io/IO.h"
 #include "io/log/Logger.h"
 
+#include "platform/JobSystem.h"
+
 #include "scene/Object.h"
 
 #include "util/String.h"
@@ -360,90 +363,67 @@ bool ARX_FTL_Save(const fs::path & file, const EERIE_3DOBJ * obj) {
 
 #endif // BUILD_EDIT_LOADSAVE
 
-// MESH cache structure definition & Globals
-struct MCACHE_DATA {
-	res::path name;
-	char * data;
-	size_t size;
-};
-static vector<MCACHE_DATA> meshCache;
+namespace {
 
-// Checks for Mesh file existence in cache
-static long MCache_Get(const res::path & file) {
-	
-	for(size_t i = 0; i < meshCache.size(); i++) {
-		if(meshCache[i].name == file) {
-			return i;
-		}
-	}
+/*!
+ * Parsed contents of a FTL file.
+ * Every entity using the mesh gets its own copy of the prototype, but while a level is
+ * loaded the file is only decompressed and parsed once.
+ */
+struct FtlMesh {
 	
-	return -1;
-}
-
-// Pushes a Mesh In Mesh Cache
-static bool MCache_Push(const res::path & file, char * data, size_t size) {
+	//! Mesh data without textures and per-instance data, never handed out
+	EERIE_3DOBJ * object;
 	
-	if(MCache_Get(file) != -1) {
-		return false; // already cached
-	}
+	//! Texture name for each entry of object->texturecontainer, empty for no texture
+	vector<res::path> textures;
 	
-	LogDebug(file << " #" << meshCache.size());
+	FtlMesh() : object(NULL) { }
 	
-	MCACHE_DATA newMesh;
-	newMesh.size = size;
-	newMesh.data = data;
-	newMesh.name = file;
-	meshCache.push_back(newMesh);
+	~FtlMesh() { delete object; }
 	
-	return true;
-}
-
-void MCache_ClearAll(){
-	for(vector<MCACHE_DATA>::iterator it = meshCache.begin(); it != meshCache.end(); ++it) {
-		free(it->data);
-	}
-
-	meshCache.clear();
-}
+};
 
-// Retreives a Mesh File pointer from cache...
-static char * MCache_Pop(const res::path & file, size_t & size) {
+//! FTL file being decompressed and parsed on the job system
+class FtlPrefetchJob : public jobs::Job {
 	
-	long num = MCache_Get(file);
-	if(num == -1) {
-		return NULL;
-	}
+public:
 	
-	size = meshCache[num].size;
-	return meshCache[num].data;
-}
-
-EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
+	res::path filename;
+	char * compressedData;
+	size_t compressedSize;
+	FtlMesh * mesh;
+	jobs::Counter done;
 	
-	// Creates FTL file name
-	res::path filename = (res::path("game") / file).set_ext("ftl");
+	FtlPrefetchJob(const res::path & file, char * compressed, size_t size)
+		: filename(file), compressedData(compressed), compressedSize(size), mesh(NULL) { }
 	
-	// Checks for FTL file existence
-	PakFile * pf = resources->getFile(filename);
-	if(!pf) {
-		return NULL;
+	~FtlPrefetchJob() {
+		free(compressedData);
+		delete mesh;
 	}
 	
-	size_t compressedSize = 0;
-	char * compressedData = MCache_Pop(filename, compressedSize);
-	LogDebug("File name check " << filename);
-	
-	bool NOrelease = true;
-	if(!compressedData) {
-		compressedData = pf->readAlloc();
-		compressedSize = pf->size();
-		NOrelease = MCache_Push(filename, compressedData, compressedSize) ? 1 : 0;
-	}
+	void run();
 	
-	if(!compressedData) {
-		LogError << "ARX_FTL_Load: error loading from PAK/cache " << filename;
-		return NULL;
-	}
+};
+
+typedef boost::unordered_map<std::string, FtlMesh *> FtlMeshes;
+typedef boost::unordered_map<std::string, FtlPrefetchJob *> FtlPrefetchJobs;
+
+} // anonymous namespace
+
+//! Parsed meshes by FTL file name, only kept while a level is loaded - NULL if parsing failed
+static FtlMeshes meshCache;
+static bool keepParsedMeshes = false;
+
+static FtlPrefetchJobs prefetchedMeshes;
+
+/*!
+ * Decompress and parse a FTL file.
+ * Only touches the returned mesh and may be called from any thread.
+ */
+static FtlMesh * ARX_FTL_Parse(const res::path & filename, const char * compressedData,
+                               size_t compressedSize) {
 	
 	size_t allocsize; // The size of the data TODO size ignored
 	char * dat = blastMemAlloc(compressedData, compressedSize, allocsize);
@@ -452,10 +432,6 @@ EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
 		return NULL;
 	}
 	
-	if(!NOrelease) {
-		free(compressedData);
-	}
-	
 	size_t pos = 0; // The position within the data
 	
 	// Pointer to Primary Header
@@ -491,7 +467,8 @@ EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
 	pos = afsh->offset_3Ddata;
 	
 	// Available from here in whole function
-	EERIE_3DOBJ * obj = new EERIE_3DOBJ();
+	FtlMesh * mesh = new FtlMesh;
+	EERIE_3DOBJ * obj = mesh->object = new EERIE_3DOBJ();
 	
 	const ARX_FTL_3D_DATA_HEADER * af3Ddh;
 	af3Ddh = reinterpret_cast<const ARX_FTL_3D_DATA_HEADER *>(dat + pos);
@@ -500,6 +477,7 @@ EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
 	obj->vertexlist.resize(af3Ddh->nb_vertex);
 	obj->facelist.resize(af3Ddh->nb_faces);
 	obj->texturecontainer.resize(af3Ddh->nb_maps);
+	mesh->textures.resize(af3Ddh->nb_maps);
 	obj->nbgroups = af3Ddh->nb_groups;
 	obj->actionlist.resize(af3Ddh->nb_action);
 	obj->selections.resize(af3Ddh->nb_selections);
@@ -564,14 +542,12 @@ EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
 			tex = reinterpret_cast<const Texture_Container_FTL *>(dat + pos);
 			pos += sizeof(Texture_Container_FTL);
 			
-			if(tex->name[0] == '\0') {
-				// Some object files contain textures with empty names
-				// Don't bother trying to load them as that will just generate an error message
-				obj->texturecontainer[i] = NULL;
-			} else {
-				// Create the texture and put it in the container list
-				res::path name = res::path::load(util::loadString(tex->name)).remove_ext();
-				obj->texturecontainer[i] = TextureContainer::Load(name, TextureContainer::Level);
+			// Some object files contain textures with empty names
+			// Don't bother trying to load them as that will just generate an error message
+			// The textures are loaded for each instance as they may be released with the level
+			obj->texturecontainer[i] = NULL;
+			if(tex->name[0] != '\0') {
+				mesh->textures[i] = res::path::load(util::loadString(tex->name)).remove_ext();
 			}
 		}
 	}
@@ -684,11 +660,188 @@ EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
 	free(dat);
 	
 	EERIE_OBJECT_CenterObjectCoordinates(obj);
-	EERIE_CreateCedricData(obj);
-	// Now we can release our cool FTL file
 	EERIE_Object_Precompute_Fast_Access(obj);
 	
-	LogDebug("ARX_FTL_Load: loaded object " << filename);
+	return mesh;
+}
+
+void FtlPrefetchJob::run() {
+	mesh = ARX_FTL_Parse(filename, compressedData, compressedSize);
+	free(compressedData), compressedData = NULL;
+}
+
+//! Create a new object with its own copy of the mesh data
+static EERIE_3DOBJ * ARX_FTL_Instantiate(const FtlMesh & mesh) {
+	
+	const EERIE_3DOBJ * src = mesh.object;
+	EERIE_3DOBJ * obj = new EERIE_3DOBJ();
+	
+	obj->file = src->file;
+	obj->origin = src->origin;
+	obj->point0 = src->point0;
+	obj->vertexlist = src->vertexlist;
+	obj->vertexlist3 = src->vertexlist3;
+	obj->facelist = src->facelist;
+	obj->actionlist = src->actionlist;
+	obj->selections = src->selections;
+	
+	if(src->nbgroups > 0) {
+		obj->nbgroups = src->nbgroups;
+		obj->grouplist = new EERIE_GROUPLIST[obj->nbgroups];
+		std::copy(src->grouplist, src->grouplist + src->nbgroups, obj->grouplist);
+	}
+	
+	obj->texturecontainer.resize(mesh.textures.size());
+	for(size_t i = 0; i < mesh.textures.size(); i++) {
+		if(!mesh.textures[i].empty()) {
+			obj->texturecontainer[i] = TextureContainer::Load(mesh.textures[i], TextureContainer::Level
+			                                                                    | TextureContainer::Async);
+		}
+	}
+	
+	if(src->sdata) {
+		obj->sdata = new COLLISION_SPHERES_DATA(*src->sdata);
+	}
+	
+	if(src->cdata) {
+		obj->cdata = new CLOTHES_DATA();
+		obj->cdata->nb_cvert = src->cdata->nb_cvert;
+		obj->cdata->springs = src->cdata->springs;
+		obj->cdata->cvert = new CLOTHESVERTEX[obj->cdata->nb_cvert];
+		obj->cdata->backup = new CLOTHESVERTEX[obj->cdata->nb_cvert];
+		std::copy(src->cdata->cvert, src->cdata->cvert + obj->cdata->nb_cvert, obj->cdata->cvert);
+		std::copy(src->cdata->backup, src->cdata->backup + obj->cdata->nb_cvert, obj->cdata->backup);
+	}
+	
+	obj->fastaccess = src->fastaccess;
+	
+	EERIE_CreateCedricData(obj);
 	
 	return obj;
 }
+
+void ARX_FTL_Prefetch(const res::path & file) {
+	
+	res::path filename = (res::path("game") / file).set_ext("ftl");
+	
+	if(meshCache.find(filename.string()) != meshCache.end()
+	   || prefetchedMeshes.find(filename.string()) != prefetchedMeshes.end()) {
+		return;
+	}
+	
+	// The resource system is not thread-safe, so read the file now
+	PakFile * pf = resources->getFile(filename);
+	if(!pf) {
+		return;
+	}
+	
+	char * compressedData = pf->readAlloc();
+	if(!compressedData) {
+		return;
+	}
+	
+	FtlPrefetchJob * job = new FtlPrefetchJob(filename, compressedData, pf->size());
+	prefetchedMeshes[filename.string()] = job;
+	jobs::submit(*job, &job->done);
+}
+
+/*!
+ * Take the parsed mesh of a prefetched file, waiting for it if needed.
+ * @param mesh receives the parsed mesh, or NULL if parsing failed
+ * @return false if the file was not prefetched
+ */
+static bool MCache_TakePrefetched(const res::path & file, FtlMesh *& mesh) {
+	
+	FtlPrefetchJobs::iterator it = prefetchedMeshes.find(file.string());
+	if(it == prefetchedMeshes.end()) {
+		return false;
+	}
+	
+	FtlPrefetchJob * job = it->second;
+	prefetchedMeshes.erase(it);
+	
+	jobs::wait(job->done);
+	mesh = job->mesh;
+	job->mesh = NULL;
+	delete job;
+	
+	return true;
+}
+
+//! Release FTL files that were prefetched but not loaded
+static void MCache_ClearPrefetched() {
+	
+	for(FtlPrefetchJobs::iterator it = prefetchedMeshes.begin(); it != prefetchedMeshes.end(); ++it) {
+		jobs::wait(it->second->done);
+		delete it->second;
+	}
+	
+	prefetchedMeshes.clear();
+}
+
+void MCache_KeepParsedMeshes() {
+	keepParsedMeshes = true;
+}
+
+void MCache_ClearAll() {
+	
+	keepParsedMeshes = false;
+	
+	MCache_ClearPrefetched();
+	
+	for(FtlMeshes::iterator it = meshCache.begin(); it != meshCache.end(); ++it) {
+		delete it->second;
+	}
+	
+	meshCache.clear();
+}
+
+EERIE_3DOBJ * ARX_FTL_Load(const res::path & file) {
+	
+	// Creates FTL file name
+	res::path filename = (res::path("game") / file).set_ext("ftl");
+	
+	FtlMeshes::const_iterator it = meshCache.find(filename.string());
+	if(it != meshCache.end()) {
+		return it->second ? ARX_FTL_Instantiate(*it->second) : NULL;
+	}
+	
+	FtlMesh * mesh;
+	if(!MCache_TakePrefetched(filename, mesh)) {
+		
+		// Checks for FTL file existence
+		PakFile * pf = resources->getFile(filename);
+		if(!pf) {
+			return NULL;
+		}
+		
+		char * compressedData = pf->readAlloc();
+		if(!compressedData) {
+			LogError << "ARX_FTL_Load: error loading from PAK " << filename;
+			return NULL;
+		}
+		
+		mesh = ARX_FTL_Parse(filename, compressedData, pf->size());
+		free(compressedData);
+	}
+	
+	if(!mesh) {
+		// Remember the failure so that the file is not parsed and reported again
+		if(keepParsedMeshes) {
+			meshCache[filename.string()] = NULL;
+		}
+		return NULL;
+	}
+	
+	LogDebug("ARX_FTL_Load: loaded object " << filename);
+	
+	if(!keepParsedMeshes) {
+		EERIE_3DOBJ * obj = ARX_FTL_Instantiate(*mesh);
+		delete mesh;
+		return obj;
+	}
+	
+	meshCache[filename.string()] = mesh;
+	
+	return ARX_FTL_Instantiate(*mesh);
+}
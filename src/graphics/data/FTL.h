@@ -64,9 +64,24 @@ bool ARX_FTL_Save(const fs::path & file, const EERIE_3DOBJ * obj);
 
 /*!
  * Load a FTL file
+ * While parsed meshes are kept, each file is only parsed once - later loads copy the
+ * cached mesh data.
  */
 EERIE_3DOBJ * ARX_FTL_Load(const res::path & file);
 
+/*!
+ * Start decompressing and parsing a FTL file on the job system.
+ * The file is read now, so that a later ARX_FTL_Load() for it can use the parsed mesh.
+ */
+void ARX_FTL_Prefetch(const res::path & file);
+
+/*!
+ * Keep the parsed meshes until MCache_ClearAll() is called.
+ * Entities loaded in the meantime that use the same FTL file only parse it once.
+ */
+void MCache_KeepParsedMeshes();
+
+//! Release all parsed and prefetched meshes and stop keeping parsed meshes
 void MCache_ClearAll();
 
 #endif // ARX_GRAPHICS_DATA_FTL_H
@@ -71,6 +71,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/VertexBuffer.h"
 #include "graphics/GraphicsUtility.h"
 #include "graphics/data/TextureContainer.h"
+#include "graphics/data/TextureLoader.h"
 #include "graphics/data/FastSceneFormat.h"
 #include "graphics/particle/ParticleEffects.h"
 
@@ -83,7 +84,11 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "io/IO.h"
 #include "io/log/Logger.h"
 
+#include "platform/JobSystem.h"
+
 #include "physics/Anchors.h"
+#include "physics/BackgroundCollision.h"
+#include "physics/Raycast.h"
 
 #include "scene/Scene.h"
 #include "scene/Light.h"
@@ -215,6 +220,10 @@ EERIEPOLY * CheckInPoly(float x, float y, float z, float * needY)
 
 	if(pz <= 0 || pz >= ACTIVEBKG->Zsize - 1 || px <= 0 || px >= ACTIVEBKG->Xsize - 1)
 		return NULL;
+	
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision)
+		return NULL;
 
 	float rx = poss.x - ((float)px * ACTIVEBKG->Xdiv);
 	float rz = poss.z - ((float)pz * ACTIVEBKG->Zdiv);
@@ -258,30 +267,38 @@ EERIEPOLY * CheckInPoly(float x, float y, float z, float * needY)
 		pxa = sPx;
 	}
 
-	EERIEPOLY * found = NULL;
+	const CollisionPoly * found = NULL;
 	float foundY = 0.f;
 
 	for(short j = pzi; j <= pza; j++) {
 		for(short i = pxi; i <= pxa; i++) {
-			FAST_BKG_DATA * feg = &ACTIVEBKG->fastdata[i][j];
-
-			for(short k = 0; k < feg->nbpolyin; k++) {
-				EERIEPOLY * ep = feg->polyin[k];
-
-				if(poss.x >= ep->min.x
-				&& poss.x <= ep->max.x
-				&& poss.z >= ep->min.z
-				&& poss.z <= ep->max.z
-				&& !(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
-				&& ep->max.y >= poss.y
-				&& ep != found
-				&& PointIn2DPolyXZ(ep, poss.x, poss.z)
-				&& GetTruePolyY(ep, &poss, &rz)
-				&& rz >= poss.y
-				&& (!found || (found && rz <= foundY))
-				) {
-					found = ep;
-					foundY = rz;
+			const CollisionCell & cell = collision->cell(i, j);
+			
+			for(u32 c = cell.inClusterBegin; c < cell.inClusterEnd; c++) {
+				const CollisionCluster & cluster = collision->clusters[c];
+				
+				if(poss.x < cluster.min.x || poss.x > cluster.max.x
+				   || poss.z < cluster.min.z || poss.z > cluster.max.z
+				   || cluster.max.y < poss.y)
+					continue;
+				
+				for(u32 k = cluster.begin; k < cluster.end; k++) {
+					const CollisionPoly * ep = &collision->overlappingPoly(k);
+					
+					if(poss.x >= ep->min.x
+					&& poss.x <= ep->max.x
+					&& poss.z >= ep->min.z
+					&& poss.z <= ep->max.z
+					&& ep->max.y >= poss.y
+					&& ep != found
+					&& PointIn2DPolyXZ(*ep, poss.x, poss.z)
+					&& GetTruePolyY(*ep, &poss, &rz)
+					&& rz >= poss.y
+					&& (!found || (found && rz <= foundY))
+					) {
+						found = ep;
+						foundY = rz;
+					}
 				}
 			}
 		}
@@ -290,7 +307,7 @@ EERIEPOLY * CheckInPoly(float x, float y, float z, float * needY)
 	if(needY)
 		*needY = foundY;
 
-	return found;
+	return found ? found->ep : NULL;
 }
 
 EERIEPOLY * EECheckInPoly(const Vec3f * pos, float * needY) {
@@ -362,66 +379,86 @@ bool IsAnyPolyThere(float x, float z) {
 
 EERIEPOLY * GetMinPoly(float x, float y, float z) {
 	
-	FAST_BKG_DATA * feg = getFastBackgroundData(x, z);
-	if(!feg) {
+	long px = x * ACTIVEBKG->Xmul;
+	long pz = z * ACTIVEBKG->Zmul;
+	
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision || px < 0 || px >= ACTIVEBKG->Xsize || pz < 0 || pz >= ACTIVEBKG->Zsize) {
 		return NULL;
 	}
 	
 	Vec3f pos(x, y, z);
 	
-	EERIEPOLY * found = NULL;
+	const CollisionCell & cell = collision->cell(px, pz);
+	
+	const CollisionPoly * found = NULL;
 	float foundy = 0.0f;
-	for (long k = 0; k < feg->nbpolyin; k++) {
+	for(u32 c = cell.inClusterBegin; c < cell.inClusterEnd; c++) {
 		
-		EERIEPOLY * ep = feg->polyin[k];
-
-		if(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
+		const CollisionCluster & cluster = collision->clusters[c];
+		if(x < cluster.min.x || x > cluster.max.x || z < cluster.min.z || z > cluster.max.z) {
 			continue;
+		}
 		
-		if(PointIn2DPolyXZ(ep, x, z)) {
-			float ret;
-			if(GetTruePolyY(ep, &pos, &ret)) {
-				if(!found || ret > foundy) {
-					found = ep;
-					foundy = ret;
+		for(u32 k = cluster.begin; k < cluster.end; k++) {
+			
+			const CollisionPoly & ep = collision->overlappingPoly(k);
+			
+			if(PointIn2DPolyXZ(ep, x, z)) {
+				float ret;
+				if(GetTruePolyY(ep, &pos, &ret)) {
+					if(!found || ret > foundy) {
+						found = &ep;
+						foundy = ret;
+					}
 				}
 			}
 		}
 	}
 	
-	return found;
+	return found ? found->ep : NULL;
 }
 
 EERIEPOLY * GetMaxPoly(float x, float y, float z) {
 	
-	FAST_BKG_DATA * feg = getFastBackgroundData(x, z);
-	if(!feg) {
+	long px = x * ACTIVEBKG->Xmul;
+	long pz = z * ACTIVEBKG->Zmul;
+	
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision || px < 0 || px >= ACTIVEBKG->Xsize || pz < 0 || pz >= ACTIVEBKG->Zsize) {
 		return NULL;
 	}
 	
 	Vec3f pos(x, y, z);
 	
-	EERIEPOLY * found = NULL;
+	const CollisionCell & cell = collision->cell(px, pz);
+	
+	const CollisionPoly * found = NULL;
 	float foundy = 0.0f;
-	for(long k = 0; k < feg->nbpolyin; k++) {
-		
-		EERIEPOLY * ep = feg->polyin[k];
+	for(u32 c = cell.inClusterBegin; c < cell.inClusterEnd; c++) {
 		
-		if(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
+		const CollisionCluster & cluster = collision->clusters[c];
+		if(x < cluster.min.x || x > cluster.max.x || z < cluster.min.z || z > cluster.max.z) {
 			continue;
+		}
 		
-		if(PointIn2DPolyXZ(ep, x, z)) {
-			float ret;
-			if(GetTruePolyY(ep, &pos, &ret)) {
-				if(!found || ret < foundy) {
-					found = ep;
-					foundy = ret;
+		for(u32 k = cluster.begin; k < cluster.end; k++) {
+			
+			const CollisionPoly & ep = collision->overlappingPoly(k);
+			
+			if(PointIn2DPolyXZ(ep, x, z)) {
+				float ret;
+				if(GetTruePolyY(ep, &pos, &ret)) {
+					if(!found || ret < foundy) {
+						found = &ep;
+						foundy = ret;
+					}
 				}
 			}
 		}
 	}
 	
-	return found;
+	return found ? found->ep : NULL;
 }
 
 EERIEPOLY * EEIsUnderWater(const Vec3f * pos) {
@@ -712,243 +749,47 @@ static bool RayIn3DPolyNoCull(Vec3f * orgn, Vec3f * dest, EERIEPOLY * epp) {
 
 int EERIELaunchRay3(Vec3f * orgn, Vec3f * dest,  Vec3f * hit, EERIEPOLY * epp, long flag) {
 	
-	Vec3f p; //current ray pos
-	Vec3f d; // ray incs
-	Vec3f ad; // absolute ray incs
-	Vec3f i;
-	long lpx, lpz;
-	long voidlast;
-	long px, pz;
-#ifdef PANDORA
-	float pas = 3.2f;
-#else
-	float pas = 1.5f;
-#endif
-	
-	long iii = 0;
-	float maxstepp = 20000.f / pas;
-	*hit = p = *orgn;
-	
-	voidlast = 0;
-	lpx = lpz = -1;
-#ifdef __ARM_NEON__
-	d.xyz0 = vsubq_f32(dest->xyz0, orgn->xyz0);
-	ad.xyz0 = vabsq_f32(d.xyz0);
-#else
-	d.x = (dest->x - orgn->x);
-	ad.x = EEfabs(d.x);
-	d.y = (dest->y - orgn->y);
-	ad.y = EEfabs(d.y);
-	d.z = (dest->z - orgn->z);
-	ad.z = EEfabs(d.z);
-#endif
-	if(ad.x >= ad.y && ad.x >= ad.z) {
-		i.x = (ad.x != d.x) ? (-1.f * pas) : (1.f * pas);
-		i.y = d.y / (ad.x / pas);
-		i.z = d.z / (ad.x / pas);
-	} else if(ad.y >= ad.x && ad.y >= ad.z) {
-		i.x = d.x / (ad.y / pas);
-		i.y = (ad.y != d.y) ? (-1.f * pas) : (1.f * pas);
-		i.z = d.z / (ad.y / pas);
-	} else {
-		i.x = d.x / (ad.z / pas);
-		i.y = d.y / (ad.z / pas);
-		i.z = (ad.z != d.z) ? (-1.f * pas) : (1.f * pas);
-	}
+	ARX_UNUSED(flag);
 	
-	for(;;) {
-		
-		p += i;
-		
-		if(i.x == -1.f * pas && p.x <= dest->x) {
-			*hit = p;
-			return 0;
-		}
-		
-		if(i.x == 1.f * pas && p.x >= dest->x) {
-			*hit = p;
-			return 0;
-		}
-		
-		if(i.y == -1.f * pas && p.y <= dest->y) {
-			*hit = p;
-			return 0;
-		}
-		
-		if(i.y == 1.f * pas && p.y >= dest->y) {
-			*hit = p;
-			return 0;
-		}
-		
-		if(i.z == -1.f * pas && p.z <= dest->z) {
-			*hit = p;
-			return 0;
-		}
-		
-		if(i.z == 1.f * pas && p.z >= dest->z) {
-			*hit = p;
-			return 0;
-		}
-		
-		iii++;
-		
-		if(iii > maxstepp) {
-			*hit = p;
-			return -1;
-		}
-		
-		px = long(p.x * ACTIVEBKG->Xmul);
-		pz = long(p.z * ACTIVEBKG->Zmul);
+	const float maxDistance = 20000.f;
+	
+	BackgroundRaycast ray(*orgn, *dest, POLY_TRANS);
+	
+	float length = fdist(*orgn, *dest);
+	
+	while(ray.nextCell()) {
 		
-		if(px < 0 || px > ACTIVEBKG->Xsize - 1 || pz < 0 || pz > ACTIVEBKG->Zsize - 1) {
-			*hit = p;
+		if(ray.enter() * length > maxDistance) {
+			*hit = ray.point(ray.enter());
 			return -1;
 		}
 		
-		if(lpx == px && lpz == pz && voidlast) {
-			continue;
-		}
-		
-		lpx = px;
-		lpz = pz;
-		voidlast = !flag;
-		long jx1 = clamp(px - 1l, 0l, ACTIVEBKG->Xsize - 1l);
-		long jx2 = clamp(px + 1l, 0l, ACTIVEBKG->Xsize - 1l);
-		long jz1 = clamp(pz - 1l, 0l, ACTIVEBKG->Zsize - 1l);
-		long jz2 = clamp(pz + 1l, 0l, ACTIVEBKG->Zsize - 1l);
-		
-		EERIE_BKG_INFO * eg = &ACTIVEBKG->Backg[px + pz * ACTIVEBKG->Xsize];
-		if(eg->nbpoly == 0) {
-			*hit = p;
+		// Cells without polygons are outside of the level
+		if(ray.cell()->nbpoly == 0) {
+			*hit = ray.point(ray.enter());
 			return 1;
 		}
 		
-		for(pz = jz1; pz < jz2; pz++) for (px = jx1; px < jx2; px++) {
-			eg = &ACTIVEBKG->Backg[px + pz * ACTIVEBKG->Xsize];
-			for(long k = 0; k < eg->nbpoly; k++) {
-				EERIEPOLY * ep = &eg->polydata[k];
-				if(ep->type & POLY_TRANS) {
-					continue;
-				}
-				if(p.y < ep->min.y - 10.f || p.y > ep->max.y + 10.f
-				   || p.x < ep->min.x - 10.f || p.x > ep->max.x + 10.f
-				   || p.z < ep->min.z - 10.f || p.z > ep->max.z + 10.f) {
-					continue;
-				}
-				voidlast = 0;
-				if(RayIn3DPolyNoCull(orgn, dest, ep)) {
-					*hit = p;
-					return (ep == epp) ? 0 : 1;
-				}
-			}
+		if(ray.testCell()) {
+			*hit = ray.hitPosition();
+			return (ray.hitPoly() == epp) ? 0 : 1;
 		}
 	}
+	
+	if(ray.leftBackground()) {
+		*hit = ray.point(ray.enter());
+		return -1;
+	}
+	
+	*hit = *dest;
+	return 0;
 }
 
 // Computes the visibility from a point to another... (sort of...)
 bool Visible(Vec3f * orgn, Vec3f * dest, EERIEPOLY * epp, Vec3f * hit)
 {
-	float ix,iy,iz;
-	long px,pz;
-	EERIEPOLY *ep;
-
-	EERIE_BKG_INFO *eg;
-	float pas = 35.f;
-
-	Vec3f found_hit = Vec3f::ZERO;
-	EERIEPOLY *found_ep = NULL;
-	float iter,t;
-	
-	//current ray pos
-	float x = orgn->x;
-	float y = orgn->y;
-	float z = orgn->z;
-
-	float distance;
-	float nearest = distance = fdist(*orgn, *dest);
-
-	if(distance < pas)
-		pas = distance * .5f;
-
-	// ray incs
-	float dx = (dest->x - orgn->x);
-	float dy = (dest->y - orgn->y);
-	float dz = (dest->z - orgn->z);
-
-	// absolute ray incs
-	float adx = EEfabs(dx);
-	float ady = EEfabs(dy);
-	float adz = EEfabs(dz);
-
-	if(adx >= ady && adx >= adz) {
-		if(adx != dx)
-			ix = -pas;
-		else
-			ix = pas;
-
-		iter = adx / pas;
-		t = 1.f / (iter);
-		iy = dy * t;
-		iz = dz * t;
-	} else if(ady >= adx && ady >= adz) {
-		if(ady != dy)
-			iy = -pas;
-		else
-			iy = pas;
-
-		iter = ady / pas;
-		t = 1.f / (iter);
-		ix = dx * t;
-		iz = dz * t;
-	} else {
-		if(adz != dz)
-			iz = -pas;
-		else
-			iz = pas;
-
-		iter = adz / pas;
-		t = 1.f / (iter);
-		ix = dx * t;
-		iy = dy * t;
-	}
-
-	float dd;
-	x -= ix;
-	y -= iy;
-	z -= iz;
-
-	while(iter > 0.f) {
-		iter -= 1.f;
-		x += ix;
-		y += iy;
-		z += iz;
-
-		px = (long)(x * ACTIVEBKG->Xmul);
-		pz = (long)(z * ACTIVEBKG->Zmul);
-
-		if(px < 0 || px > ACTIVEBKG->Xsize - 1 || pz < 0 || pz > ACTIVEBKG->Zsize - 1)
-			break;
-
-		eg = &ACTIVEBKG->Backg[px+pz*ACTIVEBKG->Xsize];
-
-		for(long k = 0; k < eg->nbpolyin; k++) {
-			ep = eg->polyin[k];
-
-			if (ep)
-			if ((ep->min.y - pas < y) && (ep->max.y + pas > y))
-			if ((ep->min.x - pas < x) && (ep->max.x + pas > x))
-			if ((ep->min.z - pas < z) && (ep->max.z + pas > z))
-			if (RayCollidingPoly(orgn, dest, ep, hit)) {
-				dd = fdist(*orgn, *hit);
-
-				if(dd < nearest) {
-					nearest = dd;
-					found_ep = ep;
-					found_hit = *hit;
-				}
-			}
-		}
-	}
+	Vec3f found_hit;
+	EERIEPOLY * found_ep = RaycastBackground(*orgn, *dest, 0, &found_hit);
 
 	if(!found_ep)
 		return true;
@@ -1128,6 +969,7 @@ void ClearBackground(EERIE_BACKGROUND * eb) {
 		return;
 	
 	AnchorData_ClearAll(eb);
+	ReleaseBackgroundCollision(eb);
 	
 	free(eb->minmax), eb->minmax = NULL;
 	
@@ -1324,6 +1166,8 @@ void EERIEPOLY_Compute_PolyIn()
 			fbd->polyin = eg->polyin;
 			fbd->ianchors = eg->ianchors;
 		}
+	
+	BuildBackgroundCollision(ACTIVEBKG);
 }
 
 float GetTileMinY(long i, long j) {
@@ -1753,70 +1597,30 @@ bool FastSceneLoad(const res::path & partial_path) {
 }
 
 
-static bool loadFastScene(const res::path & file, const char * data, const char * end) {
-	
-	// Read the scene header
-	const FAST_SCENE_HEADER * fsh = fts_read<FAST_SCENE_HEADER>(data, end);
-	if(fsh->version != FTS_VERSION) {
-		LogError << "FTS: version mismatch: got " << fsh->version << ", expected "
-		         << FTS_VERSION << " in " << file;
-		return false;
-	}
-	if(fsh->sizex != ACTIVEBKG->Xsize || fsh->sizez != ACTIVEBKG->Zsize) {
-		LogError << "FTS: size mismatch in FAST_SCENE_HEADER";
-		return false;
-	}
-	player.pos = fsh->playerpos;
-	Mscenepos = fsh->Mscenepos;
-	
-	
-	// Load textures
-	typedef std::map<s32, TextureContainer *> TextureContainerMap;
-	TextureContainerMap textures;
-	const FAST_TEXTURE_CONTAINER * ftc;
-	ftc = fts_read<FAST_TEXTURE_CONTAINER>(data, end, fsh->nb_textures);
-	for(long k = 0; k < fsh->nb_textures; k++) {
-		res::path file = res::path::load(util::loadString(ftc[k].fic)).remove_ext();
-		TextureContainer * tmpTC;
-		tmpTC = TextureContainer::Load(file, TextureContainer::Level);
-		if(tmpTC) {
-			textures[ftc[k].tc] = tmpTC;
-		}
-	}
-	PROGRESS_BAR_COUNT += 4.f, LoadLevelScreen();
+namespace {
+
+typedef std::map<s32, TextureContainer *> TextureContainerMap;
+
+//! Location of the polygons of one background cell in the FTS data
+struct FastSceneCell {
+	const FAST_EERIEPOLY * polys;
+	long nbpoly;
+	EERIEPOLY * polydata;
+};
+
+//! Convert the polygons of a range of cells - the cells are independent of each other
+struct FastScenePolyLoader {
 	
+	const std::vector<FastSceneCell> * cells;
+	const TextureContainerMap * textures;
 	
-	// Load cells with polygons and anchors
-	LogDebug("FTS: loading " << fsh->sizex << " x " << fsh->sizez
-	         << " cells ...");
-	for(long j = 0; j < fsh->sizez; j++) {
-		for(long i = 0; i < fsh->sizex; i++) {
-			
-			const FAST_SCENE_INFO * fsi = fts_read<FAST_SCENE_INFO>(data, end);
-			
-			EERIE_BKG_INFO & bkg = ACTIVEBKG->Backg[i + (j * fsh->sizex)];
-			
-			bkg.nbianchors = (short)fsi->nbianchors;
-			bkg.nbpoly = (short)fsi->nbpoly;
-			
-			if(fsi->nbpoly > 0) {
-				bkg.polydata = (EERIEPOLY *)malloc(sizeof(EERIEPOLY) * fsi->nbpoly);
-			} else {
-				bkg.polydata = NULL;
-			}
-			
-			bkg.treat = 0;
-			bkg.nothing = fsi->nbpoly ? 0 : 1;
-			
-			bkg.frustrum_maxy = -99999999.f;
-			bkg.frustrum_miny = 99999999.f;
-			
-			const FAST_EERIEPOLY * eps;
-			eps = fts_read<FAST_EERIEPOLY>(data, end, fsi->nbpoly);
-			for(long k = 0; k < fsi->nbpoly; k++) {
+	void operator()(size_t begin, size_t end) const {
+		for(size_t i = begin; i < end; i++) {
+			const FastSceneCell & cell = (*cells)[i];
+			for(long k = 0; k < cell.nbpoly; k++) {
 				
-				const FAST_EERIEPOLY * ep = &eps[k];
-				EERIEPOLY * ep2 = &bkg.polydata[k];
+				const FAST_EERIEPOLY * ep = &cell.polys[k];
+				EERIEPOLY * ep2 = &cell.polydata[k];
 				
 				memset(ep2, 0, sizeof(EERIEPOLY));
 				
@@ -1827,8 +1631,8 @@ static bool loadFastScene(const res::path & file, const char * data, const char
 				copy(ep->nrml, ep->nrml + 4, ep2->nrml);
 				
 				if(ep->tex != 0) {
-					TextureContainerMap::const_iterator cit = textures.find(ep->tex);
-					ep2->tex = (cit != textures.end()) ? cit->second : NULL;
+					TextureContainerMap::const_iterator cit = textures->find(ep->tex);
+					ep2->tex = (cit != textures->end()) ? cit->second : NULL;
 				} else {
 					ep2->tex = NULL;
 				}
@@ -1877,15 +1681,78 @@ static bool loadFastScene(const res::path & file, const char * data, const char
 					dist = max(dist, d);
 				}
 				ep2->v[0].rhw = dist;
-				
-				DeclareEGInfo(ep2->center.x, ep2->center.z);
-				DeclareEGInfo(ep2->v[0].p.x, ep2->v[0].p.z);
-				DeclareEGInfo(ep2->v[1].p.x, ep2->v[1].p.z);
-				DeclareEGInfo(ep2->v[2].p.x, ep2->v[2].p.z);
-				if(ep->type & POLY_QUAD) {
-					DeclareEGInfo(ep2->v[3].p.x, ep2->v[3].p.z);
-				}
 			}
+		}
+	}
+	
+};
+
+} // anonymous namespace
+
+static bool loadFastScene(const res::path & file, const char * data, const char * end) {
+	
+	// Read the scene header
+	const FAST_SCENE_HEADER * fsh = fts_read<FAST_SCENE_HEADER>(data, end);
+	if(fsh->version != FTS_VERSION) {
+		LogError << "FTS: version mismatch: got " << fsh->version << ", expected "
+		         << FTS_VERSION << " in " << file;
+		return false;
+	}
+	if(fsh->sizex != ACTIVEBKG->Xsize || fsh->sizez != ACTIVEBKG->Zsize) {
+		LogError << "FTS: size mismatch in FAST_SCENE_HEADER";
+		return false;
+	}
+	player.pos = fsh->playerpos;
+	Mscenepos = fsh->Mscenepos;
+	
+	
+	// Load textures
+	TextureContainerMap textures;
+	const FAST_TEXTURE_CONTAINER * ftc;
+	ftc = fts_read<FAST_TEXTURE_CONTAINER>(data, end, fsh->nb_textures);
+	for(long k = 0; k < fsh->nb_textures; k++) {
+		res::path file = res::path::load(util::loadString(ftc[k].fic)).remove_ext();
+		TextureContainer * tmpTC;
+		tmpTC = TextureContainer::Load(file, TextureContainer::Level | TextureContainer::Async);
+		if(tmpTC) {
+			textures[ftc[k].tc] = tmpTC;
+		}
+	}
+	// The scene textures are decoded while we load the rest of the scene
+	TextureLoader::Fence texturesLoaded = TextureLoader::getFence();
+	PROGRESS_BAR_COUNT += 4.f, LoadLevelScreen();
+	
+	
+	// Load cells with polygons and anchors
+	LogDebug("FTS: loading " << fsh->sizex << " x " << fsh->sizez
+	         << " cells ...");
+	std::vector<FastSceneCell> cells(fsh->sizex * fsh->sizez);
+	for(long j = 0; j < fsh->sizez; j++) {
+		for(long i = 0; i < fsh->sizex; i++) {
+			
+			const FAST_SCENE_INFO * fsi = fts_read<FAST_SCENE_INFO>(data, end);
+			
+			EERIE_BKG_INFO & bkg = ACTIVEBKG->Backg[i + (j * fsh->sizex)];
+			
+			bkg.nbianchors = (short)fsi->nbianchors;
+			bkg.nbpoly = (short)fsi->nbpoly;
+			
+			if(fsi->nbpoly > 0) {
+				bkg.polydata = (EERIEPOLY *)malloc(sizeof(EERIEPOLY) * fsi->nbpoly);
+			} else {
+				bkg.polydata = NULL;
+			}
+			
+			bkg.treat = 0;
+			
+			bkg.frustrum_maxy = -99999999.f;
+			bkg.frustrum_miny = 99999999.f;
+			
+			// The polygons are converted below, once all cells have been located
+			FastSceneCell & cell = cells[i + (j * fsh->sizex)];
+			cell.polys = fts_read<FAST_EERIEPOLY>(data, end, fsi->nbpoly);
+			cell.nbpoly = fsi->nbpoly;
+			cell.polydata = bkg.polydata;
 			
 			if(fsi->nbianchors <= 0) {
 				bkg.ianchors = NULL;
@@ -1897,6 +1764,29 @@ static bool loadFastScene(const res::path & file, const char * data, const char
 			
 		}
 	}
+	
+	FastScenePolyLoader polyLoader;
+	polyLoader.cells = &cells;
+	polyLoader.textures = &textures;
+	jobs::parallelFor(0, cells.size(), polyLoader);
+	
+	// Mark the cells touched by polygons, in the same order as when loading cell by cell
+	for(size_t i = 0; i < cells.size(); i++) {
+		
+		EERIE_BKG_INFO & bkg = ACTIVEBKG->Backg[i];
+		bkg.nothing = cells[i].nbpoly ? 0 : 1;
+		
+		for(long k = 0; k < cells[i].nbpoly; k++) {
+			const EERIEPOLY * ep = &cells[i].polydata[k];
+			DeclareEGInfo(ep->center.x, ep->center.z);
+			DeclareEGInfo(ep->v[0].p.x, ep->v[0].p.z);
+			DeclareEGInfo(ep->v[1].p.x, ep->v[1].p.z);
+			DeclareEGInfo(ep->v[2].p.x, ep->v[2].p.z);
+			if(ep->type & POLY_QUAD) {
+				DeclareEGInfo(ep->v[3].p.x, ep->v[3].p.z);
+			}
+		}
+	}
 	PROGRESS_BAR_COUNT += 4.f, LoadLevelScreen();
 	
 	
@@ -2048,6 +1938,9 @@ static bool loadFastScene(const res::path & file, const char * data, const char
 	EERIE_PORTAL_Blend_Portals_And_Rooms();
 	PROGRESS_BAR_COUNT += 1.f, LoadLevelScreen();
 	
+	// The portal vertex buffers need the final texture sizes
+	TextureLoader::wait(texturesLoaded);
+	
 	ComputePortalVertexBuffer();
 	PROGRESS_BAR_COUNT += 1.f, LoadLevelScreen();
 	
@@ -101,6 +101,7 @@ struct FAST_BKG_DATA
 #define BKG_SIZZ	100
 
 struct ANCHOR_DATA;
+struct BackgroundCollision;
 
 struct EERIE_BACKGROUND
 {
@@ -119,6 +120,7 @@ struct EERIE_BACKGROUND
 	long		  nbanchors;
 	ANCHOR_DATA * anchors;
 	char		name[256];
+	BackgroundCollision * collision; //!< compact polygon data for collision queries
 };
 
 extern long EERIEDrawnPolys;
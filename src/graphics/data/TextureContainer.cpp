@@ -48,14 +48,22 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/data/TextureContainer.h"
 
 #include <stddef.h>
+#include <algorithm>
 #include <cstdlib>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "core/Config.h"
 
 #include "graphics/Renderer.h"
+#include "graphics/data/TextureLoader.h"
+#include "graphics/image/Image.h"
 #include "graphics/texture/Texture.h"
+#include "graphics/texture/TextureCache.h"
 
 #include "io/resource/ResourcePath.h"
 #include "io/resource/PakReader.h"
@@ -79,6 +87,13 @@ const TextureContainer::TCFlags TextureContainer::UI = (TextureContainer::NoMipm
 
 static TextureContainer * g_ptcTextureList = NULL;
 
+//! Index of the textures in g_ptcTextureList by name
+typedef boost::unordered_map<std::string, TextureContainer *> TextureIndex;
+static TextureIndex g_textureIndex;
+
+//! Incremented by TextureContainer::EndFrame()
+static u32 g_textureFrame = 0;
+
 TextureContainer * GetTextureList() {
 	return g_ptcTextureList;
 }
@@ -146,7 +161,11 @@ TextureContainer::TextureContainer(const res::path & strName, TCFlags flags) : m
 	if(!(flags & NoInsert)) {
 		m_pNext = g_ptcTextureList;
 		g_ptcTextureList = this;
+		g_textureIndex[m_texName.string()] = this;
 	}
+	
+	m_lastUsedFrame = g_textureFrame;
+	m_released = false;
 
 	systemflags = 0;
 
@@ -178,6 +197,10 @@ TextureContainer::TextureContainer(const res::path & strName, TCFlags flags) : m
 
 TextureContainer::~TextureContainer() {
 	
+	if(m_dwFlags & Async) {
+		TextureLoader::cancel(this);
+	}
+	
 	delete m_pTexture;
 	delete TextureHalo;
 		
@@ -192,6 +215,18 @@ TextureContainer::~TextureContainer() {
 		}
 	}
 	
+	TextureIndex::iterator it = g_textureIndex.find(m_texName.string());
+	if(it != g_textureIndex.end() && it->second == this) {
+		g_textureIndex.erase(it);
+		// Another texture with the same name may still be in the list
+		for(TextureContainer * ptc = g_ptcTextureList; ptc; ptc = ptc->m_pNext) {
+			if(ptc->m_texName == m_texName) {
+				g_textureIndex[m_texName.string()] = ptc;
+				break;
+			}
+		}
+	}
+	
 	ResetVertexLists(this);
 }
 
@@ -225,19 +260,49 @@ bool TextureContainer::LoadFile(const res::path & strPathname) {
 		flags |= Texture::HasMipmaps;
 	}
 	
+	if(m_dwFlags & Async) {
+		
+		TextureCache::Key key;
+		bool cacheable = TextureCache::getKey(tempPath, flags, key);
+		
+		size_t size = 0;
+		char * data = NULL;
+		if(!cacheable || !TextureCache::contains(key)) {
+			data = resources->readAlloc(tempPath, size);
+			if(!data) {
+				LogError << "Error reading texture " << tempPath;
+				return false;
+			}
+		}
+		
+		// Placeholder until the TextureLoader has uploaded the image
+		m_dwWidth = m_dwHeight = 0;
+		uv = Vec2f::ONE;
+		hd = Vec2f::ZERO;
+		
+		TextureLoader::enqueue(this, tempPath, data, size, flags, cacheable ? &key : NULL);
+		
+		return true;
+	}
+	
 	if(!m_pTexture->Init(tempPath, flags)) {
 		LogError << "Error creating texture " << tempPath;
 		return false;
 	}
 	
+	updateTextureInfo();
+	
+	return true;
+}
+
+void TextureContainer::updateTextureInfo() {
+	
 	m_dwWidth = m_pTexture->getSize().x;
 	m_dwHeight = m_pTexture->getSize().y;
 	
 	Vec2i storedSize = m_pTexture->getStoredSize();
 	uv = Vec2f(float(m_dwWidth) / storedSize.x, float(m_dwHeight) / storedSize.y);
 	hd = Vec2f(.5f / storedSize.x, .5f / storedSize.y);
-	
-	return true;
 }
 
 bool TextureContainer::hasColorKey() {
@@ -255,6 +320,10 @@ TextureContainer * TextureContainer::Load(const res::path & name, TCFlags flags)
 		return newTexture;
 	}
 	
+	if(!TextureLoader::isEnabled()) {
+		flags &= ~Async;
+	}
+	
 	// Allocate and add the texture to the linked list of textures;
 	newTexture = new TextureContainer(name, flags);
 	if(!newTexture) {
@@ -350,18 +419,85 @@ bool TextureContainer::CreateHalo() {
 
 TextureContainer * TextureContainer::Find(const res::path & strTextureName) {
 	
-	TextureContainer * ptcTexture = g_ptcTextureList;
+	TextureIndex::const_iterator it = g_textureIndex.find(strTextureName.string());
 	
-	while(ptcTexture) {
-		
-		if(strTextureName == ptcTexture->m_texName) {
-			return ptcTexture;
+	return (it != g_textureIndex.end()) ? it->second : NULL;
+}
+
+size_t TextureContainer::getMemorySize() {
+	
+	if(!m_pTexture || m_released || !m_dwWidth || !m_dwHeight) {
+		return 0;
+	}
+	
+	Vec2i storedSize = m_pTexture->getStoredSize();
+	size_t size = Image::GetSize(m_pTexture->GetFormat(), storedSize.x, storedSize.y);
+	
+	// A full mipmap chain adds another third
+	return m_pTexture->hasMipmaps() ? size + size / 3 : size;
+}
+
+bool TextureContainer::isReleasable() {
+	// Textures created from in-memory images can't be reloaded
+	return m_pTexture && !m_released && !m_pTexture->getFileName().empty() && m_dwWidth != 0;
+}
+
+static bool isLessRecentlyUsed(const std::pair<u32, TextureContainer *> & a,
+                               const std::pair<u32, TextureContainer *> & b) {
+	return a.first < b.first;
+}
+
+void TextureContainer::EndFrame() {
+	
+	g_textureFrame++;
+	
+	if(config.video.textureMemoryBudget <= 0) {
+		return;
+	}
+	
+	size_t budget = size_t(config.video.textureMemoryBudget) * 1024 * 1024;
+	u32 minIdleFrames = u32(config.video.textureReleaseFrames);
+	
+	size_t total = 0;
+	std::vector< std::pair<u32, TextureContainer *> > candidates;
+	
+	for(TextureContainer * ptc = g_ptcTextureList; ptc; ptc = ptc->m_pNext) {
+		total += ptc->getMemorySize();
+		if(ptc->isReleasable() && g_textureFrame - ptc->m_lastUsedFrame >= minIdleFrames) {
+			candidates.push_back(std::make_pair(ptc->m_lastUsedFrame, ptc));
 		}
-		
-		ptcTexture = ptcTexture->m_pNext;
 	}
 	
-	return NULL;
+	if(total <= budget || candidates.empty()) {
+		return;
+	}
+	
+	std::sort(candidates.begin(), candidates.end(), isLessRecentlyUsed);
+	
+	size_t released = 0;
+	for(size_t i = 0; i < candidates.size() && total > budget; i++) {
+		TextureContainer * ptc = candidates[i].second;
+		size_t size = ptc->getMemorySize();
+		ptc->m_pTexture->Destroy();
+		ptc->m_released = true;
+		total -= size, released++;
+	}
+	
+	LogDebug("released " << released << " textures, " << (total / 1024) << " KiB still in use");
+}
+
+void TextureContainer::use() {
+	
+	m_lastUsedFrame = g_textureFrame;
+	
+	if(m_released) {
+		m_released = false;
+		if(!m_pTexture->Restore()) {
+			LogError << "Error reloading texture " << m_pTexture->getFileName();
+			return;
+		}
+		updateTextureInfo();
+	}
 }
 
 void TextureContainer::DeleteAll(TCFlags flag)
@@ -89,7 +89,8 @@ public:
 		NoInsert     = (1<<1),
 		NoRefinement = (1<<2),
 		Level        = (1<<3),
-		NoColorKey   = (1<<4)
+		NoColorKey   = (1<<4),
+		Async        = (1<<5) //!< Decode in the background if enabled, see TextureLoader
 	};
 	
 	DECLARE_FLAGS(TCFlag, TCFlags)
@@ -122,6 +123,21 @@ public:
 	
 	static void DeleteAll(TCFlags flag = TCFlags::all());
 	
+	/*!
+	 * Advance the texture usage clock and enforce the texture memory budget.
+	 * If the budget is exceeded, the least recently used textures that have not been
+	 * bound for config.video.textureReleaseFrames frames are released.
+	 * Released textures are reloaded from their file the next time they are bound.
+	 * Must be called once per frame from the render thread.
+	 */
+	static void EndFrame();
+	
+	/*!
+	 * Mark the texture as used in this frame.
+	 * Reloads the texture if it has been released by \ref EndFrame().
+	 */
+	void use();
+	
 	/*!
 	 * Create a texture to display a glowing halo around a transparent texture
 	 * TODO Rewrite this feature using shaders instead of hacking a texture effect
@@ -188,7 +204,20 @@ public:
 	
 	bool hasColorKey();
 	
+	//! Update the size and texture coordinate info from m_pTexture
+	void updateTextureInfo();
+	
 private:
+	
+	//! Approximate amount of texture memory used, 0 if not resident
+	size_t getMemorySize();
+	
+	//! Can the texture be released and reloaded from its file later
+	bool isReleasable();
+	
+	u32 m_lastUsedFrame;
+	bool m_released;
+	
 	void LookForRefinementMap(TCFlags flags);
 	
 	typedef std::map<res::path, res::path> RefinementMap;
@@ -0,0 +1,326 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "graphics/data/TextureLoader.h"
+
+#include <cstdlib>
+#include <limits>
+#include <list>
+
+#include "core/Config.h"
+#include "graphics/data/TextureContainer.h"
+#include "graphics/image/Image.h"
+#include "io/log/Logger.h"
+#include "platform/JobSystem.h"
+#include "platform/Lock.h"
+#include "platform/Profiler.h"
+#include "platform/Thread.h"
+#include "platform/Time.h"
+
+namespace {
+
+struct TextureJob {
+	
+	enum State {
+		Queued,
+		Decoding,
+		Decoded
+	};
+	
+	TextureContainer * texture; //!< NULL if the texture was destroyed while decoding
+	res::path file;
+	char * data;
+	size_t size;
+	Texture::TextureFlags flags;
+	bool cacheable;
+	bool fromCache; //!< The image is loaded from the texture cache instead of data
+	TextureCache::Key cacheKey;
+	TextureLoader::Fence ticket;
+	State state;
+	bool success;
+	Image image;
+	
+	~TextureJob() {
+		free(data);
+	}
+	
+};
+
+//! Decodes one queued texture on the job system, deletes itself when done
+class TextureDecodeTask : public jobs::Job {
+	
+	void run();
+	
+};
+
+} // anonymous namespace
+
+static Lock * mutex = NULL;
+
+//! One decode task is submitted per queued texture
+static jobs::Counter decodeTasks;
+
+//! All jobs that have not been uploaded yet, ordered by ticket
+typedef std::list<TextureJob *> TextureJobs;
+static TextureJobs queue;
+
+static TextureLoader::Fence lastTicket = 0;
+
+//! Take the next job that needs to be decoded, mutex must be locked
+static TextureJob * takeQueuedJob(TextureLoader::Fence maxTicket) {
+	
+	for(TextureJobs::iterator it = queue.begin(); it != queue.end(); ++it) {
+		TextureJob * job = *it;
+		if(job->ticket > maxTicket) {
+			break;
+		}
+		if(job->state == TextureJob::Queued) {
+			job->state = TextureJob::Decoding;
+			return job;
+		}
+	}
+	
+	return NULL;
+}
+
+static void decodeJob(TextureJob * job) {
+	
+	ARX_PROFILE_FUNC();
+	
+	if(job->fromCache) {
+		
+		job->success = TextureCache::load(job->cacheKey, job->image);
+		
+	} else {
+		
+		job->success = job->image.LoadFromMemory(job->data, job->size, job->file.string().c_str());
+		free(job->data), job->data = NULL;
+		
+		if(job->success && (job->flags & Texture::HasColorKey) && !job->image.HasAlpha()) {
+			job->image.ApplyColorKeyToAlpha();
+		}
+		
+		if(job->success && job->cacheable) {
+			TextureCache::store(job->cacheKey, job->image);
+		}
+	}
+	
+	Autolock lock(mutex);
+	job->state = TextureJob::Decoded;
+}
+
+void TextureDecodeTask::run() {
+	
+	// The texture may already have been decoded by a thread waiting for it
+	TextureJob * job;
+	{
+		Autolock lock(mutex);
+		job = takeQueuedJob(lastTicket);
+	}
+	
+	if(job) {
+		decodeJob(job);
+	}
+	
+	delete this;
+}
+
+static void uploadJob(TextureJob * job) {
+	
+	TextureContainer * texture = job->texture;
+	if(!texture) {
+		return; // The texture was destroyed while we were decoding
+	}
+	
+	if(!job->success && job->fromCache && texture->m_pTexture) {
+		// The cache entry went away - fall back to loading the file synchronously
+		if(texture->m_pTexture->Init(job->file, job->flags)) {
+			texture->updateTextureInfo();
+			return;
+		}
+	}
+	
+	if(!job->success || !texture->m_pTexture
+	   || !texture->m_pTexture->Init(job->file, job->image, job->flags)) {
+		LogError << "Error creating texture " << job->file;
+		return;
+	}
+	
+	texture->updateTextureInfo();
+}
+
+bool TextureLoader::isEnabled() {
+	return config.video.asyncTextures;
+}
+
+void TextureLoader::shutdown() {
+	
+	if(!mutex) {
+		return;
+	}
+	
+	// Let the remaining decode tasks finish
+	jobs::wait(decodeTasks);
+	
+	for(TextureJobs::iterator it = queue.begin(); it != queue.end(); ++it) {
+		delete *it;
+	}
+	queue.clear();
+	
+	delete mutex, mutex = NULL;
+}
+
+void TextureLoader::enqueue(TextureContainer * texture, const res::path & file,
+                            char * data, size_t size, Texture::TextureFlags flags,
+                            const TextureCache::Key * cacheKey) {
+	
+	if(!mutex) {
+		mutex = new Lock();
+	}
+	
+	TextureJob * job = new TextureJob;
+	job->texture = texture;
+	job->file = file;
+	job->data = data;
+	job->size = size;
+	job->flags = flags;
+	job->cacheable = (cacheKey != NULL);
+	job->fromCache = (cacheKey != NULL && data == NULL);
+	if(cacheKey) {
+		job->cacheKey = *cacheKey;
+	}
+	job->state = TextureJob::Queued;
+	job->success = false;
+	
+	{
+		Autolock lock(mutex);
+		job->ticket = ++lastTicket;
+		queue.push_back(job);
+	}
+	
+	// Keep decoding off the main thread, which would otherwise run the task when it waits
+	jobs::submitBackground(*new TextureDecodeTask, &decodeTasks);
+}
+
+void TextureLoader::cancel(TextureContainer * texture) {
+	
+	if(!mutex) {
+		return;
+	}
+	
+	Autolock lock(mutex);
+	
+	TextureJobs::iterator it = queue.begin();
+	while(it != queue.end()) {
+		TextureJob * job = *it;
+		if(job->texture != texture) {
+			++it;
+		} else if(job->state == TextureJob::Decoding) {
+			// Still in use by a decoder thread - discard it on upload
+			job->texture = NULL;
+			++it;
+		} else {
+			delete job;
+			it = queue.erase(it);
+		}
+	}
+}
+
+TextureLoader::Fence TextureLoader::getFence() {
+	
+	if(!mutex) {
+		return 0;
+	}
+	
+	Autolock lock(mutex);
+	return lastTicket;
+}
+
+void TextureLoader::upload(unsigned budgetMs) {
+	
+	ARX_PROFILE_FUNC();
+	
+	if(!mutex) {
+		return;
+	}
+	
+	u32 startTime = Time::getMs();
+	
+	// Always upload at least one texture so that loading makes progress
+	do {
+		
+		TextureJob * job = NULL;
+		{
+			Autolock lock(mutex);
+			for(TextureJobs::iterator it = queue.begin(); it != queue.end(); ++it) {
+				if((*it)->state == TextureJob::Decoded) {
+					job = *it;
+					queue.erase(it);
+					break;
+				}
+			}
+		}
+		
+		if(!job) {
+			break;
+		}
+		
+		uploadJob(job);
+		delete job;
+		
+	} while(Time::getElapsedMs(startTime) < budgetMs);
+}
+
+void TextureLoader::wait(Fence fence) {
+	
+	if(!mutex) {
+		return;
+	}
+	
+	u32 startTime = Time::getMs();
+	
+	while(true) {
+		
+		upload(std::numeric_limits<unsigned>::max());
+		
+		bool done = true;
+		TextureJob * job = NULL;
+		{
+			Autolock lock(mutex);
+			done = (queue.empty() || queue.front()->ticket > fence);
+			if(!done) {
+				job = takeQueuedJob(fence);
+			}
+		}
+		
+		if(done) {
+			break;
+		}
+		
+		// Help the decoder threads instead of just waiting for them
+		if(job) {
+			decodeJob(job);
+		} else {
+			Thread::sleep(1);
+		}
+	}
+	
+	LogDebug("waited " << Time::getElapsedMs(startTime) << " ms for textures");
+	ARX_UNUSED(startTime);
+}
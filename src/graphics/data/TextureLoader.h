@@ -0,0 +1,90 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_GRAPHICS_DATA_TEXTURELOADER_H
+#define ARX_GRAPHICS_DATA_TEXTURELOADER_H
+
+#include <stddef.h>
+
+#include "graphics/texture/Texture.h"
+#include "graphics/texture/TextureCache.h"
+#include "io/resource/ResourcePath.h"
+#include "platform/Platform.h"
+
+class TextureContainer;
+
+/*!
+ * Decodes texture files in the background.
+ *
+ * Texture files are read on the main thread as the resource system is not
+ * thread-safe, but decoding and color keying run as jobs on the job system.
+ * Textures found in the \ref TextureCache are loaded by the jobs directly.
+ * The decoded images are uploaded on the render thread by \ref upload(),
+ * which is called once per frame with a time budget.
+ * Until then the TextureContainer holds an empty placeholder texture.
+ */
+class TextureLoader {
+	
+public:
+	
+	//! Identifies all textures queued up to some point
+	typedef u64 Fence;
+	
+	//! Is background texture decoding enabled in the config
+	static bool isEnabled();
+	
+	//! Wait for running decode jobs and discard all queued textures
+	static void shutdown();
+	
+	/*!
+	 * Queue a texture file for decoding.
+	 * @param texture  The container to upload the decoded image to.
+	 * @param file     The resolved texture file name, including extension.
+	 * @param data     The file contents, allocated with malloc(). The loader takes ownership.
+	 *                 May be NULL if the image should be loaded from the texture cache.
+	 * @param flags    Flags for the uploaded texture.
+	 * @param cacheKey Texture cache key for the file, or NULL if it should not be cached.
+	 */
+	static void enqueue(TextureContainer * texture, const res::path & file,
+	                    char * data, size_t size, Texture::TextureFlags flags,
+	                    const TextureCache::Key * cacheKey = NULL);
+	
+	//! Forget about any queued work for a texture that is being destroyed
+	static void cancel(TextureContainer * texture);
+	
+	//! Get a fence that is reached once all currently queued textures are uploaded
+	static Fence getFence();
+	
+	/*!
+	 * Upload decoded textures to the renderer.
+	 * Must be called from the render thread.
+	 * @param budgetMs Stop uploading after this many milliseconds.
+	 */
+	static void upload(unsigned budgetMs);
+	
+	/*!
+	 * Block until all textures queued before the fence was created are uploaded.
+	 * The calling thread helps decoding while waiting.
+	 * Must be called from the render thread.
+	 */
+	static void wait(Fence fence);
+	
+};
+
+#endif // ARX_GRAPHICS_DATA_TEXTURELOADER_H
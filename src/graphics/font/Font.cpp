@@ -22,6 +22,7 @@
 #include <sstream>
 #include <iomanip>
 #include <iterator>
+#include <algorithm>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -42,11 +43,18 @@
 //! Pre-load all visible characters below this one when creating a font object
 static const Font::Char FONT_PRELOAD_LIMIT = 127;
 
+//! Nesting level of Font::beginBatch() / Font::endBatch()
+static long g_batchDepth = 0;
+
+//! Fonts that have glyphs waiting to be drawn
+static std::vector<Font *> g_queuedFonts;
+
 Font::Font(const res::path & fontFile, unsigned int fontSize, FT_Face face) 
 	: info(fontFile, fontSize)
 	, referenceCount(0)
 	, face(face)
-	, textures(0) {
+	, textures(0)
+	, queued(false) {
 	
 	// TODO-font: Compute optimal size using m_FTFace->bbox
 	const unsigned int TEXTURE_SIZE = 512;
@@ -70,6 +78,10 @@ Font::Font(const res::path & fontFile, unsigned int fontSize, FT_Face face)
 
 Font::~Font() {
 	
+	if(queued) {
+		g_queuedFonts.erase(std::find(g_queuedFonts.begin(), g_queuedFonts.end(), this));
+	}
+	
 	delete textures;
 	
 	// Release FreeType face object.
@@ -253,7 +265,25 @@ Font::glyph_iterator Font::getNextGlyph(text_iterator & it, text_iterator end) {
 	return glyphs.find(chr); // the newly inserted glyph
 }
 
-void addGlyphVertices(std::vector<TexturedVertex>& vertices, const Font::Glyph& glyph, const Vec2f& pos, Color color) {
+int Font::getKerning(unsigned int prevGlyphIndex, unsigned int glyphIndex) {
+	
+	u64 key = (u64(prevGlyphIndex) << 32) | glyphIndex;
+	
+	KerningCache::const_iterator it = kerning.find(key);
+	if(it != kerning.end()) {
+		return it->second;
+	}
+	
+	FT_Vector delta;
+	FT_Get_Kerning(face, prevGlyphIndex, glyphIndex, FT_KERNING_DEFAULT, &delta);
+	
+	int offset = delta.x >> 6;
+	kerning[key] = offset;
+	
+	return offset;
+}
+
+static void addGlyphVertices(std::vector<TexturedVertex>& vertices, const Font::Glyph& glyph, const Vec2f& pos, Color color) {
 
 	float w = glyph.size.x;
 	float h = -glyph.size.y;
@@ -311,9 +341,8 @@ Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color
 	
 	FT_UInt prevGlyphIndex = 0;
 	FT_Pos prevRsbDelta = 0;
-
-	typedef std::map< unsigned int, std::vector<TexturedVertex> > MapTextureVertices;
-	MapTextureVertices mapTextureVertices;
+	
+	bool hasGlyphs = false;
 	
 	for(text_iterator it = start; it != end; ) {
 		
@@ -327,9 +356,7 @@ Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color
 		// Kerning
 		if(FT_HAS_KERNING(face)) {
 			if(prevGlyphIndex != 0) {
-				FT_Vector delta;
-				FT_Get_Kerning(face, prevGlyphIndex, glyph.index, FT_KERNING_DEFAULT, &delta);
-				pen.x += delta.x >> 6;
+				pen.x += getKerning(prevGlyphIndex, glyph.index);
 			}
 			prevGlyphIndex = glyph.index;
 		}
@@ -344,7 +371,11 @@ Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color
 		
 		// Draw
 		if(DoDraw && glyph.size.x != 0 && glyph.size.y != 0) {
-			addGlyphVertices(mapTextureVertices[glyph.texture], glyph, pen, color);
+			if(glyph.texture >= queuedVertices.size()) {
+				queuedVertices.resize(glyph.texture + 1);
+			}
+			addGlyphVertices(queuedVertices[glyph.texture], glyph, pen, color);
+			hasGlyphs = true;
 		} else {
 			ARX_UNUSED(pen), ARX_UNUSED(color);
 		}
@@ -359,48 +390,14 @@ Vec2i Font::process(int x, int y, text_iterator start, text_iterator end, Color
 		pen.x += glyph.advance.x;
 	}
 	
-	if(DoDraw && !mapTextureVertices.empty()) {
-
-		GRenderer->SetRenderState(Renderer::Lighting, false);
-		GRenderer->SetRenderState(Renderer::AlphaBlending, true);
-		GRenderer->SetBlendFunc(Renderer::BlendSrcAlpha, Renderer::BlendInvSrcAlpha);
-
-		GRenderer->SetRenderState(Renderer::DepthTest, false);
-		GRenderer->SetRenderState(Renderer::DepthWrite, false);
-		GRenderer->SetCulling(Renderer::CullNone);
-
-		// 2D projection setup... Put origin (0,0) in the top left corner like GDI...
-		Rect viewport = GRenderer->GetViewport();
-		GRenderer->Begin2DProjection(viewport.left, viewport.right,
-									 viewport.bottom, viewport.top, -1.f, 1.f);
-
-		// Fixed pipeline texture stage operation
-		GRenderer->GetTextureStage(0)->setColorOp(TextureStage::ArgDiffuse);
-		GRenderer->GetTextureStage(0)->setAlphaOp(TextureStage::ArgTexture);
-
-		GRenderer->GetTextureStage(0)->setWrapMode(TextureStage::WrapClamp);
-		GRenderer->GetTextureStage(0)->setMinFilter(TextureStage::FilterNearest);
-		GRenderer->GetTextureStage(0)->setMagFilter(TextureStage::FilterNearest);
-
-		for(MapTextureVertices::const_iterator it = mapTextureVertices.begin(); it != mapTextureVertices.end(); ++it) {
-			GRenderer->SetTexture(0, &textures->getTexture(it->first));
-			EERIEDRAWPRIM(Renderer::TriangleList, it->second.data(), it->second.size());
+	if(DoDraw && hasGlyphs) {
+		if(!queued) {
+			g_queuedFonts.push_back(this);
+			queued = true;
+		}
+		if(g_batchDepth == 0) {
+			flushBatch();
 		}
-					
-		GRenderer->ResetTexture(0);
-		TextureStage * stage = GRenderer->GetTextureStage(0);
-		stage->setColorOp(TextureStage::OpModulate,
-		                  TextureStage::ArgTexture, TextureStage::ArgCurrent);
-		stage->setAlphaOp(TextureStage::ArgTexture);
-		stage->setWrapMode(TextureStage::WrapRepeat);
-		stage->setMinFilter(TextureStage::FilterLinear);
-		stage->setMagFilter(TextureStage::FilterLinear);
-		
-		GRenderer->End2DProjection();
-		GRenderer->SetRenderState(Renderer::AlphaBlending, false);
-		GRenderer->SetRenderState(Renderer::DepthWrite, true);
-		GRenderer->SetCulling(Renderer::CullCCW);
-		
 	}
 	
 	int sizeX = endX - startX;
@@ -420,3 +417,74 @@ Vec2i Font::getTextSize(text_iterator start, text_iterator end) {
 int Font::getLineHeight() const {
 	return face->size->metrics.height >> 6;
 }
+
+void Font::beginBatch() {
+	g_batchDepth++;
+}
+
+void Font::endBatch() {
+	
+	arx_assert(g_batchDepth > 0);
+	
+	g_batchDepth--;
+	if(g_batchDepth == 0) {
+		flushBatch();
+	}
+}
+
+void Font::flushBatch() {
+	
+	if(g_queuedFonts.empty()) {
+		return;
+	}
+	
+	GRenderer->SetRenderState(Renderer::Lighting, false);
+	GRenderer->SetRenderState(Renderer::AlphaBlending, true);
+	GRenderer->SetBlendFunc(Renderer::BlendSrcAlpha, Renderer::BlendInvSrcAlpha);
+	
+	GRenderer->SetRenderState(Renderer::DepthTest, false);
+	GRenderer->SetRenderState(Renderer::DepthWrite, false);
+	GRenderer->SetCulling(Renderer::CullNone);
+	
+	// 2D projection setup... Put origin (0,0) in the top left corner like GDI...
+	Rect viewport = GRenderer->GetViewport();
+	GRenderer->Begin2DProjection(viewport.left, viewport.right,
+	                             viewport.bottom, viewport.top, -1.f, 1.f);
+	
+	// Fixed pipeline texture stage operation
+	GRenderer->GetTextureStage(0)->setColorOp(TextureStage::ArgDiffuse);
+	GRenderer->GetTextureStage(0)->setAlphaOp(TextureStage::ArgTexture);
+	
+	GRenderer->GetTextureStage(0)->setWrapMode(TextureStage::WrapClamp);
+	GRenderer->GetTextureStage(0)->setMinFilter(TextureStage::FilterNearest);
+	GRenderer->GetTextureStage(0)->setMagFilter(TextureStage::FilterNearest);
+	
+	std::vector<Font *>::const_iterator font;
+	for(font = g_queuedFonts.begin(); font != g_queuedFonts.end(); ++font) {
+		std::vector< std::vector<TexturedVertex> > & pages = (*font)->queuedVertices;
+		for(size_t page = 0; page < pages.size(); page++) {
+			if(!pages[page].empty()) {
+				GRenderer->SetTexture(0, &(*font)->textures->getTexture(page));
+				EERIEDRAWPRIM(Renderer::TriangleList, &pages[page][0], pages[page].size());
+				// Keep the allocated storage for the next batch
+				pages[page].clear();
+			}
+		}
+		(*font)->queued = false;
+	}
+	g_queuedFonts.clear();
+	
+	GRenderer->ResetTexture(0);
+	TextureStage * stage = GRenderer->GetTextureStage(0);
+	stage->setColorOp(TextureStage::OpModulate,
+	                  TextureStage::ArgTexture, TextureStage::ArgCurrent);
+	stage->setAlphaOp(TextureStage::ArgTexture);
+	stage->setWrapMode(TextureStage::WrapRepeat);
+	stage->setMinFilter(TextureStage::FilterLinear);
+	stage->setMagFilter(TextureStage::FilterLinear);
+	
+	GRenderer->End2DProjection();
+	GRenderer->SetRenderState(Renderer::AlphaBlending, false);
+	GRenderer->SetRenderState(Renderer::DepthWrite, true);
+	GRenderer->SetCulling(Renderer::CullCCW);
+}
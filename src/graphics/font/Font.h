@@ -22,10 +22,13 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "graphics/Color.h"
+#include "graphics/Vertex.h"
 #include "math/Vector2.h"
 
 #include "io/resource/ResourcePath.h"
@@ -126,6 +129,20 @@ public:
 	 */
 	bool writeToDisk();
 	
+	/*!
+	 * Start queueing glyph quads instead of drawing them immediately.
+	 * Batches can be nested - the glyphs of all fonts are drawn with a single
+	 * render state setup when the outermost batch ends.
+	 * Glyphs are drawn using the viewport active at flush time.
+	 */
+	static void beginBatch();
+	
+	//! End a batch started with \ref beginBatch()
+	static void endBatch();
+	
+	//! Draw all queued glyphs now, e.g. before changing the viewport
+	static void flushBatch();
+	
 private:
 	
 	// Construction/destruction handled by FontCache only
@@ -168,8 +185,20 @@ private:
 	 */
 	glyph_iterator getNextGlyph(text_iterator & it, text_iterator end);
 	
+	//! Get the kerning offset between two glyphs, in pixels
+	int getKerning(unsigned int prevGlyphIndex, unsigned int glyphIndex);
+	
 	class PackedTexture * textures;
 	
+	//! Queued glyph quads for each texture page - kept around to reuse the storage
+	std::vector< std::vector<TexturedVertex> > queuedVertices;
+	
+	//! Whether this font is in the list of fonts with queued glyphs
+	bool queued;
+	
+	typedef boost::unordered_map<u64, int> KerningCache;
+	KerningCache kerning;
+	
 };
 
 #endif // ARX_GRAPHICS_FONT_FONT_H
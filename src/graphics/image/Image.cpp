@@ -19,6 +19,7 @@
 
 #include "graphics/image/Image.h"
 
+#include <algorithm>
 #include <sstream>
 #include <cstring>
 
@@ -26,6 +27,7 @@
 #include "graphics/image/stb_image_write.h"
 
 #include "graphics/Math.h"
+#include "graphics/image/ImageKernels.h"
 #include "io/fs/FilePath.h"
 #include "io/resource/PakReader.h"
 #include "io/log/Logger.h"
@@ -324,13 +326,7 @@ bool Image::DownScale() {
 	
 	p = new unsigned char[dataSize];
 	s = GetData();
-	unsigned int aa;
-	for (unsigned int y=0; y<hHeight; y++)
-		for (unsigned int x=0; x<hWidth; x++)
-			for (unsigned int a=0; a<nChan; a++) {
-				aa = s[(y*2*mWidth+x*2)*nChan+a]+s[((y*2+1)*mWidth+x*2)*nChan+a]+s[((y*2)*mWidth+(x*2+1))*nChan+a]+s[((y*2+1)*mWidth+(x*2+1))*nChan+a];
-				p[(y*hWidth+x)*nChan+a] = aa/4;
-	}
+	image::downScale(s, mWidth, p, hWidth, hHeight, nChan);
 	
 	Create(hWidth, hHeight, mFormat, mDepth, mNumMipmaps);
 	
@@ -345,6 +341,59 @@ bool Image::DownScale() {
 	return true;
 }
 
+bool Image::GenerateMipmaps() {
+	
+	arx_assert_msg(!IsCompressed(), "[Image::GenerateMipmaps] Mipmaps for compressed images not supported yet!");
+	arx_assert_msg(!IsVolume(), "[Image::GenerateMipmaps] Mipmaps for volume images not supported yet!");
+	if(IsCompressed() || IsVolume() || mNumMipmaps != 1) {
+		return false;
+	}
+	
+	unsigned int numMipmaps = 1;
+	while((mWidth >> numMipmaps) || (mHeight >> numMipmaps)) {
+		numMipmaps++;
+	}
+	if(numMipmaps == 1) {
+		return true;
+	}
+	
+	unsigned int dataSize = GetSizeWithMipmaps(mFormat, mWidth, mHeight, 1, numMipmaps);
+	unsigned char * data = new unsigned char[dataSize];
+	memcpy(data, mData, mDataSize);
+	
+	unsigned int nChan = GetNumChannels();
+	unsigned char * s = data;
+	unsigned int sWidth = mWidth, sHeight = mHeight;
+	
+	for(unsigned int level = 1; level < numMipmaps; level++) {
+		
+		unsigned char * p = s + GetSize(mFormat, sWidth, sHeight);
+		unsigned int pWidth = std::max(sWidth >> 1, 1u);
+		unsigned int pHeight = std::max(sHeight >> 1, 1u);
+		
+		for(unsigned int y = 0; y < pHeight; y++) {
+			unsigned int y0 = std::min(y * 2, sHeight - 1), y1 = std::min(y * 2 + 1, sHeight - 1);
+			for(unsigned int x = 0; x < pWidth; x++) {
+				unsigned int x0 = std::min(x * 2, sWidth - 1), x1 = std::min(x * 2 + 1, sWidth - 1);
+				for(unsigned int a = 0; a < nChan; a++) {
+					unsigned int aa = s[(y0 * sWidth + x0) * nChan + a] + s[(y0 * sWidth + x1) * nChan + a]
+					                + s[(y1 * sWidth + x0) * nChan + a] + s[(y1 * sWidth + x1) * nChan + a];
+					p[(y * pWidth + x) * nChan + a] = (unsigned char)((aa + 2) / 4);
+				}
+			}
+		}
+		
+		s = p, sWidth = pWidth, sHeight = pHeight;
+	}
+	
+	delete[] mData;
+	mData = data;
+	mDataSize = dataSize;
+	mNumMipmaps = numMipmaps;
+	
+	return true;
+}
+
 bool Image::RemoveAlpha() {
 	arx_assert_msg( !IsCompressed(), "[Image::RemoveAlpha] Removeing Alpha of compressed images not supported yet!" );
 	arx_assert_msg( !IsVolume(), "[Image::RemoveAlpha] Removing Alpha of volume images not supported yet!" );
@@ -381,55 +430,9 @@ bool Image::RemoveAlpha() {
 void Image::ResizeFrom(const Image &source, unsigned int desired_width, unsigned int desired_height, bool flip_vertical)
 {
 	Create(desired_width, desired_height, Format_R8G8B8);
-
-	// span, size of one line in pixels (doesn't allow for byte padding)
-	const unsigned int src_span = source.GetWidth();
-	const unsigned int dest_span = GetWidth();
-
-	// number of bytes per pixel
-	// since we assume RGB format, this is 3 for both source and destination
-	const unsigned int src_pixel = 3;
-	const unsigned int dest_pixel = 3;
-
-	// find fractional source y_delta
-	float y_source = 0.0f;
-	const float y_delta = source.GetHeight() / (float)GetHeight();
-
-	for (unsigned int y = 0; y < GetHeight(); y++)
-	{
-		// find pointer to the beginning of this destination line
-		unsigned char *dest_p = GetData() + (flip_vertical ? GetHeight() - 1 - y : y) * dest_span * dest_pixel;
-
-		// truncate y_source coordinate and premultiply by line width / span
-		const unsigned int src_y = (unsigned int)(y_source) * src_span;
-
-		// find fractional source x_delta
-		float x_source = 0.0f;
-		const float x_delta = source.GetWidth() / (float)GetWidth();
-
-		for (unsigned int x = 0; x < GetWidth(); x++)
-		{
-			// truncate x_source coordinate
-			const unsigned int src_x = (unsigned int)(x_source);
-
-			// find offset in bytes for the current source coordinate
-			const unsigned int src_offset = (src_x + src_y) * src_pixel;
-
-			// copy pixel from source to dest, assuming 24-bit format (RGB or BGR, etc)
-			dest_p[0] = source.GetData()[src_offset + 0];
-			dest_p[1] = source.GetData()[src_offset + 1];
-			dest_p[2] = source.GetData()[src_offset + 2];
-
-			// move destination pointer ahead by one pixel
-			dest_p += dest_pixel;
-
-			// increment fractional source coordinate by one destination pixel, horizontal
-			x_source += x_delta;
-		}
-
-		// increment fractional source coordinate by one destination pixel, vertical
-		y_source += y_delta;
-	}
+	
+	image::resize(source.GetData(), source.GetWidth(), source.GetHeight(),
+	              GetData(), GetWidth(), GetHeight(), flip_vertical);
 }
 
 void Image::Clear() {
@@ -498,51 +501,12 @@ void Image::QuakeGamma(float pGamma) {
 	// if the image has alpha == 1.0, those pixels will get no effect
 	// using a pGamma < 1.0 will have no effect
 
-	unsigned int numComponents = SIZE_TABLE[mFormat];
-	unsigned int size = mWidth * mHeight;
-	unsigned char * data = mData;
-	
-	const unsigned int MAX_COMPONENTS = 4;
-	const float COMPONENT_RANGE = 255.0f;
-	
-	float components[MAX_COMPONENTS];
-	
 	// Nothing to do in this case!
 	if(pGamma == 1.0f) {
 		return;
 	}
 	
-	// Go through every pixel in the image
-	for(unsigned int i = 0; i < size; i++, data += numComponents) {
-		
-		float max_component = 0.0f;
-		
-		for(unsigned int j = 0; j < numComponents; j++) {
-			
-			// scale the component's value
-			components[j] = float(data[j]) * pGamma;
-
-			// find the max component
-			max_component = std::max(max_component, components[j]);
-		}
-
-		if (max_component > COMPONENT_RANGE) {
-
-			float reciprocal = COMPONENT_RANGE / max_component;
-
-			for (unsigned int j = 0; j < numComponents; j++) {
-				
-				// normalize the components by max component value
-				components[j] *= reciprocal;
-				data[j] = (unsigned char)components[j];
-			}
-		} else {
-		
-			for (unsigned int j = 0; j < numComponents; j++) {
-				data[j] = (unsigned char)components[j];
-			}
-		}
-	}
+	image::quakeGamma(mData, mWidth * mHeight, SIZE_TABLE[mFormat], pGamma);
 }
 
 void Image::AdjustGamma(const float &v) {
@@ -551,47 +515,12 @@ void Image::AdjustGamma(const float &v) {
 	arx_assert_msg(!IsVolume(), "[Image::ChangeGamma] Gamma change of volume images not supported yet!");
 	arx_assert_msg(v <= 1.0f, "BUG WARNING: If gamma values greater than 1.0 needed, should fix the way the calculations are optimized!");
 
-	unsigned int numComponents = SIZE_TABLE[mFormat];
-	unsigned int size = mWidth * mHeight;
-	unsigned char * data = mData;
-	
-	const float COMPONENT_RANGE = 255.0f;
-	
 	// Nothing to do in this case!
 	if (v == 1.0f) {
 		return;
 	}
-
-	// TODO: this table is stored statically meaning this isn't thread-safe :(
-	// only safe option would be thread local storage?
-	static const float fraction = 1.0f / COMPONENT_RANGE;
-	static float gamma_value = -1.0f;
-	static unsigned char gamma_table[256];
-	if (gamma_value != v) {
-		memset(gamma_table, 0, sizeof(gamma_table));
-		gamma_value = v;
-	}
 	
-	// Go through every pixel in the image
-	for(unsigned int i = 0; i < size; i++, data += numComponents) {
-		
-		for(unsigned int j = 0; j < numComponents; j++) {
-			
-			if (data[j])
-			{
-				const unsigned char i = data[j];
-
-				// check if we've put a non-zero value here
-				// will start to fail with low index and gamma values > 1.0
-				// gamma_table[0] should always == 0, so ignore it
-				if (!gamma_table[i]) {
-					gamma_table[i] = (unsigned char)(COMPONENT_RANGE * powf(i * fraction, v));
-				}
-
-				data[j] = gamma_table[i];
-			}
-		}
-	}
+	image::adjustGamma(mData, mWidth * mHeight * SIZE_TABLE[mFormat], v);
 }
 
 void Image::ApplyThreshold(unsigned char threshold, int component_mask) {
@@ -616,17 +545,6 @@ void Image::ApplyThreshold(unsigned char threshold, int component_mask) {
 	}
 }
 
-inline static bool sample(const u8 * src, int w, int h, int x, int y, u8 * dst, Color key) {
-	if(x >= 0 && x < w && y >= 0 && y < h) {
-		const u8 * s = src + (y * w + x) * 3;
-		if(s[0] != key.r || s[1] != key.g || s[2] != key.b) {
-			dst[0] = s[0], dst[1] = s[1], dst[2] = s[2];
-			return true;
-		}
-	}
-	return false;
-}
-
 void Image::ApplyColorKeyToAlpha(Color key) {
 	
 	arx_assert_msg(!IsCompressed(), "ApplyColorKeyToAlpha Not supported for compressed textures!");
@@ -644,16 +562,10 @@ void Image::ApplyColorKeyToAlpha(Color key) {
 	// For RGB or BGR textures, first check if an alpha channel is really needed,
 	// then create it if it's the case
 	
+	const u8 keyData[3] = { key.r, key.g, key.b };
+	
 	// Check if we've got pixels matching the color key
-	const u8 * img = mData;
-	bool needsAlphaChannel = false;
-	for(size_t i = 0; i < (mHeight * mHeight); i++, img += 3) {
-		if(img[0] == key.r && img[1] == key.g && img[2] == key.b) {
-			needsAlphaChannel = true;
-			break;
-		}
-	}
-	if(!needsAlphaChannel) {
+	if(!image::findColorKey(mData, mWidth * mHeight, keyData)) {
 		return;
 	}
 	
@@ -664,38 +576,7 @@ void Image::ApplyColorKeyToAlpha(Color key) {
 	u8 * dataTemp = new unsigned char[dataSize];
 	
 	// Fill temp image and apply color key to alpha channel
-	u8 * dst = dataTemp;
-	img = mData;
-	for(size_t y = 0; y < mHeight; y++) {
-		for(size_t x = 0; x < mWidth; x++) {
-			
-			dst[3] = (img[0] == key.r && img[1] == key.g && img[2] == key.b) ? 0 : 0xff;
-			
-			if(dst[3]) {
-				
-				dst[0] = img[0];
-				dst[1] = img[1];
-				dst[2] = img[2];
-				
-			} else {
-				// For transparent pixels, use the color of an opaque bordering pixel,
-				// so that linear filtering won't produce black borders.
-				if(   !sample(mData, mWidth, mHeight, int(x)    , int(y) - 1, dst, key)
-				   && !sample(mData, mWidth, mHeight, int(x) + 1, int(y)    , dst, key)
-				   && !sample(mData, mWidth, mHeight, int(x)    , int(y) + 1, dst, key)
-				   && !sample(mData, mWidth, mHeight, int(x) - 1, int(y)    , dst, key)
-				   && !sample(mData, mWidth, mHeight, int(x) - 1, int(y) - 1, dst, key)
-				   && !sample(mData, mWidth, mHeight, int(x) + 1, int(y) - 1, dst, key)
-				   && !sample(mData, mWidth, mHeight, int(x) + 1, int(y) + 1, dst, key)
-				   && !sample(mData, mWidth, mHeight, int(x) - 1, int(y) + 1, dst, key)) {
-					dst[0] = dst[1] = dst[2] = 0;
-				}
-			}
-			
-			img += 3;
-			dst += 4;
-		}
-	}
+	image::applyColorKey(mData, dataTemp, mWidth, mHeight, keyData);
 	
 	// Swap data with temp data and ajust internal state
 	delete[] mData;
@@ -826,98 +707,7 @@ void Image::Blur(int radius)
 	arx_assert_msg(!IsVolume(), "Blur not yet supported for 3d textures!");
 	arx_assert_msg(mNumMipmaps == 1, "Blur not yet supported for textures with mipmaps!");
 
-	// Create kernel and precompute multiplication table
-	int kernelSize = 1 + radius * 2;
-	int* kernel = new int[kernelSize];
-	int* mult = new int[kernelSize << 8];
-
-	memset(kernel, 0, kernelSize*sizeof(*kernel));
-	memset(mult, 0, (kernelSize << 8)*sizeof(*mult));
-
-	kernel[kernelSize - 1] = 0;
-	for(int i = 1; i< radius; i++) {
-		int szi = radius - i;
-		kernel[radius + i] = kernel[szi] = szi * szi;
-		for (int j = 0; j < 256; j++) {
-			mult[((radius+i) << 8) + j] = mult[(szi << 8) + j] = kernel[szi] * j;
-		}
-	}
-
-	kernel[radius]=radius*radius;
-	for (int j = 0; j < 256; j++) {
-		mult[(radius << 8) + j] = kernel[radius] * j;
-	}
-
-	// Split color channels into separated array to simplify handling of multiple image format...
-	// Could easilly be refactored
-	int numChannels = GetNumChannels();
-	unsigned char* channel[4] = {};
-	unsigned char* blurredChannel[4] = {};
-	for(int c = 0; c < numChannels; c++) {
-		channel[c] = new unsigned char[mWidth*mHeight];
-		blurredChannel[c] = new unsigned char[mWidth*mHeight];
-		for (unsigned int i=0; i < mWidth*mHeight; i++) {
-			channel[c][i] = mData[i*numChannels + c];
-		}
-	}
-	
-	// Blur horizontally using our separable kernel
-	int yi = 0;
-	for (int yl = 0; yl < (int)mHeight; yl++) {
-		for (int xl = 0; xl < (int)mWidth; xl++) {
-			int channelVals[4] = {0,0,0,0};
-			int sum=0;
-			int ri=xl-radius;
-			for (int i = 0; i < kernelSize; i++) {
-				int read = ri + i;
-				if (read >= 0 && read < (int)mWidth) {
-					read += yi;
-					for(int c = 0; c < numChannels; c++)
-						channelVals[c] += mult[(i << 8) + channel[c][read]];
-					sum += kernel[i];
-				}
-			}
-			ri = yi + xl;
-
-			for(int c = 0; c < numChannels; c++)
-				blurredChannel[c][ri] = channelVals[c] / sum;
-		}
-		yi += mWidth;
-	}
-
-	// Blur vertically using our separable kernel
-	yi = 0;
-	for (int yl = 0; yl < (int)mHeight; yl++) {
-		int ym = yl - radius;
-		int riw = ym * mWidth;
-		for (int xl = 0; xl < (int)mWidth; xl++) {
-			int channelVals[4] = {0,0,0,0};
-			int sum=0;
-			int ri = ym;
-			int read= xl + riw;
-			for (int i = 0; i < kernelSize; i++) {
-				if (ri >= 0 && ri < (int)mHeight){
-					for(int c = 0; c < numChannels; c++)
-						channelVals[c] += mult[(i << 8) + blurredChannel[c][read]];
-					sum += kernel[i];
-				}
-				ri++;
-				read += mWidth;
-			}
-
-			for(int c = 0; c < numChannels; c++)
-				mData[(xl + yi)*numChannels + c] = channelVals[c] / sum;
-		}
-		yi += mWidth;
-	}
-
-	// Clean up mess
-	for(int c = 0; c < numChannels; c++) {
-		delete[] channel[c];
-		delete[] blurredChannel[c];
-	}
-	delete[] kernel;
-	delete[] mult;
+	image::blur(mData, mWidth, mHeight, GetNumChannels(), radius);
 }
 
 void Image::SetAlpha(const Image& img, bool bInvertAlpha)
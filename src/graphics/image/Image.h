@@ -99,6 +99,12 @@ public:
 	// Downscale (i.e /2 both with and height)
 	bool DownScale();
 	
+	/*!
+	 * Append a full mipmap chain (down to 1x1) generated using a box filter.
+	 * Only works with uncompressed 2D images that don't already have mipmaps.
+	 */
+	bool GenerateMipmaps();
+	
 	// RemoveAlpha
 	bool RemoveAlpha();
 
@@ -0,0 +1,813 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "graphics/image/ImageKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARX_IMAGE_SSE2
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+namespace image {
+
+static KernelSet g_kernels = getBestKernels();
+
+KernelSet getBestKernels() {
+#if defined(ARX_IMAGE_SSE2)
+	return SSE2Kernels;
+#elif defined(__ARM_NEON__)
+	return NEONKernels;
+#else
+	return ScalarKernels;
+#endif
+}
+
+KernelSet getKernels() {
+	return g_kernels;
+}
+
+bool setKernels(KernelSet kernels) {
+	
+	if(kernels != ScalarKernels && kernels != getBestKernels()) {
+		return false;
+	}
+	
+	g_kernels = kernels;
+	return true;
+}
+
+const char * getKernelsName(KernelSet kernels) {
+	switch(kernels) {
+		case ScalarKernels: return "scalar";
+		case SSE2Kernels: return "SSE2";
+		case NEONKernels: return "NEON";
+	}
+	return "unknown";
+}
+
+// Color key
+
+static bool sample(const u8 * src, int w, int h, int x, int y, u8 * dst, const u8 key[3]) {
+	if(x >= 0 && x < w && y >= 0 && y < h) {
+		const u8 * s = src + (y * w + x) * 3;
+		if(s[0] != key[0] || s[1] != key[1] || s[2] != key[2]) {
+			dst[0] = s[0], dst[1] = s[1], dst[2] = s[2];
+			return true;
+		}
+	}
+	return false;
+}
+
+//! Use the color of an opaque bordering pixel for a transparent pixel
+static void fillKeyedPixel(const u8 * src, int w, int h, int x, int y, u8 * dst, const u8 key[3]) {
+	if(   !sample(src, w, h, x    , y - 1, dst, key)
+	   && !sample(src, w, h, x + 1, y    , dst, key)
+	   && !sample(src, w, h, x    , y + 1, dst, key)
+	   && !sample(src, w, h, x - 1, y    , dst, key)
+	   && !sample(src, w, h, x - 1, y - 1, dst, key)
+	   && !sample(src, w, h, x + 1, y - 1, dst, key)
+	   && !sample(src, w, h, x + 1, y + 1, dst, key)
+	   && !sample(src, w, h, x - 1, y + 1, dst, key)) {
+		dst[0] = dst[1] = dst[2] = 0;
+	}
+}
+
+static void applyColorKeyScalar(const u8 * src, u8 * dst, unsigned width, unsigned height,
+                                size_t begin, const u8 key[3]) {
+	
+	size_t count = size_t(width) * height;
+	
+	const u8 * img = src + begin * 3;
+	dst += begin * 4;
+	for(size_t i = begin; i < count; i++, img += 3, dst += 4) {
+		if(img[0] == key[0] && img[1] == key[1] && img[2] == key[2]) {
+			dst[3] = 0;
+			fillKeyedPixel(src, width, height, int(i % width), int(i / width), dst, key);
+		} else {
+			dst[0] = img[0], dst[1] = img[1], dst[2] = img[2], dst[3] = 0xff;
+		}
+	}
+}
+
+#if defined(ARX_IMAGE_SSE2)
+
+//! Load a 24-bit pixel and the following byte, which must be readable
+static int loadPixel(const u8 * p) {
+	int value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static __m128i loadPixels(const u8 * p) {
+	return _mm_and_si128(_mm_setr_epi32(loadPixel(p), loadPixel(p + 3), loadPixel(p + 6),
+	                                    loadPixel(p + 9)), _mm_set1_epi32(0x00ffffff));
+}
+
+static bool findColorKeySSE2(const u8 * src, size_t pixels, const u8 key[3]) {
+	
+	const __m128i keyv = _mm_set1_epi32(key[0] | (key[1] << 8) | (key[2] << 16));
+	
+	size_t i = 0;
+	// The last pixel can't be loaded as a 32-bit word without reading past the end
+	for(; i + 4 < pixels; i += 4) {
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(loadPixels(src + i * 3), keyv))) {
+			return true;
+		}
+	}
+	
+	for(const u8 * img = src + i * 3; i < pixels; i++, img += 3) {
+		if(img[0] == key[0] && img[1] == key[1] && img[2] == key[2]) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+static void applyColorKeySSE2(const u8 * src, u8 * dst, unsigned width, unsigned height,
+                              const u8 key[3]) {
+	
+	const __m128i keyv = _mm_set1_epi32(key[0] | (key[1] << 8) | (key[2] << 16));
+	const __m128i alpha = _mm_set1_epi32(0xff000000);
+	
+	size_t count = size_t(width) * height;
+	
+	size_t i = 0;
+	for(; i + 4 < count; i += 4) {
+		
+		__m128i pixels = loadPixels(src + i * 3);
+		__m128i keyed = _mm_cmpeq_epi32(pixels, keyv);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4),
+		                 _mm_or_si128(pixels, _mm_andnot_si128(keyed, alpha)));
+		
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(keyed));
+		for(size_t j = 0; mask; j++, mask >>= 1) {
+			if(mask & 1) {
+				size_t p = i + j;
+				fillKeyedPixel(src, width, height, int(p % width), int(p / width), dst + p * 4, key);
+			}
+		}
+	}
+	
+	applyColorKeyScalar(src, dst, width, height, i, key);
+}
+
+#endif // defined(ARX_IMAGE_SSE2)
+
+#ifdef __ARM_NEON__
+
+static uint8x16_t matchColorKeyNEON(uint8x16x3_t pixels, const u8 key[3]) {
+	return vandq_u8(vandq_u8(vceqq_u8(pixels.val[0], vdupq_n_u8(key[0])),
+	                         vceqq_u8(pixels.val[1], vdupq_n_u8(key[1]))),
+	                vceqq_u8(pixels.val[2], vdupq_n_u8(key[2])));
+}
+
+static bool anyNEON(uint8x16_t mask) {
+	uint8x8_t any = vorr_u8(vget_low_u8(mask), vget_high_u8(mask));
+	return vget_lane_u64(vreinterpret_u64_u8(any), 0) != 0;
+}
+
+static bool findColorKeyNEON(const u8 * src, size_t pixels, const u8 key[3]) {
+	
+	size_t i = 0;
+	for(; i + 16 <= pixels; i += 16) {
+		if(anyNEON(matchColorKeyNEON(vld3q_u8(src + i * 3), key))) {
+			return true;
+		}
+	}
+	
+	for(const u8 * img = src + i * 3; i < pixels; i++, img += 3) {
+		if(img[0] == key[0] && img[1] == key[1] && img[2] == key[2]) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+static void applyColorKeyNEON(const u8 * src, u8 * dst, unsigned width, unsigned height,
+                              const u8 key[3]) {
+	
+	size_t count = size_t(width) * height;
+	
+	size_t i = 0;
+	for(; i + 16 <= count; i += 16) {
+		
+		uint8x16x3_t pixels = vld3q_u8(src + i * 3);
+		uint8x16_t keyed = matchColorKeyNEON(pixels, key);
+		
+		uint8x16x4_t result;
+		result.val[0] = pixels.val[0];
+		result.val[1] = pixels.val[1];
+		result.val[2] = pixels.val[2];
+		result.val[3] = vmvnq_u8(keyed);
+		vst4q_u8(dst + i * 4, result);
+		
+		if(anyNEON(keyed)) {
+			for(size_t p = i; p < i + 16; p++) {
+				if(!dst[p * 4 + 3]) {
+					fillKeyedPixel(src, width, height, int(p % width), int(p / width), dst + p * 4, key);
+				}
+			}
+		}
+	}
+	
+	applyColorKeyScalar(src, dst, width, height, i, key);
+}
+
+#endif // __ARM_NEON__
+
+bool findColorKey(const u8 * src, size_t pixels, const u8 key[3]) {
+	
+#if defined(ARX_IMAGE_SSE2)
+	if(g_kernels == SSE2Kernels) {
+		return findColorKeySSE2(src, pixels, key);
+	}
+#elif defined(__ARM_NEON__)
+	if(g_kernels == NEONKernels) {
+		return findColorKeyNEON(src, pixels, key);
+	}
+#endif
+	
+	for(size_t i = 0; i < pixels; i++, src += 3) {
+		if(src[0] == key[0] && src[1] == key[1] && src[2] == key[2]) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+void applyColorKey(const u8 * src, u8 * dst, unsigned width, unsigned height, const u8 key[3]) {
+	
+#if defined(ARX_IMAGE_SSE2)
+	if(g_kernels == SSE2Kernels) {
+		applyColorKeySSE2(src, dst, width, height, key);
+		return;
+	}
+#elif defined(__ARM_NEON__)
+	if(g_kernels == NEONKernels) {
+		applyColorKeyNEON(src, dst, width, height, key);
+		return;
+	}
+#endif
+	
+	applyColorKeyScalar(src, dst, width, height, 0, key);
+}
+
+// Gamma
+
+static const float COMPONENT_RANGE = 255.0f;
+
+static void quakeGammaScalar(u8 * data, size_t pixels, unsigned channels, float gamma) {
+	
+	const unsigned int MAX_COMPONENTS = 4;
+	float components[MAX_COMPONENTS];
+	
+	for(size_t i = 0; i < pixels; i++, data += channels) {
+		
+		float maxComponent = 0.0f;
+		
+		for(unsigned int j = 0; j < channels; j++) {
+			components[j] = float(data[j]) * gamma;
+			maxComponent = std::max(maxComponent, components[j]);
+		}
+		
+		if(maxComponent > COMPONENT_RANGE) {
+			float reciprocal = COMPONENT_RANGE / maxComponent;
+			for(unsigned int j = 0; j < channels; j++) {
+				components[j] *= reciprocal;
+				data[j] = (unsigned char)components[j];
+			}
+		} else {
+			for(unsigned int j = 0; j < channels; j++) {
+				data[j] = (unsigned char)components[j];
+			}
+		}
+	}
+}
+
+#if defined(ARX_IMAGE_SSE2)
+
+static void quakeGammaSSE2(u8 * data, size_t pixels, unsigned channels, float gamma) {
+	
+	const __m128 scale = _mm_set1_ps(gamma);
+	const __m128 range = _mm_set1_ps(COMPONENT_RANGE);
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128i zero = _mm_setzero_si128();
+	
+	size_t i = 0;
+	for(; i + 4 <= pixels; i += 4, data += channels * 4) {
+		
+		// Gather four pixels, unused channels are zero and don't affect the maximum
+		int packed[4] = { 0, 0, 0, 0 };
+		__m128i v;
+		if(channels == 4) {
+			v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+		} else {
+			for(int j = 0; j < 4; j++) {
+				std::memcpy(&packed[j], data + j * channels, channels);
+			}
+			v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed));
+		}
+		__m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+		__m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+		__m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+		__m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+		__m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+		
+		// Switch to one component of each pixel per register
+		_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+		p0 = _mm_mul_ps(p0, scale);
+		p1 = _mm_mul_ps(p1, scale);
+		p2 = _mm_mul_ps(p2, scale);
+		p3 = _mm_mul_ps(p3, scale);
+		
+		// Normalize saturated pixels - multiplying the others by one is exact
+		__m128 maxComponent = _mm_max_ps(_mm_max_ps(p0, p1), _mm_max_ps(p2, p3));
+		__m128 saturated = _mm_cmpgt_ps(maxComponent, range);
+		__m128 reciprocal = _mm_div_ps(range, _mm_or_ps(_mm_and_ps(saturated, maxComponent),
+		                                                _mm_andnot_ps(saturated, one)));
+		reciprocal = _mm_or_ps(_mm_and_ps(saturated, reciprocal), _mm_andnot_ps(saturated, one));
+		p0 = _mm_mul_ps(p0, reciprocal);
+		p1 = _mm_mul_ps(p1, reciprocal);
+		p2 = _mm_mul_ps(p2, reciprocal);
+		p3 = _mm_mul_ps(p3, reciprocal);
+		
+		_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+		lo = _mm_packs_epi32(_mm_cvttps_epi32(p0), _mm_cvttps_epi32(p1));
+		hi = _mm_packs_epi32(_mm_cvttps_epi32(p2), _mm_cvttps_epi32(p3));
+		v = _mm_packus_epi16(lo, hi);
+		if(channels == 4) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(data), v);
+		} else {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(packed), v);
+			for(int j = 0; j < 4; j++) {
+				std::memcpy(data + j * channels, &packed[j], channels);
+			}
+		}
+	}
+	
+	quakeGammaScalar(data, pixels - i, channels, gamma);
+}
+
+#endif // defined(ARX_IMAGE_SSE2)
+
+#ifdef __ARM_NEON__
+
+static void quakeGammaNEON(u8 * data, size_t pixels, unsigned channels, float gamma) {
+	
+	for(size_t i = 0; i < pixels; i++, data += channels) {
+		
+		uint32_t packed = 0;
+		std::memcpy(&packed, data, channels);
+		
+		uint8x8_t v = vreinterpret_u8_u32(vdup_n_u32(packed));
+		uint32x4_t u = vmovl_u16(vget_low_u16(vmovl_u8(v)));
+		float32x4_t components = vmulq_n_f32(vcvtq_f32_u32(u), gamma);
+		
+		// Unused lanes are zero and don't affect the maximum
+		float32x2_t m = vpmax_f32(vget_low_f32(components), vget_high_f32(components));
+		m = vpmax_f32(m, m);
+		float maxComponent = vget_lane_f32(m, 0);
+		
+		if(maxComponent > COMPONENT_RANGE) {
+			components = vmulq_n_f32(components, COMPONENT_RANGE / maxComponent);
+		}
+		
+		uint16x4_t n = vmovn_u32(vcvtq_u32_f32(components));
+		v = vmovn_u16(vcombine_u16(n, n));
+		packed = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+		std::memcpy(data, &packed, channels);
+	}
+}
+
+#endif // __ARM_NEON__
+
+void quakeGamma(u8 * data, size_t pixels, unsigned channels, float gamma) {
+	
+#if defined(ARX_IMAGE_SSE2)
+	if(g_kernels == SSE2Kernels) {
+		quakeGammaSSE2(data, pixels, channels, gamma);
+		return;
+	}
+#elif defined(__ARM_NEON__)
+	if(g_kernels == NEONKernels) {
+		quakeGammaNEON(data, pixels, channels, gamma);
+		return;
+	}
+#endif
+	
+	quakeGammaScalar(data, pixels, channels, gamma);
+}
+
+void adjustGamma(u8 * data, size_t size, float gamma) {
+	
+	// This is a pure table lookup - there is nothing to gain from SIMD here
+	u8 table[256];
+	table[0] = 0;
+	for(int i = 1; i < 256; i++) {
+		table[i] = (unsigned char)(COMPONENT_RANGE * powf(i * (1.0f / COMPONENT_RANGE), gamma));
+	}
+	
+	for(size_t i = 0; i < size; i++) {
+		data[i] = table[data[i]];
+	}
+}
+
+// Downscale
+
+static void downScaleScalar(const u8 * src, unsigned srcWidth, u8 * dst, unsigned dstWidth,
+                            unsigned y, unsigned begin, unsigned channels) {
+	
+	const u8 * row0 = src + size_t(y * 2) * srcWidth * channels;
+	const u8 * row1 = row0 + size_t(srcWidth) * channels;
+	dst += size_t(y) * dstWidth * channels;
+	
+	for(unsigned x = begin; x < dstWidth; x++) {
+		for(unsigned a = 0; a < channels; a++) {
+			unsigned aa = row0[x * 2 * channels + a] + row1[x * 2 * channels + a]
+			            + row0[(x * 2 + 1) * channels + a] + row1[(x * 2 + 1) * channels + a];
+			dst[x * channels + a] = aa / 4;
+		}
+	}
+}
+
+#if defined(ARX_IMAGE_SSE2)
+
+static __m128i loadu(const u8 * p) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+//! Downscale a row, returns the first pixel that still needs to be processed
+static unsigned downScaleSSE2(const u8 * src, unsigned srcWidth, u8 * dst, unsigned dstWidth,
+                              unsigned y, unsigned channels) {
+	
+	const u8 * row0 = src + size_t(y * 2) * srcWidth * channels;
+	const u8 * row1 = row0 + size_t(srcWidth) * channels;
+	dst += size_t(y) * dstWidth * channels;
+	
+	const __m128i zero = _mm_setzero_si128();
+	
+	unsigned x = 0;
+	
+	if(channels == 4) {
+		for(; x + 4 <= dstWidth; x += 4) {
+			const u8 * a = row0 + x * 8, * b = row1 + x * 8;
+			__m128i a0 = loadu(a), a1 = loadu(a + 16), b0 = loadu(b), b1 = loadu(b + 16);
+			__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+			// Add horizontally neighbouring pixels
+			s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+			s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+			s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+			s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+			__m128i lo = _mm_srli_epi16(_mm_unpacklo_epi64(s0, s1), 2);
+			__m128i hi = _mm_srli_epi16(_mm_unpacklo_epi64(s2, s3), 2);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_packus_epi16(lo, hi));
+		}
+	} else if(channels == 1) {
+		const __m128i ones = _mm_set1_epi16(1);
+		for(; x + 16 <= dstWidth; x += 16) {
+			const u8 * a = row0 + x * 2, * b = row1 + x * 2;
+			__m128i a0 = loadu(a), a1 = loadu(a + 16), b0 = loadu(b), b1 = loadu(b + 16);
+			__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+			// Add horizontally neighbouring pixels
+			__m128i lo = _mm_packs_epi32(_mm_madd_epi16(s0, ones), _mm_madd_epi16(s1, ones));
+			__m128i hi = _mm_packs_epi32(_mm_madd_epi16(s2, ones), _mm_madd_epi16(s3, ones));
+			lo = _mm_srli_epi16(lo, 2);
+			hi = _mm_srli_epi16(hi, 2);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+		}
+	}
+	
+	return x;
+}
+
+#endif // defined(ARX_IMAGE_SSE2)
+
+#ifdef __ARM_NEON__
+
+//! Downscale a row, returns the first pixel that still needs to be processed
+static unsigned downScaleNEON(const u8 * src, unsigned srcWidth, u8 * dst, unsigned dstWidth,
+                              unsigned y, unsigned channels) {
+	
+	const u8 * row0 = src + size_t(y * 2) * srcWidth * channels;
+	const u8 * row1 = row0 + size_t(srcWidth) * channels;
+	dst += size_t(y) * dstWidth * channels;
+	
+	unsigned x = 0;
+	
+	if(channels == 4) {
+		for(; x + 4 <= dstWidth; x += 4) {
+			// Split into even and odd pixels
+			uint32x4x2_t a = vld2q_u32(reinterpret_cast<const uint32_t *>(row0 + x * 8));
+			uint32x4x2_t b = vld2q_u32(reinterpret_cast<const uint32_t *>(row1 + x * 8));
+			uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]), a1 = vreinterpretq_u8_u32(a.val[1]);
+			uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]), b1 = vreinterpretq_u8_u32(b.val[1]);
+			uint16x8_t lo = vaddl_u8(vget_low_u8(a0), vget_low_u8(a1));
+			lo = vaddw_u8(vaddw_u8(lo, vget_low_u8(b0)), vget_low_u8(b1));
+			uint16x8_t hi = vaddl_u8(vget_high_u8(a0), vget_high_u8(a1));
+			hi = vaddw_u8(vaddw_u8(hi, vget_high_u8(b0)), vget_high_u8(b1));
+			vst1q_u8(dst + x * 4, vcombine_u8(vshrn_n_u16(lo, 2), vshrn_n_u16(hi, 2)));
+		}
+	} else if(channels == 1) {
+		for(; x + 16 <= dstWidth; x += 16) {
+			// Split into even and odd pixels
+			uint8x16x2_t a = vld2q_u8(row0 + x * 2);
+			uint8x16x2_t b = vld2q_u8(row1 + x * 2);
+			uint16x8_t lo = vaddl_u8(vget_low_u8(a.val[0]), vget_low_u8(a.val[1]));
+			lo = vaddw_u8(vaddw_u8(lo, vget_low_u8(b.val[0])), vget_low_u8(b.val[1]));
+			uint16x8_t hi = vaddl_u8(vget_high_u8(a.val[0]), vget_high_u8(a.val[1]));
+			hi = vaddw_u8(vaddw_u8(hi, vget_high_u8(b.val[0])), vget_high_u8(b.val[1]));
+			vst1q_u8(dst + x, vcombine_u8(vshrn_n_u16(lo, 2), vshrn_n_u16(hi, 2)));
+		}
+	}
+	
+	return x;
+}
+
+#endif // __ARM_NEON__
+
+void downScale(const u8 * src, unsigned srcWidth, u8 * dst,
+               unsigned dstWidth, unsigned dstHeight, unsigned channels) {
+	
+	for(unsigned y = 0; y < dstHeight; y++) {
+		
+		unsigned x = 0;
+		
+#if defined(ARX_IMAGE_SSE2)
+		if(g_kernels == SSE2Kernels) {
+			x = downScaleSSE2(src, srcWidth, dst, dstWidth, y, channels);
+		}
+#elif defined(__ARM_NEON__)
+		if(g_kernels == NEONKernels) {
+			x = downScaleNEON(src, srcWidth, dst, dstWidth, y, channels);
+		}
+#endif
+		
+		downScaleScalar(src, srcWidth, dst, dstWidth, y, x, channels);
+	}
+}
+
+// Resize
+
+void resize(const u8 * src, unsigned srcWidth, unsigned srcHeight,
+            u8 * dst, unsigned dstWidth, unsigned dstHeight, bool flipVertical) {
+	
+	// Nearest-neighbour sampling is a gather, so instead of SIMD we only compute
+	// the source offsets once and reuse rows that map to the same source line.
+	// The fractional source coordinates must be accumulated exactly like before
+	// to select the same pixels.
+	
+	const unsigned int pixel = 3;
+	const size_t dstSpan = size_t(dstWidth) * pixel;
+	
+	std::vector<size_t> offsets(dstWidth);
+	float xSource = 0.0f;
+	const float xDelta = srcWidth / (float)dstWidth;
+	for(unsigned int x = 0; x < dstWidth; x++) {
+		offsets[x] = size_t((unsigned int)(xSource)) * pixel;
+		xSource += xDelta;
+	}
+	
+	const u8 * lastSrc = NULL;
+	const u8 * lastDst = NULL;
+	
+	float ySource = 0.0f;
+	const float yDelta = srcHeight / (float)dstHeight;
+	
+	for(unsigned int y = 0; y < dstHeight; y++) {
+		
+		u8 * d = dst + (flipVertical ? dstHeight - 1 - y : y) * dstSpan;
+		const u8 * s = src + size_t((unsigned int)(ySource)) * srcWidth * pixel;
+		
+		if(s == lastSrc) {
+			std::memcpy(d, lastDst, dstSpan);
+		} else {
+			for(unsigned int x = 0; x < dstWidth; x++, d += pixel) {
+				const u8 * p = s + offsets[x];
+				d[0] = p[0], d[1] = p[1], d[2] = p[2];
+			}
+			d -= dstSpan;
+		}
+		
+		lastSrc = s, lastDst = d;
+		ySource += yDelta;
+	}
+}
+
+// Blur
+
+//! Larger kernels would overflow the 16-bit multipliers used by the SIMD kernels
+static const int MAX_SIMD_BLUR_RADIUS = 181;
+
+/*!
+ * Compute weighted sums for 8 consecutive pixels.
+ * Tap i reads the pixels at src + i * stride.
+ */
+typedef void (*BlurSpanFunc)(const u8 * src, size_t stride, const int * kernel, int taps, int * values);
+
+#if defined(ARX_IMAGE_SSE2)
+
+static void blurSpanSSE2(const u8 * src, size_t stride, const int * kernel, int taps, int * values) {
+	
+	const __m128i zero = _mm_setzero_si128();
+	
+	__m128i lo = zero, hi = zero;
+	
+	// Process two taps at a time using 16-bit multiply-add
+	for(int i = 0; i < taps; i += 2) {
+		const u8 * a = src + i * stride;
+		int ka = kernel[i], kb = 0;
+		__m128i va = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(a)), zero);
+		__m128i vb = zero;
+		if(i + 1 < taps) {
+			kb = kernel[i + 1];
+			vb = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(a + stride));
+			vb = _mm_unpacklo_epi8(vb, zero);
+		}
+		__m128i k = _mm_set1_epi32(ka | (kb << 16));
+		lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(va, vb), k));
+		hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(va, vb), k));
+	}
+	
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(values), lo);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(values + 4), hi);
+}
+
+#endif // defined(ARX_IMAGE_SSE2)
+
+#ifdef __ARM_NEON__
+
+static void blurSpanNEON(const u8 * src, size_t stride, const int * kernel, int taps, int * values) {
+	
+	uint32x4_t lo = vdupq_n_u32(0), hi = vdupq_n_u32(0);
+	
+	for(int i = 0; i < taps; i++) {
+		uint16x8_t v = vmovl_u8(vld1_u8(src + i * stride));
+		uint16_t k = uint16_t(kernel[i]);
+		lo = vmlal_n_u16(lo, vget_low_u16(v), k);
+		hi = vmlal_n_u16(hi, vget_high_u16(v), k);
+	}
+	
+	vst1q_s32(values, vreinterpretq_s32_u32(lo));
+	vst1q_s32(values + 4, vreinterpretq_s32_u32(hi));
+}
+
+#endif // __ARM_NEON__
+
+static void blurHorizontal(const u8 * src, u8 * dst, int width, int height,
+                           const int * kernel, int radius, BlurSpanFunc span) {
+	
+	int kernelSize = 1 + radius * 2;
+	
+	int total = 0;
+	for(int i = 0; i < kernelSize; i++) {
+		total += kernel[i];
+	}
+	
+	for(int y = 0; y < height; y++, src += width, dst += width) {
+		
+		int x = 0;
+		while(x < width) {
+			
+			// Pixels where the whole kernel is inside the row
+			if(span && x >= radius && x + 8 + radius <= width) {
+				int values[8];
+				span(src + x - radius, 1, kernel, kernelSize, values);
+				for(int j = 0; j < 8; j++) {
+					dst[x + j] = u8(values[j] / total);
+				}
+				x += 8;
+				continue;
+			}
+			
+			int value = 0;
+			int sum = 0;
+			for(int i = 0; i < kernelSize; i++) {
+				int read = x - radius + i;
+				if(read >= 0 && read < width) {
+					value += kernel[i] * src[read];
+					sum += kernel[i];
+				}
+			}
+			dst[x] = u8(value / sum);
+			x++;
+		}
+	}
+}
+
+static void blurVertical(const u8 * src, u8 * dst, size_t dstStride, int width, int height,
+                         const int * kernel, int radius, BlurSpanFunc span) {
+	
+	int kernelSize = 1 + radius * 2;
+	
+	for(int y = 0; y < height; y++) {
+		
+		// Only use the part of the kernel that is inside the image
+		int begin = std::max(0, radius - y);
+		int end = std::min(kernelSize, height - y + radius);
+		int sum = 0;
+		for(int i = begin; i < end; i++) {
+			sum += kernel[i];
+		}
+		
+		const u8 * s = src + (y - radius + begin) * width;
+		u8 * d = dst + size_t(y) * width * dstStride;
+		
+		int x = 0;
+		
+		if(span) {
+			for(; x + 8 <= width; x += 8) {
+				int values[8];
+				span(s + x, width, kernel + begin, end - begin, values);
+				for(int j = 0; j < 8; j++) {
+					d[(x + j) * dstStride] = u8(values[j] / sum);
+				}
+			}
+		}
+		
+		for(; x < width; x++) {
+			int value = 0;
+			for(int i = begin; i < end; i++) {
+				value += kernel[i] * s[(i - begin) * width + x];
+			}
+			d[x * dstStride] = u8(value / sum);
+		}
+	}
+}
+
+void blur(u8 * data, unsigned width, unsigned height, unsigned channels, int radius) {
+	
+	if(radius <= 0 || !width || !height) {
+		return;
+	}
+	
+	// Create the kernel
+	int kernelSize = 1 + radius * 2;
+	std::vector<int> kernel(kernelSize, 0);
+	for(int i = 1; i < radius; i++) {
+		int szi = radius - i;
+		kernel[radius + i] = kernel[szi] = szi * szi;
+	}
+	kernel[radius] = radius * radius;
+	
+	BlurSpanFunc span = NULL;
+#if defined(ARX_IMAGE_SSE2)
+	if(g_kernels == SSE2Kernels && radius <= MAX_SIMD_BLUR_RADIUS) {
+		span = blurSpanSSE2;
+	}
+#elif defined(__ARM_NEON__)
+	if(g_kernels == NEONKernels && radius <= MAX_SIMD_BLUR_RADIUS) {
+		span = blurSpanNEON;
+	}
+#endif
+	
+	// Blur each channel separately using our separable kernel
+	size_t size = size_t(width) * height;
+	std::vector<u8> channel(size);
+	std::vector<u8> blurred(size);
+	for(unsigned c = 0; c < channels; c++) {
+		
+		for(size_t i = 0; i < size; i++) {
+			channel[i] = data[i * channels + c];
+		}
+		
+		blurHorizontal(&channel[0], &blurred[0], width, height, &kernel[0], radius, span);
+		blurVertical(&blurred[0], data + c, channels, width, height, &kernel[0], radius, span);
+	}
+}
+
+} // namespace image
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_GRAPHICS_IMAGE_IMAGEKERNELS_H
+#define ARX_GRAPHICS_IMAGE_IMAGEKERNELS_H
+
+#include <stddef.h>
+
+#include "platform/Platform.h"
+
+/*!
+ * Pixel processing loops used by \ref Image.
+ *
+ * Every kernel has a scalar reference implementation. Where the compiler
+ * supports it, SSE2 or NEON versions are provided that must produce
+ * bit-identical results. The implementation is selected at runtime and can be
+ * overridden for testing and benchmarking.
+ */
+namespace image {
+
+enum KernelSet {
+	ScalarKernels,
+	SSE2Kernels,
+	NEONKernels
+};
+
+//! Get the fastest kernel set supported by this build
+KernelSet getBestKernels();
+
+//! Get the kernel set currently used
+KernelSet getKernels();
+
+/*!
+ * Select the kernel set to use for the following calls.
+ * @return false if the kernel set is not supported by this build
+ */
+bool setKernels(KernelSet kernels);
+
+const char * getKernelsName(KernelSet kernels);
+
+//! Check if any pixel in a RGB/BGR buffer matches the color key
+bool findColorKey(const u8 * src, size_t pixels, const u8 key[3]);
+
+/*!
+ * Convert a RGB/BGR buffer to RGBA/BGRA, making pixels that match the key transparent.
+ * Transparent pixels take the color of an opaque neighbour (or black) so that
+ * linear filtering won't produce dark borders.
+ */
+void applyColorKey(const u8 * src, u8 * dst, unsigned width, unsigned height, const u8 key[3]);
+
+/*!
+ * Scale all components by gamma, normalizing saturated pixels by their
+ * largest component to preserve chroma.
+ */
+void quakeGamma(u8 * data, size_t pixels, unsigned channels, float gamma);
+
+//! Apply data = 255 * (data / 255) ^ gamma to each component
+void adjustGamma(u8 * data, size_t size, float gamma);
+
+//! Average 2x2 pixel blocks from src into dst
+void downScale(const u8 * src, unsigned srcWidth, u8 * dst,
+               unsigned dstWidth, unsigned dstHeight, unsigned channels);
+
+//! Nearest-neighbour resize of a RGB/BGR buffer
+void resize(const u8 * src, unsigned srcWidth, unsigned srcHeight,
+            u8 * dst, unsigned dstWidth, unsigned dstHeight, bool flipVertical);
+
+//! Blur each channel using a separable kernel with quadratic falloff
+void blur(u8 * data, unsigned width, unsigned height, unsigned channels, int radius);
+
+} // namespace image
+
+#endif // ARX_GRAPHICS_IMAGE_IMAGEKERNELS_H
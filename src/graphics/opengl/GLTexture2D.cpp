@@ -19,6 +19,8 @@
 
 #include "graphics/opengl/GLTexture2D.h"
 
+#include <algorithm>
+
 #include "graphics/Math.h"
 #include "graphics/opengl/GLTextureStage.h"
 #include "graphics/opengl/OpenGLRenderer.h"
@@ -128,7 +130,10 @@ printf("GLTexture2D::Upload (%ix%i), Mipmaps=%s, Format=%s\n", size.x, size.y,
 	}
 #endif
 	
-	if(hasMipmaps()) 
+	// Mipmaps loaded from the texture cache can only be used if there is no padding
+	bool precomputedMipmaps = hasMipmaps() && mImage.GetNumMipmaps() > 1 && storedSize == size;
+	
+	if(hasMipmaps() && !precomputedMipmaps) 
 	{
 		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
 	}
@@ -177,6 +182,13 @@ printf("GLTexture2D::Upload (%ix%i), Mipmaps=%s, Format=%s\n", size.x, size.y,
 	if(storedSize != size) {
 		glTexImage2D(GL_TEXTURE_2D, 0, internal, storedSize.x, storedSize.y, 0, format, GL_UNSIGNED_BYTE, NULL);
 		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, format, GL_UNSIGNED_BYTE, mImage.GetData());
+	} else if(precomputedMipmaps) {
+		const unsigned char * data = mImage.GetData();
+		for(unsigned int level = 0; level < mImage.GetNumMipmaps(); level++) {
+			GLsizei width = std::max(size.x >> level, 1), height = std::max(size.y >> level, 1);
+			glTexImage2D(GL_TEXTURE_2D, level, internal, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+			data += Image::GetSize(mFormat, width, height);
+		}
 	} else {
 		glTexImage2D(GL_TEXTURE_2D, 0, internal, size.x, size.y, 0, format, GL_UNSIGNED_BYTE, mImage.GetData());
 	}
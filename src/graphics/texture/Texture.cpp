@@ -19,6 +19,8 @@
 
 #include "graphics/texture/Texture.h"
 
+#include "graphics/texture/TextureCache.h"
+
 bool Texture2D::Init(const res::path & strFileName, TextureFlags newFlags) {
 	
 	mFileName = strFileName;
@@ -46,20 +48,50 @@ bool Texture2D::Init(unsigned int pWidth, unsigned int pHeight, Image::Format pF
 	return Create();
 }
 
-bool Texture2D::Restore() {
+bool Texture2D::Init(const res::path & strFileName, const Image & image, TextureFlags newFlags) {
 	
-	bool bRestored = false;
+	mFileName = strFileName;
+	mImage = image;
+	flags = newFlags;
+	
+	if((flags & HasColorKey) && !mImage.HasAlpha()) {
+		flags &= ~HasColorKey;
+	}
+	
+	return createFromImage();
+}
 
+bool Texture2D::Restore() {
+	
 	if(!mFileName.empty()) {
-		mImage.LoadFromFile(mFileName);
-
-		if((flags & HasColorKey) && !mImage.HasAlpha()) {
-			mImage.ApplyColorKeyToAlpha();
-			if(!mImage.HasAlpha()) {
-				flags &= ~HasColorKey;
+		
+		TextureCache::Key key;
+		bool cacheable = TextureCache::getKey(mFileName, flags, key);
+		
+		if(!cacheable || !TextureCache::load(key, mImage)) {
+			
+			mImage.LoadFromFile(mFileName);
+			
+			if((flags & HasColorKey) && !mImage.HasAlpha()) {
+				mImage.ApplyColorKeyToAlpha();
+			}
+			
+			if(cacheable) {
+				TextureCache::store(key, mImage);
 			}
 		}
+		
+		if((flags & HasColorKey) && !mImage.HasAlpha()) {
+			flags &= ~HasColorKey;
+		}
 	}
+	
+	return createFromImage();
+}
+
+bool Texture2D::createFromImage() {
+	
+	bool bRestored = false;
 
 	if(mImage.IsValid()) {
 		mFormat = mImage.GetFormat();
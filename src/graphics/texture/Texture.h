@@ -78,6 +78,12 @@ public:
 	bool Init(const Image & image, TextureFlags flags = HasMipmaps);
 	bool Init(unsigned int width, unsigned int height, Image::Format format);
 	
+	/*!
+	 * Initialize from an image that has already been loaded from strFileName.
+	 * If flags contains HasColorKey, the color key must already have been applied.
+	 */
+	bool Init(const res::path & strFileName, const Image & image, TextureFlags flags);
+	
 	bool Restore();
 	
 	inline Image & GetImage() { return mImage; }
@@ -87,6 +93,9 @@ protected:
 	
 	Texture2D() { } 
 	
+	//! Create and upload the texture from mImage
+	bool createFromImage();
+	
 	Image mImage;
 	res::path mFileName;
 	
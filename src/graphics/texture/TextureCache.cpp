@@ -0,0 +1,318 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "graphics/texture/TextureCache.h"
+
+#include "Configure.h"
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#if defined(ARX_HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <boost/noncopyable.hpp>
+
+#include "core/Config.h"
+#include "graphics/image/Image.h"
+#include "io/fs/FilePath.h"
+#include "io/fs/FileStream.h"
+#include "io/fs/Filesystem.h"
+#include "io/fs/SystemPaths.h"
+#include "io/log/Logger.h"
+#include "io/resource/PakEntry.h"
+#include "io/resource/PakReader.h"
+#include "platform/Atomic.h"
+#include "platform/Platform.h"
+#include "platform/Thread.h"
+
+namespace {
+
+//! Increment this whenever the format of cache entries changes
+const u32 CACHE_VERSION = 1;
+
+const char CACHE_MAGIC[4] = { 'A', 'R', 'X', 'T' };
+
+struct CacheHeader {
+	char magic[4];
+	u32 version;
+	u64 sourceSize;
+	s64 sourceTime;
+	u32 flags;
+	u32 format;
+	u32 width;
+	u32 height;
+	u32 mipmaps;
+	u32 pathLength;
+	// followed by the resource path and the image data
+};
+
+//! Read-only view of a cache file, memory-mapped if possible
+class CacheFile : private boost::noncopyable {
+	
+public:
+	
+	explicit CacheFile(const fs::path & file);
+	~CacheFile();
+	
+	const char * data() const { return m_data; }
+	size_t size() const { return m_size; }
+	
+private:
+	
+	char * m_data;
+	size_t m_size;
+	bool m_mapped;
+	
+};
+
+CacheFile::CacheFile(const fs::path & file) : m_data(NULL), m_size(0), m_mapped(false) {
+	
+#if defined(ARX_HAVE_MMAP)
+	
+	int fd = open(file.string().c_str(), O_RDONLY);
+	if(fd == -1) {
+		return;
+	}
+	
+	struct stat buf;
+	if(fstat(fd, &buf) == 0 && buf.st_size > 0) {
+		void * data = mmap(NULL, size_t(buf.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data != MAP_FAILED) {
+			m_data = static_cast<char *>(data);
+			m_size = size_t(buf.st_size);
+			m_mapped = true;
+		}
+	}
+	
+	close(fd);
+	
+	if(m_mapped) {
+		return;
+	}
+	
+#endif
+	
+	m_data = fs::read_file(file, m_size);
+}
+
+CacheFile::~CacheFile() {
+	
+#if defined(ARX_HAVE_MMAP)
+	if(m_mapped) {
+		munmap(m_data, m_size);
+		return;
+	}
+#endif
+	
+	delete[] m_data;
+}
+
+fs::path getCacheDir() {
+	return fs::paths.user / "cache" / "textures";
+}
+
+fs::path getCacheFile(const TextureCache::Key & key) {
+	
+	// FNV-1a hash of the resource path and flags
+	const std::string & name = key.file.string();
+	u64 hash = 14695981039346656037ull;
+	for(size_t i = 0; i < name.length(); i++) {
+		hash = (hash ^ u8(name[i])) * 1099511628211ull;
+	}
+	hash = (hash ^ u8(key.flags)) * 1099511628211ull;
+	
+	std::ostringstream oss;
+	oss << std::hex << std::setfill('0') << std::setw(16) << hash << ".tex";
+	
+	return getCacheDir() / oss.str();
+}
+
+//! Check if the cache file header matches the key, returns the image data offset or 0
+size_t checkHeader(const TextureCache::Key & key, const char * data, size_t size) {
+	
+	if(!data || size < sizeof(CacheHeader)) {
+		return 0;
+	}
+	
+	CacheHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	
+	if(std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+	   || header.version != CACHE_VERSION || header.sourceSize != key.size
+	   || header.sourceTime != s64(key.mtime) || header.flags != u32(key.flags)) {
+		return 0;
+	}
+	
+	const std::string & name = key.file.string();
+	if(header.pathLength != name.length() || size < sizeof(header) + header.pathLength
+	   || name.compare(0, name.length(), data + sizeof(header), header.pathLength) != 0) {
+		return 0;
+	}
+	
+	return sizeof(header) + header.pathLength;
+}
+
+//! Number of temporary files created by this process, to give each writer its own file
+volatile size_t tempFileCount = 0;
+
+} // anonymous namespace
+
+bool TextureCache::isEnabled() {
+	return config.video.textureCache && !fs::paths.user.empty();
+}
+
+bool TextureCache::getKey(const res::path & file, Texture::TextureFlags flags, Key & key) {
+	
+	if(!isEnabled()) {
+		return false;
+	}
+	
+	PakFile * source = resources->getFile(file);
+	if(!source || !source->mtime()) {
+		return false;
+	}
+	
+	key.file = file;
+	key.flags = flags;
+	key.size = source->size();
+	key.mtime = source->mtime();
+	
+	return true;
+}
+
+bool TextureCache::contains(const Key & key) {
+	
+	fs::path file = getCacheFile(key);
+	
+	fs::ifstream ifs(file, fs::fstream::in | fs::fstream::binary);
+	if(!ifs.is_open()) {
+		return false;
+	}
+	
+	std::vector<char> buffer(sizeof(CacheHeader) + key.file.string().length());
+	ifs.read(&buffer.front(), buffer.size());
+	if(ifs.fail()) {
+		return false;
+	}
+	
+	return checkHeader(key, &buffer.front(), buffer.size()) != 0;
+}
+
+bool TextureCache::load(const Key & key, Image & image) {
+	
+	fs::path file = getCacheFile(key);
+	
+	CacheFile cached(file);
+	if(!cached.data()) {
+		return false;
+	}
+	
+	size_t offset = checkHeader(key, cached.data(), cached.size());
+	if(!offset) {
+		LogDebug("discarding stale texture cache entry " << file << " for " << key.file);
+		fs::remove(file);
+		return false;
+	}
+	
+	CacheHeader header;
+	std::memcpy(&header, cached.data(), sizeof(header));
+	
+	if(header.format >= Image::Format_Unknown || !header.width || !header.height
+	   || !header.mipmaps || cached.size() - offset != Image::GetSizeWithMipmaps(
+	     Image::Format(header.format), header.width, header.height, 1, header.mipmaps)) {
+		LogWarning << "Corrupt texture cache entry " << file << " for " << key.file;
+		fs::remove(file);
+		return false;
+	}
+	
+	image.Create(header.width, header.height, Image::Format(header.format), header.mipmaps);
+	std::memcpy(image.GetData(), cached.data() + offset, image.GetDataSize());
+	
+	return true;
+}
+
+void TextureCache::store(const Key & key, Image & image) {
+	
+	if(!image.IsValid() || image.IsVolume()) {
+		return;
+	}
+	
+#ifndef HAVE_GLES
+	// OpenGL ES textures are downscaled at upload time, so mipmaps are generated there
+	if((key.flags & Texture::HasMipmaps) && image.GetNumMipmaps() == 1) {
+		image.GenerateMipmaps();
+	}
+#endif
+	
+	if(!fs::create_directories(getCacheDir())) {
+		LogWarning << "Could not create texture cache directory " << getCacheDir();
+		return;
+	}
+	
+	fs::path file = getCacheFile(key);
+	
+	const std::string & name = key.file.string();
+	
+	CacheHeader header;
+	std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceSize = key.size;
+	header.sourceTime = key.mtime;
+	header.flags = key.flags;
+	header.format = image.GetFormat();
+	header.width = image.GetWidth();
+	header.height = image.GetHeight();
+	header.mipmaps = image.GetNumMipmaps();
+	header.pathLength = name.length();
+	
+	// Write to a temporary file first so that readers never see partial entries
+	// Other processes and jobs may be writing the same entry, so use a unique name
+	std::ostringstream suffix;
+	suffix << '.' << getProcessId() << '-' << atomic::add(tempFileCount, 1) << ".tmp";
+	fs::path temp = file;
+	temp.append(suffix.str());
+	
+	{
+		fs::ofstream ofs(temp, fs::fstream::out | fs::fstream::binary | fs::fstream::trunc);
+		if(!ofs.is_open()) {
+			LogWarning << "Could not write texture cache entry " << file;
+			return;
+		}
+		ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		ofs.write(name.data(), name.length());
+		ofs.write(reinterpret_cast<const char *>(image.GetData()), image.GetDataSize());
+		if(ofs.fail()) {
+			LogWarning << "Could not write texture cache entry " << file;
+			ofs.close();
+			fs::remove(temp);
+			return;
+		}
+	}
+	
+	if(!fs::rename(temp, file, true)) {
+		fs::remove(temp);
+	}
+}
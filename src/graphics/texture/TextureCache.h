@@ -0,0 +1,80 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_GRAPHICS_TEXTURE_TEXTURECACHE_H
+#define ARX_GRAPHICS_TEXTURE_TEXTURECACHE_H
+
+#include <stddef.h>
+#include <ctime>
+
+#include "graphics/texture/Texture.h"
+#include "io/resource/ResourcePath.h"
+
+class Image;
+
+/*!
+ * Persistent cache of decoded textures in the user directory.
+ *
+ * Entries hold the image after color keying, including a precomputed mipmap
+ * chain for textures that need one, so that later runs can skip decoding.
+ * They are keyed by resource path and texture flags and are discarded when the
+ * size or modification time of the source file (or its archive) changes.
+ */
+class TextureCache {
+	
+public:
+	
+	//! Identifies a texture source file
+	struct Key {
+		res::path file;
+		Texture::TextureFlags flags;
+		size_t size;
+		std::time_t mtime;
+	};
+	
+	//! Is the texture cache enabled in the config
+	static bool isEnabled();
+	
+	/*!
+	 * Get the cache key for a texture file.
+	 * Must be called from the main thread as it queries the resource system.
+	 * @return false if the cache is disabled or the file does not exist.
+	 */
+	static bool getKey(const res::path & file, Texture::TextureFlags flags, Key & key);
+	
+	//! Check if there is a cache entry for the key without loading it
+	static bool contains(const Key & key);
+	
+	/*!
+	 * Load an image from the cache.
+	 * Stale or corrupt entries are removed.
+	 * @return false if there is no valid entry for the key.
+	 */
+	static bool load(const Key & key, Image & image);
+	
+	/*!
+	 * Store a decoded (and color-keyed) image in the cache.
+	 * If the key requests mipmaps, the mipmap chain is generated and appended to
+	 * the image first.
+	 */
+	static void store(const Key & key, Image & image);
+	
+};
+
+#endif // ARX_GRAPHICS_TEXTURE_TEXTURECACHE_H
@@ -253,6 +253,8 @@ void Credits::render() {
 		ARXmenu.mda->creditspos -= 0.03f * Yratio * dtime;
 		ARXmenu.mda->creditstart = time;
 		
+		Font::beginBatch();
+		
 		std::vector<CreditsTextInformations>::const_iterator it = CreditsData.aCreditsInformations.begin() + CreditsData.iFirstLine ;
 		for (; it != CreditsData.aCreditsInformations.end(); ++it)
 		{
@@ -273,6 +275,8 @@ void Credits::render() {
 			if ( yy >= g_size.height() )
 				break ; //it's useless to continue because next phrase will not be inside the viewport
 		}
+		
+		Font::endBatch();
 	} else {
 		LogWarning << "Error initializing credits";
 	}
@@ -89,6 +89,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "graphics/data/TextureContainer.h"
 #include "graphics/effects/DrawEffects.h"
 #include "graphics/effects/Halo.h"
+#include "graphics/font/Font.h"
 #include "graphics/particle/ParticleEffects.h"
 #include "graphics/texture/TextureStage.h"
 #include "graphics/texture/Texture.h"
@@ -4965,6 +4966,9 @@ void ARX_INTERFACE_ManageOpenedBook()
 
 		//------------------------------
 		
+		// The attribute and skill values are text only, draw them in one go
+		Font::beginBatch();
+		
 		std::stringstream ss3;
 		ss3 << std::setw(3) << std::setprecision(0) << std::fixed << player.Full_Attribute_Strength;
 		tex = ss3.str();
@@ -5278,6 +5282,8 @@ void ARX_INTERFACE_ManageOpenedBook()
 		else color = Color::black;
 
 		DrawBookTextCenter(hFontInBook, 153, 278, tex, color);
+		
+		Font::endBatch();
 	}
 	else if (Book_Mode == BOOKMODE_MINIMAP)
 	{
@@ -46,6 +46,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "gui/MiniMap.h"
 
+#include <cmath>
 #include <cstdio>
 
 #include "core/Core.h"
@@ -61,6 +62,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "graphics/Draw.h"
 #include "graphics/Math.h"
+#include "graphics/Renderer.h"
 #include "graphics/data/TextureContainer.h"
 #include "graphics/texture/TextureStage.h"
 #include "graphics/texture/Texture.h"
@@ -228,6 +230,7 @@ void MiniMap::reveal() {
 				m_levels[d].m_revealed[i][j] = 255;
 			}
 		}
+		invalidateRevealed(d);
 	}
 }
 
@@ -246,6 +249,12 @@ void MiniMap::firstInit(ARXCHARACTER *pl, PakReader *pakRes, EntityManager *enti
 	m_currentLevel = 0;
 	m_entities = entityMng;
 	m_activeBkg = NULL;
+	
+	for(int i = 0; i < MAX_MINIMAP_LEVELS; i++) {
+		m_revealedMaps[i].m_texture = NULL;
+		m_revealedMaps[i].m_dirtyMinX = m_revealedMaps[i].m_dirtyMinZ = 0;
+		m_revealedMaps[i].m_dirtyMaxX = m_revealedMaps[i].m_dirtyMaxZ = -1;
+	}
 
     m_mapVertices.reserve(MINIMAP_MAX_X * MINIMAP_MAX_Z);
 
@@ -270,6 +279,7 @@ void MiniMap::resetLevels() {
 		m_levels[i].m_width = 0.f;
 		m_levels[i].m_height = 0.f;
 		memset(m_levels[i].m_revealed, 0, sizeof(m_levels[i].m_revealed[0][0] * MINIMAP_MAX_X * MINIMAP_MAX_Z)); // Sets the whole array to 0
+		invalidateRevealed(i);
 	}
 }
 
@@ -284,7 +294,142 @@ void MiniMap::purgeTexContainer() {
 	for(int i = 0; i < MAX_MINIMAP_LEVELS; i++) {
 		delete m_levels[i].m_texContainer;
 		m_levels[i].m_texContainer = NULL;
+		delete m_revealedMaps[i].m_texture;
+		m_revealedMaps[i].m_texture = NULL;
+		m_revealedMaps[i].m_source.Reset();
+		m_revealedMaps[i].m_composite.Reset();
+	}
+}
+
+void MiniMap::invalidateRevealed(int showLevel, int minX, int minZ, int maxX, int maxZ) {
+	
+	RevealedMap & map = m_revealedMaps[showLevel];
+	
+	if(map.m_dirtyMinX > map.m_dirtyMaxX) {
+		map.m_dirtyMinX = minX;
+		map.m_dirtyMinZ = minZ;
+		map.m_dirtyMaxX = maxX;
+		map.m_dirtyMaxZ = maxZ;
+	} else {
+		map.m_dirtyMinX = min(map.m_dirtyMinX, minX);
+		map.m_dirtyMinZ = min(map.m_dirtyMinZ, minZ);
+		map.m_dirtyMaxX = max(map.m_dirtyMaxX, maxX);
+		map.m_dirtyMaxZ = max(map.m_dirtyMaxZ, maxZ);
+	}
+}
+
+void MiniMap::invalidateRevealed(int showLevel) {
+	invalidateRevealed(showLevel, 0, 0, MINIMAP_MAX_X - 1, MINIMAP_MAX_Z - 1);
+}
+
+float MiniMap::getRevealed(int showLevel, int i, int j) const {
+	
+	if(i < 0 || i >= MINIMAP_MAX_X || j < 0 || j >= MINIMAP_MAX_Z) {
+		return 0.f;
+	}
+	
+	return m_levels[showLevel].m_revealed[i][j] * (1.0f / 255);
+}
+
+void MiniMap::compositeRevealed(int showLevel, Image & image) {
+	
+	RevealedMap & map = m_revealedMaps[showLevel];
+	
+	// Revealing a cell changes the interpolated value up to one cell away
+	float minX = map.m_padX + (map.m_dirtyMinX - 1) * map.m_cellWidth;
+	float maxX = map.m_padX + (map.m_dirtyMaxX + 1) * map.m_cellWidth;
+	float minY = map.m_padY + (map.m_dirtyMinZ - 1) * map.m_cellHeight;
+	float maxY = map.m_padY + (map.m_dirtyMaxZ + 1) * map.m_cellHeight;
+	int x0 = max(int(std::floor(minX)), 0);
+	int x1 = min(int(std::ceil(maxX)), int(image.GetWidth()));
+	int y0 = max(int(std::floor(minY)), 0);
+	int y1 = min(int(std::ceil(maxY)), int(image.GetHeight()));
+	
+	const Image & source = map.m_source;
+	int sourceWidth = source.GetWidth();
+	int sourceHeight = source.GetHeight();
+	
+	size_t channels = source.GetNumChannels();
+	size_t colorChannels = source.HasAlpha() ? channels - 1 : channels;
+	
+	for(int y = y0; y < y1; y++) {
+		
+		float fj = (y - map.m_padY + 0.5f) / map.m_cellHeight;
+		int j = int(std::floor(fj));
+		fj -= j;
+		
+		int sy = min(max(y - map.m_padY, 0), sourceHeight - 1);
+		
+		for(int x = x0; x < x1; x++) {
+			
+			float fi = (x - map.m_padX + 0.5f) / map.m_cellWidth;
+			int i = int(std::floor(fi));
+			fi -= i;
+			
+			float top = getRevealed(showLevel, i, j) * (1.f - fi)
+			            + getRevealed(showLevel, i + 1, j) * fi;
+			float bottom = getRevealed(showLevel, i, j + 1) * (1.f - fi)
+			               + getRevealed(showLevel, i + 1, j + 1) * fi;
+			float v = top * (1.f - fj) + bottom * fj;
+			
+			int sx = min(max(x - map.m_padX, 0), sourceWidth - 1);
+			
+			const unsigned char * in = source.GetData() + (sy * sourceWidth + sx) * channels;
+			unsigned char * out = image.GetData() + (y * image.GetWidth() + x) * channels;
+			for(size_t c = 0; c < colorChannels; c++) {
+				out[c] = static_cast<unsigned char>(in[c] * v + 0.5f);
+			}
+			for(size_t c = colorChannels; c < channels; c++) {
+				out[c] = in[c];
+			}
+		}
+	}
+	
+	map.m_dirtyMinX = map.m_dirtyMinZ = 0;
+	map.m_dirtyMaxX = map.m_dirtyMaxZ = -1;
+}
+
+Texture2D * MiniMap::getRevealedTexture(int showLevel) {
+	
+	RevealedMap & map = m_revealedMaps[showLevel];
+	
+	if(!map.m_texture) {
+		
+		if(!map.m_source.IsValid()) {
+			const res::path & file = m_levels[showLevel].m_texContainer->m_pTexture->getFileName();
+			if(!map.m_source.LoadFromFile(file) || map.m_source.IsCompressed()) {
+				LogError << "Could not load minimap image " << file;
+				map.m_source.Reset();
+				return NULL;
+			}
+		}
+		
+		map.m_cellWidth = m_activeBkg->Xdiv * m_modX * (1.0f / 25);
+		map.m_cellHeight = m_activeBkg->Zdiv * m_modZ * (1.0f / 25);
+		map.m_padX = int(std::ceil(map.m_cellWidth));
+		map.m_padY = int(std::ceil(map.m_cellHeight));
+		
+		map.m_composite.Create(map.m_padX + int(std::ceil(MINIMAP_MAX_X * map.m_cellWidth)),
+		                       map.m_padY + int(std::ceil(MINIMAP_MAX_Z * map.m_cellHeight)),
+		                       map.m_source.GetFormat());
+		invalidateRevealed(showLevel);
+		compositeRevealed(showLevel, map.m_composite);
+		
+		map.m_texture = GRenderer->CreateTexture2D();
+		if(!map.m_texture || !map.m_texture->Init(map.m_composite, Texture::HasMipmaps)) {
+			LogError << "Could not create minimap texture";
+			delete map.m_texture, map.m_texture = NULL;
+			return NULL;
+		}
+		
+	} else if(map.m_dirtyMinX <= map.m_dirtyMaxX) {
+		compositeRevealed(showLevel, map.m_composite);
+		// Uploading may modify the texture image in place, e.g. downscale it on GLES
+		map.m_texture->GetImage() = map.m_composite;
+		map.m_texture->Upload();
 	}
+	
+	return map.m_texture;
 }
 
 void MiniMap::showPlayerMiniMap(int showLevel) {
@@ -479,10 +624,14 @@ void MiniMap::revealPlayerPos(int showLevel) {
 	playerPos.x += startX;
 	playerPos.y += startY;
 	
-	// TODO this is inefficient - we don't really need to iterate over the whole minimap!
-	// only the area around the player will be modified
-	for(int j = 0; j < MINIMAP_MAX_Z; j++) {
-		for(int i = 0; i < MINIMAP_MAX_X; i++) {
+	// Only the cells around the player can be revealed
+	int minX = max(int(std::floor((playerPos.x - 6.f - startX) / caseX)) - 1, 0);
+	int maxX = min(int(std::ceil((playerPos.x + 6.f - startX) / caseX)), MINIMAP_MAX_X - 1);
+	int minZ = max(int(std::floor((playerPos.y - 6.f - startY) / caseY)), 0);
+	int maxZ = min(int(std::ceil((playerPos.y + 6.f - startY) / caseY)), MINIMAP_MAX_Z - 1);
+	
+	for(int j = minZ; j <= maxZ; j++) {
+		for(int i = minX; i <= maxX; i++) {
 			
 			float posx = startX + i * caseX;
 			float posy = startY + j * caseY;
@@ -504,8 +653,10 @@ void MiniMap::revealPlayerPos(int showLevel) {
 			
 			int r = vv * 255.f;
 			
-			int ucLevel =  max(r, (int)m_levels[showLevel].m_revealed[i][j]);
-			m_levels[showLevel].m_revealed[i][j] = checked_range_cast<unsigned char>(ucLevel);
+			if(r > m_levels[showLevel].m_revealed[i][j]) {
+				m_levels[showLevel].m_revealed[i][j] = checked_range_cast<unsigned char>(r);
+				invalidateRevealed(showLevel, i, j, i, j);
+			}
 		}
 	}
 }
@@ -531,159 +682,155 @@ Vec2f MiniMap::computePlayerPos(float zoom, int showLevel) {
 	return pos;
 }
 
-void MiniMap::drawBackground(int showLevel, Rect boundaries, float startX, float startY, float zoom, float fadeBorder, float decalX, float decalY, bool invColor, float alpha) {
+namespace {
+
+//! Fade factor for a position, 0 outside [low, high] and linear within border of the bounds
+float fadeFactor(float pos, float low, float high, float border) {
+	
+	float v = 1.f;
+	
+	float d = pos - low;
+	if(d < 0.f) {
+		return 0.f;
+	} else if(d < border) {
+		v *= d / border;
+	}
+	
+	d = high - pos;
+	if(d < 0.f) {
+		return 0.f;
+	} else if(d < border) {
+		v *= d / border;
+	}
+	
+	return v;
+}
+
+//! Collect the positions where the fade factor changes slope, in [start, end]
+size_t getFadeSteps(float * steps, float start, float end, float low, float high, float border) {
+	
+	size_t count = 0;
+	steps[count++] = start;
+	
+	if(border > 0.f) {
+		float candidates[] = { low, low + border, high - border, high };
+		for(size_t i = 0; i < ARRAY_SIZE(candidates); i++) {
+			if(candidates[i] > steps[count - 1] && candidates[i] < end) {
+				steps[count++] = candidates[i];
+			}
+		}
+	}
 	
-    m_mapVertices.resize(0);
+	steps[count++] = end;
+	
+	return count;
+}
 
+} // anonymous namespace
+
+void MiniMap::drawBackground(int showLevel, Rect boundaries, float startX, float startY, float zoom, float fadeBorder, float decalX, float decalY, bool invColor, float alpha) {
+	
+	Texture2D * texture = getRevealedTexture(showLevel);
+	if(!texture) {
+		return;
+	}
+	
+	const RevealedMap & map = m_revealedMaps[showLevel];
+	
 	float caseX = zoom / ((float)MINIMAP_MAX_X);
 	float caseY = zoom / ((float)MINIMAP_MAX_Z);
 	
-	GRenderer->SetTexture(0, m_levels[showLevel].m_texContainer);
-	
-	float div = (1.0f / 25);
-	TextureContainer * tc = m_levels[showLevel].m_texContainer;
-	float dw = 1.f / tc->m_pTexture->getStoredSize().x; 
-	float dh = 1.f / tc->m_pTexture->getStoredSize().y;
+	// Cells are included if their top-left corner is inside the boundaries
+	// Cells before -1 and after MINIMAP_MAX_X - 1 are never revealed
+	int firstX = max(int(std::ceil((boundaries.left - startX) / caseX)), -1);
+	int lastX = min(int(std::floor((boundaries.right - startX) / caseX)), MINIMAP_MAX_X - 1);
+	int firstY = max(int(std::ceil((boundaries.top - startY) / caseY)), -1);
+	int lastY = min(int(std::floor((boundaries.bottom - startY) / caseY)), MINIMAP_MAX_Z - 1);
+	if(firstX > lastX || firstY > lastY) {
+		return;
+	}
 	
-	float vx2 = 4.f * dw * m_modX;
-	float vy2 = 4.f * dh * m_modZ;
+	float left = (startX + firstX * caseX) * Xratio;
+	float right = (startX + (lastX + 1) * caseX) * Xratio;
+	float top = (startY + firstY * caseY) * Yratio;
+	float bottom = (startY + (lastY + 1) * caseY) * Yratio;
 	
-	float fadeDiv = 0.f;
 	Rect fadeBounds(0, 0, 0, 0);
-	
 	if(fadeBorder > 0.f) {
-		fadeDiv = 1.f/fadeBorder;
 		fadeBounds.left = checked_range_cast<Rect::Num>((boundaries.left + fadeBorder) * Xratio);
 		fadeBounds.right = checked_range_cast<Rect::Num>((boundaries.right - fadeBorder) * Xratio);
 		fadeBounds.top = checked_range_cast<Rect::Num>((boundaries.top + fadeBorder) * Yratio);
 		fadeBounds.bottom = checked_range_cast<Rect::Num>((boundaries.bottom - fadeBorder) * Yratio);
 	}
 	
-	GRenderer->SetRenderState(Renderer::AlphaBlending, true);
-	if(invColor) {
-		GRenderer->SetBlendFunc(Renderer::BlendOne, Renderer::BlendInvSrcColor);
-	} else {
-		GRenderer->SetBlendFunc(Renderer::BlendZero, Renderer::BlendInvSrcColor);
-	}
-	GRenderer->GetTextureStage(0)->setWrapMode(TextureStage::WrapClamp);
-
-	for(int j = -2; j < MINIMAP_MAX_Z + 2; j++) {
-		for(int i = -2; i < MINIMAP_MAX_X + 2; i++) {
-			
-			float vx, vy, vxx, vyy;
-			vxx = ((float)i * (float)m_activeBkg->Xdiv * m_modX);
-			vyy = ((float)j * (float)m_activeBkg->Zdiv * m_modZ);
-			vx = (vxx * div) * dw;
-			vy = (vyy * div) * dh;
-			
-			float posx = (startX + i * caseX) * Xratio;
-			float posy = (startY + j * caseY) * Yratio;
+	// The revealed amount is already in the texture, only the fade needs more vertices
+	float stepsX[6];
+	float stepsY[6];
+	size_t countX = getFadeSteps(stepsX, left, right, fadeBounds.left, fadeBounds.right, fadeBorder);
+	size_t countY = getFadeSteps(stepsY, top, bottom, fadeBounds.top, fadeBounds.bottom, fadeBorder);
+	
+	// Texture coordinates per composited texel - the texture may have been downscaled
+	float texelU = float(texture->getSize().x)
+	               / (float(map.m_composite.GetWidth()) * texture->getStoredSize().x);
+	float texelV = float(texture->getSize().y)
+	               / (float(map.m_composite.GetHeight()) * texture->getStoredSize().y);
+	
+	float du = map.m_cellWidth * texelU / (caseX * Xratio);
+	float dv = map.m_cellHeight * texelV / (caseY * Yratio);
+	float u0 = map.m_padX * texelU - startX * Xratio * du;
+	float v0 = map.m_padY * texelV - startY * Yratio * dv;
+	
+	m_mapVertices.resize(0);
+	
+	for(size_t j = 0; j + 1 < countY; j++) {
+		for(size_t i = 0; i + 1 < countX; i++) {
 			
-			if((posx < boundaries.left * Xratio)
-			   || (posx > boundaries.right * Xratio)
-			   || (posy < boundaries.top * Yratio)
-			   || (posy > boundaries.bottom * Yratio)) {
-				continue; // out of bounds
-			}
-
 			TexturedVertex verts[4];
 			
-			verts[3].p.x = verts[0].p.x = (posx);
-			verts[1].p.y = verts[0].p.y = (posy);
-			verts[2].p.x = verts[1].p.x = posx + (caseX * Xratio);
-			verts[3].p.y = verts[2].p.y = posy + (caseY * Yratio);
-			
-			verts[3].uv.x = verts[0].uv.x = vx;
-			verts[1].uv.y = verts[0].uv.y = vy;
-			verts[2].uv.x = verts[1].uv.x = vx + vx2;
-			verts[3].uv.y = verts[2].uv.y = vy + vy2;
-			
-			float v;
-			float oo = 0.f;
+			verts[3].p.x = verts[0].p.x = stepsX[i];
+			verts[1].p.y = verts[0].p.y = stepsY[j];
+			verts[2].p.x = verts[1].p.x = stepsX[i + 1];
+			verts[3].p.y = verts[2].p.y = stepsY[j + 1];
 			
 			for(int vert = 0; vert < 4; vert++) {
-				verts[vert].color = 0xFFFFFFFF;
-				verts[vert].rhw = 1;
-				verts[vert].p.z = 0.00001f;
-
-				// Array offset according to "vert"
-				int iOffset = 0;
-				int jOffset = 0;
-				
-				if(vert == 1 || vert == 2)
-					iOffset = 1;
-				if(vert == 2 || vert == 3)
-					jOffset = 1;
 				
-				if((i + iOffset < 0) || (i + iOffset >= MINIMAP_MAX_X) || (j + jOffset < 0) || (j + jOffset >= MINIMAP_MAX_Z)) {
-					v = 0;
-				} else {
-					v = ((float)m_levels[showLevel].m_revealed[min(i+iOffset, MINIMAP_MAX_X-iOffset)][min(j+jOffset, MINIMAP_MAX_Z-jOffset)]) * (1.0f / 255);
-				}
+				verts[vert].uv.x = u0 + verts[vert].p.x * du;
+				verts[vert].uv.y = v0 + verts[vert].p.y * dv;
 				
+				float v = 1.f;
 				if(fadeBorder > 0.f) {
-					
-					float _px = verts[vert].p.x - fadeBounds.left;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
-					
-					_px = fadeBounds.right - verts[vert].p.x;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
-					
-					_px = verts[vert].p.y - fadeBounds.top;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
-					
-					_px = fadeBounds.bottom - verts[vert].p.y;
-					
-					if(_px < 0.f) {
-						v = 0.f;
-					} else if(_px < fadeBorder) {
-						v *= _px * fadeDiv;
-					}
+					v *= fadeFactor(verts[vert].p.x, fadeBounds.left, fadeBounds.right, fadeBorder);
+					v *= fadeFactor(verts[vert].p.y, fadeBounds.top, fadeBounds.bottom, fadeBorder);
 				}
 				
 				verts[vert].color = Color::gray(v * alpha).toBGR();
-				
-				oo += v;
+				verts[vert].rhw = 1;
+				verts[vert].p.x += decalX * Xratio;
+				verts[vert].p.y += decalY * Yratio;
+				verts[vert].p.z = 0.00001f;
 			}
 			
-			if(oo > 0.f) {
-				
-				verts[0].p.x += decalX * Xratio;
-				verts[0].p.y += decalY * Yratio;
-				verts[1].p.x += decalX * Xratio;
-				verts[1].p.y += decalY * Yratio;
-				verts[2].p.x += decalX * Xratio;
-				verts[2].p.y += decalY * Yratio;
-				verts[3].p.x += decalX * Xratio;
-				verts[3].p.y += decalY * Yratio;
-				
-				m_mapVertices.push_back(verts[0]);
-				m_mapVertices.push_back(verts[1]);
-				m_mapVertices.push_back(verts[2]);
-
-				m_mapVertices.push_back(verts[0]);
-				m_mapVertices.push_back(verts[2]);
-				m_mapVertices.push_back(verts[3]);
-			}
+			m_mapVertices.push_back(verts[0]);
+			m_mapVertices.push_back(verts[1]);
+			m_mapVertices.push_back(verts[2]);
+			
+			m_mapVertices.push_back(verts[0]);
+			m_mapVertices.push_back(verts[2]);
+			m_mapVertices.push_back(verts[3]);
 		}
 	}
-
-    EERIEDRAWPRIM(Renderer::TriangleList, m_mapVertices.data(), m_mapVertices.size());
+	
+	GRenderer->SetTexture(0, texture);
+	
+	GRenderer->SetRenderState(Renderer::AlphaBlending, true);
+	if(invColor) {
+		GRenderer->SetBlendFunc(Renderer::BlendOne, Renderer::BlendInvSrcColor);
+	} else {
+		GRenderer->SetBlendFunc(Renderer::BlendZero, Renderer::BlendInvSrcColor);
+	}
+	GRenderer->GetTextureStage(0)->setWrapMode(TextureStage::WrapClamp);
+	
+	EERIEDRAWPRIM(Renderer::TriangleList, m_mapVertices.data(), m_mapVertices.size());
 	
 	GRenderer->SetRenderState(Renderer::AlphaBlending, false);
 }
@@ -801,6 +948,9 @@ void MiniMap::clearMarkerTexCont() {
 
 void MiniMap::load(const SavedMiniMap *saved, size_t size) {
 	std::copy(saved, saved + size, m_levels);
+	for(size_t i = 0; i < size; i++) {
+		invalidateRevealed(i);
+	}
 }
 
 void MiniMap::save(SavedMiniMap *toSave, size_t size) {
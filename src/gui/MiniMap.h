@@ -56,9 +56,11 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "game/EntityManager.h"
 #include "game/Player.h"
 #include "graphics/data/Mesh.h"
+#include "graphics/image/Image.h"
 #include "graphics/VertexBuffer.h"
 
 class TextureContainer;
+class Texture2D;
 struct SavedMiniMap;
 
 #define MINIMAP_MAX_X 50
@@ -172,7 +174,43 @@ private:
 	std::vector<MapMarkerData> m_mapMarkers;
 	MiniMapData m_levels[MAX_MINIMAP_LEVELS];
 	
+	/*!
+	 * Map image multiplied by the revealed amount of each cell.
+	 * Only the cells changed since the last draw are composited again.
+	 */
+	struct RevealedMap {
+		
+		Image m_source; //!< Map image as loaded from disk
+		Image m_composite; //!< Map with the revealed amount applied, at full resolution
+		Texture2D * m_texture; //!< Uploaded from m_composite, may be smaller on GLES
+		
+		//! Texels per minimap cell
+		float m_cellWidth;
+		float m_cellHeight;
+		
+		//! Texels before cell 0 so that the fade-in of the first cells is included
+		int m_padX;
+		int m_padY;
+		
+		//! Cells changed since the texture was last updated, empty if min > max
+		int m_dirtyMinX;
+		int m_dirtyMinZ;
+		int m_dirtyMaxX;
+		int m_dirtyMaxZ;
+		
+	};
+	
+	RevealedMap m_revealedMaps[MAX_MINIMAP_LEVELS];
+	
 	void getData(int showLevel);
+	
+	void invalidateRevealed(int showLevel, int minX, int minZ, int maxX, int maxZ);
+	void invalidateRevealed(int showLevel);
+	float getRevealed(int showLevel, int i, int j) const;
+	void compositeRevealed(int showLevel, Image & image);
+	
+	//! @return the revealed part of the map texture, updated if cells have been revealed
+	Texture2D * getRevealedTexture(int showLevel);
 	void resetLevels();
 	void loadOffsets(PakReader *pakRes);
 	void validatePos();
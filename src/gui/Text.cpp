@@ -189,6 +189,8 @@ long ARX_UNICODE_DrawTextInRect(Font* font,
 	
 	Rect previousViewport;
 	if(pClipRect) {
+		// Queued glyphs are drawn with the viewport active at flush time
+		Font::flushBatch();
 		previousViewport = GRenderer->GetViewport();
 		GRenderer->SetViewport(*pClipRect); 
 	}
@@ -199,9 +201,12 @@ long ARX_UNICODE_DrawTextInRect(Font* font,
 	}
 
 	long height;
+	Font::beginBatch();
 	ARX_UNICODE_FormattingInRect(font, _text, rect, col, &height);
+	Font::endBatch();
 
 	if(pClipRect) {
+		Font::flushBatch();
 		GRenderer->SetViewport(previousViewport);
 	}
 
@@ -156,6 +156,9 @@ void TextManager::Update(float _fDiffFrame) {
 }
 
 void TextManager::Render() {
+	
+	Font::beginBatch();
+	
 	vector<ManagedText *>::const_iterator itManage = entries.begin();
 	for(; itManage != entries.end(); ++itManage) {
 		
@@ -180,6 +183,8 @@ void TextManager::Render() {
 		
 		pArxText->rRect.bottom = pArxText->rRect.top + height;
 	}
+	
+	Font::endBatch();
 }
 
 void TextManager::Clear() {
@@ -139,7 +139,7 @@ struct huffman {
  *   this ordering, the bits pulled during decoding are inverted to apply the
  *   more "natural" ordering starting with all zeros and incrementing.
  */
-static int decode(state * s, huffman * h) {
+static int decode(state * s, const huffman * h) {
 	
 	int len;            /* current number of bits in code */
 	int code;           /* len bits being decoded */
@@ -254,6 +254,50 @@ static int construct(huffman * h, const unsigned char * rep, int n) {
 	return left;
 }
 
+/* bit lengths of literal codes */
+static const unsigned char litlen[] = {
+	11, 124, 8, 7, 28, 7, 188, 13, 76, 4, 10, 8, 12, 10, 12, 10, 8, 23, 8,
+	9, 7, 6, 7, 8, 7, 6, 55, 8, 23, 24, 12, 11, 7, 9, 11, 12, 6, 7, 22, 5,
+	7, 24, 6, 11, 9, 6, 7, 22, 7, 11, 38, 7, 9, 8, 25, 11, 8, 11, 9, 12,
+	8, 12, 5, 38, 5, 38, 5, 11, 7, 5, 6, 21, 6, 10, 53, 8, 7, 24, 10, 27,
+	44, 253, 253, 253, 252, 252, 252, 13, 12, 45, 12, 45, 12, 61, 12, 45,
+	44, 173
+};
+/* bit lengths of length codes 0..15 */
+static const unsigned char lenlen[] = {2, 35, 36, 53, 38, 23};
+/* bit lengths of distance codes 0..63 */
+static const unsigned char distlen[] = {2, 20, 53, 230, 247, 151, 248};
+
+namespace {
+
+/*
+ * Decoding tables, built once during static initialization so that
+ * blast() can be used from several threads at the same time.
+ */
+struct BlastTables {
+	
+	short litcnt[MAXBITS+1], litsym[256];        /* litcode memory */
+	short lencnt[MAXBITS+1], lensym[16];         /* lencode memory */
+	short distcnt[MAXBITS+1], distsym[64];       /* distcode memory */
+	huffman litcode;   /* literal code */
+	huffman lencode;   /* length code */
+	huffman distcode;  /* distance code */
+	
+	BlastTables() {
+		litcode.count = litcnt, litcode.symbol = litsym;
+		lencode.count = lencnt, lencode.symbol = lensym;
+		distcode.count = distcnt, distcode.symbol = distsym;
+		construct(&litcode, litlen, sizeof(litlen));
+		construct(&lencode, lenlen, sizeof(lenlen));
+		construct(&distcode, distlen, sizeof(distlen));
+	}
+	
+};
+
+const BlastTables g_tables;
+
+} // anonymous namespace
+
 /*
  * Decode PKWare Compression Library stream.
  *
@@ -301,26 +345,6 @@ static BlastResult blastDecompress(state * s) {
 	int dist;           /* distance for copy */
 	int copy;           /* copy counter */
 	unsigned char * from, *to;   /* copy pointers */
-	static int virgin = 1;                              /* build tables once */
-	static short litcnt[MAXBITS+1], litsym[256];        /* litcode memory */
-	static short lencnt[MAXBITS+1], lensym[16];         /* lencode memory */
-	static short distcnt[MAXBITS+1], distsym[64];       /* distcode memory */
-	static huffman litcode = {litcnt, litsym};   /* length code */
-	static huffman lencode = {lencnt, lensym};   /* length code */
-	static huffman distcode = {distcnt, distsym};/* distance code */
-	/* bit lengths of literal codes */
-	static const unsigned char litlen[] = {
-		11, 124, 8, 7, 28, 7, 188, 13, 76, 4, 10, 8, 12, 10, 12, 10, 8, 23, 8,
-		9, 7, 6, 7, 8, 7, 6, 55, 8, 23, 24, 12, 11, 7, 9, 11, 12, 6, 7, 22, 5,
-		7, 24, 6, 11, 9, 6, 7, 22, 7, 11, 38, 7, 9, 8, 25, 11, 8, 11, 9, 12,
-		8, 12, 5, 38, 5, 38, 5, 11, 7, 5, 6, 21, 6, 10, 53, 8, 7, 24, 10, 27,
-		44, 253, 253, 253, 252, 252, 252, 13, 12, 45, 12, 45, 12, 61, 12, 45,
-		44, 173
-	};
-	/* bit lengths of length codes 0..15 */
-	static const unsigned char lenlen[] = {2, 35, 36, 53, 38, 23};
-	/* bit lengths of distance codes 0..63 */
-	static const unsigned char distlen[] = {2, 20, 53, 230, 247, 151, 248};
 	static const short base[16] = {     /* base for length codes */
 		3, 2, 4, 5, 6, 7, 8, 9, 10, 12, 16, 24, 40, 72, 136, 264
 	};
@@ -328,13 +352,9 @@ static BlastResult blastDecompress(state * s) {
 		0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8
 	};
 	
-	/* set up decoding tables (once--might not be thread-safe) */
-	if(virgin) {
-		construct(&litcode, litlen, sizeof(litlen));
-		construct(&lencode, lenlen, sizeof(lenlen));
-		construct(&distcode, distlen, sizeof(distlen));
-		virgin = 0;
-	}
+	const huffman & litcode = g_tables.litcode;
+	const huffman & lencode = g_tables.lencode;
+	const huffman & distcode = g_tables.distcode;
 	
 	/* read header */
 	lit = bits(s, 8);
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "io/log/AsyncLogger.h"
+
+#include <sstream>
+
+#include "platform/Atomic.h"
+#include "platform/Platform.h"
+
+namespace logger {
+
+namespace {
+
+//! Queue whose messages are being delivered by the current thread, if any
+ARX_THREAD_LOCAL const AsyncQueue * t_deliveringQueue = NULL;
+
+} // anonymous namespace
+
+AsyncQueue::AsyncQueue(size_t capacity)
+	: pushPosition(0), popPosition(0), delivered(0), dropped(0),
+	  sleeping(0), stopping(0) {
+	
+	size_t size = 2;
+	while(size < capacity) {
+		size *= 2;
+	}
+	mask = size - 1;
+	
+	messages.resize(size);
+	for(size_t i = 0; i < size; i++) {
+		messages[i].sequence = i;
+	}
+	
+	atomic::barrier();
+	
+	setThreadName("Logger");
+	start();
+}
+
+AsyncQueue::~AsyncQueue() {
+	atomic::store(stopping, 1);
+	wakeUp();
+	waitForCompletion();
+}
+
+bool AsyncQueue::tryPush(const char * file, int line, Logger::LogLevel level,
+                         const std::string & str) {
+	
+	size_t pos = atomic::load(pushPosition);
+	Message * message;
+	for(;;) {
+		message = &messages[pos & mask];
+		size_t sequence = atomic::load(message->sequence);
+		if(sequence == pos) {
+			if(atomic::compareExchange(pushPosition, pos, pos + 1)) {
+				break;
+			}
+			pos = atomic::load(pushPosition);
+		} else if(ptrdiff_t(sequence - pos) < 0) {
+			// The slot still holds a message from the previous round
+			return false;
+		} else {
+			pos = atomic::load(pushPosition);
+		}
+	}
+	
+	message->file = file;
+	message->line = line;
+	message->level = level;
+	message->str = str;
+	
+	atomic::store(message->sequence, pos + 1);
+	
+	return true;
+}
+
+bool AsyncQueue::push(const char * file, int line, Logger::LogLevel level,
+                      const std::string & str, bool block) {
+	
+	while(!tryPush(file, line, level, str)) {
+		// Waiting on our own thread would never return
+		if(!block || isDeliveryThread()) {
+			atomic::add(dropped, 1);
+			return false;
+		}
+		wakeUp();
+		Thread::sleep(1);
+	}
+	
+	wakeUp();
+	
+	return true;
+}
+
+bool AsyncQueue::pop(Message & out) {
+	
+	size_t pos = atomic::load(popPosition);
+	Message * message;
+	for(;;) {
+		message = &messages[pos & mask];
+		size_t sequence = atomic::load(message->sequence);
+		if(sequence == pos + 1) {
+			if(atomic::compareExchange(popPosition, pos, pos + 1)) {
+				break;
+			}
+			pos = atomic::load(popPosition);
+		} else if(ptrdiff_t(sequence - (pos + 1)) < 0) {
+			return false;
+		} else {
+			pos = atomic::load(popPosition);
+		}
+	}
+	
+	out.file = message->file;
+	out.line = message->line;
+	out.level = message->level;
+	// Swap so that both buffers keep their capacity for reuse
+	out.str.swap(message->str);
+	
+	atomic::store(message->sequence, pos + mask + 1);
+	
+	return true;
+}
+
+bool AsyncQueue::empty() {
+	size_t pos = atomic::load(popPosition);
+	return atomic::load(messages[pos & mask].sequence) != pos + 1;
+}
+
+size_t AsyncQueue::deliver(Dispatch function) {
+	
+	size_t count = 0;
+	
+	Message message;
+	while(pop(message)) {
+		function(message.file, message.line, message.level, message.str);
+		atomic::add(delivered, 1);
+		count++;
+	}
+	
+	size_t lost = atomic::load(dropped);
+	if(lost != 0) {
+		atomic::add(dropped, size_t(0) - lost);
+		std::ostringstream oss;
+		oss << "Log queue full, dropped " << lost << " messages";
+		function(__FILE__, __LINE__, Logger::Warning, oss.str());
+	}
+	
+	return count;
+}
+
+void AsyncQueue::wakeUp() {
+	if(atomic::load(sleeping) && atomic::compareExchange(sleeping, 1, 0)) {
+		wakeup.post();
+	}
+}
+
+void AsyncQueue::waitForMessages() {
+	
+	if(!atomic::compareExchange(sleeping, 0, 1)) {
+		return;
+	}
+	
+	// Re-check after announcing that we are about to sleep so no wakeup is lost
+	if(!empty() || atomic::load(stopping)) {
+		if(atomic::compareExchange(sleeping, 1, 0)) {
+			return;
+		}
+		// A producer has already claimed the wakeup and will post the semaphore
+	}
+	
+	wakeup.wait();
+}
+
+bool AsyncQueue::isDeliveryThread() const {
+	return t_deliveringQueue == this;
+}
+
+void AsyncQueue::run() {
+	
+	t_deliveringQueue = this;
+	
+	for(;;) {
+		
+		if(deliver(&Logger::dispatch) != 0) {
+			continue;
+		}
+		
+		if(atomic::load(stopping)) {
+			break;
+		}
+		
+		waitForMessages();
+	}
+	
+}
+
+void AsyncQueue::flush() {
+	
+	if(isDeliveryThread()) {
+		// Called from a backend - older messages will be delivered once it returns
+		return;
+	}
+	
+	size_t target = atomic::load(pushPosition);
+	
+	while(ptrdiff_t(atomic::load(delivered) - target) < 0) {
+		wakeUp();
+		Thread::sleep(1);
+	}
+	
+}
+
+void AsyncQueue::drain(Dispatch function) {
+	deliver(function);
+}
+
+} // namespace logger
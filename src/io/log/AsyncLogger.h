@@ -0,0 +1,113 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_IO_LOG_ASYNCLOGGER_H
+#define ARX_IO_LOG_ASYNCLOGGER_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "io/log/LogBackend.h"
+#include "platform/Lock.h"
+#include "platform/Thread.h"
+
+namespace logger {
+
+/*!
+ * Bounded lock-free queue of log messages that are delivered by a dedicated thread
+ * using Logger::dispatch().
+ *
+ * Producers reserve a slot with a single compare-and-swap and never wait for the
+ * consumer unless the queue is full and blocking was requested.
+ * Backends logging from the delivery thread never wait: their messages are dropped
+ * if the queue is full.
+ * Slots carry a sequence number so that any number of threads can push and pop
+ * concurrently, which allows a crashing thread to drain the queue itself.
+ */
+class AsyncQueue : public MessageQueue, private Thread {
+	
+public:
+	
+	/*!
+	 * Start the delivery thread.
+	 * @param capacity Maximum number of queued messages, rounded up to a power of two.
+	 */
+	explicit AsyncQueue(size_t capacity = 4096);
+	
+	//! Deliver all queued messages and stop the thread.
+	~AsyncQueue();
+	
+	bool push(const char * file, int line, Logger::LogLevel level, const std::string & str,
+	          bool block);
+	
+	void flush();
+	
+	void drain(Dispatch dispatch);
+	
+private:
+	
+	void run();
+	
+	struct Message {
+		
+		volatile size_t sequence;
+		
+		const char * file;
+		int line;
+		Logger::LogLevel level;
+		std::string str;
+		
+	};
+	
+	bool tryPush(const char * file, int line, Logger::LogLevel level, const std::string & str);
+	
+	//! Pop one message into the given buffer
+	bool pop(Message & message);
+	
+	bool empty();
+	
+	//! Deliver all available messages using the given function.
+	size_t deliver(Dispatch dispatch);
+	
+	void wakeUp();
+	
+	void waitForMessages();
+	
+	//! @return true if called by the thread delivering messages from this queue.
+	bool isDeliveryThread() const;
+	
+	std::vector<Message> messages;
+	size_t mask;
+	
+	volatile size_t pushPosition;
+	volatile size_t popPosition;
+	
+	volatile size_t delivered;
+	volatile size_t dropped;
+	
+	volatile size_t sleeping;
+	volatile size_t stopping;
+	Semaphore wakeup;
+	
+};
+
+} // namespace logger
+
+#endif // ARX_IO_LOG_ASYNCLOGGER_H
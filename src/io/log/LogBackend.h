@@ -58,6 +58,38 @@ public:
 	
 };
 
+/*!
+ * Queue that delivers log messages to the backends from another thread.
+ */
+class MessageQueue {
+	
+public:
+	
+	typedef void (*Dispatch)(const char * file, int line, Logger::LogLevel level,
+	                         const std::string & str);
+	
+	//! Deliver all queued messages before returning.
+	virtual ~MessageQueue() { }
+	
+	/*!
+	 * Queue a log message.
+	 * @param block Wait for free space if the queue is full instead of dropping the message.
+	 * @return false if the message was dropped.
+	 */
+	virtual bool push(const char * file, int line, Logger::LogLevel level,
+	                  const std::string & str, bool block) = 0;
+	
+	//! Wait until all messages queued before this call have been delivered.
+	virtual void flush() = 0;
+	
+	/*!
+	 * Deliver all queued messages from the calling thread.
+	 * Intended for crash handlers where other threads can no longer be relied on.
+	 */
+	virtual void drain(Dispatch dispatch) = 0;
+	
+};
+
 } // namespace logger
 
 #endif // ARX_IO_LOG_LOGBACKEND_H
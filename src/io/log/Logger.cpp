@@ -45,8 +45,12 @@ struct LogManager {
 	static const Logger::LogLevel defaultLevel;
 	static Logger::LogLevel minimumLevel;
 	
+	//! Protects the log level rules and sources.
 	static Lock lock;
 	
+	//! Protects the backends. Never acquire lock while holding this.
+	static Lock outputLock;
+	
 	//! note: using the pointer value of a string constant as a hash map index.
 	typedef boost::unordered_map<const char *, logger::Source> Sources;
 	static Sources sources;
@@ -57,8 +61,16 @@ struct LogManager {
 	typedef boost::unordered_map<string, Logger::LogLevel> Rules;
 	static Rules rules;
 	
+	static logger::MessageQueue * queue;
+	static Logger::OverflowPolicy overflowPolicy;
+	
+	static string getSourceName(const char * file);
 	static logger::Source * getSource(const char * file);
 	static void deleteAllBackends();
+	
+	//! Pass a message to all backends without locking, for use after a crash.
+	static void dispatchUnlocked(const char * file, int line, Logger::LogLevel level,
+	                             const string & str);
 };
 
 const Logger::LogLevel LogManager::defaultLevel = Logger::Info;
@@ -67,6 +79,26 @@ LogManager::Sources LogManager::sources;
 LogManager::Backends LogManager::backends;
 LogManager::Rules LogManager::rules;
 Lock LogManager::lock;
+Lock LogManager::outputLock;
+logger::MessageQueue * LogManager::queue = NULL;
+Logger::OverflowPolicy LogManager::overflowPolicy = Logger::Block;
+
+string LogManager::getSourceName(const char * file) {
+	
+	const char * end = file + strlen(file);
+	const char * start = end;
+	while(start != file && start[-1] != '/' && start[-1] != '\\') {
+		start--;
+	}
+	
+	string name(start, end);
+	size_t pos = name.find_last_of('.');
+	if(pos != string::npos) {
+		name.resize(pos);
+	}
+	
+	return name;
+}
 
 logger::Source * LogManager::getSource(const char * file) {
 	
@@ -77,6 +109,7 @@ logger::Source * LogManager::getSource(const char * file) {
 	
 	logger::Source * source = &LogManager::sources[file];
 	source->file = file;
+	source->name = getSourceName(file);
 	source->level = LogManager::defaultLevel;
 	
 	const char * end = file + strlen(file);
@@ -91,7 +124,6 @@ logger::Source * LogManager::getSource(const char * file) {
 				if(pos != string::npos) {
 					component.resize(pos);
 				}
-				source->name = component;
 				first = false;
 			}
 			
@@ -119,11 +151,24 @@ void LogManager::deleteAllBackends() {
 	backends.clear();
 }
 
+void LogManager::dispatchUnlocked(const char * file, int line, Logger::LogLevel level,
+                                  const string & str) {
+	
+	logger::Source source;
+	source.file = file;
+	source.name = getSourceName(file);
+	source.level = level;
+	
+	for(Backends::const_iterator i = backends.begin(); i != backends.end(); ++i) {
+		(*i)->log(source, line, level, str);
+	}
+}
+
 } // anonymous namespace
 
 void Logger::add(logger::Backend * backend) {
 	
-	Autolock lock(LogManager::lock);
+	Autolock lock(LogManager::outputLock);
 	
 	if(backend != NULL) {
 		LogManager::backends.push_back(backend);
@@ -132,7 +177,7 @@ void Logger::add(logger::Backend * backend) {
 
 void Logger::remove(logger::Backend * backend) {
 	
-	Autolock lock(LogManager::lock);
+	Autolock lock(LogManager::outputLock);
 	
 	LogManager::backends.erase(std::remove(LogManager::backends.begin(),
 	                                       LogManager::backends.end(),
@@ -157,16 +202,33 @@ void Logger::log(const char * file, int line, LogLevel level, const string & str
 		return;
 	}
 	
-	Autolock lock(LogManager::lock);
+	logger::MessageQueue * queue = LogManager::queue;
+	if(queue) {
+		if(level != Critical) {
+			queue->push(file, line, level, str, LogManager::overflowPolicy == Block);
+			return;
+		}
+		// Make sure everything leading up to the critical error is written out
+		queue->flush();
+	}
 	
-	const logger::Source * source = LogManager::getSource(file);
+	dispatch(file, line, level, str);
+}
+
+void Logger::dispatch(const char * file, int line, LogLevel level, const string & str) {
 	
-	for(LogManager::Backends::const_iterator i = LogManager::backends.begin();
-		  i != LogManager::backends.end(); ++i) {
-		(*i)->log(*source, line, level, str);
+	logger::Source source;
+	{
+		Autolock lock(LogManager::lock);
+		source = *LogManager::getSource(file);
 	}
 	
-	LogManager::lock.unlock();
+	Autolock lock(LogManager::outputLock);
+	
+	for(LogManager::Backends::const_iterator i = LogManager::backends.begin();
+	    i != LogManager::backends.end(); ++i) {
+		(*i)->log(source, line, level, str);
+	}
 }
 
 void Logger::set(const string & prefix, Logger::LogLevel level) {
@@ -225,7 +287,11 @@ void Logger::reset(const string & prefix) {
 
 void Logger::flush() {
 	
-	Autolock lock(LogManager::lock);
+	if(LogManager::queue) {
+		LogManager::queue->flush();
+	}
+	
+	Autolock lock(LogManager::outputLock);
 	
 	for(LogManager::Backends::const_iterator i = LogManager::backends.begin();
 	    i != LogManager::backends.end(); ++i) {
@@ -233,6 +299,17 @@ void Logger::flush() {
 	}
 }
 
+void Logger::setQueue(logger::MessageQueue * queue) {
+	logger::MessageQueue * old = LogManager::queue;
+	LogManager::queue = queue;
+	// Delivers all remaining messages before returning
+	delete old;
+}
+
+void Logger::setOverflowPolicy(OverflowPolicy policy) {
+	LogManager::overflowPolicy = policy;
+}
+
 void Logger::configure(const string config) {
 	
 	size_t start = 0;
@@ -294,17 +371,26 @@ void Logger::initialize() {
 
 void Logger::shutdown() {
 	
+	setQueue(NULL);
+	
+	{
+		Autolock lock(LogManager::outputLock);
+		LogManager::deleteAllBackends();
+	}
+	
 	Autolock lock(LogManager::lock);
 	
 	LogManager::sources.clear();
 	LogManager::rules.clear();
 	
 	LogManager::minimumLevel = LogManager::defaultLevel;
-	
-	LogManager::deleteAllBackends();
 }
 
 void Logger::quickShutdown() {
+	if(LogManager::queue) {
+		// The logging thread may not get to run again - write queued messages ourselves
+		LogManager::queue->drain(&LogManager::dispatchUnlocked);
+	}
 	for(LogManager::Backends::const_iterator i = LogManager::backends.begin();
 	    i != LogManager::backends.end(); ++i) {
 		(*i)->quickShutdown();
@@ -312,3 +398,11 @@ void Logger::quickShutdown() {
 }
 
 ARX_PROGRAM_OPTION("debug", "g", "Log level settings", &Logger::configure, "LEVELS");
+
+static void dropLogMessagesOnOverflow() {
+	Logger::setOverflowPolicy(Logger::Drop);
+}
+
+ARX_PROGRAM_OPTION("drop-log", "D",
+                   "Drop log messages instead of waiting when the log queue is full",
+                   &dropLogMessagesOnOverflow);
@@ -58,7 +58,7 @@
 //! Test if the Error log level is enabled for the current file.
 #define LogErrorEnabled   ::Logger::isEnabled(__FILE__, ::Logger::Error)
 
-namespace logger { class Backend; }
+namespace logger { class Backend; class MessageQueue; }
 
 /*!
  * Logger class that allows longging via the stream operator.
@@ -76,6 +76,12 @@ public:
 		None //!< A special pseudo log level used to completely disable logging for a source file.
 	};
 	
+	//! What to do with new messages when the asynchronous log queue is full.
+	enum OverflowPolicy {
+		Block, //!< Wait for the logging thread to make room.
+		Drop   //!< Discard the message and report the number of dropped messages later.
+	};
+	
 private:
 	
 	static void log(const char * file, int line, LogLevel level, const std::string & str);
@@ -165,6 +171,25 @@ public:
 	 */
 	static void flush();
 	
+	/*!
+	 * Deliver log messages to the backends through a queue, such as logger::AsyncQueue,
+	 * so that logging does not wait for file or console output.
+	 * Critical messages are still delivered synchronously, after all queued messages.
+	 * The previous queue is drained and deleted. The queue will be automatically freed on exit.
+	 * This is not threadsafe: no other thread may log while the queue is changed.
+	 * @param queue The queue to use or NULL to deliver messages synchronously.
+	 */
+	static void setQueue(logger::MessageQueue * queue);
+	
+	//! Set what to do when the log queue is full.
+	static void setOverflowPolicy(OverflowPolicy policy);
+	
+	/*!
+	 * Pass a message to all backends immediately.
+	 * This is used by message queues to deliver queued messages.
+	 */
+	static void dispatch(const char * file, int line, LogLevel level, const std::string & str);
+	
 	/*!
 	* Helper class to pass a C string that might be NULL to the logger.
 	* If the pointer is NULL, the string "NULL" is logged.
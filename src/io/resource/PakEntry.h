@@ -20,6 +20,7 @@
 #ifndef ARX_IO_RESOURCE_PAKENTRY_H
 #define ARX_IO_RESOURCE_PAKENTRY_H
 
+#include <ctime>
 #include <string>
 #include <map>
 
@@ -34,12 +35,13 @@ class PakFile : private boost::noncopyable {
 private:
 	
 	size_t _size;
+	std::time_t _mtime;
 	
 	PakFile * _alternative;
 	
 protected:
 	
-	explicit inline PakFile(size_t size) :  _size(size), _alternative(NULL) { }
+	explicit inline PakFile(size_t size) :  _size(size), _mtime(0), _alternative(NULL) { }
 	
 	virtual ~PakFile();
 	
@@ -49,6 +51,13 @@ protected:
 public:
 	
 	inline size_t size() const { return _size; }
+	
+	/*!
+	 * Modification time of the file or the archive containing it.
+	 * @return 0 if the modification time is not known.
+	 */
+	inline std::time_t mtime() const { return _mtime; }
+	
 	inline PakFile * alternative() const { return _alternative; }
 	
 	virtual void read(void * buf) const = 0;
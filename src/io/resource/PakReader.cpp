@@ -447,6 +447,8 @@ bool PakReader::addArchive(const fs::path & pakfile) {
 		return false;
 	}
 	
+	std::time_t mtime = fs::last_write_time(pakfile);
+	
 	// Read fat location and size.
 	u32 fat_offset;
 	u32 fat_size;
@@ -535,6 +537,7 @@ bool PakReader::addArchive(const fs::path & pakfile) {
 			} else {
 				file = new UncompressedFile(ifs, offset, size);
 			}
+			file->_mtime = mtime;
 			
 			dir->addFile(std::string(filename, len), file);
 		}
@@ -653,7 +656,10 @@ bool PakReader::addFile(PakDirectory * dir, const fs::path & path,
 		return false;
 	}
 	
-	dir->addFile(name, new PlainFile(path, size));
+	PakFile * file = new PlainFile(path, size);
+	file->_mtime = fs::last_write_time(path);
+	
+	dir->addFile(name, file);
 	return true;
 }
 
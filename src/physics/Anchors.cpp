@@ -53,6 +53,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "game/Player.h"
 #include "graphics/Math.h"
 #include "io/log/Logger.h"
+#include "physics/BackgroundCollision.h"
 #include "physics/Collisions.h"
 
 using std::min;
@@ -73,23 +74,37 @@ static EERIEPOLY * ANCHOR_CheckInPolyPrecis(float x, float y, float z) {
 	EERIEPOLY * found = NULL;
 	float foundY = 9999999.f;
 
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision)
+		return NULL;
+
 	for(long j = pz - 1; j <= pz + 1; j++) {
 		for(long i = px - 1; i <= px + 1; i++) {
-			FAST_BKG_DATA *feg = &ACTIVEBKG->fastdata[i][j];
+			const CollisionCell & cell = collision->cell(i, j);
+
+			for(u32 c = cell.inClusterBegin; c < cell.inClusterEnd; ) {
+				const CollisionCluster & cluster = collision->clusters[c];
+
+				if(x < cluster.min.x || x > cluster.max.x || z < cluster.min.z || z > cluster.max.z) {
+					c = cluster.skip;
+					continue;
+				}
+				c++;
 
-			for(long k = 0; k < feg->nbpolyin; k++) {
-				EERIEPOLY *ep = feg->polyin[k];
+				for(u32 k = cluster.begin; k < cluster.end; k++) {
+					const CollisionPoly & cp = collision->overlappingPoly(k);
 
-				if(!(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL)) && PointIn2DPolyXZ(ep, x, z)) {
-					Vec3f poss;
-					poss.x = x;
-					poss.y = y;
-					poss.z = z;
-					float yy;
+					if(PointIn2DPolyXZ(cp, x, z)) {
+						Vec3f poss;
+						poss.x = x;
+						poss.y = y;
+						poss.z = z;
+						float yy;
 
-					if(GetTruePolyY(ep, &poss, &yy) && yy >= y && (!found || (found && (yy <= foundY)))) {
-						found = ep;
-						foundY = yy;
+						if(GetTruePolyY(cp, &poss, &yy) && yy >= y && (!found || (found && (yy <= foundY)))) {
+							found = cp.ep;
+							foundY = yy;
+						}
 					}
 				}
 			}
@@ -107,33 +122,47 @@ static EERIEPOLY * ANCHOR_CheckInPoly(float x, float y, float z) {
 	if(px < 0 || px >= ACTIVEBKG->Xsize || pz < 0 || pz >= ACTIVEBKG->Zsize)
 		return NULL;
 
-	EERIEPOLY *found = NULL;
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision)
+		return NULL;
 
-	FAST_BKG_DATA *feg = &ACTIVEBKG->fastdata[px][pz];
+	const CollisionPoly * found = NULL;
 
-	for(long k = 0; k < feg->nbpolyin; k++) {
-		EERIEPOLY *ep = feg->polyin[k];
+	const CollisionCell & cell = collision->cell(px, pz);
 
-		if (!(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
-		        &&	(ep->max.y >= y)
-		        &&	(ep != found)
-		        &&	((ep->norm.y < 0.f) || ((ep->type & POLY_QUAD) && (ep->norm2.y < 0.f)))
-		        &&	(PointIn2DPolyXZ(ep, x, z)))
-		{
-			if(!found || (found && ep->min.y < found->min.y))
-				found = ep;
+	for(u32 c = cell.inClusterBegin; c < cell.inClusterEnd; ) {
+		const CollisionCluster & cluster = collision->clusters[c];
+
+		if(cluster.max.y < y
+		   || x < cluster.min.x || x > cluster.max.x || z < cluster.min.z || z > cluster.max.z) {
+			c = cluster.skip;
+			continue;
+		}
+		c++;
+
+		for(u32 k = cluster.begin; k < cluster.end; k++) {
+			const CollisionPoly & cp = collision->overlappingPoly(k);
+
+			if ((cp.max.y >= y)
+			        &&	(&cp != found)
+			        &&	((cp.normY < 0.f) || ((cp.type & POLY_QUAD) && (cp.norm2Y < 0.f)))
+			        &&	(PointIn2DPolyXZ(cp, x, z)))
+			{
+				if(!found || (found && cp.min.y < found->min.y))
+					found = &cp;
+			}
 		}
 	}
 
 	if(!found)
 		return CheckInPoly(x, y, z);
 
-	return found;
+	return found->ep;
 }
 
 extern Vec3f vector2D;
 
-float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
+float ANCHOR_IsPolyInCylinder(const CollisionPoly * ep, EERIE_CYLINDER * cyl,
                               CollisionFlags flags) {
 	
 	if (!(flags & CFLAG_EXTRA_PRECISION))
@@ -143,7 +172,7 @@ float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
 
 	if (PointInCylinder(cyl, &ep->center)) 
 	{
-		if (ep->norm.y < 0.5f)
+		if (ep->normY < 0.5f)
 			return ep->min.y;
 
 		return ep->center.y;
@@ -170,7 +199,7 @@ float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
 			for (long o = 0; o < 5; o++)
 			{
 				float p = (float)o * ( 1.0f / 5 );
-				center = ep->v[n].p * p + ep->center * (1.f - p);
+				center = ep->v[n] * p + ep->center * (1.f - p);
 				if(PointInCylinder(cyl, &center)) {
 					anything = std::min(anything, center.y);
 					return anything;
@@ -183,7 +212,7 @@ float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
 		        || (flags & CFLAG_EXTRA_PRECISION)
 		   )
 		{
-			center = (ep->v[n].p + ep->v[r].p) * 0.5f;
+			center = (ep->v[n] + ep->v[r]) * 0.5f;
 			if(PointInCylinder(cyl, &center)) {
 				anything = std::min(anything, center.y);
 				return anything;
@@ -191,7 +220,7 @@ float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
 
 			if ((ep->area > 4000.f) || (flags & CFLAG_EXTRA_PRECISION))
 			{
-				center = (ep->v[n].p + ep->center) * 0.5f;
+				center = (ep->v[n] + ep->center) * 0.5f;
 				if(PointInCylinder(cyl, &center)) {
 					anything = std::min(anything, center.y);
 					return anything;
@@ -200,7 +229,7 @@ float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
 
 			if ((ep->area > 6000.f) || (flags & CFLAG_EXTRA_PRECISION))
 			{
-				center = (center + ep->v[n].p) * 0.5f;
+				center = (center + ep->v[n]) * 0.5f;
 				if(PointInCylinder(cyl, &center)) {
 					anything = std::min(anything, center.y);
 					return anything;
@@ -208,8 +237,8 @@ float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
 			}
 		}
 
-		if(PointInCylinder(cyl, &ep->v[n].p)) {
-			anything = std::min(anything, ep->v[n].p.y);
+		if(PointInCylinder(cyl, &ep->v[n])) {
+			anything = std::min(anything, ep->v[n].y);
 			return anything;
 		}
 
@@ -219,7 +248,7 @@ float ANCHOR_IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl,
 
 	}
 
-	if ((anything != 999999.f) && (ep->norm.y < 0.1f) && (ep->norm.y > -0.1f))
+	if ((anything != 999999.f) && (ep->normY < 0.1f) && (ep->normY > -0.1f))
 		anything = std::min(anything, ep->min.y);
 
 	return anything;
@@ -260,21 +289,38 @@ static float ANCHOR_CheckAnythingInCylinder(EERIE_CYLINDER *cyl, CollisionFlags
 		}
 		*/
 
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision)
+		return 0.f;
+
+	// Only points inside the polygon bounds are tested against the cylinder
+	float minf = std::min(cyl->origin.y, cyl->origin.y + cyl->height) - 1.f;
+	float maxf = std::max(cyl->origin.y, cyl->origin.y + cyl->height) + 1.f;
+	float reach = cyl->radius + 1.f;
+
 	for(long j = pz - rad; j <= pz + rad; j++) {
 		for(long i = px - rad; i <= px + rad; i++) {
-			FAST_BKG_DATA *feg = &ACTIVEBKG->fastdata[i][j];
+			const CollisionCell & cell = collision->cell(i, j);
 
-			for(long k = 0; k < feg->nbpoly; k++) {
-				EERIEPOLY *ep = &feg->polydata[k];
+			for(u32 c = cell.clusterBegin; c < cell.clusterEnd; ) {
+				const CollisionCluster & cluster = collision->clusters[c];
 
-				if(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
+				if(cluster.min.y >= anything || minf > cluster.max.y || maxf < cluster.min.y
+				   || distSqrXZ(cluster, cyl->origin.x, cyl->origin.z) > reach * reach) {
+					c = cluster.skip;
 					continue;
+				}
+				c++;
 
-				if(ep->min.y < anything) {
-					float minanything = std::min(anything, ANCHOR_IsPolyInCylinder(ep, cyl, flags));
+				for(u32 k = cluster.begin; k < cluster.end; k++) {
+					const CollisionPoly & cp = collision->polys[k];
 
-					if(anything != minanything)
-						anything = minanything;
+					if(cp.min.y < anything) {
+						float minanything = std::min(anything, ANCHOR_IsPolyInCylinder(&cp, cyl, flags));
+
+						if(anything != minanything)
+							anything = minanything;
+					}
 				}
 			}
 		}
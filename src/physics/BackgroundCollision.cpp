@@ -0,0 +1,233 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "physics/BackgroundCollision.h"
+
+#include <boost/unordered_map.hpp>
+
+#include "graphics/Math.h"
+#include "graphics/data/Mesh.h"
+#include "io/log/Logger.h"
+
+namespace {
+
+//! Lists up to this size are kept as a single cluster
+const size_t MAX_UNCLUSTERED_POLYS = 16;
+const size_t CLUSTER_SIZE = 8;
+//! Number of clusters in each group of the second level
+const size_t CLUSTER_GROUP_SIZE = 4;
+
+bool isCollisionPoly(const EERIEPOLY * ep) {
+	return !(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL));
+}
+
+void makeCollisionPoly(CollisionPoly & cp, EERIEPOLY * ep) {
+	
+	cp.min = ep->min;
+	cp.max = ep->max;
+	for(size_t i = 0; i < 4; i++) {
+		cp.v[i] = ep->v[i].p;
+	}
+	cp.center = ep->center;
+	
+	// Same operations as GetTruePolyY() so that the results are identical
+	Vec3f s21 = ep->v[1].p - ep->v[0].p;
+	Vec3f s31 = ep->v[2].p - ep->v[0].p;
+	cp.plane.y = (s21.z * s31.x) - (s21.x * s31.z);
+	cp.plane.x = (s21.y * s31.z) - (s21.z * s31.y);
+	cp.plane.z = (s21.x * s31.y) - (s21.y * s31.x);
+	cp.planeDist = ep->v[0].p.x * cp.plane.x + ep->v[0].p.y * cp.plane.y
+	               + ep->v[0].p.z * cp.plane.z;
+	
+	cp.normY = ep->norm.y;
+	cp.norm2Y = ep->norm2.y;
+	cp.area = ep->area;
+	cp.type = ep->type;
+	cp.ep = ep;
+}
+
+template <class Index>
+void addCluster(BackgroundCollision & data, u32 begin, u32 end, Index index) {
+	
+	CollisionCluster cluster;
+	cluster.begin = begin;
+	cluster.end = end;
+	cluster.skip = data.clusters.size() + 1;
+	
+	const CollisionPoly & cp = data.polys[index(data, begin)];
+	cluster.min = cp.min;
+	cluster.max = cp.max;
+	for(u32 i = begin + 1; i < end; i++) {
+		const CollisionPoly & other = data.polys[index(data, i)];
+		cluster.min = componentwise_min(cluster.min, other.min);
+		cluster.max = componentwise_max(cluster.max, other.max);
+	}
+	
+	data.clusters.push_back(cluster);
+}
+
+/*!
+ * Split the list [begin, end) into clusters.
+ * @param index maps list positions to polygons
+ */
+template <class Index>
+void addClusters(BackgroundCollision & data, u32 begin, u32 end, Index index) {
+	
+	if(end - begin <= MAX_UNCLUSTERED_POLYS) {
+		if(begin != end) {
+			addCluster(data, begin, end, index);
+		}
+		return;
+	}
+	
+	const size_t groupSize = CLUSTER_SIZE * CLUSTER_GROUP_SIZE;
+	
+	for(u32 first = begin; first < end; first += groupSize) {
+		
+		u32 last = std::min(u32(first + groupSize), end);
+		
+		// A single cluster doesn't need a group
+		size_t group = data.clusters.size();
+		if(last - first > CLUSTER_SIZE) {
+			data.clusters.resize(group + 1);
+		}
+		
+		for(u32 i = first; i < last; i += CLUSTER_SIZE) {
+			addCluster(data, i, std::min(u32(i + CLUSTER_SIZE), last), index);
+		}
+		
+		if(last - first > CLUSTER_SIZE) {
+			CollisionCluster & parent = data.clusters[group];
+			parent.begin = parent.end = first;
+			parent.skip = data.clusters.size();
+			parent.min = data.clusters[group + 1].min;
+			parent.max = data.clusters[group + 1].max;
+			for(size_t i = group + 2; i < data.clusters.size(); i++) {
+				parent.min = componentwise_min(parent.min, data.clusters[i].min);
+				parent.max = componentwise_max(parent.max, data.clusters[i].max);
+			}
+		}
+	}
+}
+
+u32 storedIndex(const BackgroundCollision & data, u32 i) {
+	ARX_UNUSED(data);
+	return i;
+}
+
+u32 overlappingIndex(const BackgroundCollision & data, u32 i) {
+	return data.overlapping[i];
+}
+
+} // anonymous namespace
+
+void BuildBackgroundCollision(EERIE_BACKGROUND * eb) {
+	
+	ReleaseBackgroundCollision(eb);
+	
+	BackgroundCollision * data = new BackgroundCollision;
+	data->width = eb->Xsize;
+	data->cells.resize(eb->Xsize * eb->Zsize);
+	
+	boost::unordered_map<const EERIEPOLY *, u32> indices;
+	
+	for(long z = 0; z < eb->Zsize; z++)
+	for(long x = 0; x < eb->Xsize; x++) {
+		
+		const FAST_BKG_DATA & feg = eb->fastdata[x][z];
+		
+		u32 begin = data->polys.size();
+		for(long k = 0; k < feg.nbpoly; k++) {
+			EERIEPOLY * ep = &feg.polydata[k];
+			if(isCollisionPoly(ep)) {
+				indices[ep] = data->polys.size();
+				data->polys.resize(data->polys.size() + 1);
+				makeCollisionPoly(data->polys.back(), ep);
+			}
+		}
+		
+		CollisionCell & cell = data->cells[x + z * eb->Xsize];
+		cell.clusterBegin = data->clusters.size();
+		addClusters(*data, begin, data->polys.size(), storedIndex);
+		cell.clusterEnd = data->clusters.size();
+	}
+	
+	for(long z = 0; z < eb->Zsize; z++)
+	for(long x = 0; x < eb->Xsize; x++) {
+		
+		const FAST_BKG_DATA & feg = eb->fastdata[x][z];
+		
+		u32 begin = data->overlapping.size();
+		for(long k = 0; k < feg.nbpolyin; k++) {
+			boost::unordered_map<const EERIEPOLY *, u32>::const_iterator it;
+			it = indices.find(feg.polyin[k]);
+			if(it != indices.end()) {
+				data->overlapping.push_back(it->second);
+			}
+		}
+		
+		CollisionCell & cell = data->cells[x + z * eb->Xsize];
+		cell.inClusterBegin = data->clusters.size();
+		addClusters(*data, begin, data->overlapping.size(), overlappingIndex);
+		cell.inClusterEnd = data->clusters.size();
+	}
+	
+	LogDebug("collision data: " << data->polys.size() << " polygons, "
+	         << data->overlapping.size() << " overlap entries, "
+	         << data->clusters.size() << " clusters");
+	
+	eb->collision = data;
+}
+
+void ReleaseBackgroundCollision(EERIE_BACKGROUND * eb) {
+	delete eb->collision, eb->collision = NULL;
+}
+
+int PointIn2DPolyXZ(const CollisionPoly & ep, float x, float z) {
+	
+	int i, j, c = 0, d = 0;
+	
+	for(i = 0, j = 2; i < 3; j = i++) {
+		if((((ep.v[i].z <= z) && (z < ep.v[j].z)) || ((ep.v[j].z <= z) && (z < ep.v[i].z)))
+		   && (x < (ep.v[j].x - ep.v[i].x) * (z - ep.v[i].z) / (ep.v[j].z - ep.v[i].z) + ep.v[i].x))
+			c = !c;
+	}
+	
+	if(ep.type & POLY_QUAD) {
+		for(i = 1, j = 3; i < 4; j = i++) {
+			if((((ep.v[i].z <= z) && (z < ep.v[j].z)) || ((ep.v[j].z <= z) && (z < ep.v[i].z)))
+			   && (x < (ep.v[j].x - ep.v[i].x) * (z - ep.v[i].z) / (ep.v[j].z - ep.v[i].z) + ep.v[i].x))
+				d = !d;
+		}
+	}
+	
+	return c + d;
+}
+
+bool GetTruePolyY(const CollisionPoly & ep, const Vec3f * pos, float * ret) {
+	
+	if(ep.plane.y == 0.f) {
+		return false;
+	}
+	
+	float y = (ep.planeDist - (ep.plane.x * pos->x) - (ep.plane.z * pos->z)) / ep.plane.y;
+	
+	*ret = clamp(y, ep.min.y, ep.max.y);
+	return true;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PHYSICS_BACKGROUNDCOLLISION_H
+#define ARX_PHYSICS_BACKGROUNDCOLLISION_H
+
+#include <algorithm>
+#include <vector>
+
+#include "graphics/GraphicsTypes.h"
+#include "math/Vector3.h"
+#include "platform/Platform.h"
+
+struct EERIE_BACKGROUND;
+
+/*!
+ * Collision-only copy of a solid background polygon.
+ *
+ * Holds the data used by collision queries, so that these don't need to touch the
+ * render-only parts of EERIEPOLY (tv, nrml, uslInd, ...).
+ */
+struct CollisionPoly {
+	
+	Vec3f min;
+	Vec3f max;
+	Vec3f v[4];
+	Vec3f center;
+	Vec3f plane; //!< unnormalized normal of the first triangle, see GetTruePolyY()
+	float planeDist; //!< dot(plane, v[0])
+	float normY; //!< EERIEPOLY::norm.y
+	float norm2Y; //!< EERIEPOLY::norm2.y
+	float area;
+	PolyType type;
+	EERIEPOLY * ep; //!< the full polygon
+	
+};
+
+/*!
+ * Run of consecutive polygons in a cell list with their combined bounds.
+ *
+ * Clusters never reorder polygons, so queries that pick the first of several equal
+ * results still return the same polygon.
+ *
+ * Long lists get a second level: a group cluster with an empty polygon range is
+ * stored directly before the clusters it contains, and its bounds cover all of them.
+ * Queries walk the clusters in order and jump to skip when the bounds are rejected.
+ */
+struct CollisionCluster {
+	Vec3f min;
+	Vec3f max;
+	u32 begin;
+	u32 end;
+	u32 skip; //!< Index of the first cluster after this one and the clusters it contains
+};
+
+struct CollisionCell {
+	
+	//! Clusters over the polygons stored in the cell (FAST_BKG_DATA::polydata)
+	u32 clusterBegin;
+	u32 clusterEnd;
+	
+	//! Clusters over the polygons overlapping the cell (FAST_BKG_DATA::polyin)
+	u32 inClusterBegin;
+	u32 inClusterEnd;
+	
+};
+
+/*!
+ * Compact per-cell collision data for a background.
+ *
+ * Only polygons that can be collided with (no water, transparent or no-collision
+ * polygons) are included.
+ */
+struct BackgroundCollision {
+	
+	//! Polygons stored in the cells, contiguous per cell
+	std::vector<CollisionPoly> polys;
+	
+	//! Polygons overlapping the cells, as indices into polys
+	std::vector<u32> overlapping;
+	
+	//! Clusters of the stored lists index polys, clusters of the overlapping lists index overlapping
+	std::vector<CollisionCluster> clusters;
+	
+	std::vector<CollisionCell> cells;
+	
+	long width;
+	
+	const CollisionCell & cell(long x, long z) const {
+		return cells[x + z * width];
+	}
+	
+	const CollisionPoly & overlappingPoly(u32 i) const {
+		return polys[overlapping[i]];
+	}
+	
+};
+
+//! Build the collision data for a background, after the polyin lists have been computed
+void BuildBackgroundCollision(EERIE_BACKGROUND * eb);
+
+void ReleaseBackgroundCollision(EERIE_BACKGROUND * eb);
+
+//! Squared horizontal distance from a point to the bounds of a cluster
+inline float distSqrXZ(const CollisionCluster & cluster, float x, float z) {
+	float dx = std::max(std::max(cluster.min.x - x, x - cluster.max.x), 0.f);
+	float dz = std::max(std::max(cluster.min.z - z, z - cluster.max.z), 0.f);
+	return dx * dx + dz * dz;
+}
+
+//! Same as the EERIEPOLY version
+int PointIn2DPolyXZ(const CollisionPoly & ep, float x, float z);
+
+//! Same as the EERIEPOLY version, using the precomputed plane
+bool GetTruePolyY(const CollisionPoly & ep, const Vec3f * pos, float * ret);
+
+#endif // ARX_PHYSICS_BACKGROUNDCOLLISION_H
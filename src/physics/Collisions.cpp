@@ -46,6 +46,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "physics/Collisions.h"
 
+#include <cmath>
+
 #include "core/GameTime.h"
 #include "core/Core.h"
 #include "game/Damage.h"
@@ -54,6 +56,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "game/Player.h"
 #include "graphics/Math.h"
 #include "physics/Anchors.h"
+#include "physics/BackgroundCollision.h"
+#include "physics/Raycast.h"
 #include "scene/Interactive.h"
 
 using std::min;
@@ -76,7 +80,7 @@ bool DIRECT_PATH=true;
 
 //-----------------------------------------------------------------------------
 // Added immediate return (return anything;)
-inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
+inline float IsPolyInCylinder(const CollisionPoly * ep, EERIE_CYLINDER * cyl, long flag) {
 
 	long flags = flag;
 	POLYIN = 0;
@@ -91,7 +95,7 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 	float nearest = 99999999.f;
 
 	for(long num = 0; num < to; num++) {
-		float dd = fdist(Vec2f(ep->v[num].p.x, ep->v[num].p.z), Vec2f(cyl->origin.x, cyl->origin.z));
+		float dd = fdist(Vec2f(ep->v[num].x, ep->v[num].z), Vec2f(cyl->origin.x, cyl->origin.z));
 
 		if(dd < nearest) {
 			nearest = dd;
@@ -118,7 +122,7 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 	if(PointInCylinder(cyl, &ep->center)) {
 		POLYIN = 1;
 		
-		if(ep->norm.y < 0.5f)
+		if(ep->normY < 0.5f)
 			anything = min(anything, ep->min.y);
 		else
 			anything = min(anything, ep->center.y);
@@ -137,7 +141,7 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 		if(flags & CFLAG_EXTRA_PRECISION) {
 			for(long o = 0; o < 5; o++) {
 				float p = (float)o * (1.f/5);
-				center = ep->v[n].p * p + ep->center * (1.f - p);
+				center = ep->v[n] * p + ep->center * (1.f - p);
 				if(PointInCylinder(cyl, &center)) {
 					anything = min(anything, center.y);
 					POLYIN = 1;
@@ -149,7 +153,7 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 		}
 
 		if(ep->area > 2000.f || (flags & CFLAG_EXTRA_PRECISION)) {
-			center = (ep->v[n].p + ep->v[r].p) * 0.5f;
+			center = (ep->v[n] + ep->v[r]) * 0.5f;
 			if(PointInCylinder(cyl, &center)) {
 				anything = min(anything, center.y);
 				POLYIN = 1;
@@ -159,7 +163,7 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 			}
 
 			if(ep->area > 4000.f || (flags & CFLAG_EXTRA_PRECISION)) {
-				center = (ep->v[n].p + ep->center) * 0.5f;
+				center = (ep->v[n] + ep->center) * 0.5f;
 				if(PointInCylinder(cyl, &center)) {
 					anything = min(anything, center.y);
 					POLYIN = 1;
@@ -170,7 +174,7 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 			}
 
 			if(ep->area > 6000.f || (flags & CFLAG_EXTRA_PRECISION)) {
-				center = (center + ep->v[n].p) * 0.5f;
+				center = (center + ep->v[n]) * 0.5f;
 				if(PointInCylinder(cyl, &center)) {
 					anything = min(anything, center.y);
 					POLYIN = 1;
@@ -181,9 +185,9 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 			}
 		}
 
-		if(PointInCylinder(cyl, &ep->v[n].p)) {
+		if(PointInCylinder(cyl, &ep->v[n])) {
 			
-			anything = min(anything, ep->v[n].p.y);
+			anything = min(anything, ep->v[n].y);
 			POLYIN = 1;
 
 			if(!(flags & CFLAG_EXTRA_PRECISION))
@@ -222,13 +226,13 @@ inline float IsPolyInCylinder(EERIEPOLY * ep, EERIE_CYLINDER * cyl, long flag) {
 		}
 	} 
 //}*/
-	if(anything != 999999.f && ep->norm.y < 0.1f && ep->norm.y > -0.1f)
+	if(anything != 999999.f && ep->normY < 0.1f && ep->normY > -0.1f)
 		anything = min(anything, ep->min.y);
 
 	return anything;
 }
 
-inline bool IsPolyInSphere(EERIEPOLY *ep, EERIE_SPHERE * sph) {
+inline bool IsPolyInSphere(const CollisionPoly * ep, EERIE_SPHERE * sph) {
 
 	if(!ep || !sph)
 		return false;
@@ -243,25 +247,25 @@ inline bool IsPolyInSphere(EERIEPOLY *ep, EERIE_SPHERE * sph) {
 
 	for(long n = 0; n < to; n++) {
 		if(ep->area > 2000.f) {
-			center = (ep->v[n].p + ep->v[r].p) * 0.5f;
+			center = (ep->v[n] + ep->v[r]) * 0.5f;
 			if(sph->contains(center)) {	
 				return true;
 			}
 			if(ep->area > 4000.f) {
-				center = (ep->v[n].p + ep->center) * 0.5f;
+				center = (ep->v[n] + ep->center) * 0.5f;
 				if(sph->contains(center)) {
 					return true;
 				}
 			}
 			if(ep->area > 6000.f) {
-				center = (center + ep->v[n].p) * 0.5f;
+				center = (center + ep->v[n]) * 0.5f;
 				if(sph->contains(center)) {
 					return true;
 				}
 			}
 		}
 		
-		Vec3f v(ep->v[n].p.x, ep->v[n].p.y, ep->v[n].p.z);
+		Vec3f v(ep->v[n].x, ep->v[n].y, ep->v[n].z);
 
 		if(sph->contains(v)) {
 			return true;
@@ -276,6 +280,17 @@ inline bool IsPolyInSphere(EERIEPOLY *ep, EERIE_SPHERE * sph) {
 	return false;
 }
 
+//! Conservative test if any point tested by IsPolyInSphere() can be in the sphere
+inline bool IsClusterInSphere(const CollisionCluster & cluster, const EERIE_SPHERE * sph) {
+	
+	// All tested points lie inside the cluster bounds
+	float slack = sph->radius + 1.f;
+	if(sph->origin.y < cluster.min.y - slack || sph->origin.y > cluster.max.y + slack)
+		return false;
+	
+	return distSqrXZ(cluster, sph->origin.x, sph->origin.z) <= slack * slack;
+}
+
 bool IsCollidingIO(Entity * io,Entity * ioo) {
 
 	if(ioo != NULL
@@ -509,6 +524,14 @@ float CheckAnythingInCylinder(EERIE_CYLINDER * cyl,Entity * ioo,long flags) {
 
 	float anything = 999999.f; 
 	
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision)
+		return 0.f;
+	
+	float minf = cyl->origin.y + cyl->height;
+	float maxf = cyl->origin.y;
+	float reach = max(82.f, cyl->radius);
+	
 	EERIEPOLY * ep;
 	
 	for(long j = pz - rad; j <= pz + rad; j++)
@@ -538,19 +561,27 @@ float CheckAnythingInCylinder(EERIE_CYLINDER * cyl,Entity * ioo,long flags) {
 			continue;
 
 
-		FAST_BKG_DATA * feg = &ACTIVEBKG->fastdata[i][j];
-		for(long k = 0; k < feg->nbpoly; k++) {
-			ep = &feg->polydata[k];
-
-			if(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
+		const CollisionCell & cell = collision->cell(i, j);
+		for(u32 c = cell.clusterBegin; c < cell.clusterEnd; ) {
+			const CollisionCluster & cluster = collision->clusters[c];
+			
+			if(cluster.min.y >= anything || minf > cluster.max.y || maxf < cluster.min.y
+			   || distSqrXZ(cluster, cyl->origin.x, cyl->origin.z) > reach * reach) {
+				c = cluster.skip;
 				continue;
-
-			if(ep->min.y < anything) {
-				anything= min(anything, IsPolyInCylinder(ep, cyl, flags));
-
-				if(POLYIN) {
-					if(ep->type & POLY_CLIMB)
-						COLLIDED_CLIMB_POLY = 1;
+			}
+			c++;
+			
+			for(u32 k = cluster.begin; k < cluster.end; k++) {
+				const CollisionPoly & cp = collision->polys[k];
+				
+				if(cp.min.y < anything) {
+					anything = min(anything, IsPolyInCylinder(&cp, cyl, flags));
+					
+					if(POLYIN) {
+						if(cp.type & POLY_CLIMB)
+							COLLIDED_CLIMB_POLY = 1;
+					}
 				}
 			}
 		}
@@ -1002,19 +1033,30 @@ EERIEPOLY * CheckBackgroundInSphere(EERIE_SPHERE * sphere) //except source...
 	long spz = std::max(pz - rad, 0L);
 	long epz = std::min(pz + rad, ACTIVEBKG->Zsize - 1L);
 
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!collision)
+		return NULL;
+	
 	for(long j = spz; j <= epz; j++)
 	for(long i = spx; i <= epx; i++) {
-		FAST_BKG_DATA * feg = &ACTIVEBKG->fastdata[i][j];
-
-		for(long k = 0; k < feg->nbpoly; k++) {
-			EERIEPOLY * ep = &feg->polydata[k];
-
-			if(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
+		const CollisionCell & cell = collision->cell(i, j);
+		
+		for(u32 c = cell.clusterBegin; c < cell.clusterEnd; ) {
+			const CollisionCluster & cluster = collision->clusters[c];
+			
+			if(!IsClusterInSphere(cluster, sphere)) {
+				c = cluster.skip;
 				continue;
-
-			if(IsPolyInSphere(ep, sphere)) {
-				return ep;					
-			}			
+			}
+			c++;
+			
+			for(u32 k = cluster.begin; k < cluster.end; k++) {
+				const CollisionPoly & cp = collision->polys[k];
+				
+				if(IsPolyInSphere(&cp, sphere)) {
+					return cp.ep;
+				}
+			}
 		}
 	}	
 	
@@ -1032,7 +1074,8 @@ bool CheckAnythingInSphere(EERIE_SPHERE * sphere, long source, CASFlags flags, l
 	long px = sphere->origin.x * ACTIVEBKG->Xmul;
 	long pz = sphere->origin.z * ACTIVEBKG->Zmul;
 
-	if(!(flags & CAS_NO_BACKGROUND_COL)) {
+	const BackgroundCollision * collision = ACTIVEBKG->collision;
+	if(!(flags & CAS_NO_BACKGROUND_COL) && collision) {
 		long spx = std::max(px - rad, 0L);
 		long epx = std::min(px + rad, ACTIVEBKG->Xsize - 1L);
 		long spz = std::max(pz - rad, 0L);
@@ -1040,16 +1083,21 @@ bool CheckAnythingInSphere(EERIE_SPHERE * sphere, long source, CASFlags flags, l
 
 		for(long j = spz; j <= epz; j++)
 		for(long i = spx; i <= epx; i++) {
-			FAST_BKG_DATA *feg = &ACTIVEBKG->fastdata[i][j];
-
-			for(long k = 0; k < feg->nbpoly; k++) {
-				EERIEPOLY *ep = &feg->polydata[k];
-
-				if(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL))
+			const CollisionCell & cell = collision->cell(i, j);
+			
+			for(u32 c = cell.clusterBegin; c < cell.clusterEnd; ) {
+				const CollisionCluster & cluster = collision->clusters[c];
+				
+				if(!IsClusterInSphere(cluster, sphere)) {
+					c = cluster.skip;
 					continue;
-
-				if(IsPolyInSphere(ep,sphere))
-					return true;
+				}
+				c++;
+				
+				for(u32 k = cluster.begin; k < cluster.end; k++) {
+					if(IsPolyInSphere(&collision->polys[k], sphere))
+						return true;
+				}
 			}
 		}	
 	}
@@ -1579,138 +1627,60 @@ bool ARX_COLLISION_Move_Cylinder(IO_PHYSICS * ip, Entity * io, float MOVE_CYLIND
 	return true;
 }
 
-//TODO copy-paste
-bool IO_Visible(Vec3f * orgn, Vec3f * dest, EERIEPOLY * epp, Vec3f * hit)
-{
-	float ix,iy,iz;
-	long px,pz;
-	EERIEPOLY *ep;
-
-	FAST_BKG_DATA *feg;
-	float pas = 35.f;
- 
-	Vec3f found_hit = Vec3f::ZERO;
-	EERIEPOLY *found_ep = NULL;
-	float iter,t;
-
-	//current ray pos
-	float x = orgn->x;
-	float y = orgn->y;
-	float z = orgn->z;
-
-	float distance;
-	float nearest = distance = fdist(*orgn, *dest);
-
-	if(distance < pas)
-		pas = distance * .5f;
-
-	// ray incs
-	float dx = (dest->x - orgn->x);
-	float dy = (dest->y - orgn->y);
-	float dz = (dest->z - orgn->z);
-
-	// absolute ray incs
-	float adx = EEfabs(dx);
-	float ady = EEfabs(dy);
-	float adz = EEfabs(dz);
-
-	if(adx >= ady && adx >= adz) {
-		if(adx != dx)
-			ix = -pas;
-		else
-			ix = pas;
-
-		iter = adx / pas;
-		t = 1.f / (iter);
-		iy = dy * t;
-		iz = dz * t;
-	} else if(ady >= adx && ady >= adz) {
-		if(ady != dy)
-			iy = -pas;
-		else
-			iy = pas;
-
-		iter = ady / pas;
-		t = 1.f / (iter);
-		ix = dx * t;
-		iz = dz * t;
-	} else {
-		if(adz != dz)
-			iz = -pas;
-		else
-			iz = pas;
-
-		iter = adz / pas;
-		t = 1.f / (iter);
-		ix = dx * t;
-		iy = dy * t;
+/*!
+ * Check entities flagged as view blockers along the segment, in 35 unit steps.
+ * Only blockers closer than nearest to the origin are reported.
+ */
+static bool IsViewBlockedByEntity(const Vec3f & orgn, const Vec3f & dest, float nearest,
+                                  Vec3f * hit) {
+	
+	std::vector<long> blockers;
+	for(size_t num = 0; num < entities.size(); num++) {
+		Entity * io = entities[num];
+		if(io && (io->gameFlags & GFLAG_VIEW_BLOCKER)) {
+			blockers.push_back(num);
+		}
 	}
-
-	float dd;
-	x -= ix;
-	y -= iy;
-	z -= iz;
-
-	while(iter > 0.f) {
-		iter -= 1.f;
-		x += ix;
-		y += iy;
-		z += iz;
-
+	
+	if(blockers.empty()) {
+		return false;
+	}
+	
+	float distance = fdist(orgn, dest);
+	float pas = (distance < 35.f) ? distance * .5f : 35.f;
+	long steps = (pas > 0.f) ? long(std::ceil(distance / pas)) : 0;
+	
+	for(long i = 0; i < steps; i++) {
+		
 		EERIE_SPHERE sphere;
-		sphere.origin.x=x;
-		sphere.origin.y=y;
-		sphere.origin.z=z;
-		sphere.radius=65.f;
-
-		for(size_t num = 0; num < entities.size(); num++) {
-			Entity * io = entities[num];
-
-			if(io && (io->gameFlags & GFLAG_VIEW_BLOCKER)) {
-				if(CheckIOInSphere(&sphere, num)) {
-					dd = fdist(*orgn, sphere.origin);
-
-					if(dd < nearest) {
-						hit->x=x;
-						hit->y=y;
-						hit->z=z;
-						return false;
-					}
-				}
-			}
+		sphere.origin = orgn + (dest - orgn) * (float(i) * pas / distance);
+		sphere.radius = 65.f;
+		
+		if(fdist(orgn, sphere.origin) >= nearest) {
+			break;
 		}
-
-		px = (long)(x * ACTIVEBKG->Xmul);
-		pz = (long)(z * ACTIVEBKG->Zmul);
-
-		if(px < 0 || px >= ACTIVEBKG->Xsize || pz < 0 || pz >= ACTIVEBKG->Zsize)
-			goto fini;
-
-			feg = &ACTIVEBKG->fastdata[px][pz];
-
-			for(long k = 0; k < feg->nbpolyin; k++) {
-				ep = feg->polyin[k];
-
-				if(!(ep->type & (POLY_WATER | POLY_TRANS | POLY_NOCOL)))
-				if((ep->min.y - pas < y) && (ep->max.y + pas > y))
-				if((ep->min.x - pas < x) && (ep->max.x + pas > x))
-				if((ep->min.z - pas < z) && (ep->max.z + pas > z))
-				{
-					if(RayCollidingPoly(orgn, dest, ep, hit)) {
-						dd = fdist(*orgn, *hit);
-						if(dd < nearest) {
-							nearest = dd;
-							found_ep = ep;
-							found_hit = *hit;
-						}
-					}
-				}
+		
+		for(size_t k = 0; k < blockers.size(); k++) {
+			if(CheckIOInSphere(&sphere, blockers[k])) {
+				*hit = sphere.origin;
+				return true;
 			}
-			
 		}
-		
-fini:
-	;
+	}
+	
+	return false;
+}
+
+bool IO_Visible(Vec3f * orgn, Vec3f * dest, EERIEPOLY * epp, Vec3f * hit)
+{
+	Vec3f found_hit;
+	EERIEPOLY * found_ep = RaycastBackground(*orgn, *dest,
+	                                         POLY_WATER | POLY_TRANS | POLY_NOCOL, &found_hit);
+	
+	float nearest = found_ep ? fdist(*orgn, found_hit) : fdist(*orgn, *dest);
+	if(IsViewBlockedByEntity(*orgn, *dest, nearest, hit)) {
+		return false;
+	}
 	
 	if(!found_ep)
 		return true;
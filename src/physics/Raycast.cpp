@@ -0,0 +1,399 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "physics/Raycast.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARX_RAYCAST_SSE2
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+#include "graphics/data/Mesh.h"
+
+//! Triangles of several polygons, stored as structure of arrays for the SIMD kernels
+struct TriangleBatch {
+	
+	enum { Capacity = 32 };
+	
+	float v0x[Capacity], v0y[Capacity], v0z[Capacity];
+	float e1x[Capacity], e1y[Capacity], e1z[Capacity];
+	float e2x[Capacity], e2y[Capacity], e2z[Capacity];
+	EERIEPOLY * poly[Capacity];
+	size_t count;
+	
+	TriangleBatch() : count(0) { }
+	
+	bool full() const { return count == Capacity; }
+	
+	void add(EERIEPOLY * ep, const Vec3f & a, const Vec3f & b, const Vec3f & c) {
+		v0x[count] = a.x, v0y[count] = a.y, v0z[count] = a.z;
+		e1x[count] = b.x - a.x, e1y[count] = b.y - a.y, e1z[count] = b.z - a.z;
+		e2x[count] = c.x - a.x, e2y[count] = c.y - a.y, e2z[count] = c.z - a.z;
+		poly[count] = ep;
+		count++;
+	}
+	
+	//! Fill the last group of four with degenerate triangles, which never hit
+	void pad() {
+		for(size_t i = count; i % 4 != 0; i++) {
+			v0x[i] = v0y[i] = v0z[i] = 0.f;
+			e1x[i] = e1y[i] = e1z[i] = 0.f;
+			e2x[i] = e2y[i] = e2z[i] = 0.f;
+			poly[i] = NULL;
+		}
+	}
+	
+};
+
+namespace {
+
+/*
+ * Möller-Trumbore ray/triangle intersection without backface culling.
+ * Each kernel writes the segment parameter of the hit for every triangle,
+ * or a value larger than 1 if the triangle is missed.
+ */
+
+const float RAYCAST_MISS = 2.f;
+
+#if defined(ARX_RAYCAST_SSE2)
+
+void intersectTrianglesSSE2(const TriangleBatch & b, const Vec3f & o, const Vec3f & d,
+                            float * out) {
+	
+	const __m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+	const __m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 miss = _mm_set1_ps(RAYCAST_MISS);
+	
+	for(size_t i = 0; i < b.count; i += 4) {
+		
+		__m128 e1x = _mm_loadu_ps(b.e1x + i), e1y = _mm_loadu_ps(b.e1y + i);
+		__m128 e1z = _mm_loadu_ps(b.e1z + i);
+		__m128 e2x = _mm_loadu_ps(b.e2x + i), e2y = _mm_loadu_ps(b.e2y + i);
+		__m128 e2z = _mm_loadu_ps(b.e2z + i);
+		
+		// pvec = cross(d, e2)
+		__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+		__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+		__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+		
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)),
+		                        _mm_mul_ps(e1z, pz));
+		__m128 valid = _mm_cmpneq_ps(det, zero);
+		__m128 inv = _mm_div_ps(one, det);
+		
+		__m128 tx = _mm_sub_ps(ox, _mm_loadu_ps(b.v0x + i));
+		__m128 ty = _mm_sub_ps(oy, _mm_loadu_ps(b.v0y + i));
+		__m128 tz = _mm_sub_ps(oz, _mm_loadu_ps(b.v0z + i));
+		
+		__m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)),
+		                      _mm_mul_ps(tz, pz));
+		u = _mm_mul_ps(u, inv);
+		
+		// qvec = cross(tvec, e1)
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+		__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+		
+		__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+		                      _mm_mul_ps(dz, qz));
+		v = _mm_mul_ps(v, inv);
+		
+		__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+		                      _mm_mul_ps(e2z, qz));
+		t = _mm_mul_ps(t, inv);
+		
+		valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+		valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+		valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+		valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+		valid = _mm_and_ps(valid, _mm_cmple_ps(t, one));
+		
+		_mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, miss)));
+	}
+}
+
+#endif // defined(ARX_RAYCAST_SSE2)
+
+#ifdef __ARM_NEON__
+
+void intersectTrianglesNEON(const TriangleBatch & b, const Vec3f & o, const Vec3f & d,
+                            float * out) {
+	
+	const float32x4_t zero = vdupq_n_f32(0.f);
+	const float32x4_t one = vdupq_n_f32(1.f);
+	const float32x4_t miss = vdupq_n_f32(RAYCAST_MISS);
+	
+	for(size_t i = 0; i < b.count; i += 4) {
+		
+		float32x4_t e1x = vld1q_f32(b.e1x + i), e1y = vld1q_f32(b.e1y + i);
+		float32x4_t e1z = vld1q_f32(b.e1z + i);
+		float32x4_t e2x = vld1q_f32(b.e2x + i), e2y = vld1q_f32(b.e2y + i);
+		float32x4_t e2z = vld1q_f32(b.e2z + i);
+		
+		// pvec = cross(d, e2)
+		float32x4_t px = vmlsq_n_f32(vmulq_n_f32(e2z, d.y), e2y, d.z);
+		float32x4_t py = vmlsq_n_f32(vmulq_n_f32(e2x, d.z), e2z, d.x);
+		float32x4_t pz = vmlsq_n_f32(vmulq_n_f32(e2y, d.x), e2x, d.y);
+		
+		float32x4_t det = vmlaq_f32(vmlaq_f32(vmulq_f32(e1x, px), e1y, py), e1z, pz);
+		uint32x4_t valid = vmvnq_u32(vceqq_f32(det, zero));
+		
+		// No vector divide before ARMv8: refine the reciprocal estimate
+		float32x4_t inv = vrecpeq_f32(det);
+		inv = vmulq_f32(inv, vrecpsq_f32(det, inv));
+		inv = vmulq_f32(inv, vrecpsq_f32(det, inv));
+		
+		float32x4_t tx = vsubq_f32(vdupq_n_f32(o.x), vld1q_f32(b.v0x + i));
+		float32x4_t ty = vsubq_f32(vdupq_n_f32(o.y), vld1q_f32(b.v0y + i));
+		float32x4_t tz = vsubq_f32(vdupq_n_f32(o.z), vld1q_f32(b.v0z + i));
+		
+		float32x4_t u = vmlaq_f32(vmlaq_f32(vmulq_f32(tx, px), ty, py), tz, pz);
+		u = vmulq_f32(u, inv);
+		
+		// qvec = cross(tvec, e1)
+		float32x4_t qx = vmlsq_f32(vmulq_f32(ty, e1z), tz, e1y);
+		float32x4_t qy = vmlsq_f32(vmulq_f32(tz, e1x), tx, e1z);
+		float32x4_t qz = vmlsq_f32(vmulq_f32(tx, e1y), ty, e1x);
+		
+		float32x4_t v = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(qx, d.x), qy, d.y), qz, d.z);
+		v = vmulq_f32(v, inv);
+		
+		float32x4_t t = vmlaq_f32(vmlaq_f32(vmulq_f32(e2x, qx), e2y, qy), e2z, qz);
+		t = vmulq_f32(t, inv);
+		
+		valid = vandq_u32(valid, vcgeq_f32(u, zero));
+		valid = vandq_u32(valid, vcgeq_f32(v, zero));
+		valid = vandq_u32(valid, vcleq_f32(vaddq_f32(u, v), one));
+		valid = vandq_u32(valid, vcgeq_f32(t, zero));
+		valid = vandq_u32(valid, vcleq_f32(t, one));
+		
+		vst1q_f32(out + i, vbslq_f32(valid, t, miss));
+	}
+}
+
+#endif // defined(__ARM_NEON__)
+
+#if !defined(ARX_RAYCAST_SSE2) && !defined(__ARM_NEON__)
+
+void intersectTrianglesScalar(const TriangleBatch & b, const Vec3f & o, const Vec3f & d,
+                              float * out) {
+	
+	for(size_t i = 0; i < b.count; i++) {
+		
+		Vec3f e1(b.e1x[i], b.e1y[i], b.e1z[i]);
+		Vec3f e2(b.e2x[i], b.e2y[i], b.e2z[i]);
+		
+		out[i] = RAYCAST_MISS;
+		
+		Vec3f p = cross(d, e2);
+		float det = dot(e1, p);
+		if(det == 0.f) {
+			continue;
+		}
+		float inv = 1.f / det;
+		
+		Vec3f tvec = o - Vec3f(b.v0x[i], b.v0y[i], b.v0z[i]);
+		float u = dot(tvec, p) * inv;
+		Vec3f q = cross(tvec, e1);
+		float v = dot(d, q) * inv;
+		float t = dot(e2, q) * inv;
+		
+		if(u >= 0.f && v >= 0.f && u + v <= 1.f && t >= 0.f && t <= 1.f) {
+			out[i] = t;
+		}
+	}
+}
+
+#endif // !defined(ARX_RAYCAST_SSE2) && !defined(__ARM_NEON__)
+
+} // anonymous namespace
+
+BackgroundRaycast::BackgroundRaycast(const Vec3f & orgn, const Vec3f & dest, PolyType ignored)
+	: m_orgn(orgn), m_dir(dest - orgn), m_ignored(ignored), m_x(0), m_z(0),
+	  m_stepX(0), m_stepZ(0), m_enter(0.f), m_exit(0.f), m_started(false), m_outside(false),
+	  m_hitPoly(NULL), m_hitT(RAYCAST_MISS) {
+	
+	std::memset(m_mailbox, 0, sizeof(m_mailbox));
+	
+	const float inf = std::numeric_limits<float>::infinity();
+	m_nextX = m_nextZ = m_deltaX = m_deltaZ = inf;
+	
+	if(!ACTIVEBKG) {
+		m_outside = true;
+		return;
+	}
+	
+	m_x = long(std::floor(orgn.x * ACTIVEBKG->Xmul));
+	m_z = long(std::floor(orgn.z * ACTIVEBKG->Zmul));
+	
+	const float sizeX = float(ACTIVEBKG->Xdiv);
+	const float sizeZ = float(ACTIVEBKG->Zdiv);
+	
+	if(m_dir.x > 0.f) {
+		m_stepX = 1;
+		m_nextX = (float(m_x + 1) * sizeX - orgn.x) / m_dir.x;
+		m_deltaX = sizeX / m_dir.x;
+	} else if(m_dir.x < 0.f) {
+		m_stepX = -1;
+		m_nextX = (float(m_x) * sizeX - orgn.x) / m_dir.x;
+		m_deltaX = -sizeX / m_dir.x;
+	}
+	
+	if(m_dir.z > 0.f) {
+		m_stepZ = 1;
+		m_nextZ = (float(m_z + 1) * sizeZ - orgn.z) / m_dir.z;
+		m_deltaZ = sizeZ / m_dir.z;
+	} else if(m_dir.z < 0.f) {
+		m_stepZ = -1;
+		m_nextZ = (float(m_z) * sizeZ - orgn.z) / m_dir.z;
+		m_deltaZ = -sizeZ / m_dir.z;
+	}
+}
+
+bool BackgroundRaycast::nextCell() {
+	
+	if(m_outside) {
+		return false;
+	}
+	
+	if(!m_started) {
+		m_started = true;
+	} else if(m_exit >= 1.f) {
+		return false;
+	} else if(m_nextX < m_nextZ) {
+		m_x += m_stepX;
+		m_enter = m_nextX;
+		m_nextX += m_deltaX;
+	} else {
+		m_z += m_stepZ;
+		m_enter = m_nextZ;
+		m_nextZ += m_deltaZ;
+	}
+	
+	m_exit = std::min(std::min(m_nextX, m_nextZ), 1.f);
+	
+	if(m_x < 0 || m_x >= ACTIVEBKG->Xsize || m_z < 0 || m_z >= ACTIVEBKG->Zsize) {
+		m_outside = true;
+		return false;
+	}
+	
+	return true;
+}
+
+EERIE_BKG_INFO * BackgroundRaycast::cell() const {
+	return &ACTIVEBKG->Backg[m_x + m_z * ACTIVEBKG->Xsize];
+}
+
+bool BackgroundRaycast::wasTested(EERIEPOLY * ep) {
+	
+	// Polygons are allocated in per-cell arrays, so neighbours map to different slots
+	size_t slot = (size_t(ep) / sizeof(EERIEPOLY)) % MailboxSize;
+	if(m_mailbox[slot] == ep) {
+		return true;
+	}
+	
+	m_mailbox[slot] = ep;
+	return false;
+}
+
+bool BackgroundRaycast::testCell() {
+	
+	EERIE_BKG_INFO * eg = cell();
+	
+	TriangleBatch batch;
+	
+	for(long k = 0; k < eg->nbpolyin; k++) {
+		
+		EERIEPOLY * ep = eg->polyin[k];
+		if(!ep || (ep->type & m_ignored) || wasTested(ep)) {
+			continue;
+		}
+		
+		if(batch.count + 2 > TriangleBatch::Capacity) {
+			intersect(batch);
+		}
+		
+		batch.add(ep, ep->v[0].p, ep->v[1].p, ep->v[2].p);
+		if(ep->type & POLY_QUAD) {
+			batch.add(ep, ep->v[1].p, ep->v[2].p, ep->v[3].p);
+		}
+	}
+	
+	intersect(batch);
+	
+	return m_hitPoly && m_hitT <= m_exit;
+}
+
+void BackgroundRaycast::intersect(TriangleBatch & batch) {
+	
+	if(batch.count == 0) {
+		return;
+	}
+	
+	batch.pad();
+	
+	float t[TriangleBatch::Capacity];
+#if defined(ARX_RAYCAST_SSE2)
+	intersectTrianglesSSE2(batch, m_orgn, m_dir, t);
+#elif defined(__ARM_NEON__)
+	intersectTrianglesNEON(batch, m_orgn, m_dir, t);
+#else
+	intersectTrianglesScalar(batch, m_orgn, m_dir, t);
+#endif
+	
+	// Strict comparison: on ties the polygon listed first wins
+	for(size_t i = 0; i < batch.count; i++) {
+		if(t[i] < m_hitT) {
+			m_hitT = t[i];
+			m_hitPoly = batch.poly[i];
+		}
+	}
+	
+	batch.count = 0;
+}
+
+EERIEPOLY * RaycastBackground(const Vec3f & orgn, const Vec3f & dest, PolyType ignored,
+                              Vec3f * hit) {
+	
+	BackgroundRaycast ray(orgn, dest, ignored);
+	
+	while(ray.nextCell()) {
+		if(ray.testCell()) {
+			break;
+		}
+	}
+	
+	if(ray.hitPoly() && hit) {
+		*hit = ray.hitPosition();
+	}
+	
+	return ray.hitPoly();
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PHYSICS_RAYCAST_H
+#define ARX_PHYSICS_RAYCAST_H
+
+#include <stddef.h>
+
+#include "graphics/GraphicsTypes.h"
+#include "math/Vector3.h"
+
+struct EERIE_BKG_INFO;
+struct TriangleBatch;
+
+/*!
+ * Segment cast against the background polygons.
+ *
+ * The segment is walked through the background grid with an Amanatides-Woo
+ * traversal, visiting every cell it crosses exactly once and in order. Polygons
+ * that are listed in several cells are only tested once per ray (mailboxing),
+ * and the remaining triangles are intersected four at a time.
+ *
+ * Usage:
+ * \code
+ * BackgroundRaycast ray(orgn, dest, POLY_TRANS);
+ * while(ray.nextCell()) {
+ *   if(ray.testCell()) {
+ *     // ray.hitPoly() is the first polygon along the segment
+ *   }
+ * }
+ * \endcode
+ */
+class BackgroundRaycast {
+	
+public:
+	
+	/*!
+	 * @param ignored Polygons with any of these types are never reported.
+	 */
+	BackgroundRaycast(const Vec3f & orgn, const Vec3f & dest, PolyType ignored = 0);
+	
+	/*!
+	 * Advance to the next cell crossed by the segment.
+	 * @return false once the segment ends or leaves the background.
+	 */
+	bool nextCell();
+	
+	//! Did the segment leave the background before reaching its end
+	bool leftBackground() const { return m_outside; }
+	
+	//! The current cell
+	EERIE_BKG_INFO * cell() const;
+	
+	//! Segment parameter where the segment enters the current cell
+	float enter() const { return m_enter; }
+	
+	//! Segment parameter where the segment leaves the current cell
+	float exit() const { return m_exit; }
+	
+	//! Position for a segment parameter in [0, 1]
+	Vec3f point(float t) const { return m_orgn + m_dir * t; }
+	
+	/*!
+	 * Test the polygons of the current cell that were not tested yet.
+	 * @return true if the nearest hit is known, i.e. it lies before the end of
+	 *         the current cell.
+	 */
+	bool testCell();
+	
+	//! Nearest polygon hit so far or NULL
+	EERIEPOLY * hitPoly() const { return m_hitPoly; }
+	
+	//! Segment parameter of the nearest hit so far
+	float hitDistance() const { return m_hitT; }
+	
+	Vec3f hitPosition() const { return point(m_hitT); }
+	
+private:
+	
+	enum { MailboxSize = 128 };
+	
+	bool wasTested(EERIEPOLY * ep);
+	void intersect(TriangleBatch & batch);
+	
+	Vec3f m_orgn;
+	Vec3f m_dir;
+	PolyType m_ignored;
+	
+	long m_x, m_z;
+	long m_stepX, m_stepZ;
+	float m_nextX, m_nextZ; //!< segment parameter of the next cell boundary
+	float m_deltaX, m_deltaZ; //!< segment parameter covered by one cell
+	float m_enter, m_exit;
+	bool m_started;
+	bool m_outside;
+	
+	EERIEPOLY * m_hitPoly;
+	float m_hitT;
+	
+	EERIEPOLY * m_mailbox[MailboxSize];
+	
+};
+
+/*!
+ * Find the first background polygon crossed by the segment from orgn to dest.
+ * Only the part of the segment inside the background is considered.
+ * @return the polygon or NULL if the segment is unobstructed.
+ */
+EERIEPOLY * RaycastBackground(const Vec3f & orgn, const Vec3f & dest, PolyType ignored,
+                              Vec3f * hit);
+
+#endif // ARX_PHYSICS_RAYCAST_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PLATFORM_ATOMIC_H
+#define ARX_PLATFORM_ATOMIC_H
+
+#include <stddef.h>
+
+#include "platform/Platform.h"
+
+#if ARX_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+/*!
+ * Minimal set of atomic operations on machine words.
+ * All operations act as full memory barriers.
+ */
+namespace atomic {
+
+#if ARX_COMPILER_MSVC
+
+inline void barrier() {
+	// Interlocked operations are full barriers for both the compiler and the CPU
+	volatile long dummy = 0;
+	_InterlockedOr(&dummy, 0);
+}
+
+inline bool compareExchange(volatile size_t & value, size_t expected, size_t desired) {
+#ifdef _WIN64
+	return size_t(_InterlockedCompareExchange64((volatile __int64 *)&value, __int64(desired),
+	                                            __int64(expected))) == expected;
+#else
+	return size_t(_InterlockedCompareExchange((volatile long *)&value, long(desired),
+	                                          long(expected))) == expected;
+#endif
+}
+
+inline size_t add(volatile size_t & value, size_t n) {
+#ifdef _WIN64
+	return size_t(_InterlockedExchangeAdd64((volatile __int64 *)&value, __int64(n))) + n;
+#else
+	return size_t(_InterlockedExchangeAdd((volatile long *)&value, long(n))) + n;
+#endif
+}
+
+#else
+
+inline void barrier() {
+	__sync_synchronize();
+}
+
+inline bool compareExchange(volatile size_t & value, size_t expected, size_t desired) {
+	return __sync_bool_compare_and_swap(&value, expected, desired);
+}
+
+inline size_t add(volatile size_t & value, size_t n) {
+	return __sync_add_and_fetch(&value, n);
+}
+
+#endif
+
+//! Read a value written by another thread.
+inline size_t load(const volatile size_t & value) {
+	size_t result = value;
+	barrier();
+	return result;
+}
+
+//! Publish a value to other threads after all previous writes.
+inline void store(volatile size_t & value, size_t n) {
+	barrier();
+	value = n;
+	barrier();
+}
+
+} // namespace atomic
+
+#endif // ARX_PLATFORM_ATOMIC_H
@@ -0,0 +1,472 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform/JobSystem.h"
+
+#include <deque>
+
+#include "io/log/Logger.h"
+#include "platform/Lock.h"
+#include "platform/Platform.h"
+#include "platform/Profiler.h"
+#include "platform/Thread.h"
+
+namespace jobs {
+
+namespace {
+
+//! Maximum number of worker threads
+const unsigned MAX_WORKERS = 31;
+
+/*!
+ * Fixed-size work-stealing deque (Chase-Lev).
+ * Only the owning thread may push() and pop(), any thread may steal().
+ */
+class JobDeque {
+	
+	static const size_t Capacity = 1024;
+	
+	Job * volatile m_jobs[Capacity];
+	
+	volatile size_t m_top; //!< Next job to steal
+	char m_padding[64];
+	volatile size_t m_bottom; //!< Next free slot
+	
+public:
+	
+	JobDeque() : m_top(0), m_bottom(0) { }
+	
+	//! \return false if the deque is full
+	bool push(Job * job) {
+		
+		size_t bottom = m_bottom;
+		if(bottom - atomic::load(m_top) >= Capacity) {
+			return false;
+		}
+		
+		m_jobs[bottom % Capacity] = job;
+		atomic::store(m_bottom, bottom + 1);
+		
+		return true;
+	}
+	
+	//! Take the most recently pushed job
+	Job * pop() {
+		
+		size_t bottom = m_bottom - 1;
+		atomic::store(m_bottom, bottom);
+		size_t top = atomic::load(m_top);
+		
+		if(ptrdiff_t(bottom - top) < 0) {
+			// Empty
+			atomic::store(m_bottom, top);
+			return NULL;
+		}
+		
+		Job * job = m_jobs[bottom % Capacity];
+		if(bottom != top) {
+			return job;
+		}
+		
+		// Last job - race against thieves for it
+		if(!atomic::compareExchange(m_top, top, top + 1)) {
+			job = NULL;
+		}
+		atomic::store(m_bottom, top + 1);
+		
+		return job;
+	}
+	
+	//! Take the oldest job, may spuriously fail if there is contention
+	Job * steal() {
+		
+		size_t top = atomic::load(m_top);
+		size_t bottom = atomic::load(m_bottom);
+		if(ptrdiff_t(bottom - top) <= 0) {
+			return NULL;
+		}
+		
+		Job * job = m_jobs[top % Capacity];
+		if(!atomic::compareExchange(m_top, top, top + 1)) {
+			return NULL;
+		}
+		
+		return job;
+	}
+	
+	bool isEmpty() const {
+		size_t top = atomic::load(m_top);
+		return ptrdiff_t(atomic::load(m_bottom) - top) <= 0;
+	}
+	
+};
+
+class Worker : public Thread {
+	
+	size_t m_index;
+	
+public:
+	
+	explicit Worker(size_t index) : m_index(index) { }
+	
+protected:
+	
+	void run();
+	
+};
+
+//! Deques of the threads in the pool, the first one belongs to the thread that called init()
+std::vector<JobDeque *> g_deques;
+std::vector<Worker *> g_workers;
+
+//! Jobs submitted from outside the pool or that did not fit into a deque
+std::deque<Job *> g_injected;
+volatile size_t g_injectedCount = 0;
+
+//! Jobs submitted with submitBackground(), only run by idle worker threads
+std::deque<Job *> g_background;
+volatile size_t g_backgroundCount = 0;
+
+//! Protects both g_injected and g_background
+Lock g_injectedLock;
+
+//! Protects the waiting lists of all counters and their transition to zero
+Lock g_counterLock;
+
+Semaphore g_wakeup;
+volatile size_t g_sleeping = 0;
+volatile size_t g_stop = 0;
+
+//! Index of the deque owned by the current thread plus one, 0 for threads outside the pool
+ARX_THREAD_LOCAL size_t g_currentDeque = 0;
+
+} // anonymous namespace
+
+struct Scheduler {
+	
+	static void push(Job & job);
+	
+	//! \param background Also consider background jobs, for idle worker threads only.
+	static Job * find(bool background);
+	
+	static bool hasWork();
+	
+	static void execute(Job & job);
+	
+	static void finish(Counter & counter);
+	
+	static void submit(Job & job, Counter * counter);
+	
+	static void submitAfter(Counter & dependency, Job & job, Counter * counter);
+	
+	static void submitBackground(Job & job, Counter * counter);
+	
+	static void wait(Counter & counter);
+	
+};
+
+void Scheduler::push(Job & job) {
+	
+	if(g_deques.empty()) {
+		execute(job);
+		return;
+	}
+	
+	size_t self = g_currentDeque;
+	if(!self || !g_deques[self - 1]->push(&job)) {
+		Autolock lock(g_injectedLock);
+		g_injected.push_back(&job);
+		atomic::add(g_injectedCount, 1);
+	}
+	
+	if(atomic::load(g_sleeping) != 0) {
+		g_wakeup.post();
+	}
+}
+
+Job * Scheduler::find(bool background) {
+	
+	size_t self = g_currentDeque;
+	if(self) {
+		if(Job * job = g_deques[self - 1]->pop()) {
+			return job;
+		}
+	}
+	
+	if(atomic::load(g_injectedCount) != 0) {
+		Autolock lock(g_injectedLock);
+		if(!g_injected.empty()) {
+			Job * job = g_injected.front();
+			g_injected.pop_front();
+			atomic::add(g_injectedCount, size_t(-1));
+			return job;
+		}
+	}
+	
+	// Start with the next deque so that thieves don't all go after the same victim
+	size_t count = g_deques.size();
+	for(size_t i = 0; i < count; i++) {
+		size_t victim = (self + i) % count;
+		if(victim + 1 == self) {
+			continue;
+		}
+		if(Job * job = g_deques[victim]->steal()) {
+			return job;
+		}
+	}
+	
+	if(background && atomic::load(g_backgroundCount) != 0) {
+		Autolock lock(g_injectedLock);
+		if(!g_background.empty()) {
+			Job * job = g_background.front();
+			g_background.pop_front();
+			atomic::add(g_backgroundCount, size_t(-1));
+			return job;
+		}
+	}
+	
+	return NULL;
+}
+
+bool Scheduler::hasWork() {
+	
+	if(atomic::load(g_injectedCount) != 0 || atomic::load(g_backgroundCount) != 0) {
+		return true;
+	}
+	
+	for(size_t i = 0; i < g_deques.size(); i++) {
+		if(!g_deques[i]->isEmpty()) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+void Scheduler::execute(Job & job) {
+	
+	Counter * counter = job.m_counter;
+	
+	job.run();
+	
+	if(counter) {
+		finish(*counter);
+	}
+}
+
+void Scheduler::finish(Counter & counter) {
+	
+	Job * released = NULL;
+	{
+		Autolock lock(g_counterLock);
+		if(atomic::add(counter.m_count, size_t(-1)) == 0) {
+			released = counter.m_waiting;
+			counter.m_waiting = NULL;
+		}
+	}
+	
+	// The counter may already be destroyed here
+	
+	while(released) {
+		Job * job = released;
+		released = job->m_next;
+		job->m_next = NULL;
+		push(*job);
+	}
+}
+
+void Scheduler::submit(Job & job, Counter * counter) {
+	
+	job.m_counter = counter;
+	if(counter) {
+		atomic::add(counter->m_count, 1);
+	}
+	
+	push(job);
+}
+
+void Scheduler::submitAfter(Counter & dependency, Job & job, Counter * counter) {
+	
+	job.m_counter = counter;
+	if(counter) {
+		atomic::add(counter->m_count, 1);
+	}
+	
+	{
+		Autolock lock(g_counterLock);
+		if(atomic::load(dependency.m_count) != 0) {
+			job.m_next = dependency.m_waiting;
+			dependency.m_waiting = &job;
+			return;
+		}
+	}
+	
+	push(job);
+}
+
+void Scheduler::submitBackground(Job & job, Counter * counter) {
+	
+	job.m_counter = counter;
+	if(counter) {
+		atomic::add(counter->m_count, 1);
+	}
+	
+	if(g_deques.empty()) {
+		execute(job);
+		return;
+	}
+	
+	{
+		Autolock lock(g_injectedLock);
+		g_background.push_back(&job);
+		atomic::add(g_backgroundCount, 1);
+	}
+	
+	if(atomic::load(g_sleeping) != 0) {
+		g_wakeup.post();
+	}
+}
+
+void Scheduler::wait(Counter & counter) {
+	
+	while(atomic::load(counter.m_count) != 0) {
+		
+		// Background jobs can take long, leave them to the worker threads
+		if(Job * job = find(false)) {
+			execute(*job);
+			continue;
+		}
+		
+		arx_assert_msg(!g_deques.empty(), "waiting for jobs that can never run");
+		
+		Thread::sleep(0);
+	}
+	
+	// Make sure finish() is done with the counter before the caller destroys it
+	Autolock lock(g_counterLock);
+}
+
+void Worker::run() {
+	
+	profiler::registerThread("Job Worker");
+	
+	g_currentDeque = m_index + 1;
+	
+	while(true) {
+		
+		if(Job * job = Scheduler::find(true)) {
+			Scheduler::execute(*job);
+			continue;
+		}
+		
+		// Announce that we are going to sleep before the last check for new jobs
+		// so that submitters either see us sleeping or we see their job.
+		atomic::add(g_sleeping, 1);
+		if(atomic::load(g_stop) != 0) {
+			atomic::add(g_sleeping, size_t(-1));
+			break;
+		}
+		if(!Scheduler::hasWork()) {
+			g_wakeup.wait();
+		}
+		atomic::add(g_sleeping, size_t(-1));
+		
+	}
+	
+	g_currentDeque = 0;
+}
+
+void init(int threads) {
+	
+	arx_assert(g_deques.empty());
+	
+	unsigned count;
+	if(threads < 0) {
+		count = std::min(Thread::getProcessorCount() - 1, MAX_WORKERS);
+	} else {
+		count = std::min(unsigned(threads), MAX_WORKERS);
+	}
+	
+	if(count == 0) {
+		LogInfo << "Running jobs on the main thread";
+		return;
+	}
+	
+	atomic::store(g_stop, 0);
+	
+	for(unsigned i = 0; i <= count; i++) {
+		g_deques.push_back(new JobDeque);
+	}
+	g_currentDeque = 1;
+	
+	for(unsigned i = 1; i <= count; i++) {
+		Worker * worker = new Worker(i);
+		worker->setThreadName("Job Worker");
+		worker->start();
+		g_workers.push_back(worker);
+	}
+	
+	LogInfo << "Using " << count << " job worker threads";
+}
+
+void shutdown() {
+	
+	if(g_deques.empty()) {
+		return;
+	}
+	
+	atomic::store(g_stop, 1);
+	g_wakeup.post(unsigned(g_workers.size()));
+	
+	for(size_t i = 0; i < g_workers.size(); i++) {
+		g_workers[i]->waitForCompletion();
+		delete g_workers[i];
+	}
+	g_workers.clear();
+	
+	arx_assert(!Scheduler::hasWork());
+	
+	for(size_t i = 0; i < g_deques.size(); i++) {
+		delete g_deques[i];
+	}
+	g_deques.clear();
+	g_currentDeque = 0;
+}
+
+size_t getWorkerCount() {
+	return g_workers.size();
+}
+
+void submit(Job & job, Counter * counter) {
+	Scheduler::submit(job, counter);
+}
+
+void submitAfter(Counter & dependency, Job & job, Counter * counter) {
+	Scheduler::submitAfter(dependency, job, counter);
+}
+
+void submitBackground(Job & job, Counter * counter) {
+	Scheduler::submitBackground(job, counter);
+}
+
+void wait(Counter & counter) {
+	Scheduler::wait(counter);
+}
+
+} // namespace jobs
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PLATFORM_JOBSYSTEM_H
+#define ARX_PLATFORM_JOBSYSTEM_H
+
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "platform/Atomic.h"
+
+/*!
+ * Pool of worker threads that run short jobs submitted by the game.
+ * 
+ * Each thread in the pool owns a work-stealing deque: jobs submitted from a pool thread are
+ * pushed to its own deque and idle threads steal from the other end of the others.
+ * Jobs submitted from threads outside the pool go through a shared queue.
+ * 
+ * Completion is tracked by counters: every job submitted with a counter increments it and
+ * decrements it when done. Waiting on a counter runs other jobs instead of blocking.
+ * 
+ * With zero worker threads, jobs run on the submitting thread as soon as they can start,
+ * which makes the execution order deterministic for debugging.
+ */
+namespace jobs {
+
+class Counter;
+struct Scheduler;
+
+class Job {
+	
+public:
+	
+	Job() : m_counter(NULL), m_next(NULL) { }
+	
+	virtual ~Job() { }
+	
+	virtual void run() = 0;
+	
+private:
+	
+	friend struct Scheduler;
+	
+	Counter * m_counter;
+	Job * m_next; //!< Next job waiting for the same counter
+	
+};
+
+/*!
+ * Number of unfinished jobs in a group.
+ * Must not be destroyed while jobs using it are pending - call wait() first.
+ */
+class Counter : private boost::noncopyable {
+	
+public:
+	
+	Counter() : m_count(0), m_waiting(NULL) { }
+	
+	bool isDone() const { return atomic::load(m_count) == 0; }
+	
+private:
+	
+	friend struct Scheduler;
+	
+	volatile size_t m_count;
+	Job * m_waiting; //!< Jobs to submit once the count reaches zero
+	
+};
+
+/*!
+ * Start the worker threads and make the calling thread part of the pool.
+ * 
+ * \param threads Number of worker threads in addition to the calling thread,
+ *                or -1 to use one for each additional processor.
+ *                0 runs all jobs on the thread submitting them.
+ */
+void init(int threads = -1);
+
+//! Stop the worker threads. There must not be any pending jobs.
+void shutdown();
+
+//! Number of worker threads, not including the thread that called init()
+size_t getWorkerCount();
+
+/*!
+ * Queue a job to be run by any thread in the pool.
+ * The job must stay alive until it has finished.
+ * 
+ * \param counter Counter to increment now and decrement when the job has finished, or NULL.
+ */
+void submit(Job & job, Counter * counter = NULL);
+
+//! Like submit(), but only start the job once dependency has reached zero.
+void submitAfter(Counter & dependency, Job & job, Counter * counter = NULL);
+
+/*!
+ * Like submit(), but for long jobs that nobody is waiting for right away.
+ * Background jobs are only run by idle worker threads, never while waiting on a counter,
+ * so that they don't delay the thread that called init().
+ */
+void submitBackground(Job & job, Counter * counter = NULL);
+
+//! Run queued jobs until counter reaches zero.
+void wait(Counter & counter);
+
+namespace detail {
+
+template <typename Body>
+class RangeJob : public Job {
+	
+	Body * m_body;
+	size_t m_begin;
+	size_t m_end;
+	
+public:
+	
+	RangeJob(Body & body, size_t begin, size_t end) : m_body(&body), m_begin(begin), m_end(end) { }
+	
+	void run() {
+		(*m_body)(m_begin, m_end);
+	}
+	
+};
+
+} // namespace detail
+
+/*!
+ * Call body(first, last) for chunks of [begin, end) in parallel and wait until all are done.
+ * 
+ * The body may be called concurrently from several threads and must only modify
+ * the elements in its own range.
+ * 
+ * \param grain Minimum number of indices per chunk.
+ */
+template <typename Body>
+void parallelFor(size_t begin, size_t end, Body & body, size_t grain = 1) {
+	
+	if(begin >= end) {
+		return;
+	}
+	
+	// A few chunks per thread so that threads finishing early can steal the rest
+	size_t count = end - begin;
+	size_t chunks = std::min(count / std::max(grain, size_t(1)), (getWorkerCount() + 1) * 4);
+	if(chunks <= 1 || getWorkerCount() == 0) {
+		body(begin, end);
+		return;
+	}
+	
+	std::vector< detail::RangeJob<Body> > jobs;
+	jobs.reserve(chunks);
+	for(size_t i = 0; i < chunks; i++) {
+		jobs.push_back(detail::RangeJob<Body>(body, begin + count * i / chunks,
+		                                      begin + count * (i + 1) / chunks));
+	}
+	
+	Counter counter;
+	for(size_t i = 1; i < chunks; i++) {
+		submit(jobs[i], &counter);
+	}
+	jobs[0].run();
+	wait(counter);
+}
+
+} // namespace jobs
+
+#endif // ARX_PLATFORM_JOBSYSTEM_H
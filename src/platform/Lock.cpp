@@ -55,6 +55,42 @@ void Lock::unlock() {
 	pthread_mutex_unlock(&mutex);
 }
 
+Semaphore::Semaphore(unsigned initial) : count(initial) {
+	const pthread_mutex_t mutex_init = PTHREAD_MUTEX_INITIALIZER;
+	mutex = mutex_init;
+	const pthread_cond_t cond_init = PTHREAD_COND_INITIALIZER;
+	cond = cond_init;
+}
+
+Semaphore::~Semaphore() {
+	
+}
+
+void Semaphore::wait() {
+	
+	pthread_mutex_lock(&mutex);
+	
+	while(count == 0) {
+		int rc = pthread_cond_wait(&cond, &mutex);
+		arx_assert(rc == 0);
+		ARX_UNUSED(rc);
+	}
+	
+	count--;
+	pthread_mutex_unlock(&mutex);
+}
+
+void Semaphore::post(unsigned n) {
+	pthread_mutex_lock(&mutex);
+	count += n;
+	if(n == 1) {
+		pthread_cond_signal(&cond);
+	} else if(n > 1) {
+		pthread_cond_broadcast(&cond);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
 #elif defined(ARX_HAVE_WINAPI)
 
 Lock::Lock() {
@@ -76,4 +112,25 @@ void Lock::unlock() {
 	ReleaseMutex(mutex);
 }
 
+Semaphore::Semaphore(unsigned initial) {
+	semaphore = CreateSemaphore(NULL, LONG(initial), 0x7fffffff, NULL);
+	arx_assert(semaphore);
+}
+
+Semaphore::~Semaphore() {
+	CloseHandle(semaphore);
+}
+
+void Semaphore::wait() {
+	DWORD rc = WaitForSingleObject(semaphore, INFINITE);
+	arx_assert(rc == WAIT_OBJECT_0);
+	ARX_UNUSED(rc);
+}
+
+void Semaphore::post(unsigned n) {
+	if(n > 0) {
+		ReleaseSemaphore(semaphore, LONG(n), NULL);
+	}
+}
+
 #endif
@@ -53,6 +53,33 @@ public:
 	
 };
 
+/*!
+ * Counting semaphore: wait() blocks until the count is positive and then decrements it.
+ */
+class Semaphore {
+	
+private:
+	
+#if defined(ARX_HAVE_PTHREADS)
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned count;
+#elif defined(ARX_HAVE_WINAPI)
+	HANDLE semaphore;
+#endif
+	
+public:
+	
+	explicit Semaphore(unsigned initial = 0);
+	~Semaphore();
+	
+	void wait();
+	
+	//! Increment the count by n, waking up to n waiting threads.
+	void post(unsigned n = 1);
+	
+};
+
 class Autolock {
 	
 private:
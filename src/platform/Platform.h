@@ -160,6 +160,13 @@ typedef double f64; // 64 bits double float
 #define ARX_FORMAT_PRINTF(message_arg, param_vararg)
 #endif
 
+//! ARX_THREAD_LOCAL - Give a variable with static storage duration a separate instance per thread
+#if ARX_COMPILER_MSVC
+	#define ARX_THREAD_LOCAL __declspec(thread)
+#else
+	#define ARX_THREAD_LOCAL __thread
+#endif
+
 /* ---------------------------------------------------------
                      Macro for assertion
 ------------------------------------------------------------*/
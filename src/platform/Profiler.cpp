@@ -0,0 +1,225 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "platform/Profiler.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "io/fs/FilePath.h"
+#include "io/fs/FileStream.h"
+#include "platform/Atomic.h"
+#include "platform/Lock.h"
+
+namespace profiler {
+
+namespace {
+
+struct Sample {
+	const char * tag;
+	u64 start;
+	u64 end;
+};
+
+//! Ring buffer size for each thread, must be a power of two
+const size_t SamplesPerThread = 65536;
+
+//! Number of frames to keep for export
+const size_t FrameHistory = 300;
+
+struct ThreadProfile {
+	
+	std::string name;
+	
+	std::vector<Sample> samples;
+	
+	//! Total number of samples written, only modified by the owning thread.
+	volatile size_t count;
+	
+	ThreadProfile() : samples(SamplesPerThread), count(0) { }
+	
+};
+
+//! Profiles are kept until exit so that samples from finished threads can be exported.
+std::vector<ThreadProfile *> g_threads;
+Lock g_threadsLock;
+
+ARX_THREAD_LOCAL ThreadProfile * t_profile = NULL;
+ARX_THREAD_LOCAL const char * t_name = NULL;
+
+u64 g_frameStarts[FrameHistory];
+size_t g_frameCount = 0;
+u64 g_frameStart = 0;
+
+ThreadProfile * getThreadProfile() {
+	
+	if(t_profile) {
+		return t_profile;
+	}
+	
+	// Only allocate the buffer once the thread actually records something
+	ThreadProfile * profile = new ThreadProfile;
+	
+	Autolock lock(g_threadsLock);
+	
+	if(t_name) {
+		profile->name = t_name;
+	} else {
+		std::ostringstream oss;
+		oss << "Thread " << g_threads.size();
+		profile->name = oss.str();
+	}
+	
+	g_threads.push_back(profile);
+	t_profile = profile;
+	
+	return profile;
+}
+
+void writeString(std::ostream & os, const char * str) {
+	os << '"';
+	for(; *str; str++) {
+		if(*str == '"' || *str == '\\') {
+			os << '\\';
+		}
+		os << *str;
+	}
+	os << '"';
+}
+
+} // anonymous namespace
+
+bool detail::enabled = false;
+
+void detail::record(const char * tag, u64 start, u64 end) {
+	
+	ThreadProfile * profile = getThreadProfile();
+	
+	size_t index = profile->count;
+	
+	Sample & sample = profile->samples[index & (SamplesPerThread - 1)];
+	sample.tag = tag;
+	sample.start = start;
+	sample.end = end;
+	
+	atomic::store(profile->count, index + 1);
+}
+
+void setEnabled(bool enable) {
+	
+	if(enable && !detail::enabled) {
+		g_frameCount = 0;
+		g_frameStart = Time::getUs();
+	}
+	
+	detail::enabled = enable;
+}
+
+void registerThread(const char * name) {
+	
+	t_name = name;
+	
+	if(t_profile) {
+		Autolock lock(g_threadsLock);
+		t_profile->name = name;
+	}
+}
+
+void frame() {
+	
+	if(!detail::enabled) {
+		return;
+	}
+	
+	u64 now = Time::getUs();
+	
+	detail::record("Frame", g_frameStart, now);
+	
+	g_frameStarts[g_frameCount % FrameHistory] = g_frameStart;
+	g_frameCount++;
+	g_frameStart = now;
+}
+
+bool writeChromeTrace(const fs::path & file) {
+	
+	if(g_frameCount == 0) {
+		return false;
+	}
+	
+	// Start of the oldest frame in the history
+	u64 begin = g_frameStarts[(g_frameCount < FrameHistory) ? 0 : g_frameCount % FrameHistory];
+	
+	fs::ofstream ofs(file, fs::fstream::out | fs::fstream::trunc);
+	if(!ofs.is_open()) {
+		return false;
+	}
+	
+	ofs << "{\"traceEvents\":[\n";
+	
+	Autolock lock(g_threadsLock);
+	
+	std::vector<Sample> samples;
+	
+	for(size_t tid = 0; tid < g_threads.size(); tid++) {
+		
+		const ThreadProfile * profile = g_threads[tid];
+		
+		if(tid != 0) {
+			ofs << ",\n";
+		}
+		ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+		    << ",\"args\":{\"name\":";
+		writeString(ofs, profile->name.c_str());
+		ofs << "}}";
+		
+		// Other threads may still be recording - copy the samples first
+		size_t end = atomic::load(profile->count);
+		size_t start = (end > SamplesPerThread) ? end - SamplesPerThread : 0;
+		samples.clear();
+		for(size_t i = start; i < end; i++) {
+			samples.push_back(profile->samples[i & (SamplesPerThread - 1)]);
+		}
+		
+		// Then discard any samples that were overwritten or may be in the process of being overwritten
+		size_t now = atomic::load(profile->count);
+		size_t valid = (now + 1 > SamplesPerThread) ? now + 1 - SamplesPerThread : 0;
+		
+		for(size_t i = 0; i < samples.size(); i++) {
+			
+			const Sample & sample = samples[i];
+			if(start + i < valid || sample.start < begin || sample.end < sample.start) {
+				continue;
+			}
+			
+			ofs << ",\n{\"name\":";
+			writeString(ofs, sample.tag);
+			ofs << ",\"ph\":\"X\",\"ts\":" << (sample.start - begin)
+			    << ",\"dur\":" << (sample.end - sample.start)
+			    << ",\"pid\":1,\"tid\":" << tid << '}';
+		}
+		
+	}
+	
+	ofs << "\n]}\n";
+	
+	return !ofs.fail();
+}
+
+} // namespace profiler
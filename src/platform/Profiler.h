@@ -0,0 +1,105 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PLATFORM_PROFILER_H
+#define ARX_PLATFORM_PROFILER_H
+
+#include <boost/preprocessor/cat.hpp>
+
+#include "platform/Platform.h"
+#include "platform/Time.h"
+
+namespace fs { class path; }
+
+/*!
+ * Lightweight hierarchical CPU profiler.
+ *
+ * Code is instrumented with ARX_PROFILE() zones which record their start and end time
+ * into a per-thread ring buffer while profiling is enabled. When disabled, a zone costs
+ * a single branch. The samples for the last frames can be exported as a Chrome trace
+ * (load it in chrome://tracing).
+ */
+namespace profiler {
+
+namespace detail {
+
+extern bool enabled;
+
+void record(const char * tag, u64 start, u64 end);
+
+} // namespace detail
+
+//! @return true if zones are currently being recorded.
+inline bool isEnabled() {
+	return detail::enabled;
+}
+
+/*!
+ * Start or stop recording zones.
+ * Enabling the profiler discards the frame history.
+ */
+void setEnabled(bool enable);
+
+/*!
+ * Name the calling thread in exported traces.
+ * Threads that record zones without calling this get a generic name.
+ * @param name A string constant.
+ */
+void registerThread(const char * name);
+
+/*!
+ * Mark the end of a frame. This must be called from the main thread.
+ * Only the samples for the last frames are kept for export.
+ */
+void frame();
+
+/*!
+ * Write the samples recorded for the last frames as a Chrome trace event JSON file.
+ * This must be called from the main thread.
+ */
+bool writeChromeTrace(const fs::path & file);
+
+//! Record a zone from construction to destruction.
+class Scope {
+	
+	const char * const tag;
+	const u64 start; //!< 0 if the profiler was disabled when entering the zone
+	
+public:
+	
+	explicit Scope(const char * _tag)
+		: tag(_tag), start(detail::enabled ? Time::getUs() : 0) { }
+	
+	~Scope() {
+		if(start) {
+			detail::record(tag, start, Time::getUs());
+		}
+	}
+	
+};
+
+} // namespace profiler
+
+//! Profile the rest of the current block. Tag must be a string constant.
+#define ARX_PROFILE(tag) ::profiler::Scope BOOST_PP_CAT(profileScope, __LINE__)(tag)
+
+//! Profile the rest of the current function.
+#define ARX_PROFILE_FUNC() ARX_PROFILE(__func__)
+
+#endif // ARX_PLATFORM_PROFILER_H
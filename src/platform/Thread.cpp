@@ -129,6 +129,11 @@ thread_id_type Thread::getCurrentThreadId() {
 	return pthread_self();
 }
 
+unsigned Thread::getProcessorCount() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? unsigned(count) : 1;
+}
+
 process_id_type getProcessId() {
 	return getpid();
 }
@@ -231,6 +236,12 @@ thread_id_type Thread::getCurrentThreadId() {
 	return GetCurrentThreadId();
 }
 
+unsigned Thread::getProcessorCount() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0) ? unsigned(info.dwNumberOfProcessors) : 1;
+}
+
 process_id_type getProcessId() {
 	return GetCurrentProcessId();
 }
@@ -104,6 +104,11 @@ public:
 	
 	static thread_id_type getCurrentThreadId();
 	
+	/*!
+	 * Get the number of processors available to run threads (at least 1).
+	 */
+	static unsigned getProcessorCount();
+	
 protected:
 	
 	/*!
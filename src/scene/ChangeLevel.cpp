@@ -1779,6 +1779,7 @@ static long ARX_CHANGELEVEL_Pop_Player() {
 			}
 		}
 	}
+	indexInventory(entities.player());
 	
 	if(size < pos + (asp->nb_PlayerQuest * 80)) {
 		LogError << "Truncated data";
@@ -2117,8 +2118,6 @@ static Entity * ARX_CHANGELEVEL_Pop_IO(const string & ident, long num) {
 				continue;
 			}
 			
-			ActiveTimers++;
-			
 			if(ats->script) {
 				scr_timer[num].es = &io->over_script;
 			} else {
@@ -2126,7 +2125,6 @@ static Entity * ARX_CHANGELEVEL_Pop_IO(const string & ident, long num) {
 			}
 			
 			scr_timer[num].flags = sFlags;
-			scr_timer[num].exist = 1;
 			scr_timer[num].io = io;
 			scr_timer[num].msecs = ats->msecs;
 			scr_timer[num].name = boost::to_lower_copy(util::loadString(ats->name));
@@ -2141,6 +2139,7 @@ static Entity * ARX_CHANGELEVEL_Pop_IO(const string & ident, long num) {
 			}
 			
 			scr_timer[num].times = ats->times;
+			ARX_SCRIPT_Timer_Activate(num);
 		}
 		
 		if(!loadScriptData(io->script, dat, pos) || !loadScriptData(io->over_script, dat, pos)) {
@@ -2424,6 +2423,7 @@ static void ARX_CHANGELEVEL_PopAllIO_FINISH(long reloadflag, bool firstTime) {
 							inv->slot[m][n].show = aids->slot_show[m][n];
 						}
 					}
+					indexInventory(io);
 				}
 			}
 			
@@ -2681,6 +2681,7 @@ static bool ARX_CHANGELEVEL_PopLevel(long instance, long reloadflag) {
 		for(long i = 0; i < MAX_TIMER_SCRIPT; i++) {
 			if(scr_timer[i].exist) {
 				scr_timer[i].tim = ulDTime;
+				ARX_SCRIPT_Timer_Reschedule(i);
 			}
 		}
 	} else {
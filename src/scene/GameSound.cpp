@@ -434,6 +434,9 @@ void ARX_SOUND_LoadData() {
 	ARX_SOUND_CreateCollisionMaps();
 	ARX_SOUND_CreatePresenceMap();
 	
+	// Footstep and collision sounds are played often, keep them decoded too
+	audio::preloadSamples();
+	
 	// Load environments, enable environment system and set default one if required
 	ARX_SOUND_CreateEnvironments();
 	
@@ -1315,6 +1318,9 @@ static void ARX_SOUND_CreateStaticSamples() {
 	SND_SPELL_TELEPORTED               = audio::createSample("magic_spell_teleported.wav");
 	SND_SPELL_VISION_START             = audio::createSample("magic_spell_vision2.wav");
 	SND_SPELL_VISION_LOOP              = audio::createSample("magic_spell_vision.wav");
+	
+	// Decode the interface and spell sounds now so they play without loading hitches
+	audio::preloadSamples();
 }
 
 // Reset each static sample to INVALID_ID
@@ -102,6 +102,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "physics/Box.h"
 #include "physics/Clothes.h"
 
+#include "platform/Profiler.h"
 #include "platform/Thread.h"
 
 #include "scene/ChangeLevel.h"
@@ -1396,15 +1397,14 @@ void ARX_INTERACTIVE_TeleportBehindTarget(Entity * io)
 
 		if(num != -1) {
 			long t = io->index();
-			ActiveTimers++;
 			scr_timer[num].es = NULL;
-			scr_timer[num].exist = 1;
 			scr_timer[num].io = io;
 			scr_timer[num].msecs = Random::get(3000, 6000);
 			scr_timer[num].name = "_r_a_t_";
 			scr_timer[num].pos = -1; 
 			scr_timer[num].tim = (unsigned long)(arxtime);
 			scr_timer[num].times = 1;
+			ARX_SCRIPT_Timer_Activate(num);
 			entities[t]->show = SHOW_FLAG_TELEPORTING;
 			AddRandomSmoke(io, 10);
 			ARX_PARTICLES_Add_Smoke(&io->pos, 3, 20);
@@ -2926,6 +2926,8 @@ EERIEMATRIX convertToMatrixForDrawEERIEInter(const PHYSICS_BOX_DATA &box) {
 }
 
 void UpdateInter() {
+	
+	ARX_PROFILE_FUNC();
 
 	for(size_t i = 1; i < entities.size(); i++) {
 		Entity * io = entities[i];
@@ -2969,9 +2971,12 @@ void UpdateInter() {
 				pos.y = io->_npcdata->vvpos;
 			}
 
-			EERIEDrawAnimQuatUpdate(io->obj, io->animlayer, temp, pos, diff, io, true);
+			EERIEDrawAnimQuatQueueUpdate(io->obj, io->animlayer, temp, pos, diff, io, true);
 		}
 	}
+	
+	// Skin all visible entities in parallel before they are rendered or collided with
+	EERIEDrawAnimQuatFinishUpdates();
 }
 
 
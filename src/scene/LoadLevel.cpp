@@ -69,6 +69,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "gui/Interface.h"
 
 #include "graphics/Math.h"
+#include "graphics/data/FTL.h"
 #include "graphics/data/TextureContainer.h"
 #include "graphics/effects/Fog.h"
 #include "graphics/particle/ParticleEffects.h"
@@ -85,6 +86,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "physics/CollisionShapes.h"
 
+#include "platform/Time.h"
+
 #include "scene/Object.h"
 #include "scene/GameSound.h"
 #include "scene/Interactive.h"
@@ -591,6 +594,47 @@ Entity * LoadInter_Ex(const res::path & classPath, EntityInstance instance,
 	return io;
 }
 
+namespace {
+
+//! Time spent in the stages of DanaeLoadLevel, for the log
+class LoadingStages {
+	
+	u64 m_start;
+	u64 m_last;
+	std::ostringstream m_stages;
+	
+public:
+	
+	LoadingStages() : m_start(Time::getUs()), m_last(m_start) { }
+	
+	//! Finish the current stage
+	void end(const char * stage) {
+		u64 now = Time::getUs();
+		m_stages << ", " << stage << ' ' << (Time::getElapsedUs(m_last, now) / 1000) << " ms";
+		m_last = now;
+	}
+	
+	void log() const {
+		LogInfo << "Done loading level in " << (Time::getElapsedUs(m_start, m_last) / 1000)
+		        << " ms" << m_stages.str();
+	}
+	
+};
+
+} // anonymous namespace
+
+static res::path getEntityClassPath(const DANAE_LS_INTER * dli) {
+	
+	string pathstr = boost::to_lower_copy(util::loadString(dli->name));
+	
+	size_t pos = pathstr.find("graph");
+	if(pos != std::string::npos) {
+		pathstr = pathstr.substr(pos);
+	}
+	
+	return res::path::load(pathstr).remove_ext();
+}
+
 static long LastLoadedLightningNb = 0;
 static u32 * LastLoadedLightning = NULL;
 Vec3f loddpos;
@@ -602,6 +646,8 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 	
 	LogInfo << "Loading Level " << file;
 	
+	LoadingStages stages;
+	
 	CURRENTLEVEL = GetLevelNumByName(file.string());
 	
 	res::path lightingFileName = res::path(file).set_ext("llf");
@@ -717,6 +763,8 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 	
 	MSP = trans;
 	
+	stages.end("scene");
+	
 	float increment = 0;
 	if(dlh.nb_inter > 0) {
 		increment = (60.f / (float)dlh.nb_inter);
@@ -725,6 +773,17 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 		LoadLevelScreen();
 	}
 	
+	// Entities of the same class share the parsed mesh while the level is loaded
+	MCache_KeepParsedMeshes();
+	
+	if(loadEntities) {
+		// Decompress the entity meshes in the background while the entities are created
+		const DANAE_LS_INTER * dli = reinterpret_cast<const DANAE_LS_INTER *>(dat + pos);
+		for(long i = 0; i < dlh.nb_inter; i++) {
+			ARX_FTL_Prefetch(getEntityClassPath(&dli[i]) + ".teo");
+		}
+	}
+	
 	for(long i = 0 ; i < dlh.nb_inter ; i++) {
 		
 		PROGRESS_BAR_COUNT += increment;
@@ -734,19 +793,16 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 		pos += sizeof(DANAE_LS_INTER);
 		
 		if(loadEntities) {
-			
-			string pathstr = boost::to_lower_copy(util::loadString(dli->name));
-			
-			size_t pos = pathstr.find("graph");
-			if(pos != std::string::npos) {
-				pathstr = pathstr.substr(pos);
-			}
-			
-			res::path classPath = res::path::load(pathstr).remove_ext();
-			LoadInter_Ex(classPath, dli->ident, dli->pos, dli->angle, trans);
+			LoadInter_Ex(getEntityClassPath(dli), dli->ident, dli->pos, dli->angle, trans);
 		}
 	}
 	
+	// Every entity owns a full copy of its mesh, so the parsed meshes are not needed anymore.
+	// This also releases prefetched files for which scripts loaded a different mesh.
+	MCache_ClearAll();
+	
+	stages.end("entities");
+	
 	if(dlh.lighting) {
 		
 		const DANAE_LS_LIGHTINGHEADER * dll = reinterpret_cast<const DANAE_LS_LIGHTINGHEADER *>(dat + pos);
@@ -949,6 +1005,8 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 	PROGRESS_BAR_COUNT += 5.f;
 	LoadLevelScreen();
 	
+	stages.end("lights, fogs and paths");
+	
 	
 	//Now LOAD Separate LLF Lighting File
 	
@@ -976,7 +1034,7 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 		LOADEDD = 1;
 		FASTmse = 0;
 		USE_PLAYERCOLLISIONS = 1;
-		LogInfo << "Done loading level";
+		stages.log();
 		return 1;
 	}
 	
@@ -1081,13 +1139,13 @@ long DanaeLoadLevel(const res::path & file, bool loadEntities) {
 	FASTmse = 0;
 	USE_PLAYERCOLLISIONS = 1;
 	
-	LogInfo << "Done loading level";
+	stages.end("lighting");
+	stages.log();
 	
 	return 1;
 	
 }
 
-void MCache_ClearAll();
 long FAST_RELEASE = 0;
 extern Entity * FlyingOverIO;
 extern unsigned long LAST_JUMP_ENDTIME;
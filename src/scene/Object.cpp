@@ -1112,6 +1112,8 @@ void EERIE_RemoveCedricData(EERIE_3DOBJ * eobj) {
 	for(long i = 0; i < eobj->c_data->nb_bones; i++) {
 		free(eobj->c_data->bones[i].idxvertices);
 		eobj->c_data->bones[i].idxvertices = NULL;
+		delete[] eobj->c_data->bones[i].localblocks;
+		eobj->c_data->bones[i].localblocks = NULL;
 	}
 	
 	delete[] eobj->c_data->bones, eobj->c_data->bones = NULL;
@@ -1237,6 +1239,7 @@ void EERIE_CreateCedricData(EERIE_3DOBJ * eobj) {
 				bone.anim.trans = bone.init.trans;
 			}
 			bone.anim.scale = Vec3f::ONE;
+			bone.lodTarget = bone.init;
 		}
 
 		eobj->vertexlocal = new EERIE_3DPAD[eobj->vertexlist.size()];
@@ -1258,6 +1261,20 @@ void EERIE_CreateCedricData(EERIE_3DOBJ * eobj) {
 				outVert.y = temp.y;
 				outVert.z = temp.z;
 			}
+			
+			// Lay out the local positions in SoA blocks for Cedric_TransformVerts
+			EERIE_BONE & bone = obj->bones[i];
+			long nblocks = (bone.nb_idxvertices + 3) / 4;
+			bone.localblocks = new float[nblocks * 12];
+			for(long v = 0; v < nblocks * 4; v++) {
+				float * block = &bone.localblocks[(v / 4) * 12 + (v % 4)];
+				if(v < bone.nb_idxvertices) {
+					const EERIE_3DPAD & local = eobj->vertexlocal[bone.idxvertices[v]];
+					block[0] = local.x, block[4] = local.y, block[8] = local.z;
+				} else {
+					block[0] = block[4] = block[8] = 0.f;
+				}
+			}
 		}
 	}
 }
@@ -79,6 +79,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "io/log/Logger.h"
 
+#include "platform/Profiler.h"
+
 #include "scene/Light.h"
 #include "scene/Interactive.h"
 
@@ -1678,6 +1680,8 @@ extern long SPECIAL_DRAGINTER_RENDER;
 //*************************************************************************************
 ///////////////////////////////////////////////////////////
 void ARX_SCENE_Render() {
+	
+	ARX_PROFILE_FUNC();
 
 	if(uw_mode)
 		GRenderer->GetTextureStage(0)->setMipMapLODBias(10.f);
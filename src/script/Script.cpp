@@ -51,8 +51,10 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include <sstream>
 #include <cstdio>
 #include <algorithm>
+#include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "ai/Paths.h"
 
@@ -77,6 +79,8 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "io/resource/PakReader.h"
 #include "io/log/Logger.h"
 
+#include "platform/Profiler.h"
+
 #include "scene/Scene.h"
 #include "scene/Interactive.h"
 
@@ -1499,118 +1503,203 @@ void MakeSSEPARAMS(const char * params)
 	}
 }
 
-#define MAX_EVENT_STACK 800
-struct STACKED_EVENT {
+namespace {
+
+struct StackedEvent {
 	Entity * sender;
-	long              exist;
-	Entity * io;
-	ScriptMessage     msg;
-	std::string       params;
-	std::string       eventname;
+	Entity * io; //!< NULL if the event has been cancelled
+	ScriptMessage msg;
+	std::string params;
+	std::string eventname;
 };
 
-STACKED_EVENT eventstack[MAX_EVENT_STACK];
-
-void ARX_SCRIPT_EventStackInit()
-{
-	ARX_SCRIPT_EventStackClear( false ); // Clear everything in the stack
-}
-void ARX_SCRIPT_EventStackClear( bool check_exist )
-{
-	LogDebug("Event Stack Clear");
-	for (long i = 0; i < MAX_EVENT_STACK; i++)
-	{
-		if ( check_exist ) // If we're not blatantly clearing everything
-			if ( !eventstack[i].exist ) // If the Stacked_Event is not being used
-				continue; // Continue on to the next one
-
-			// Otherwise, clear all the fields in this stacked_event
-			eventstack[i].sender = NULL;
-			eventstack[i].exist = 0;
-			eventstack[i].io = NULL;
-			eventstack[i].msg = SM_NULL;
-			eventstack[i].params.clear();
-			eventstack[i].eventname.clear();
+/*!
+ * FIFO of events to be sent later.
+ * Event records are kept in a ring buffer and reused so that their strings keep their
+ * buffers. The ring grows instead of dropping events when it is full.
+ */
+class EventStack {
+	
+	std::vector<StackedEvent> events; //!< Size is always a power of two
+	size_t first;
+	size_t count;
+	
+	void grow() {
+		
+		std::vector<StackedEvent> grown(events.size() * 2);
+		for(size_t i = 0; i < count; i++) {
+			StackedEvent & event = events[(first + i) & (events.size() - 1)];
+			grown[i].sender = event.sender;
+			grown[i].io = event.io;
+			grown[i].msg = event.msg;
+			grown[i].params.swap(event.params);
+			grown[i].eventname.swap(event.eventname);
+		}
+		
+		events.swap(grown);
+		first = 0;
+		
+		LogWarning << "Script event stack overflow: " << count << " events pending, growing to "
+		           << events.size();
 	}
-}
-
-long STACK_FLOW = 8;
-
-void ARX_SCRIPT_EventStackClearForIo(Entity * io)
-{
-	for (long i = 0; i < MAX_EVENT_STACK; i++)
-	{
-		if (eventstack[i].exist)
-		{
-			if (eventstack[i].io == io)
-			{
-				eventstack[i].sender = NULL;
-				eventstack[i].exist = 0;
-				eventstack[i].io = NULL;
-				eventstack[i].msg = SM_NULL;
-				eventstack[i].params.clear();
-				eventstack[i].eventname.clear();
+	
+public:
+	
+	explicit EventStack(size_t size) : events(size), first(0), count(0) {
+		arx_assert(size != 0 && (size & (size - 1)) == 0);
+	}
+	
+	size_t size() const { return count; }
+	
+	StackedEvent & push() {
+		
+		if(count == events.size()) {
+			grow();
+		}
+		
+		return events[(first + count++) & (events.size() - 1)];
+	}
+	
+	StackedEvent & front() {
+		arx_assert(count != 0);
+		return events[first];
+	}
+	
+	void pop() {
+		arx_assert(count != 0);
+		first = (first + 1) & (events.size() - 1);
+		count--;
+	}
+	
+	void clear() {
+		first = 0;
+		count = 0;
+	}
+	
+	//! @return the number of events that have not been cancelled
+	size_t pending() const {
+		size_t pending = 0;
+		for(size_t i = 0; i < count; i++) {
+			if(events[(first + i) & (events.size() - 1)].io) {
+				pending++;
 			}
 		}
+		return pending;
 	}
-}
-
-void ARX_SCRIPT_EventStackExecute()
-{
-	long count = 0;
+	
+	void cancel(const Entity * io) {
+		for(size_t i = 0; i < count; i++) {
+			StackedEvent & event = events[(first + i) & (events.size() - 1)];
+			if(event.io == io) {
+				event.io = NULL;
+			}
+		}
+	}
+	
+};
 
-	for (long i = 0; i < MAX_EVENT_STACK; i++)
-	{
-		if (eventstack[i].exist)
-		{
-			if(ValidIOAddress(eventstack[i].io)) {
+//! Initial size of the event stack, enough for all but the busiest levels
+const size_t EVENT_STACK_SIZE = 1024;
 
-			if (ValidIOAddress(eventstack[i].sender))
-				EVENT_SENDER = eventstack[i].sender;
-			else
-				EVENT_SENDER = NULL;
+//! Maximum number of stacked events to send per frame
+const size_t EVENT_STACK_FLOW = 20;
 
-			SendIOScriptEvent(eventstack[i].io, eventstack[i].msg, eventstack[i].params, eventstack[i].eventname);
-			}
+//! Maximum number of passes when sending all stacked events, in case scripts keep stacking
+const size_t EVENT_STACK_FLUSH_PASSES = 16;
 
-			eventstack[i].sender = NULL;
-			eventstack[i].exist = 0;
-			eventstack[i].io = NULL;
-			eventstack[i].msg = SM_NULL;
-			eventstack[i].params.clear();
-			eventstack[i].eventname.clear();
-			count++;
+EventStack eventstack(EVENT_STACK_SIZE);
 
-			if (count >= STACK_FLOW) return;
+/*!
+ * Send stacked events in order.
+ * @param budget  Maximum number of events to send - cancelled events don't count.
+ * @param records Maximum number of records to remove, including cancelled events.
+ */
+void executeStackedEvents(size_t budget, size_t records) {
+	
+	// Sending an event may stack new events and move the records around,
+	// so take the strings out first - swapping keeps the buffers in use
+	std::string params;
+	std::string eventname;
+	
+	size_t count = 0;
+	for(; count < budget && records != 0 && eventstack.size() != 0; records--) {
+		
+		StackedEvent & event = eventstack.front();
+		Entity * sender = event.sender;
+		Entity * io = event.io;
+		ScriptMessage msg = event.msg;
+		params.swap(event.params);
+		eventname.swap(event.eventname);
+		eventstack.pop();
+		
+		if(!io) {
+			// Cancelled events don't count towards the budget
+			continue;
 		}
+		
+		if(ValidIOAddress(io)) {
+			EVENT_SENDER = ValidIOAddress(sender) ? sender : NULL;
+			SendIOScriptEvent(io, msg, params, eventname);
+		}
+		
+		count++;
 	}
 }
 
-void ARX_SCRIPT_EventStackExecuteAll()
-{
-	STACK_FLOW = 9999999;
-	ARX_SCRIPT_EventStackExecute();
-	STACK_FLOW = 20;
+} // anonymous namespace
+
+void ARX_SCRIPT_EventStackInit() {
+	ARX_SCRIPT_EventStackClear(false);
 }
 
-void Stack_SendIOScriptEvent(Entity * io, ScriptMessage msg, const std::string& params, const std::string& eventname)
-{
-	for (long i = 0; i < MAX_EVENT_STACK; i++)
-	{
-		if (!eventstack[i].exist)
-		{
-			eventstack[i].sender = EVENT_SENDER;
-			eventstack[i].io = io;
-			eventstack[i].msg = msg;
-			eventstack[i].exist = 1;
-			eventstack[i].params = params;
-			eventstack[i].eventname = eventname;
+void ARX_SCRIPT_EventStackClear(bool check_exist) {
+	ARX_UNUSED(check_exist);
+	LogDebug("Event Stack Clear, discarding " << eventstack.pending() << " events");
+	eventstack.clear();
+}
 
-			return;
-		}
+void ARX_SCRIPT_EventStackClearForIo(Entity * io) {
+	eventstack.cancel(io);
+}
+
+void ARX_SCRIPT_EventStackExecute() {
+	
+	executeStackedEvents(EVENT_STACK_FLOW, size_t(-1));
+	
+	if(eventstack.size() != 0) {
+		LogDebug(eventstack.size() << " stacked events deferred to the next frame");
 	}
 }
 
+void ARX_SCRIPT_EventStackExecuteAll() {
+	
+	// Events stacked while executing are sent in the following passes
+	for(size_t pass = 0; pass < EVENT_STACK_FLUSH_PASSES && eventstack.size() != 0; pass++) {
+		// Limit each pass to the records present at its start, including cancelled events
+		executeStackedEvents(size_t(-1), eventstack.size());
+	}
+	
+	if(size_t pending = eventstack.pending()) {
+		LogWarning << pending << " stacked events still pending after "
+		           << EVENT_STACK_FLUSH_PASSES << " passes";
+	}
+}
+
+long ARX_SCRIPT_EventStackCount() {
+	return long(eventstack.size());
+}
+
+void Stack_SendIOScriptEvent(Entity * io, ScriptMessage msg, const std::string & params,
+                             const std::string & eventname) {
+	
+	StackedEvent & event = eventstack.push();
+	event.sender = EVENT_SENDER;
+	event.io = io;
+	event.msg = msg;
+	event.params = params;
+	event.eventname = eventname;
+}
+
 ScriptResult SendIOScriptEventReverse(Entity * io, ScriptMessage msg, const std::string& params, const std::string& eventname)
 {
 	// checks invalid IO
@@ -1718,18 +1807,190 @@ ScriptResult SendInitScriptEvent(Entity * io) {
 	return ACCEPT;
 }
 
-//! Checks if timer named texx exists.
-static bool ARX_SCRIPT_Timer_Exist(const std::string & texx) {
+namespace {
+
+/*!
+ * Bookkeeping for the active timers in scr_timer.
+ * Pending expirations are kept in a min-heap keyed by tim + msecs so that only due
+ * timers are looked at each frame. Heap entries are invalidated lazily: each slot has a
+ * generation that is bumped whenever the timer is cleared or rescheduled.
+ * Active timers are also linked into per-entity lists and counted by name.
+ */
+class TimerIndex {
 	
-	for(long i = 0; i < MAX_TIMER_SCRIPT; i++) {
-		if(scr_timer[i].exist) {
-			if(scr_timer[i].name == texx) {
-				return true;
+public:
+	
+	struct Expiration {
+		
+		unsigned long time;
+		long slot;
+		unsigned long generation;
+		
+		//! Orders the heap by time, ties are broken by slot
+		bool operator<(const Expiration & o) const {
+			return (time != o.time) ? (time > o.time) : (slot > o.slot);
+		}
+		
+	};
+	
+private:
+	
+	struct Slot {
+		long prev;
+		long next;
+		unsigned long generation;
+		Slot() : prev(-1), next(-1), generation(0) { }
+	};
+	
+	typedef boost::unordered_map<const Entity *, long> EntityTimers;
+	typedef boost::unordered_map<std::string, size_t> NameCounts;
+	
+	std::vector<Slot> slots;
+	std::vector<Expiration> heap;
+	EntityTimers entityTimers; //!< First timer slot for each entity
+	NameCounts names;
+	
+	void push(long slot) {
+		const SCR_TIMER & timer = scr_timer[slot];
+		Expiration expiration;
+		expiration.time = timer.tim + timer.msecs;
+		expiration.slot = slot;
+		expiration.generation = slots[slot].generation;
+		heap.push_back(expiration);
+		std::push_heap(heap.begin(), heap.end());
+	}
+	
+	//! Drops stale heap entries once they outnumber the active timers
+	void compact() {
+		heap.clear();
+		for(size_t i = 0; i < slots.size(); i++) {
+			if(scr_timer[i].exist) {
+				push(long(i));
 			}
 		}
 	}
 	
-	return false;
+public:
+	
+	void init(size_t count) {
+		slots.assign(count, Slot());
+		clear();
+	}
+	
+	void clear() {
+		for(size_t i = 0; i < slots.size(); i++) {
+			slots[i].prev = slots[i].next = -1;
+			slots[i].generation++;
+		}
+		heap.clear();
+		entityTimers.clear();
+		names.clear();
+	}
+	
+	void add(long slot) {
+		
+		const SCR_TIMER & timer = scr_timer[slot];
+		
+		std::pair<EntityTimers::iterator, bool> first;
+		first = entityTimers.insert(EntityTimers::value_type(timer.io, slot));
+		if(!first.second) {
+			slots[slot].next = first.first->second;
+			slots[first.first->second].prev = slot;
+			first.first->second = slot;
+		}
+		
+		names[timer.name]++;
+		schedule(slot);
+	}
+	
+	void remove(long slot) {
+		
+		const SCR_TIMER & timer = scr_timer[slot];
+		
+		Slot & s = slots[slot];
+		if(s.prev != -1) {
+			slots[s.prev].next = s.next;
+		} else {
+			EntityTimers::iterator it = entityTimers.find(timer.io);
+			arx_assert(it != entityTimers.end() && it->second == slot);
+			if(s.next != -1) {
+				it->second = s.next;
+			} else {
+				entityTimers.erase(it);
+			}
+		}
+		if(s.next != -1) {
+			slots[s.next].prev = s.prev;
+		}
+		s.prev = s.next = -1;
+		s.generation++;
+		
+		NameCounts::iterator name = names.find(timer.name);
+		arx_assert(name != names.end());
+		if(!--name->second) {
+			names.erase(name);
+		}
+	}
+	
+	//! Queues the next expiration after tim or msecs have changed
+	void schedule(long slot) {
+		slots[slot].generation++;
+		if(heap.size() >= 2 * size_t(ActiveTimers) + 64) {
+			compact();
+		} else {
+			push(slot);
+		}
+	}
+	
+	/*!
+	 * Removes all expirations up to and including now from the heap.
+	 * Due timers are returned in slot order. They must each be rescheduled or cleared.
+	 */
+	void popDue(unsigned long now, std::vector<Expiration> & due) {
+		while(!heap.empty() && heap.front().time <= now) {
+			std::pop_heap(heap.begin(), heap.end());
+			if(isCurrent(heap.back())) {
+				due.push_back(heap.back());
+			}
+			heap.pop_back();
+		}
+		std::sort(due.begin(), due.end(), compareSlots);
+	}
+	
+	//! @return false if the timer has been cleared or rescheduled since the expiration
+	bool isCurrent(const Expiration & expiration) const {
+		return scr_timer[expiration.slot].exist
+		       && slots[expiration.slot].generation == expiration.generation;
+	}
+	
+	bool hasName(const std::string & name) const {
+		return names.find(name) != names.end();
+	}
+	
+	//! @return the first timer slot of an entity, or -1
+	long first(const Entity * io) const {
+		EntityTimers::const_iterator it = entityTimers.find(io);
+		return (it == entityTimers.end()) ? -1 : it->second;
+	}
+	
+	//! @return the next timer slot of the same entity, or -1
+	long next(long slot) const {
+		return slots[slot].next;
+	}
+	
+	static bool compareSlots(const Expiration & a, const Expiration & b) {
+		return a.slot < b.slot;
+	}
+	
+};
+
+TimerIndex timerIndex;
+
+} // anonymous namespace
+
+//! Checks if timer named texx exists.
+static bool ARX_SCRIPT_Timer_Exist(const std::string & texx) {
+	return timerIndex.hasName(texx);
 }
 
 string ARX_SCRIPT_Timer_GetDefaultName() {
@@ -1758,6 +2019,19 @@ long ARX_SCRIPT_Timer_GetFree() {
 	return -1;
 }
 
+void ARX_SCRIPT_Timer_Activate(long num) {
+	arx_assert(num >= 0 && num < MAX_TIMER_SCRIPT && !scr_timer[num].exist);
+	scr_timer[num].exist = 1;
+	ActiveTimers++;
+	timerIndex.add(num);
+}
+
+void ARX_SCRIPT_Timer_Reschedule(long num) {
+	if(scr_timer[num].exist) {
+		timerIndex.schedule(num);
+	}
+}
+
 //*************************************************************************************
 // Count the number of active script timers...
 //*************************************************************************************
@@ -1771,6 +2045,7 @@ long ARX_SCRIPT_CountTimers() {
 //*************************************************************************************
 void ARX_SCRIPT_Timer_ClearByNum(long timer_idx) {
 	if(scr_timer[timer_idx].exist) {
+		timerIndex.remove(timer_idx);
 		scr_timer[timer_idx].name.clear();
 		ActiveTimers--;
 		scr_timer[timer_idx].exist = 0;
@@ -1778,34 +2053,30 @@ void ARX_SCRIPT_Timer_ClearByNum(long timer_idx) {
 }
 
 void ARX_SCRIPT_Timer_Clear_By_Name_And_IO(const string & timername, Entity * io) {
-	for(long i = 0; i < MAX_TIMER_SCRIPT; i++) {
-		if(scr_timer[i].exist && scr_timer[i].io == io && scr_timer[i].name == timername) {
+	for(long i = timerIndex.first(io); i != -1; ) {
+		long next = timerIndex.next(i);
+		if(scr_timer[i].name == timername) {
 			ARX_SCRIPT_Timer_ClearByNum(i);
 		}
+		i = next;
 	}
 }
 
-void ARX_SCRIPT_Timer_Clear_All_Locals_For_IO(Entity * io)
-{
-	for (long i = 0; i < MAX_TIMER_SCRIPT; i++)
-	{
-		if (scr_timer[i].exist)
-		{
-			if ((scr_timer[i].io == io) && (scr_timer[i].es == &io->over_script))
-				ARX_SCRIPT_Timer_ClearByNum(i);
+void ARX_SCRIPT_Timer_Clear_All_Locals_For_IO(Entity * io) {
+	for(long i = timerIndex.first(io); i != -1; ) {
+		long next = timerIndex.next(i);
+		if(scr_timer[i].es == &io->over_script) {
+			ARX_SCRIPT_Timer_ClearByNum(i);
 		}
+		i = next;
 	}
 }
 
-void ARX_SCRIPT_Timer_Clear_By_IO(Entity * io)
-{
-	for (long i = 0; i < MAX_TIMER_SCRIPT; i++)
-	{
-		if (scr_timer[i].exist)
-		{
-			if (scr_timer[i].io == io)
-				ARX_SCRIPT_Timer_ClearByNum(i);
-		}
+void ARX_SCRIPT_Timer_Clear_By_IO(Entity * io) {
+	for(long i = timerIndex.first(io); i != -1; ) {
+		long next = timerIndex.next(i);
+		ARX_SCRIPT_Timer_ClearByNum(i);
+		i = next;
 	}
 }
 
@@ -1822,6 +2093,7 @@ void ARX_SCRIPT_Timer_FirstInit(long number)
 	delete[] scr_timer;
 	scr_timer = new SCR_TIMER[MAX_TIMER_SCRIPT];
 	ActiveTimers = 0;
+	timerIndex.init(MAX_TIMER_SCRIPT);
 }
 
 void ARX_SCRIPT_Timer_ClearAll()
@@ -1831,26 +2103,18 @@ void ARX_SCRIPT_Timer_ClearAll()
 			ARX_SCRIPT_Timer_ClearByNum(i);
 
 	ActiveTimers = 0;
+	timerIndex.clear();
 }
 
-void ARX_SCRIPT_Timer_Clear_For_IO(Entity * io)
-{
-	for (long i = 0; i < MAX_TIMER_SCRIPT; i++)
-	{
-		if (scr_timer[i].exist)
-		{
-			if (scr_timer[i].io == io) ARX_SCRIPT_Timer_ClearByNum(i);
-		}
-	}
+void ARX_SCRIPT_Timer_Clear_For_IO(Entity * io) {
+	ARX_SCRIPT_Timer_Clear_By_IO(io);
 }
 
 long ARX_SCRIPT_GetSystemIOScript(Entity * io, const std::string & name) {
 	
-	if(ActiveTimers) {
-		for(long i = 0; i < MAX_TIMER_SCRIPT; i++) {
-			if(scr_timer[i].exist && scr_timer[i].io == io && scr_timer[i].name == name) {
-				return i;
-			}
+	for(long i = timerIndex.first(io); i != -1; i = timerIndex.next(i)) {
+		if(scr_timer[i].name == name) {
+			return i;
 		}
 	}
 	
@@ -1904,23 +2168,27 @@ long Manage_Specific_RAT_Timer(SCR_TIMER * st)
 
 void ARX_SCRIPT_Timer_Check() {
 	
+	ARX_PROFILE_FUNC();
+	
 	if(!ActiveTimers) {
 		return;
 	}
 	
-	for(long i = 0; i < MAX_TIMER_SCRIPT; i++) {
+	unsigned long now = static_cast<unsigned long>(arxtime);
+	
+	static std::vector<TimerIndex::Expiration> due;
+	due.clear();
+	timerIndex.popDue(now, due);
+	
+	for(size_t j = 0; j < due.size(); j++) {
 		
-		SCR_TIMER * st = &scr_timer[i];
-		if(!st->exist) {
+		// Earlier events may have cleared or replaced this timer
+		if(!timerIndex.isCurrent(due[j])) {
 			continue;
 		}
 		
-		unsigned long now = static_cast<unsigned long>(arxtime);
-		unsigned long fire_time = st->tim + st->msecs;
-		if(fire_time > now) {
-			// Timer not ready to fire yet
-			continue;
-		}
+		long i = due[j].slot;
+		SCR_TIMER * st = &scr_timer[i];
 		
 		// Skip heartbeat timer events for far away objects
 		if((st->flags & 1) && !(st->io->gameFlags & GFLAG_ISINTREATZONE)) {
@@ -1928,6 +2196,7 @@ void ARX_SCRIPT_Timer_Check() {
 			st->tim += st->msecs * increment;
 			arx_assert_msg(st->tim <= now && st->tim + st->msecs > now,
 			               "start=%lu wait=%ld now=%lu", st->tim, st->msecs, now);
+			timerIndex.schedule(i);
 			continue;
 		}
 		
@@ -1937,6 +2206,7 @@ void ARX_SCRIPT_Timer_Check() {
 		
 		if(!es && st->name == "_r_a_t_") {
 			if(Manage_Specific_RAT_Timer(st)) {
+				timerIndex.schedule(i);
 				continue;
 			}
 		}
@@ -1948,6 +2218,7 @@ void ARX_SCRIPT_Timer_Check() {
 				st->times--;
 			}
 			st->tim += st->msecs;
+			timerIndex.schedule(i);
 		}
 		
 		if(es && ValidIOAddress(io)) {
@@ -419,6 +419,10 @@ void ARX_SCRIPT_Timer_ClearAll();
 void ARX_SCRIPT_Timer_Clear_For_IO(Entity * io);
 void ARX_SCRIPT_Timer_Clear_By_IO(Entity * io);
 long ARX_SCRIPT_Timer_GetFree();
+//! Starts a timer slot from ARX_SCRIPT_Timer_GetFree() once its fields have been filled in
+void ARX_SCRIPT_Timer_Activate(long num);
+//! Must be called after changing tim or msecs of an active timer
+void ARX_SCRIPT_Timer_Reschedule(long num);
  
 void ARX_SCRIPT_SetMainEvent(Entity * io, const std::string & newevent);
 void ARX_SCRIPT_EventStackExecute();
@@ -434,6 +438,8 @@ long ARX_SCRIPT_CountTimers();
 void ARX_SCRIPT_Timer_ClearByNum(long num);
 void ARX_SCRIPT_ResetAll(long flags);
 void ARX_SCRIPT_EventStackClearForIo(Entity * io);
+//! @return the number of stacked events waiting to be sent
+long ARX_SCRIPT_EventStackCount();
 Entity * ARX_SCRIPT_Get_IO_Max_Events();
 Entity * ARX_SCRIPT_Get_IO_Max_Events_Sent();
 
@@ -51,6 +51,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 
 #include "io/log/Logger.h"
 
+#include "script/ScriptProfiler.h"
 #include "script/ScriptUtils.h"
 #include "script/ScriptedAnimation.h"
 #include "script/ScriptedCamera.h"
@@ -362,6 +363,14 @@ ScriptResult ScriptEvent::send(EERIE_SCRIPT * es, ScriptMessage msg, const std::
 	         << " io=" << (io ? io->long_name() : "unknown")
 	         << (io == NULL ? "" : es == &io->script ? " base" : " overriding")
 	         << " pos=" << pos);
+	
+	ScriptProfiler::Event profile;
+	if(ScriptProfiler::isEnabled()) {
+		profile.begin(io, es, !evname.empty() ? evname
+		              : (msg == SM_EXECUTELINE) ? string("executeline")
+		              : ((size_t)msg < ARRAY_SIZE(AS_EVENT) - 1) ? AS_EVENT[msg].name.substr(3)
+		              : string("(none)"));
+	}
 
 	MakeSSEPARAMS(params.c_str());
 
@@ -416,6 +425,7 @@ ScriptResult ScriptEvent::send(EERIE_SCRIPT * es, ScriptMessage msg, const std::
 				context.skipCommand();
 				res = script::Command::Failed;
 			} else {
+				ScriptProfiler::Command commandProfile(command.getName());
 				res = it->second->execute(context);
 			}
 			
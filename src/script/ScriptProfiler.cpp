@@ -0,0 +1,162 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "script/ScriptProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include <boost/foreach.hpp>
+
+#include "game/Entity.h"
+#include "io/log/Logger.h"
+
+using std::string;
+
+struct ScriptProfiler::EventStats {
+	
+	Stats total;
+	
+	typedef std::map<string, Stats> Commands;
+	Commands commands;
+	
+};
+
+namespace {
+
+typedef std::map<std::pair<string, string>, ScriptProfiler::EventStats *> Events;
+Events g_events;
+
+bool compareTime(const ScriptProfiler::Entry & a, const ScriptProfiler::Entry & b) {
+	return a.stats.time > b.stats.time;
+}
+
+} // anonymous namespace
+
+bool ScriptProfiler::enabled = false;
+ScriptProfiler::EventStats * ScriptProfiler::current = NULL;
+
+void ScriptProfiler::setEnabled(bool enable) {
+	
+	arx_assert(current == NULL);
+	
+	if(enable && !enabled) {
+		BOOST_FOREACH(const Events::value_type & event, g_events) {
+			delete event.second;
+		}
+		g_events.clear();
+	}
+	
+	enabled = enable;
+}
+
+void ScriptProfiler::Event::begin(const Entity * io, const EERIE_SCRIPT * es,
+                                  const string & event) {
+	
+	arx_assert(enabled);
+	
+	string script;
+	if(!io) {
+		script = "(none)";
+	} else if(es == &io->script) {
+		script = io->short_name();
+	} else {
+		// Overriding scripts belong to a single entity
+		script = io->long_name();
+	}
+	
+	EventStats * & entry = g_events[std::make_pair(script, event)];
+	if(!entry) {
+		entry = new EventStats;
+	}
+	
+	stats = entry;
+	parent = current;
+	current = stats;
+	start = Time::getUs();
+}
+
+ScriptProfiler::Event::~Event() {
+	
+	if(!start) {
+		return;
+	}
+	
+	stats->total.calls++;
+	stats->total.time += Time::getUs() - start;
+	
+	current = parent;
+}
+
+void ScriptProfiler::record(const string & command, u64 time) {
+	
+	if(!current) {
+		return;
+	}
+	
+	Stats & stats = current->commands[command];
+	stats.calls++;
+	stats.time += time;
+}
+
+void ScriptProfiler::getTop(std::vector<Entry> & entries, size_t count) {
+	
+	entries.clear();
+	
+	BOOST_FOREACH(const Events::value_type & event, g_events) {
+		
+		Entry entry;
+		entry.script = event.first.first;
+		entry.event = event.first.second;
+		entry.stats = event.second->total;
+		entries.push_back(entry);
+		
+		BOOST_FOREACH(const EventStats::Commands::value_type & command, event.second->commands) {
+			entry.command = command.first;
+			entry.stats = command.second;
+			entries.push_back(entry);
+		}
+	}
+	
+	count = std::min(count, entries.size());
+	std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), compareTime);
+	entries.resize(count);
+}
+
+void ScriptProfiler::dump() {
+	
+	std::vector<Entry> entries;
+	getTop(entries, size_t(-1));
+	
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(3);
+	BOOST_FOREACH(const Entry & entry, entries) {
+		oss << '\n' << std::setw(10) << (entry.stats.time / 1000.0) << " ms "
+		    << std::setw(8) << entry.stats.calls << "x  "
+		    << entry.script << " on " << entry.event;
+		if(!entry.command.empty()) {
+			oss << ": " << entry.command;
+		}
+	}
+	
+	LogInfo << "Script profile (" << (enabled ? "running" : "stopped") << "):" << oss.str();
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_SCRIPT_SCRIPTPROFILER_H
+#define ARX_SCRIPT_SCRIPTPROFILER_H
+
+#include <string>
+#include <vector>
+
+#include "platform/Platform.h"
+#include "platform/Time.h"
+
+class Entity;
+struct EERIE_SCRIPT;
+
+/*!
+ * Collects wall time and call counts per script, event and command.
+ * Times are inclusive: an event sent from a command counts towards both.
+ */
+class ScriptProfiler {
+	
+public:
+	
+	struct EventStats;
+	
+	struct Stats {
+		
+		size_t calls;
+		u64 time; //!< Total time in microseconds
+		
+		Stats() : calls(0), time(0) { }
+		
+	};
+	
+	struct Entry {
+		
+		std::string script;
+		std::string event;
+		std::string command; //!< Empty for the event as a whole
+		
+		Stats stats;
+		
+	};
+	
+	static bool isEnabled() { return enabled; }
+	
+	//! Start or stop collecting statistics. Enabling resets the collected statistics.
+	static void setEnabled(bool enable);
+	
+	/*!
+	 * Get the events and commands that took the most time.
+	 * @param entries Receives at most count entries, sorted by descending time.
+	 */
+	static void getTop(std::vector<Entry> & entries, size_t count);
+	
+	//! Write all collected statistics to the log.
+	static void dump();
+	
+	//! Attribute the time until destruction to a script event.
+	class Event {
+		
+		u64 start;
+		EventStats * stats;
+		EventStats * parent;
+		
+	public:
+		
+		Event() : start(0), stats(NULL), parent(NULL) { }
+		
+		//! Only call this while the profiler is enabled.
+		void begin(const Entity * io, const EERIE_SCRIPT * es, const std::string & event);
+		
+		~Event();
+		
+	};
+	
+	//! Attribute the time until destruction to a command in the current event.
+	class Command {
+		
+		const std::string & name;
+		const u64 start;
+		
+	public:
+		
+		explicit Command(const std::string & _name)
+			: name(_name), start(enabled ? Time::getUs() : 0) { }
+		
+		~Command() {
+			if(start) {
+				record(name, Time::getUs() - start);
+			}
+		}
+		
+	};
+	
+private:
+	
+	static void record(const std::string & command, u64 time);
+	
+	static bool enabled;
+	
+	//! Innermost event being profiled
+	static EventStats * current;
+	
+};
+
+#endif // ARX_SCRIPT_SCRIPTPROFILER_H
@@ -51,6 +51,7 @@ ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
 #include "gui/MiniMap.h"
 #include "scene/GameSound.h"
 #include "script/ScriptEvent.h"
+#include "script/ScriptProfiler.h"
 #include "script/ScriptUtils.h"
 
 using std::string;
@@ -221,6 +222,25 @@ public:
 	
 };
 
+class ShowProfileCommand : public Command {
+	
+public:
+	
+	ShowProfileCommand() : Command("showprofile") { }
+	
+	Result execute(Context & context) {
+		
+		ARX_UNUSED(context);
+		
+		DebugScript("");
+		
+		ScriptProfiler::dump();
+		
+		return Success;
+	}
+	
+};
+
 class PlayerInterfaceCommand : public Command {
 	
 public:
@@ -382,6 +402,7 @@ void setupScriptedInterface() {
 	ScriptEvent::registerCommand(new ShowGlobalsCommand);
 	ScriptEvent::registerCommand(new ShowLocalsCommand);
 	ScriptEvent::registerCommand(new ShowVarsCommand);
+	ScriptEvent::registerCommand(new ShowProfileCommand);
 	ScriptEvent::registerCommand(new PlayerInterfaceCommand);
 	ScriptEvent::registerCommand(new PopupCommand);
 	ScriptEvent::registerCommand(new EndIntroCommand);
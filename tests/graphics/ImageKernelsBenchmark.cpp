@@ -0,0 +1,109 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compare the scalar and SIMD image kernels on representative texture sizes.
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include "graphics/image/ImageKernels.h"
+
+namespace {
+
+const unsigned SIZES[] = { 256, 512 };
+
+const int ITERATIONS = 20;
+
+std::vector<u8> makeImage(unsigned size, unsigned channels) {
+	std::vector<u8> data(size_t(size) * size * channels);
+	for(size_t i = 0; i < data.size(); i++) {
+		// Leave some black pixels for the color key
+		data[i] = (i % 61 < 3) ? 0 : u8(std::rand());
+	}
+	return data;
+}
+
+double elapsedMs(std::clock_t start) {
+	return double(std::clock() - start) * 1000.0 / CLOCKS_PER_SEC / ITERATIONS;
+}
+
+void benchmark(image::KernelSet kernels, unsigned size) {
+	
+	if(!image::setKernels(kernels)) {
+		return;
+	}
+	
+	const u8 key[3] = { 0, 0, 0 };
+	
+	std::vector<u8> rgb = makeImage(size, 3);
+	std::vector<u8> rgba = makeImage(size, 4);
+	std::vector<u8> dst(size_t(size) * size * 4);
+	
+	std::printf("%-6s %ux%u:", image::getKernelsName(kernels), size, size);
+	
+	std::clock_t start = std::clock();
+	for(int i = 0; i < ITERATIONS; i++) {
+		image::applyColorKey(&rgb[0], &dst[0], size, size, key);
+	}
+	std::printf("  colorkey %6.3f ms", elapsedMs(start));
+	
+	start = std::clock();
+	for(int i = 0; i < ITERATIONS; i++) {
+		std::vector<u8> data = rgba;
+		image::quakeGamma(&data[0], size_t(size) * size, 4, 1.6f);
+	}
+	std::printf("  gamma %6.3f ms", elapsedMs(start));
+	
+	start = std::clock();
+	for(int i = 0; i < ITERATIONS; i++) {
+		image::downScale(&rgba[0], size, &dst[0], size / 2, size / 2, 4);
+	}
+	std::printf("  downscale %6.3f ms", elapsedMs(start));
+	
+	start = std::clock();
+	for(int i = 0; i < ITERATIONS; i++) {
+		image::resize(&rgb[0], size, size, &dst[0], size * 3 / 4, size * 3 / 4, true);
+	}
+	std::printf("  resize %6.3f ms", elapsedMs(start));
+	
+	start = std::clock();
+	for(int i = 0; i < ITERATIONS; i++) {
+		std::vector<u8> data = rgba;
+		image::blur(&data[0], size, size, 4, 5);
+	}
+	std::printf("  blur %6.3f ms\n", elapsedMs(start));
+}
+
+} // anonymous namespace
+
+int main() {
+	
+	image::KernelSet best = image::getBestKernels();
+	
+	for(size_t i = 0; i < sizeof(SIZES) / sizeof(*SIZES); i++) {
+		benchmark(image::ScalarKernels, SIZES[i]);
+		if(best != image::ScalarKernels) {
+			benchmark(best, SIZES[i]);
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
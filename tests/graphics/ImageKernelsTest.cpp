@@ -0,0 +1,207 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImageKernelsTest.h"
+
+#include <algorithm>
+
+#include <cppunit/TestAssert.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ImageKernelsTest);
+
+namespace {
+
+const u8 KEY[3] = { 0, 0, 0 };
+
+//! Sizes to test, including ones that are not a multiple of the SIMD width
+const unsigned SIZES[][2] = {
+	{ 1, 1 }, { 3, 5 }, { 17, 9 }, { 32, 32 }, { 61, 47 }, { 256, 128 }
+};
+const size_t NUM_SIZES = sizeof(SIZES) / sizeof(*SIZES);
+
+} // anonymous namespace
+
+std::vector<u8> ImageKernelsTest::makeImage(unsigned width, unsigned height, unsigned channels) {
+	
+	std::vector<u8> data(size_t(width) * height * channels);
+	
+	u32 seed = width * 7919 + height * 104729 + channels;
+	for(size_t i = 0; i < data.size(); i += channels) {
+		seed = seed * 1103515245 + 12345;
+		if(((seed >> 16) & 7) == 0) {
+			// Make runs of color-keyed pixels
+			for(unsigned c = 0; c < channels; c++) {
+				data[i + c] = KEY[c % 3];
+			}
+		} else {
+			for(unsigned c = 0; c < channels; c++) {
+				seed = seed * 1103515245 + 12345;
+				data[i + c] = u8(seed >> 16);
+			}
+		}
+	}
+	
+	return data;
+}
+
+void ImageKernelsTest::setUp() {
+	kernels = image::getBestKernels();
+}
+
+void ImageKernelsTest::tearDown() {
+	image::setKernels(image::getBestKernels());
+}
+
+void ImageKernelsTest::colorKey() {
+	
+	for(size_t i = 0; i < NUM_SIZES; i++) {
+		
+		unsigned w = SIZES[i][0], h = SIZES[i][1];
+		std::vector<u8> src = makeImage(w, h, 3);
+		std::vector<u8> expected(size_t(w) * h * 4), result(size_t(w) * h * 4);
+		
+		image::setKernels(image::ScalarKernels);
+		bool expectedFound = image::findColorKey(&src[0], size_t(w) * h, KEY);
+		image::applyColorKey(&src[0], &expected[0], w, h, KEY);
+		
+		image::setKernels(kernels);
+		bool found = image::findColorKey(&src[0], size_t(w) * h, KEY);
+		image::applyColorKey(&src[0], &result[0], w, h, KEY);
+		
+		CPPUNIT_ASSERT_EQUAL(expectedFound, found);
+		CPPUNIT_ASSERT(expected == result);
+	}
+}
+
+void ImageKernelsTest::quakeGamma() {
+	
+	const float gammas[] = { 0.5f, 1.6f, 10.f };
+	
+	for(unsigned channels = 1; channels <= 4; channels++) {
+		for(size_t g = 0; g < sizeof(gammas) / sizeof(*gammas); g++) {
+			for(size_t i = 0; i < NUM_SIZES; i++) {
+				
+				unsigned w = SIZES[i][0], h = SIZES[i][1];
+				std::vector<u8> expected = makeImage(w, h, channels);
+				std::vector<u8> result = expected;
+				
+				image::setKernels(image::ScalarKernels);
+				image::quakeGamma(&expected[0], size_t(w) * h, channels, gammas[g]);
+				
+				image::setKernels(kernels);
+				image::quakeGamma(&result[0], size_t(w) * h, channels, gammas[g]);
+				
+				CPPUNIT_ASSERT(expected == result);
+			}
+		}
+	}
+}
+
+void ImageKernelsTest::adjustGamma() {
+	
+	std::vector<u8> data(256);
+	for(size_t i = 0; i < data.size(); i++) {
+		data[i] = u8(i);
+	}
+	
+	image::adjustGamma(&data[0], data.size(), 0.5f);
+	
+	CPPUNIT_ASSERT_EQUAL(0, int(data[0]));
+	CPPUNIT_ASSERT_EQUAL(255, int(data[255]));
+	for(size_t i = 1; i < data.size(); i++) {
+		CPPUNIT_ASSERT(data[i] >= data[i - 1]);
+	}
+}
+
+void ImageKernelsTest::downScale() {
+	
+	for(unsigned channels = 1; channels <= 4; channels++) {
+		for(size_t i = 0; i < NUM_SIZES; i++) {
+			
+			unsigned w = SIZES[i][0], h = SIZES[i][1];
+			unsigned dw = w / 2, dh = h / 2;
+			if(!dw || !dh) {
+				continue;
+			}
+			
+			std::vector<u8> src = makeImage(w, h, channels);
+			std::vector<u8> expected(size_t(dw) * dh * channels), result(expected.size());
+			
+			image::setKernels(image::ScalarKernels);
+			image::downScale(&src[0], w, &expected[0], dw, dh, channels);
+			
+			image::setKernels(kernels);
+			image::downScale(&src[0], w, &result[0], dw, dh, channels);
+			
+			CPPUNIT_ASSERT(expected == result);
+		}
+	}
+}
+
+void ImageKernelsTest::resize() {
+	
+	for(size_t i = 0; i < NUM_SIZES; i++) {
+		for(size_t j = 0; j < NUM_SIZES; j++) {
+			
+			unsigned w = SIZES[i][0], h = SIZES[i][1];
+			unsigned dw = SIZES[j][0], dh = SIZES[j][1];
+			
+			std::vector<u8> src = makeImage(w, h, 3);
+			std::vector<u8> expected(size_t(dw) * dh * 3), result(expected.size());
+			
+			image::setKernels(image::ScalarKernels);
+			image::resize(&src[0], w, h, &expected[0], dw, dh, false);
+			
+			image::setKernels(kernels);
+			image::resize(&src[0], w, h, &result[0], dw, dh, false);
+			CPPUNIT_ASSERT(expected == result);
+			
+			// Flipping must only change the row order
+			image::resize(&src[0], w, h, &result[0], dw, dh, true);
+			for(unsigned y = 0; y < dh; y++) {
+				CPPUNIT_ASSERT(std::equal(&expected[y * dw * 3], &expected[(y + 1) * dw * 3],
+				                          &result[(dh - 1 - y) * dw * 3]));
+			}
+		}
+	}
+}
+
+void ImageKernelsTest::blur() {
+	
+	const int radii[] = { 1, 2, 5, 12 };
+	
+	for(unsigned channels = 1; channels <= 4; channels++) {
+		for(size_t r = 0; r < sizeof(radii) / sizeof(*radii); r++) {
+			for(size_t i = 0; i < NUM_SIZES; i++) {
+				
+				unsigned w = SIZES[i][0], h = SIZES[i][1];
+				std::vector<u8> expected = makeImage(w, h, channels);
+				std::vector<u8> result = expected;
+				
+				image::setKernels(image::ScalarKernels);
+				image::blur(&expected[0], w, h, channels, radii[r]);
+				
+				image::setKernels(kernels);
+				image::blur(&result[0], w, h, channels, radii[r]);
+				
+				CPPUNIT_ASSERT(expected == result);
+			}
+		}
+	}
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_GRAPHICS_IMAGEKERNELSTEST_H
+#define ARX_GRAPHICS_IMAGEKERNELSTEST_H
+
+#include <vector>
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "graphics/image/ImageKernels.h"
+
+/*!
+ * Check that the SIMD image kernels produce exactly the same results
+ * as the scalar reference implementations.
+ */
+class ImageKernelsTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(ImageKernelsTest);
+	CPPUNIT_TEST(colorKey);
+	CPPUNIT_TEST(quakeGamma);
+	CPPUNIT_TEST(adjustGamma);
+	CPPUNIT_TEST(downScale);
+	CPPUNIT_TEST(resize);
+	CPPUNIT_TEST(blur);
+	CPPUNIT_TEST_SUITE_END();
+	
+public:
+	
+	void setUp();
+	void tearDown();
+	
+	void colorKey();
+	void quakeGamma();
+	void adjustGamma();
+	void downScale();
+	void resize();
+	void blur();
+	
+private:
+	
+	image::KernelSet kernels;
+	
+	//! Fill a buffer with pseudo-random data, some pixels matching the color key
+	static std::vector<u8> makeImage(unsigned width, unsigned height, unsigned channels);
+	
+};
+
+#endif // ARX_GRAPHICS_IMAGEKERNELSTEST_H
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JobSystemTest.h"
+
+#include <vector>
+
+#include <cppunit/TestAssert.h>
+
+#include "platform/Atomic.h"
+#include "platform/Thread.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JobSystemTest);
+
+namespace {
+
+//! Number of worker threads to use, independent of the number of processors
+const int WORKERS = 3;
+
+//! Counts how many times each index has been visited
+struct VisitRange {
+	
+	std::vector<size_t> * visits;
+	
+	void operator()(size_t begin, size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			atomic::add((*visits)[i], 1);
+		}
+	}
+	
+};
+
+class CountJob : public jobs::Job {
+	
+public:
+	
+	volatile size_t * count;
+	
+	CountJob() : count(NULL) { }
+	
+	void run() {
+		atomic::add(*count, 1);
+	}
+	
+};
+
+//! Records whether all jobs of its dependency had finished before it started
+class CheckJob : public jobs::Job {
+	
+public:
+	
+	volatile size_t * count;
+	size_t expected;
+	volatile size_t * failures;
+	
+	CheckJob() : count(NULL), expected(0), failures(NULL) { }
+	
+	void run() {
+		if(atomic::load(*count) != expected) {
+			atomic::add(*failures, 1);
+		}
+	}
+	
+};
+
+//! Keeps a worker thread busy until released
+class BlockJob : public jobs::Job {
+	
+public:
+	
+	volatile size_t * started;
+	volatile size_t * released;
+	
+	BlockJob() : started(NULL), released(NULL) { }
+	
+	void run() {
+		atomic::add(*started, 1);
+		while(!atomic::load(*released)) {
+			Thread::sleep(1);
+		}
+	}
+	
+};
+
+void checkParallelFor(size_t count, size_t grain) {
+	
+	std::vector<size_t> visits(count, 0);
+	VisitRange body = { &visits };
+	jobs::parallelFor(0, count, body, grain);
+	
+	for(size_t i = 0; i < count; i++) {
+		CPPUNIT_ASSERT_EQUAL(size_t(1), visits[i]);
+	}
+}
+
+void checkSubmitAfter() {
+	
+	const size_t count = 64;
+	
+	volatile size_t done = 0;
+	volatile size_t failures = 0;
+	std::vector<CountJob> first(count);
+	std::vector<CheckJob> second(count);
+	
+	jobs::Counter firstDone;
+	jobs::Counter secondDone;
+	for(size_t i = 0; i < count; i++) {
+		first[i].count = &done;
+		jobs::submit(first[i], &firstDone);
+	}
+	for(size_t i = 0; i < count; i++) {
+		second[i].count = &done;
+		second[i].expected = count;
+		second[i].failures = &failures;
+		jobs::submitAfter(firstDone, second[i], &secondDone);
+	}
+	
+	jobs::wait(secondDone);
+	
+	CPPUNIT_ASSERT(firstDone.isDone());
+	CPPUNIT_ASSERT_EQUAL(count, size_t(done));
+	CPPUNIT_ASSERT_EQUAL(size_t(0), size_t(failures));
+}
+
+} // anonymous namespace
+
+void JobSystemTest::tearDown() {
+	jobs::shutdown();
+}
+
+void JobSystemTest::parallelFor() {
+	
+	jobs::init(WORKERS);
+	CPPUNIT_ASSERT_EQUAL(size_t(WORKERS), jobs::getWorkerCount());
+	
+	for(size_t count = 1; count < 1000; count = count * 3 + 1) {
+		checkParallelFor(count, 1);
+		checkParallelFor(count, 7);
+	}
+	
+	// Empty ranges must not call the body at all
+	checkParallelFor(0, 1);
+}
+
+void JobSystemTest::submitAfter() {
+	
+	jobs::init(WORKERS);
+	
+	for(size_t i = 0; i < 100; i++) {
+		checkSubmitAfter();
+	}
+}
+
+void JobSystemTest::inlineMode() {
+	
+	jobs::init(0);
+	CPPUNIT_ASSERT_EQUAL(size_t(0), jobs::getWorkerCount());
+	
+	// Without workers, jobs run on the submitting thread as soon as they can start
+	volatile size_t done = 0;
+	CountJob job;
+	job.count = &done;
+	jobs::Counter counter;
+	jobs::submit(job, &counter);
+	CPPUNIT_ASSERT(counter.isDone());
+	CPPUNIT_ASSERT_EQUAL(size_t(1), size_t(done));
+	
+	checkSubmitAfter();
+	checkParallelFor(1000, 1);
+}
+
+void JobSystemTest::dequeOverflow() {
+	
+	jobs::init(WORKERS);
+	
+	// Occupy all workers so that nobody steals from the deque while it is being filled
+	volatile size_t started = 0;
+	volatile size_t released = 0;
+	std::vector<BlockJob> blockers(WORKERS);
+	jobs::Counter blocked;
+	for(size_t i = 0; i < blockers.size(); i++) {
+		blockers[i].started = &started;
+		blockers[i].released = &released;
+		jobs::submit(blockers[i], &blocked);
+	}
+	while(atomic::load(started) != blockers.size()) {
+		Thread::sleep(1);
+	}
+	
+	// More jobs than fit into the submitting thread's deque, the rest use the shared queue
+	const size_t count = 5000;
+	
+	volatile size_t done = 0;
+	std::vector<CountJob> batch(count);
+	jobs::Counter counter;
+	for(size_t i = 0; i < count; i++) {
+		batch[i].count = &done;
+		jobs::submit(batch[i], &counter);
+	}
+	
+	atomic::store(released, 1);
+	jobs::wait(counter);
+	jobs::wait(blocked);
+	
+	CPPUNIT_ASSERT_EQUAL(count, size_t(done));
+}
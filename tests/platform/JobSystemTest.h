@@ -0,0 +1,51 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARX_PLATFORM_JOBSYSTEMTEST_H
+#define ARX_PLATFORM_JOBSYSTEMTEST_H
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "platform/JobSystem.h"
+
+/*!
+ * Check that the job system runs every submitted job exactly once
+ * and respects dependencies, with and without worker threads.
+ */
+class JobSystemTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(JobSystemTest);
+	CPPUNIT_TEST(parallelFor);
+	CPPUNIT_TEST(submitAfter);
+	CPPUNIT_TEST(inlineMode);
+	CPPUNIT_TEST(dequeOverflow);
+	CPPUNIT_TEST_SUITE_END();
+	
+public:
+	
+	void tearDown();
+	
+	void parallelFor();
+	void submitAfter();
+	void inlineMode();
+	void dequeOverflow();
+	
+};
+
+#endif // ARX_PLATFORM_JOBSYSTEMTEST_H
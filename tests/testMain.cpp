@@ -4,6 +4,7 @@
 
 #include "graphics/ColorTest.h"
 #include "graphics/GraphicsUtilityTest.h"
+#include "graphics/ImageKernelsTest.h"
 
 int main(int argc, char *argv[]) {
 	CppUnit::TextUi::TestRunner testRunner;
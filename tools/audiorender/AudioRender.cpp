@@ -0,0 +1,103 @@
+/*
+ * Copyright 2013 Arx Libertatis Team (see the AUTHORS file)
+ *
+ * This file is part of Arx Libertatis.
+ *
+ * Arx Libertatis is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Arx Libertatis is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Arx Libertatis.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "audio/Audio.h"
+#include "io/fs/FilePath.h"
+#include "io/fs/Filesystem.h"
+#include "io/log/Logger.h"
+#include "io/resource/PakReader.h"
+#include "io/resource/ResourcePath.h"
+#include "platform/Time.h"
+
+using std::string;
+
+/*!
+ * Render an ambiance with the software audio backend as fast as possible.
+ * This doubles as a benchmark for the audio mixer.
+ */
+int main(int argc, char ** argv) {
+	
+	Logger::initialize();
+	
+	if(argc < 5) {
+		printf("usage: arxaudiorender <ambiance> <seconds> <output.wav|-> <pakfile|dir> [<pakfile|dir>...]\n");
+		return 1;
+	}
+	
+	Time::init();
+	
+	resources = new PakReader;
+	for(int i = 4; i < argc; i++) {
+		fs::path path = argv[i];
+		bool added = fs::is_directory(path) ? resources->addFiles(path) : resources->addArchive(path);
+		if(!added) {
+			printf("error opening %s\n", argv[i]);
+			return 1;
+		}
+	}
+	
+	string output = argv[3];
+	if(audio::initOffline(output == "-" ? fs::path() : fs::path(output)) != audio::AAL_OK) {
+		printf("error initializing the audio system\n");
+		return 1;
+	}
+	
+	audio::setSamplePath("sfx");
+	audio::setAmbiancePath("sfx/ambiance");
+	audio::setEnvironmentPath("sfx/environment");
+	
+	audio::MixerId mixer = audio::createMixer();
+	audio::setMixerVolume(mixer, 1.f);
+	
+	res::path name = res::path::load(argv[1]).set_ext("amb");
+	audio::AmbianceId ambiance = audio::createAmbiance(name);
+	if(ambiance == audio::INVALID_ID) {
+		printf("error loading ambiance %s\n", name.string().c_str());
+		return 1;
+	}
+	
+	audio::Channel channel;
+	channel.mixer = mixer;
+	channel.flags = audio::FLAG_VOLUME;
+	channel.volume = 1.f;
+	audio::ambiancePlay(ambiance, channel, true);
+	
+	size_t duration = size_t(atof(argv[2]) * 1000.f);
+	
+	u64 start = Time::getUs();
+	audio::renderOffline(duration);
+	u64 elapsed = Time::getElapsedUs(start);
+	
+	printf("rendered %lu ms of audio in %lu ms", (unsigned long)duration,
+	       (unsigned long)(elapsed / 1000));
+	if(elapsed > 0) {
+		printf(" (%.1fx realtime)", double(duration) * 1000.0 / double(elapsed));
+	}
+	printf("\n");
+	
+	audio::clean();
+	
+	delete resources, resources = NULL;
+	
+	return 0;
+}